@@ -0,0 +1,39 @@
+// Matrix multiplication C += A * B of 256x256 matrices.
+
+#matmul_trait = {
+  indexing_maps = [
+    affine_map<(i, j, k) -> (i, k)>,
+    affine_map<(i, j, k) -> (k, j)>,
+    affine_map<(i, j, k) -> (i, j)>
+  ],
+  iterator_types = ["parallel", "parallel", "reduction"]
+}
+
+memref.global "private" @A : memref<256x256xf32> = dense<1.0>
+memref.global "private" @B : memref<256x256xf32> = dense<2.0>
+memref.global "private" @C : memref<256x256xf32> = dense<0.0>
+
+func.func @matmul_kernel(%A: memref<256x256xf32>, %B: memref<256x256xf32>,
+                         %C: memref<256x256xf32>) {
+  linalg.generic #matmul_trait
+    ins(%A, %B : memref<256x256xf32>, memref<256x256xf32>)
+   outs(%C : memref<256x256xf32>) {
+  ^bb0(%a: f32, %b: f32, %c: f32):
+    %0 = arith.mulf %a, %b : f32
+    %1 = arith.addf %c, %0 : f32
+    linalg.yield %1 : f32
+  }
+  func.return
+}
+
+// 2 * 256^3 flops, reads A and B and updates C: 3 * 256^2 * 4 bytes.
+func.func @matmul_256() attributes {
+  bench.flops = 33554432 : i64, bench.bytes = 786432 : i64
+} {
+  %A = memref.get_global @A : memref<256x256xf32>
+  %B = memref.get_global @B : memref<256x256xf32>
+  %C = memref.get_global @C : memref<256x256xf32>
+  func.call @matmul_kernel(%A, %B, %C)
+    : (memref<256x256xf32>, memref<256x256xf32>, memref<256x256xf32>) -> ()
+  func.return
+}
@@ -0,0 +1,36 @@
+// Row-wise sum of a 1024x1024 matrix.
+
+#row_sum_trait = {
+  indexing_maps = [
+    affine_map<(i, j) -> (i, j)>,
+    affine_map<(i, j) -> (i)>
+  ],
+  iterator_types = ["parallel", "reduction"]
+}
+
+memref.global "private" @input : memref<1024x1024xf32> = dense<1.0>
+memref.global "private" @output : memref<1024xf32> = dense<0.0>
+
+func.func @row_sum_kernel(%input: memref<1024x1024xf32>,
+                          %output: memref<1024xf32>) {
+  linalg.generic #row_sum_trait
+    ins(%input : memref<1024x1024xf32>)
+   outs(%output : memref<1024xf32>) {
+  ^bb0(%a: f32, %acc: f32):
+    %0 = arith.addf %acc, %a : f32
+    linalg.yield %0 : f32
+  }
+  func.return
+}
+
+// One addition per element, reads the input and updates the output:
+// (1024^2 + 1024) * 4 bytes.
+func.func @row_sum_1024() attributes {
+  bench.flops = 1048576 : i64, bench.bytes = 4198400 : i64
+} {
+  %input = memref.get_global @input : memref<1024x1024xf32>
+  %output = memref.get_global @output : memref<1024xf32>
+  func.call @row_sum_kernel(%input, %output)
+    : (memref<1024x1024xf32>, memref<1024xf32>) -> ()
+  func.return
+}
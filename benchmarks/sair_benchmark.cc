@@ -0,0 +1,156 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// sair-benchmark measures the performance of code generated from Linalg
+// kernels. Each input module is converted to Sair, lowered with the default
+// lowering decisions and JIT-compiled. Functions carrying `bench.flops` and
+// `bench.bytes` integer attributes are then timed and reported along with the
+// achieved floating-point and memory throughput. Benchmark functions take no
+// arguments and produce no results.
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/MemRef/Transforms/Passes.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/InitAllDialects.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LogicalResult.h"
+#include "sair_jit.h"
+#include "sair_registration.h"
+#include "transforms/default_lowering_attributes.h"
+#include "transforms/lowering.h"
+#include "transforms/sair_from_linalg.h"
+
+namespace {
+
+// A function to time and the amount of work it performs.
+struct Benchmark {
+  std::string name;
+  int64_t flops;
+  int64_t bytes;
+};
+
+// Converts Linalg operations in `module` to Sair and assigns default lowering
+// decisions.
+mlir::LogicalResult PrepareModule(mlir::ModuleOp module) {
+  mlir::PassManager pm(module.getContext(), mlir::ModuleOp::getOperationName(),
+                       mlir::OpPassManager::Nesting::Implicit);
+  pm.addNestedPass<mlir::func::FuncOp>(
+      sair::CreateLinalgToSairConversionPass());
+  pm.addNestedPass<mlir::func::FuncOp>(sair::CreateLowerMapReducePass());
+  sair::CreateDefaultLoweringAttributesPipeline(&pm);
+  // Kernels may operate on subviews.
+  pm.addPass(mlir::memref::createExpandStridedMetadataPass());
+  return pm.run(module);
+}
+
+// Collects functions of `module` annotated with the amount of work they do.
+llvm::SmallVector<Benchmark> CollectBenchmarks(mlir::ModuleOp module) {
+  llvm::SmallVector<Benchmark> benchmarks;
+  module.walk([&](mlir::func::FuncOp function) {
+    auto flops = function->getAttrOfType<mlir::IntegerAttr>("bench.flops");
+    auto bytes = function->getAttrOfType<mlir::IntegerAttr>("bench.bytes");
+    if (flops == nullptr || bytes == nullptr) return;
+    if (function.getNumArguments() != 0 || function.getNumResults() != 0) {
+      function.emitWarning() << "benchmark functions must not have arguments "
+                                "or results, skipping";
+      return;
+    }
+    benchmarks.push_back(
+        {function.getName().str(), flops.getInt(), bytes.getInt()});
+  });
+  return benchmarks;
+}
+
+// Runs the benchmarks of `input_filename`. Returns failure if the file cannot
+// be compiled or if a benchmark cannot be run.
+mlir::LogicalResult RunBenchmarks(llvm::StringRef input_filename,
+                                  int repetitions,
+                                  mlir::MLIRContext &context) {
+  mlir::OwningOpRef<mlir::ModuleOp> module =
+      mlir::parseSourceFile<mlir::ModuleOp>(input_filename, &context);
+  if (!module) return mlir::failure();
+  llvm::SmallVector<Benchmark> benchmarks = CollectBenchmarks(*module);
+  if (mlir::failed(PrepareModule(*module))) return mlir::failure();
+  std::unique_ptr<sair::CompiledSairModule> compiled =
+      sair::CompileSairModule(*module);
+  if (compiled == nullptr) return mlir::failure();
+
+  for (const Benchmark &benchmark : benchmarks) {
+    std::optional<double> time =
+        sair::TimeFunction(*compiled, benchmark.name, repetitions);
+    if (!time.has_value()) return mlir::failure();
+    llvm::outs() << llvm::left_justify(benchmark.name, 24)
+                 << llvm::format("%12.3f", *time * 1e3)
+                 << llvm::format("%12.3f", benchmark.flops / *time * 1e-9)
+                 << llvm::format("%12.3f", benchmark.bytes / *time * 1e-9)
+                 << "\n";
+  }
+  return mlir::success();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  llvm::cl::list<std::string> input_filenames(
+      llvm::cl::Positional, llvm::cl::desc("<input files>"),
+      llvm::cl::OneOrMore);
+  llvm::cl::opt<int> repetitions(
+      "repetitions", llvm::cl::desc("Number of timed runs of each benchmark"),
+      llvm::cl::init(10));
+
+  llvm::InitLLVM init(argc, argv);
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  mlir::registerMLIRContextCLOptions();
+  mlir::registerPassManagerCLOptions();
+  mlir::registerAsmPrinterCLOptions();
+  llvm::cl::ParseCommandLineOptions(argc, argv, "SAIR benchmark runner\n");
+
+  mlir::DialectRegistry registry;
+  mlir::registerAllDialects(registry);
+  sair::RegisterSairJitTranslations(registry);
+  sair::RegisterSairDialect(registry);
+  mlir::MLIRContext context(registry);
+
+  llvm::outs() << llvm::left_justify("benchmark", 24)
+               << llvm::right_justify("time (ms)", 12)
+               << llvm::right_justify("GFLOP/s", 12)
+               << llvm::right_justify("GB/s", 12) << "\n";
+  bool success = true;
+  for (const std::string &input_filename : input_filenames) {
+    if (mlir::failed(RunBenchmarks(input_filename, repetitions, context))) {
+      llvm::errs() << "failed to run benchmarks in " << input_filename << "\n";
+      success = false;
+    }
+  }
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
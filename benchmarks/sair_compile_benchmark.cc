@@ -0,0 +1,226 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// sair-compile-benchmark measures how the compilation time of Sair passes
+// scales with the size of programs. It generates synthetic programs made of a
+// chain of `sair.map` operations, periodically interrupted by `sair.fby`
+// cycles, and times each pass of the default lowering attributes and
+// Sair-to-loops pipelines for increasing program sizes. For each pass, it
+// reports the time spent for each size and the growth exponent observed between
+// the two largest sizes: 1 for linear passes, 2 for quadratic ones.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/InitAllDialects.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassInstrumentation.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LogicalResult.h"
+#include "sair_registration.h"
+#include "transforms/default_lowering_attributes.h"
+#include "transforms/lowering.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Generates the source of a function containing a Sair program with
+// `num_ops` compute operations over an 8x8 domain. Every `fby_period`
+// operations, the chain goes through a `sair.fby` cycle along the second
+// dimension so that the analyses must propagate information around loops.
+std::string GenerateProgram(int num_ops, int fby_period) {
+  std::string source;
+  llvm::raw_string_ostream os(source);
+  constexpr llvm::StringLiteral kShape =
+      "#sair.shape<d0:static_range<8> x d1:static_range<8>>";
+  constexpr llvm::StringLiteral kBody = R"({
+      ^bb0(%i: index, %j: index, %a: f32):
+        %s = arith.addf %a, %a : f32
+        sair.return %s : f32
+    })";
+
+  os << "func.func @generated(%arg0: memref<8x8xf32>, "
+        "%arg1: memref<8x8xf32>) {\n"
+     << "  sair.program {\n"
+     << "    %r = sair.static_range : !sair.static_range<8>\n"
+     << "    %in = sair.from_scalar %arg0 : !sair.value<(), memref<8x8xf32>>\n"
+     << "    %out = sair.from_scalar %arg1 : !sair.value<(), memref<8x8xf32>>\n"
+     << "    %v0 = sair.from_memref %in memref[d0:%r, d1:%r] "
+        "{buffer_name = \"in\"} : "
+     << kShape << ", memref<8x8xf32>\n";
+  for (int i = 0; i < num_ops; ++i) {
+    if (fby_period > 0 && i % fby_period == fby_period - 1) {
+      os << llvm::formatv(
+          "    %p{0} = sair.proj_last[d0:%r] of[d1:%r] %v{0}(d0, d1) : {1}, "
+          "f32\n"
+          "    %f{0} = sair.fby[d0:%r] %p{0}(d0) then[d1:%r] %v{2}(d0, d1) : "
+          "!sair.value<d0:static_range<8> x d1:static_range<8>, f32>\n"
+          "    %v{2} = sair.map[d0:%r, d1:%r] %f{0}(d0, d1) {3} : {1}, "
+          "(f32) -> f32\n",
+          i, kShape, i + 1, kBody);
+    } else {
+      os << llvm::formatv(
+          "    %v{0} = sair.map[d0:%r, d1:%r] %v{1}(d0, d1) {2} : {3}, "
+          "(f32) -> f32\n",
+          i + 1, i, kBody, kShape);
+    }
+  }
+  os << "    sair.to_memref %out memref[d0:%r, d1:%r] %v" << num_ops
+     << "(d0, d1) {buffer_name = \"out\"} : " << kShape << ", memref<8x8xf32>\n"
+     << "    sair.exit\n"
+     << "  }\n"
+     << "  func.return\n"
+     << "}\n";
+  return source;
+}
+
+// Accumulates the time spent in each pass, indexed by pass argument in order
+// of first execution.
+class PassTimer : public mlir::PassInstrumentation {
+ public:
+  explicit PassTimer(llvm::MapVector<std::string, double> &times)
+      : times_(times) {}
+
+  void runBeforePass(mlir::Pass *pass, mlir::Operation *op) override {
+    start_times_[pass] = Clock::now();
+  }
+  void runAfterPass(mlir::Pass *pass, mlir::Operation *op) override {
+    Record(pass);
+  }
+  void runAfterPassFailed(mlir::Pass *pass, mlir::Operation *op) override {
+    Record(pass);
+  }
+
+ private:
+  void Record(mlir::Pass *pass) {
+    std::chrono::duration<double> elapsed = Clock::now() - start_times_[pass];
+    // Pass adaptors have no argument and include the time of nested passes.
+    if (pass->getArgument().empty()) return;
+    times_[pass->getArgument().str()] += elapsed.count();
+  }
+
+  llvm::MapVector<std::string, double> &times_;
+  llvm::DenseMap<mlir::Pass *, Clock::time_point> start_times_;
+};
+
+// Compiles a generated program of size `num_ops` and records the time spent in
+// each pass in `times`.
+mlir::LogicalResult TimeProgram(int num_ops, int fby_period,
+                                mlir::MLIRContext &context,
+                                llvm::MapVector<std::string, double> &times) {
+  mlir::OwningOpRef<mlir::ModuleOp> module =
+      mlir::parseSourceString<mlir::ModuleOp>(
+          GenerateProgram(num_ops, fby_period), &context);
+  if (!module) return mlir::failure();
+
+  mlir::PassManager pm(&context, mlir::ModuleOp::getOperationName(),
+                       mlir::OpPassManager::Nesting::Implicit);
+  sair::CreateDefaultLoweringAttributesPipeline(&pm);
+  sair::CreateSairToLoopConversionPipeline(&pm);
+  pm.addInstrumentation(std::make_unique<PassTimer>(times));
+  return pm.run(*module);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  llvm::cl::list<int> sizes(
+      "sizes", llvm::cl::desc("Number of operations of generated programs"),
+      llvm::cl::CommaSeparated);
+  llvm::cl::opt<int> fby_period(
+      "fby-period",
+      llvm::cl::desc("Number of operations between sair.fby cycles, 0 to "
+                     "disable them"),
+      llvm::cl::init(4));
+  llvm::cl::list<std::string> passes(
+      "passes",
+      llvm::cl::desc("Only report the time of these passes, e.g. "
+                     "sair-materialize-buffers"),
+      llvm::cl::CommaSeparated);
+  llvm::cl::opt<bool> print_program(
+      "print-program",
+      llvm::cl::desc("Print the program generated for the first size and exit"),
+      llvm::cl::init(false));
+
+  llvm::InitLLVM init(argc, argv);
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "SAIR compile-time scaling benchmark\n");
+  llvm::SmallVector<int> program_sizes(sizes.begin(), sizes.end());
+  if (program_sizes.empty()) program_sizes = {250, 500, 1000, 2000};
+
+  if (print_program) {
+    llvm::outs() << GenerateProgram(program_sizes.front(), fby_period);
+    return EXIT_SUCCESS;
+  }
+
+  mlir::DialectRegistry registry;
+  mlir::registerAllDialects(registry);
+  sair::RegisterSairDialect(registry);
+  mlir::MLIRContext context(registry);
+  // Passes must not overlap for their timings to be meaningful.
+  context.disableMultithreading();
+
+  llvm::SmallVector<llvm::MapVector<std::string, double>> times(
+      program_sizes.size());
+  for (int i = 0, e = program_sizes.size(); i < e; ++i) {
+    if (mlir::failed(
+            TimeProgram(program_sizes[i], fby_period, context, times[i]))) {
+      llvm::errs() << "failed to compile a program of size " << program_sizes[i]
+                   << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  llvm::outs() << llvm::left_justify("pass (ms)", 40);
+  for (int size : program_sizes) {
+    llvm::outs() << llvm::right_justify(std::to_string(size), 12);
+  }
+  llvm::outs() << llvm::right_justify("exponent", 12) << "\n";
+  for (const auto &[pass, unused] : times.back()) {
+    if (!passes.empty() && llvm::find(passes, pass) == passes.end()) continue;
+    llvm::outs() << llvm::left_justify(pass, 40);
+    for (const auto &size_times : times) {
+      llvm::outs() << llvm::format("%12.2f", size_times.lookup(pass) * 1e3);
+    }
+    int e = program_sizes.size();
+    if (e < 2) {
+      llvm::outs() << "\n";
+      continue;
+    }
+    double last = times[e - 1].lookup(pass);
+    double previous = times[e - 2].lookup(pass);
+    double exponent = std::log(last / previous) /
+                      std::log(static_cast<double>(program_sizes[e - 1]) /
+                               program_sizes[e - 2]);
+    llvm::outs() << llvm::format("%12.2f", exponent) << "\n";
+  }
+  return EXIT_SUCCESS;
+}
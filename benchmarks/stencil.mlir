@@ -0,0 +1,55 @@
+// One-dimensional 3-point stencil out[i] = in[i] + in[i+1] + in[i+2] over
+// 2^20 points. Shifted accesses are expressed with subviews since Sair only
+// accepts permutations and projections as Linalg indexing maps.
+
+#stencil_trait = {
+  indexing_maps = [
+    affine_map<(i) -> (i)>,
+    affine_map<(i) -> (i)>,
+    affine_map<(i) -> (i)>,
+    affine_map<(i) -> (i)>
+  ],
+  iterator_types = ["parallel"]
+}
+
+memref.global "private" @input : memref<1048578xf32> = dense<1.0>
+memref.global "private" @output : memref<1048576xf32> = dense<0.0>
+
+func.func @stencil_kernel(
+    %in0: memref<1048576xf32, strided<[1]>>,
+    %in1: memref<1048576xf32, strided<[1], offset: 1>>,
+    %in2: memref<1048576xf32, strided<[1], offset: 2>>,
+    %out: memref<1048576xf32>) {
+  linalg.generic #stencil_trait
+    ins(%in0, %in1, %in2 : memref<1048576xf32, strided<[1]>>,
+                           memref<1048576xf32, strided<[1], offset: 1>>,
+                           memref<1048576xf32, strided<[1], offset: 2>>)
+   outs(%out : memref<1048576xf32>) {
+  ^bb0(%a: f32, %b: f32, %c: f32, %d: f32):
+    %0 = arith.addf %a, %b : f32
+    %1 = arith.addf %0, %c : f32
+    linalg.yield %1 : f32
+  }
+  func.return
+}
+
+// Two additions per point, reads the input once and writes the output:
+// (2^20 + 2 + 2^20) * 4 bytes.
+func.func @stencil_3pt() attributes {
+  bench.flops = 2097152 : i64, bench.bytes = 8388616 : i64
+} {
+  %input = memref.get_global @input : memref<1048578xf32>
+  %output = memref.get_global @output : memref<1048576xf32>
+  %in0 = memref.subview %input[0] [1048576] [1]
+    : memref<1048578xf32> to memref<1048576xf32, strided<[1]>>
+  %in1 = memref.subview %input[1] [1048576] [1]
+    : memref<1048578xf32> to memref<1048576xf32, strided<[1], offset: 1>>
+  %in2 = memref.subview %input[2] [1048576] [1]
+    : memref<1048578xf32> to memref<1048576xf32, strided<[1], offset: 2>>
+  func.call @stencil_kernel(%in0, %in1, %in2, %output)
+    : (memref<1048576xf32, strided<[1]>>,
+       memref<1048576xf32, strided<[1], offset: 1>>,
+       memref<1048576xf32, strided<[1], offset: 2>>,
+       memref<1048576xf32>) -> ()
+  func.return
+}
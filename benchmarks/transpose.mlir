@@ -0,0 +1,34 @@
+// Transposition of a 1024x1024 matrix.
+
+#transpose_trait = {
+  indexing_maps = [
+    affine_map<(i, j) -> (j, i)>,
+    affine_map<(i, j) -> (i, j)>
+  ],
+  iterator_types = ["parallel", "parallel"]
+}
+
+memref.global "private" @input : memref<1024x1024xf32> = dense<1.0>
+memref.global "private" @output : memref<1024x1024xf32> = dense<0.0>
+
+func.func @transpose_kernel(%input: memref<1024x1024xf32>,
+                            %output: memref<1024x1024xf32>) {
+  linalg.generic #transpose_trait
+    ins(%input : memref<1024x1024xf32>)
+   outs(%output : memref<1024x1024xf32>) {
+  ^bb0(%a: f32, %b: f32):
+    linalg.yield %a : f32
+  }
+  func.return
+}
+
+// No arithmetic, reads the input and writes the output: 2 * 1024^2 * 4 bytes.
+func.func @transpose_1024() attributes {
+  bench.flops = 0 : i64, bench.bytes = 8388608 : i64
+} {
+  %input = memref.get_global @input : memref<1024x1024xf32>
+  %output = memref.get_global @output : memref<1024x1024xf32>
+  func.call @transpose_kernel(%input, %output)
+    : (memref<1024x1024xf32>, memref<1024x1024xf32>) -> ()
+  func.return
+}
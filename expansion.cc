@@ -14,14 +14,27 @@
 
 #include "expansion.h"
 
+#include <optional>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/TypeSwitch.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/SymbolTable.h"
 #include "sair_dialect.h"
+#include "util.h"
 
 namespace sair {
 
 mlir::LogicalResult VerifyExpansionPatterns(SairProgramOp program) {
   auto *sair_dialect = static_cast<SairDialect *>(program->getDialect());
+  // Names of loops vectorized by the vector expansion pattern.
+  llvm::StringSet<> vector_loops;
   auto result = program.TryWalkComputeOpInstances(
       [&](const ComputeOpInstance &op) -> mlir::WalkResult {
         DecisionsAttr decisions = op.GetDecisions();
@@ -34,6 +47,31 @@ mlir::LogicalResult VerifyExpansionPatterns(SairProgramOp program) {
           return op.EmitError()
                  << "expansion pattern does not apply to the operation";
         }
+        if (pattern_name.getValue() == kVectorExpansionPattern) {
+          vector_loops.insert(
+              op.Loops().back().cast<LoopAttr>().name().getValue());
+        }
+        return mlir::success();
+      });
+  if (result.wasInterrupted()) return mlir::failure();
+  if (vector_loops.empty()) return mlir::success();
+
+  // Operations fused in a vector loop are vectorized along with it,
+  // independently of their own expansion pattern.
+  const ExpansionPattern *vector_pattern =
+      sair_dialect->GetExpansionPattern(kVectorExpansionPattern);
+  result = program.TryWalkComputeOpInstances(
+      [&](const ComputeOpInstance &op) -> mlir::WalkResult {
+        llvm::ArrayRef<mlir::Attribute> loops = op.Loops();
+        for (auto [i, attr] : llvm::enumerate(loops)) {
+          llvm::StringRef name = attr.cast<LoopAttr>().name().getValue();
+          if (!vector_loops.contains(name)) continue;
+          if (i + 1 != loops.size() ||
+              mlir::failed(vector_pattern->Match(op))) {
+            return op.EmitError() << "operation fused in vector loop " << name
+                                  << " cannot be vectorized";
+          }
+        }
         return mlir::success();
       });
   return mlir::failure(result.wasInterrupted());
@@ -121,7 +159,32 @@ llvm::SmallVector<mlir::Value> AllocExpansionPattern::Emit(
     SairAllocOp op, MapBodyBuilder &map_body, mlir::OpBuilder &builder) const {
   mlir::Value result = builder.create<mlir::memref::AllocOp>(
       op.getLoc(), op.MemType(), map_body.block_inputs(),
-      /*alignment=*/nullptr);
+      op.getAlignmentAttr());
+  return {result};
+}
+
+// Expansion pattern that implements a sair.alloc operation by memref.alloca.
+// The allocation is released when exiting the enclosing loop iteration or
+// function, so the alloc must not be paired with a sair.free.
+class AllocaExpansionPattern : public TypedExpansionPattern<SairAllocOp> {
+ public:
+  constexpr static llvm::StringRef kName = kAllocaExpansionPattern;
+
+  mlir::LogicalResult Match(SairAllocOp op) const override;
+
+  llvm::SmallVector<mlir::Value> Emit(SairAllocOp op, MapBodyBuilder &map_body,
+                                      mlir::OpBuilder &builder) const override;
+};
+
+mlir::LogicalResult AllocaExpansionPattern::Match(SairAllocOp op) const {
+  mlir::MemRefType type = op.MemType();
+  return mlir::success(type.getLayout().isIdentity() && type.hasStaticShape());
+}
+
+llvm::SmallVector<mlir::Value> AllocaExpansionPattern::Emit(
+    SairAllocOp op, MapBodyBuilder &map_body, mlir::OpBuilder &builder) const {
+  mlir::Value result = builder.create<mlir::memref::AllocaOp>(
+      op.getLoc(), op.MemType(), op.getAlignmentAttr());
   return {result};
 }
 
@@ -147,11 +210,13 @@ llvm::SmallVector<mlir::Value> FreeExpansionPattern::Emit(
 }
 
 // Insert code that computes memref access indices to `map_body`. `domain` is
-// the domain of the memory access operation and `layout` a mapping from domain
-// to memref dimensions.
+// the domain of the memory access operation, `layout` a mapping from domain
+// to memref dimensions and `domain_indices` the indices of the accessed point
+// of the domain.
 llvm::SmallVector<mlir::Value> LoadStoreIndices(
     mlir::Location loc, llvm::ArrayRef<ValueAccess> domain, MappingAttr layout,
-    MapBodyBuilder &map_body, mlir::OpBuilder &builder) {
+    mlir::ValueRange domain_indices, MapBodyBuilder &map_body,
+    mlir::OpBuilder &builder) {
   // The mapping from the old operation domain to the new operation domain is
   // the identity. As `GetRangeParameters` expects to find the inverse of
   // `layout` in the mapping, we express the identity as the composition of
@@ -166,7 +231,7 @@ llvm::SmallVector<mlir::Value> LoadStoreIndices(
   // index of the current dimension.
   llvm::SmallVector<mlir::Value> apply_args;
   apply_args.reserve(domain.size() + 1);
-  llvm::append_range(apply_args, map_body.indices());
+  llvm::append_range(apply_args, domain_indices);
   apply_args.push_back(nullptr);
 
   // Compute memref indices from domain indices. Normalize domain indices so
@@ -185,8 +250,27 @@ llvm::SmallVector<mlir::Value> LoadStoreIndices(
   return indices;
 }
 
+// Returns the domain dimension iterated on by the loop `prefetch` refers to in
+// the loop nest of `decisions`. Returns std::nullopt if the loop is not part of
+// the loop nest or does not iterate along a single dimension.
+std::optional<int> PrefetchDimension(DecisionsAttr decisions,
+                                     PrefetchAttr prefetch) {
+  if (decisions.loop_nest() == nullptr) return std::nullopt;
+  for (mlir::Attribute attr : decisions.loop_nest()) {
+    auto loop = attr.cast<LoopAttr>();
+    if (loop.name() != prefetch.loop()) continue;
+    auto dim_expr = loop.iter().dyn_cast<MappingDimExpr>();
+    if (dim_expr == nullptr) return std::nullopt;
+    return dim_expr.dimension();
+  }
+  return std::nullopt;
+}
+
 // Expansion pattern that implements a sair.load_from_memref operation by
-// memref.load
+// memref.load, optionally followed by a memref.prefetch of the element loaded
+// a given number of iterations ahead. Prefetching is a hint: it is skipped when
+// the prefetch loop does not iterate along a single dimension, as is the case
+// of stripe-tiled loops.
 class LoadExpansionPattern
     : public TypedExpansionPattern<SairLoadFromMemRefOp> {
  public:
@@ -208,9 +292,36 @@ llvm::SmallVector<mlir::Value> LoadExpansionPattern::Emit(
     mlir::OpBuilder &builder) const {
   llvm::SmallVector<mlir::Value> indices =
       LoadStoreIndices(op.getLoc(), op.DomainWithDependencies(), op.getLayout(),
-                       map_body, builder);
+                       map_body.indices(), map_body, builder);
   auto load = builder.create<mlir::memref::LoadOp>(
       op.getLoc(), map_body.block_input(0), indices);
+
+  PrefetchAttr prefetch = op.getPrefetchAttr();
+  if (prefetch == nullptr) return {load};
+  auto sair_op = cast<SairOp>(op.getOperation());
+  std::optional<int> dimension =
+      PrefetchDimension(sair_op.GetDecisions(0), prefetch);
+  // Only prefetch along loops that iterate on a single dimension.
+  if (!dimension.has_value()) return {load};
+  auto range = op.getDomain()[*dimension].getDefiningOp<RangeOp>();
+  // Prefetching is a hint, skip it if the step of the loop is unknown.
+  if (range == nullptr) return {load};
+
+  // Compute the indices of the point accessed `distance` iterations ahead.
+  // Prefetches do not fault, so the point may lie past the end of the domain.
+  llvm::SmallVector<mlir::Value> ahead_indices =
+      llvm::to_vector(map_body.indices());
+  auto d0 = mlir::getAffineDimExpr(0, builder.getContext());
+  auto map = mlir::AffineMap::get(
+      1, 0, d0 + prefetch.distance().getInt() * range.Step());
+  ahead_indices[*dimension] = builder.create<affine::AffineApplyOp>(
+      op.getLoc(), map, map_body.index(*dimension));
+  llvm::SmallVector<mlir::Value> prefetch_indices =
+      LoadStoreIndices(op.getLoc(), op.DomainWithDependencies(), op.getLayout(),
+                       ahead_indices, map_body, builder);
+  builder.create<mlir::memref::PrefetchOp>(
+      op.getLoc(), map_body.block_input(0), prefetch_indices,
+      /*isWrite=*/false, /*localityHint=*/3, /*isDataCache=*/true);
   return {load};
 }
 
@@ -237,12 +348,241 @@ llvm::SmallVector<mlir::Value> StoreExpansionPattern::Emit(
     mlir::OpBuilder &builder) const {
   llvm::SmallVector<mlir::Value> indices =
       LoadStoreIndices(op.getLoc(), op.DomainWithDependencies(), op.getLayout(),
-                       map_body, builder);
-  builder.create<mlir::memref::StoreOp>(op.getLoc(), map_body.block_input(1),
-                                        map_body.block_input(0), indices);
+                       map_body.indices(), map_body, builder);
+  auto store = builder.create<mlir::memref::StoreOp>(
+      op.getLoc(), map_body.block_input(1), map_body.block_input(0), indices);
+  // Lowered to LLVM stores with !nontemporal metadata.
+  if (op.getNontemporal()) store.setNontemporal(true);
   return {};
 }
 
+// Indicates if `type` can be the element type of a vector.
+static bool IsVectorElementType(mlir::Type type) {
+  return type.isIntOrIndexOrFloat();
+}
+
+// Expansion pattern that implements a compute operation by vector operations
+// spanning the innermost loop. The operation is expanded as its scalar
+// counterpart; the loop is turned into vector operations when introduced.
+class VectorExpansionPattern : public ExpansionPattern {
+ public:
+  constexpr static llvm::StringRef kName = kVectorExpansionPattern;
+
+  mlir::LogicalResult Match(const ComputeOpInstance &op) const override;
+
+  llvm::SmallVector<mlir::Value> Emit(ComputeOp op, MapBodyBuilder &map_body,
+                                      mlir::OpBuilder &builder) const override;
+
+ private:
+  MapExpansionPattern map_pattern_;
+  LoadExpansionPattern load_pattern_;
+  StoreExpansionPattern store_pattern_;
+};
+
+mlir::LogicalResult VectorExpansionPattern::Match(
+    const ComputeOpInstance &op) const {
+  if (op.is_copy()) return mlir::failure();
+
+  // The innermost loop must have a static size: either the point loop of a
+  // stripe or, once loops are normalized, a full dimension.
+  llvm::ArrayRef<mlir::Attribute> loops = op.Loops();
+  if (loops.empty()) return mlir::failure();
+  MappingExpr iter = loops.back().cast<LoopAttr>().iter();
+  if (auto stripe = iter.dyn_cast<MappingStripeExpr>()) {
+    if (stripe.factors().size() < 2 || stripe.factors().back() != 1) {
+      return mlir::failure();
+    }
+  } else if (auto dim = iter.dyn_cast<MappingDimExpr>()) {
+    auto sair_op = cast<SairOp>(op.GetDuplicatedOp());
+    mlir::Operation *dimension_op =
+        sair_op.getDomain()[dim.dimension()].getDefiningOp();
+    if (auto range = dyn_cast<RangeOp>(dimension_op)) {
+      bool is_exact;
+      if (!GetMaxTripCount(range, is_exact).has_value() || range.Step() != 1) {
+        return mlir::failure();
+      }
+    } else if (!sair_op.getShape()
+                    .Dimension(dim.dimension())
+                    .type()
+                    .isa<StaticRangeType>()) {
+      return mlir::failure();
+    }
+  } else {
+    return mlir::failure();
+  }
+
+  mlir::Operation *operation = op.GetDuplicatedOp();
+  if (auto load = dyn_cast<SairLoadFromMemRefOp>(operation)) {
+    return mlir::success(
+        IsVectorElementType(load.MemRefType().getElementType()));
+  }
+  if (auto store = dyn_cast<SairStoreToMemRefOp>(operation)) {
+    return mlir::success(
+        IsVectorElementType(store.MemRefType().getElementType()));
+  }
+  auto map_op = dyn_cast<SairMapOp>(operation);
+  if (map_op == nullptr) return mlir::failure();
+
+  // Only accept operations that have a direct vector counterpart.
+  for (mlir::Operation &body_op : map_op.block().without_terminator()) {
+    if (!isa<mlir::arith::ConstantOp, mlir::affine::AffineApplyOp,
+             mlir::memref::LoadOp, mlir::memref::StoreOp>(body_op) &&
+        !body_op.hasTrait<mlir::OpTrait::Elementwise>()) {
+      return mlir::failure();
+    }
+    if (!llvm::all_of(body_op.getResultTypes(), IsVectorElementType)) {
+      return mlir::failure();
+    }
+  }
+  return mlir::success();
+}
+
+llvm::SmallVector<mlir::Value> VectorExpansionPattern::Emit(
+    ComputeOp op, MapBodyBuilder &map_body, mlir::OpBuilder &builder) const {
+  return llvm::TypeSwitch<mlir::Operation *, llvm::SmallVector<mlir::Value>>(
+             op.getOperation())
+      .Case<SairMapOp>([&](SairMapOp op) {
+        return map_pattern_.Emit(op, map_body, builder);
+      })
+      .Case<SairLoadFromMemRefOp>([&](SairLoadFromMemRefOp op) {
+        return load_pattern_.Emit(op, map_body, builder);
+      })
+      .Case<SairStoreToMemRefOp>([&](SairStoreToMemRefOp op) {
+        return store_pattern_.Emit(op, map_body, builder);
+      });
+}
+
+// Appends to `types` the types of the arguments a microkernel receives for a
+// value of type `type`. Memrefs are passed as their base buffer followed by
+// their offset and strides, other values are passed as is. Fails for memrefs
+// without a strided layout.
+mlir::LogicalResult AppendMicrokernelArgumentTypes(
+    mlir::Type type, llvm::SmallVectorImpl<mlir::Type> &types) {
+  auto memref_type = type.dyn_cast<mlir::MemRefType>();
+  if (memref_type == nullptr) {
+    types.push_back(type);
+    return mlir::success();
+  }
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  if (mlir::failed(mlir::getStridesAndOffset(memref_type, strides, offset))) {
+    return mlir::failure();
+  }
+  mlir::Type index_type = mlir::IndexType::get(type.getContext());
+  types.push_back(mlir::MemRefType::get({}, memref_type.getElementType(),
+                                        mlir::MemRefLayoutAttrInterface(),
+                                        memref_type.getMemorySpace()));
+  types.append(memref_type.getRank() + 1, index_type);
+  return mlir::success();
+}
+
+// Returns the microkernel implementing the function called by `call`, or
+// nullptr if the callee is not an external function with a microkernel.
+mlir::func::FuncOp GetMicrokernel(mlir::func::CallOp call) {
+  auto callee = mlir::SymbolTable::lookupNearestSymbolFrom<mlir::func::FuncOp>(
+      call, call.getCalleeAttr());
+  if (callee == nullptr || !callee.isExternal()) return nullptr;
+  auto symbol =
+      callee->getAttrOfType<mlir::FlatSymbolRefAttr>(kMicrokernelAttrName);
+  if (symbol == nullptr) return nullptr;
+  auto microkernel =
+      mlir::SymbolTable::lookupNearestSymbolFrom<mlir::func::FuncOp>(call,
+                                                                     symbol);
+  if (microkernel == nullptr || !microkernel.isExternal()) return nullptr;
+  return microkernel;
+}
+
+// Expansion pattern that implements a sair.map or sair.map_reduce operation
+// whose body is a single call by a call to an external microkernel, such as a
+// matrix multiplication micro-tile. The callee must be a function declaration
+// whose `sair.microkernel` attribute refers to the declaration of the
+// microkernel. Memref operands are passed to the microkernel as their base
+// buffer followed by their offset and strides so that it can address the tile
+// of the current iteration. Other operands, including partially reduced values
+// of sair.map_reduce, are passed as scalars.
+//
+// sair.map_reduce operations keep their expansion pattern when lowered to
+// sair.map, so only sair.map operations are emitted.
+class LibcallExpansionPattern : public ExpansionPattern {
+ public:
+  constexpr static llvm::StringRef kName = kLibcallExpansionPattern;
+
+  mlir::LogicalResult Match(const ComputeOpInstance &op) const override;
+
+  llvm::SmallVector<mlir::Value> Emit(ComputeOp op, MapBodyBuilder &map_body,
+                                      mlir::OpBuilder &builder) const override;
+};
+
+mlir::LogicalResult LibcallExpansionPattern::Match(
+    const ComputeOpInstance &op) const {
+  if (op.is_copy()) return mlir::failure();
+  mlir::Operation *operation = op.GetDuplicatedOp();
+  mlir::Block *body = nullptr;
+  if (auto map_op = dyn_cast<SairMapOp>(operation)) {
+    body = &map_op.block();
+  } else if (auto map_reduce_op = dyn_cast<SairMapReduceOp>(operation)) {
+    body = &map_reduce_op.block();
+  } else {
+    return mlir::failure();
+  }
+
+  // The body must forward block arguments to a call and return its results.
+  mlir::Block &block = *body;
+  if (!llvm::hasSingleElement(block.without_terminator())) {
+    return mlir::failure();
+  }
+  auto call = dyn_cast<mlir::func::CallOp>(&block.front());
+  if (call == nullptr ||
+      !llvm::equal(block.getTerminator()->getOperands(), call.getResults())) {
+    return mlir::failure();
+  }
+  if (!llvm::all_of(call.getOperands(), [&](mlir::Value value) {
+        auto arg = value.dyn_cast<mlir::BlockArgument>();
+        return arg != nullptr && arg.getOwner() == &block;
+      })) {
+    return mlir::failure();
+  }
+
+  mlir::func::FuncOp callee = GetMicrokernel(call);
+  if (callee == nullptr) return mlir::failure();
+  llvm::SmallVector<mlir::Type> argument_types;
+  for (mlir::Type type : call.getOperandTypes()) {
+    if (mlir::failed(AppendMicrokernelArgumentTypes(type, argument_types))) {
+      return mlir::failure();
+    }
+  }
+  return mlir::success(
+      llvm::equal(callee.getArgumentTypes(), argument_types) &&
+      llvm::equal(callee.getResultTypes(), call.getResultTypes()));
+}
+
+llvm::SmallVector<mlir::Value> LibcallExpansionPattern::Emit(
+    ComputeOp op, MapBodyBuilder &map_body, mlir::OpBuilder &builder) const {
+  auto map_op = cast<SairMapOp>(op.getOperation());
+  auto call = cast<mlir::func::CallOp>(&map_op.block().front());
+  int domain_size = map_op.getDomain().size();
+  mlir::func::FuncOp callee = GetMicrokernel(call);
+  llvm::SmallVector<mlir::Value> arguments;
+  for (mlir::Value operand : call.getOperands()) {
+    int position = operand.cast<mlir::BlockArgument>().getArgNumber();
+    mlir::Value value = position < domain_size
+                            ? map_body.index(position)
+                            : map_body.block_input(position - domain_size);
+    if (!value.getType().isa<mlir::MemRefType>()) {
+      arguments.push_back(value);
+      continue;
+    }
+    auto metadata = builder.create<mlir::memref::ExtractStridedMetadataOp>(
+        call.getLoc(), value);
+    arguments.push_back(metadata.getBaseBuffer());
+    arguments.push_back(metadata.getOffset());
+    llvm::append_range(arguments, metadata.getStrides());
+  }
+  auto new_call =
+      builder.create<mlir::func::CallOp>(call.getLoc(), callee, arguments);
+  return llvm::to_vector(new_call.getResults());
+}
+
 // Registers expansion pattern of type I in `map`.
 template <typename... Ts>
 void RegisterExpansionPattern(
@@ -256,8 +596,10 @@ void RegisterExpansionPattern(
 void RegisterExpansionPatterns(
     llvm::StringMap<std::unique_ptr<ExpansionPattern>> &map) {
   RegisterExpansionPattern<MapExpansionPattern, CopyExpansionPattern,
-                           AllocExpansionPattern, FreeExpansionPattern,
-                           LoadExpansionPattern, StoreExpansionPattern>(map);
+                           AllocExpansionPattern, AllocaExpansionPattern,
+                           FreeExpansionPattern, LoadExpansionPattern,
+                           StoreExpansionPattern, VectorExpansionPattern,
+                           LibcallExpansionPattern>(map);
 }
 
 }  // namespace sair
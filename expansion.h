@@ -27,9 +27,18 @@ namespace sair {
 constexpr llvm::StringRef kMapExpansionPattern = "map";
 constexpr llvm::StringRef kCopyExpansionPattern = "copy";
 constexpr llvm::StringRef kAllocExpansionPattern = "alloc";
+constexpr llvm::StringRef kAllocaExpansionPattern = "alloca";
 constexpr llvm::StringRef kFreeExpansionPattern = "free";
 constexpr llvm::StringRef kLoadExpansionPattern = "load";
 constexpr llvm::StringRef kStoreExpansionPattern = "store";
+constexpr llvm::StringRef kVectorExpansionPattern = "vector";
+constexpr llvm::StringRef kLibcallExpansionPattern = "libcall";
+
+// Attribute of external function declarations called from the body of
+// operations expanded with the libcall pattern. It refers to the declaration
+// of the microkernel implementing the function, taking memrefs as base buffer,
+// offset and strides.
+constexpr llvm::StringRef kMicrokernelAttrName = "sair.microkernel";
 
 // Verifies expansion patterns apply to operations where they are specified.
 mlir::LogicalResult VerifyExpansionPatterns(SairProgramOp program);
@@ -14,6 +14,7 @@
 
 #include "loop_nest.h"
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
 #include "mlir/IR/Builders.h"
@@ -142,6 +143,23 @@ const IterationSpace &IterationSpaceAnalysis::ComputeIterationSpace(
   return it->second;
 }
 
+void IterationSpaceAnalysis::Update(const ComputeOpInstance &op) {
+  // Erase all stale iteration spaces before recomputing any of them as they
+  // may be inferred from one another.
+  llvm::SetVector<OpInstance> ops;
+  ops.insert(op);
+  for (int i = 0; i < ops.size(); ++i) {
+    iteration_space_.erase(ops[i]);
+    for (ResultInstance result : ops[i].Results()) {
+      for (auto &[user, pos] : result.GetUses()) {
+        (void)pos;
+        if (!user.isa<ComputeOpInstance>()) ops.insert(user);
+      }
+    }
+  }
+  for (const OpInstance &updated_op : ops) ComputeIterationSpace(updated_op);
+}
+
 MappingAttr IterationSpaceAnalysis::TranslateMapping(
     const OpInstance &from, const OpInstance &to, MappingAttr mapping) const {
   MappingAttr result = TryTranslateMapping(from, to, mapping);
@@ -151,19 +169,29 @@ MappingAttr IterationSpaceAnalysis::TranslateMapping(
 
 MappingAttr IterationSpaceAnalysis::TryTranslateMapping(
     const OpInstance &from, const OpInstance &to, MappingAttr mapping) const {
+  std::optional<ScratchMapping> result =
+      TryTranslateMapping(from, to, ScratchMapping(mapping));
+  if (!result.has_value()) return nullptr;
+  return result->ToAttr(mapping.getContext());
+}
+
+std::optional<ScratchMapping> IterationSpaceAnalysis::TryTranslateMapping(
+    const OpInstance &from, const OpInstance &to,
+    const ScratchMapping &mapping) const {
   const IterationSpace &from_space = Get(from);
   const IterationSpace &to_space = Get(to);
-  MappingAttr space_mapping = from_space.mapping()
-                                  .Inverse()
-                                  .Compose(mapping)
-                                  .Compose(to_space.mapping())
-                                  .Canonicalize();
+  ScratchMapping to_space_mapping(to_space.mapping());
+  ScratchMapping space_mapping = ScratchMapping(from_space.mapping())
+                                     .Inverse()
+                                     .Compose(mapping)
+                                     .Compose(to_space_mapping)
+                                     .Canonicalize();
 
   int num_common_loops = from_space.NumCommonLoops(to_space);
-  auto common_loops_mapping = MappingAttr::GetIdentity(
-      mapping.getContext(), num_common_loops, from_space.mapping().size());
-  MappingAttr loops_mapping =
-      common_loops_mapping.Resize(to_space.mapping().size());
+  ScratchMapping loops_mapping =
+      ScratchMapping::GetIdentity(num_common_loops,
+                                  from_space.mapping().size())
+          .Resize(to_space.mapping().size());
   return space_mapping.Unify(loops_mapping);
 }
 
@@ -188,6 +216,22 @@ class LoopNestConstraintsAnalysis {
         [&](const OpInstance &op) { ComputeConstraints(op, loop_nests); });
   }
 
+  // Only computes the constraints for using the operands and dimensions of
+  // `ops`.
+  LoopNestConstraintsAnalysis(llvm::ArrayRef<OpInstance> ops,
+                              const IterationSpaceAnalysis &loop_nests) {
+    for (const OpInstance &op : ops) {
+      for (ResultInstance dimension : op.getDomain()) {
+        ComputeConstraints(dimension.defining_op(), loop_nests);
+      }
+      for (OperandInstance operand : op.Operands()) {
+        auto value = operand.GetValue();
+        if (!value.has_value()) continue;
+        ComputeConstraints(value->defining_op(), loop_nests);
+      }
+    }
+  }
+
   // Returns the constraints for using the given value.
   const Constraints &GetConstraints(ResultInstance value) const {
     return constraints_.find(value.defining_op())->second;
@@ -257,12 +301,18 @@ class LoopNestConstraintsAnalysis {
   llvm::DenseMap<OpInstance, Constraints> constraints_;
 };
 
+// Processors GPU loops can be mapped to.
+static constexpr llvm::StringRef kGpuProcessors[] = {
+    "block_x", "block_y", "block_z", "thread_x", "thread_y", "thread_z"};
+
 mlir::LogicalResult VerifyLoopNestWellFormed(
     mlir::Location loc, DomainShapeAttr shape,
     llvm::ArrayRef<mlir::Attribute> loop_nest) {
   llvm::SmallVector<MappingExpr> iter_exprs;
   iter_exprs.reserve(loop_nest.size());
   int domain_size = shape.Dimensions().size();
+  // Position of the last loop mapped to a GPU processor.
+  int last_gpu_loop = -1;
 
   for (int i = 0, e = loop_nest.size(); i < e; ++i) {
     LoopAttr loop = loop_nest[i].dyn_cast<LoopAttr>();
@@ -274,6 +324,47 @@ mlir::LogicalResult VerifyLoopNestWellFormed(
       }
     }
 
+    // Loops mapped to GPU processors are lowered to a single kernel launch and
+    // must thus be adjacent and use each processor at most once.
+    if (mlir::StringAttr gpu = loop.gpu()) {
+      if (!llvm::is_contained(kGpuProcessors, gpu.getValue())) {
+        return mlir::emitError(loc) << "invalid GPU processor " << gpu;
+      }
+      if (last_gpu_loop >= 0 && last_gpu_loop != i - 1) {
+        return mlir::emitError(loc)
+               << "loops mapped to GPU processors must be adjacent";
+      }
+      for (int j = 0; j < i; ++j) {
+        if (loop_nest[j].cast<LoopAttr>().gpu() == gpu) {
+          return mlir::emitError(loc)
+                 << "GPU processor " << gpu << " used twice in a loop nest";
+        }
+      }
+      last_gpu_loop = i;
+    }
+
+    // Interleaved accumulators make iterations depend on each other.
+    if (loop.accumulators() != nullptr &&
+        (loop.parallel() != nullptr || loop.gpu() != nullptr)) {
+      return mlir::emitError(loc)
+             << "loop " << loop.name()
+             << " cannot be parallel and interleave accumulators";
+    }
+
+    // Peeling splits the loop into two sequential loops.
+    if (loop.peel() != nullptr &&
+        (loop.parallel() != nullptr || loop.gpu() != nullptr)) {
+      return mlir::emitError(loc)
+             << "loop " << loop.name() << " cannot be parallel and peeled";
+    }
+
+    // Unrolling is only implemented for sequential loops.
+    if (loop.unroll() != nullptr &&
+        (loop.parallel() != nullptr || loop.gpu() != nullptr)) {
+      return mlir::emitError(loc)
+             << "loop " << loop.name() << " cannot be parallel and unrolled";
+    }
+
     int min_domain_size = loop.iter().MinDomainSize();
     if (loop.iter().MinDomainSize() > domain_size) {
       return mlir::emitError(loc)
@@ -408,11 +499,13 @@ static mlir::LogicalResult VerifyDependency(
     const LoopNestConstraintsAnalysis &loop_constraints_analysis) {
   OpInstance dependency_op = dependency.value.defining_op();
 
-  MappingAttr domain_mapping =
-      dependency.mapping.Resize(dependency_op.domain_size())
+  ScratchMapping domain_mapping =
+      ScratchMapping(dependency.mapping)
+          .Resize(dependency_op.domain_size())
           .ResizeUseDomain(op.domain_size());
-  if (iteration_space_analysis.TryTranslateMapping(op, dependency_op,
-                                                   domain_mapping) == nullptr) {
+  if (!iteration_space_analysis
+           .TryTranslateMapping(op, dependency_op, domain_mapping)
+           .has_value()) {
     mlir::InFlightDiagnostic diag = op.EmitError()
                                     << "loop nest violates a data dependency";
     dependency.value.defining_op().AttachNote(diag)
@@ -553,6 +646,116 @@ static mlir::LogicalResult VerifySubDomains(
   return mlir::success();
 }
 
+// Verifies that loops marked as parallel or mapped to GPU processors do not
+// carry values from one iteration to the next, either through sair.fby
+// operations, by producing the last value selected by sair.proj_last
+// operations or by iterating along the reduction domain of sair.map_reduce
+// operations.
+static mlir::LogicalResult VerifyParallelLoops(
+    const OpInstance &op, const IterationSpace &iteration_space,
+    const LoopFusionAnalysis &fusion_analysis) {
+  int domain_size = op.domain_size();
+  llvm::SmallBitVector carrying_dims(domain_size);
+  mlir::Operation *operation = op.GetDuplicatedOp();
+  bool is_reduction = false;
+  if (auto fby = dyn_cast<SairFbyOp>(operation)) {
+    carrying_dims.set(fby.getParallelDomain().size(), domain_size);
+  } else if (auto proj_last = dyn_cast<SairProjLastOp>(operation)) {
+    carrying_dims.set(proj_last.getParallelDomain().size(), domain_size);
+  } else if (auto map_reduce = dyn_cast<SairMapReduceOp>(operation)) {
+    carrying_dims.set(map_reduce.getParallelDomain().size(), domain_size);
+    is_reduction = true;
+  } else {
+    return mlir::success();
+  }
+
+  for (int i = 0, e = iteration_space.num_loops(); i < e; ++i) {
+    mlir::StringAttr name = iteration_space.loop_names()[i];
+    const LoopFusionClass &fusion_class = fusion_analysis.GetClass(name);
+    if (!fusion_class.parallel() && fusion_class.gpu() == nullptr) continue;
+    MappingExpr expr = iteration_space.mapping().Dimension(i);
+    if (!expr.DependencyMask(domain_size).anyCommon(carrying_dims)) continue;
+    if (is_reduction) {
+      return op.EmitError()
+             << "loop " << name
+             << " cannot be parallel as it iterates along a reduction; use "
+                "split_factor to split the reduction into parallel partial "
+                "reductions";
+    }
+    return op.EmitError() << "loop " << name
+                          << " cannot be parallel as it carries a value "
+                             "across iterations";
+  }
+  return mlir::success();
+}
+
+// Same as above, but relies on the fusion analysis instead of a loop nest state
+// to know which loops were open before `op`. Assumes that the occurrences of
+// each loop are contiguous.
+static mlir::LogicalResult VerifyLoopsOpen(
+    const ComputeOpInstance &op, const LoopFusionAnalysis &fusion_analysis,
+    const SequenceAnalysis &sequence_analysis,
+    const LoopNestConstraintsAnalysis &loop_constaints_analysis) {
+  auto verify_loops_open = [&](const llvm::SetVector<mlir::Attribute> &loops)
+      -> mlir::LogicalResult {
+    for (mlir::Attribute loop : loops) {
+      if (llvm::any_of(op.Loops(), [&](mlir::Attribute attr) {
+            return attr.cast<LoopAttr>().name() == loop;
+          })) {
+        continue;
+      }
+      // Loops are contiguous, so a loop is closed before `op` if and only if
+      // its last operation is.
+      const LoopFusionClass &fusion_class =
+          fusion_analysis.GetClass(loop.cast<mlir::StringAttr>());
+      if (sequence_analysis.IsBefore(fusion_class.EndPoint().operation(), op)) {
+        continue;
+      }
+      return op.EmitError() << "loop " << loop
+                            << " must be open at or before this operation";
+    }
+    return mlir::success();
+  };
+
+  for (ResultInstance dimension : op.getDomain()) {
+    const auto &constraints =
+        loop_constaints_analysis.GetConstraints(dimension);
+    if (mlir::failed(verify_loops_open(constraints.open_loops))) {
+      return mlir::failure();
+    }
+  }
+  for (OperandInstance operand : op.Operands()) {
+    auto value = operand.GetValue();
+    if (!value.has_value()) continue;
+    const auto &constraints = loop_constaints_analysis.GetConstraints(*value);
+    if (mlir::failed(verify_loops_open(constraints.open_loops))) {
+      return mlir::failure();
+    }
+  }
+  return mlir::success();
+}
+
+// Returns the outermost loop of the loop nest of `op`, or nullptr if `op` is
+// not nested in any loop.
+static mlir::StringAttr RootLoop(const ComputeOpInstance &op) {
+  if (op.Loops().empty()) return nullptr;
+  return op.Loops().front().cast<LoopAttr>().name();
+}
+
+mlir::LogicalResult VerifyLoopNestDependencies(
+    SairProgramOp program, llvm::ArrayRef<OpInstance> ops,
+    const IterationSpaceAnalysis &iteration_spaces) {
+  LoopNestConstraintsAnalysis loop_constraints_analysis(program,
+                                                        iteration_spaces);
+  for (const OpInstance &op : ops) {
+    if (mlir::failed(VerifyDependencies(op, iteration_spaces,
+                                        loop_constraints_analysis))) {
+      return mlir::failure();
+    }
+  }
+  return mlir::success();
+}
+
 mlir::LogicalResult VerifyLoopNests(
     SairProgramOp program, const LoopFusionAnalysis &fusion_analysis,
     const IterationSpaceAnalysis &iteration_spaces,
@@ -588,6 +791,10 @@ mlir::LogicalResult VerifyLoopNests(
         if (mlir::failed(VerifySubDomains(op, iteration_spaces.Get(op)))) {
           return mlir::failure();
         }
+        if (mlir::failed(VerifyParallelLoops(op, iteration_spaces.Get(op),
+                                             fusion_analysis))) {
+          return mlir::failure();
+        }
         return VerifyDependencies(op, iteration_spaces,
                                   loop_constraints_analysis);
       });
@@ -596,6 +803,103 @@ mlir::LogicalResult VerifyLoopNests(
   return mlir::success();
 }
 
+mlir::LogicalResult VerifyLoopNests(
+    llvm::ArrayRef<OpInstance> ops,
+    llvm::ArrayRef<ComputeOpInstance> nested_ops,
+    const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const SequenceAnalysis &sequence_analysis) {
+  // Find the first and the last operation nested in each outermost loop.
+  llvm::MapVector<mlir::Attribute,
+                  std::pair<ComputeOpInstance, ComputeOpInstance>>
+      spans;
+  for (const ComputeOpInstance &op : nested_ops) {
+    auto [it, was_inserted] = spans.insert({RootLoop(op), {op, op}});
+    auto &[first, last] = it->second;
+    if (sequence_analysis.IsBefore(op, first)) first = op;
+    if (sequence_analysis.IsBefore(last, op)) last = op;
+  }
+
+  // Verify that the loop structure forms a tree and that loop ranges are well
+  // defined by walking the span of each outermost loop. Loops open when the
+  // span starts belong to other trees and were verified before.
+  for (auto &[root, span] : spans) {
+    LoopNestState loop_nest_state;
+    for (ComputeOpInstance op = span.first;;
+         op = sequence_analysis.NextOp(op)) {
+      if (op.GetDecisions().loop_nest() == nullptr) {
+        if (mlir::failed(loop_nest_state.CloseLoops())) {
+          return mlir::failure();
+        }
+      } else if (mlir::failed(loop_nest_state.Update(op, op.Loops()))) {
+        return mlir::failure();
+      }
+      if (RootLoop(op) == root &&
+          mlir::failed(VerifyLoopRanges(op, op.Loops(), fusion_analysis,
+                                        sequence_analysis))) {
+        return mlir::failure();
+      }
+      if (op == span.second) break;
+    }
+  }
+
+  // Moving an operation between two operations nested in the same outermost
+  // loop splits the loop, unless the operation is nested in the loop too.
+  llvm::SmallVector<ComputeOpInstance> compute_ops;
+  for (const OpInstance &op : ops) {
+    auto compute_op = op.dyn_cast<ComputeOpInstance>();
+    if (compute_op == nullptr) continue;
+    compute_ops.push_back(compute_op);
+    ComputeOpInstance prev = sequence_analysis.PrevOp(compute_op);
+    ComputeOpInstance next = sequence_analysis.NextOp(compute_op);
+    if (prev == nullptr || next == nullptr) continue;
+    mlir::StringAttr root = RootLoop(prev);
+    if (root == nullptr || RootLoop(next) != root ||
+        RootLoop(compute_op) == root) {
+      continue;
+    }
+    return next.EmitError()
+           << "occurrences of loop " << root << " must be contiguous";
+  }
+  for (const ComputeOpInstance &op : compute_ops) {
+    if (mlir::failed(VerifyLoopRanges(op, op.Loops(), fusion_analysis,
+                                      sequence_analysis))) {
+      return mlir::failure();
+    }
+  }
+
+  // Verify that loops are open when they need to.
+  llvm::SmallVector<OpInstance> constrained_ops = llvm::to_vector(ops);
+  llvm::append_range(constrained_ops, nested_ops);
+  LoopNestConstraintsAnalysis loop_constraints_analysis(constrained_ops,
+                                                        iteration_spaces);
+  for (const OpInstance &op : constrained_ops) {
+    auto compute_op = op.dyn_cast<ComputeOpInstance>();
+    if (compute_op == nullptr) continue;
+    if (mlir::failed(VerifyLoopsOpen(compute_op, fusion_analysis,
+                                     sequence_analysis,
+                                     loop_constraints_analysis))) {
+      return mlir::failure();
+    }
+  }
+
+  // Verify dependencies.
+  for (const OpInstance &op : ops) {
+    if (mlir::failed(VerifySubDomains(op, iteration_spaces.Get(op)))) {
+      return mlir::failure();
+    }
+    if (mlir::failed(VerifyParallelLoops(op, iteration_spaces.Get(op),
+                                         fusion_analysis))) {
+      return mlir::failure();
+    }
+    if (mlir::failed(VerifyDependencies(op, iteration_spaces,
+                                        loop_constraints_analysis))) {
+      return mlir::failure();
+    }
+  }
+  return mlir::success();
+}
+
 LoopFusionAnalysis::LoopFusionAnalysis(
     mlir::Operation *operation, const SequenceAnalysis *sequence_analysis)
     : context_(operation->getContext()) {
@@ -608,6 +912,16 @@ LoopFusionAnalysis::LoopFusionAnalysis(
   (void)status;
 }
 
+LoopFusionAnalysis::LoopFusionAnalysis(SairProgramOp program_op,
+                                       mlir::AnalysisManager &analysis_manager)
+    : context_(program_op->getContext()) {
+  auto &sequence_analysis =
+      analysis_manager.getAnalysis<SequenceAnalysis, SairProgramOp>();
+  mlir::LogicalResult status = Init(program_op, sequence_analysis);
+  assert(mlir::succeeded(status));
+  (void)status;
+}
+
 std::optional<LoopFusionAnalysis> LoopFusionAnalysis::Create(
     SairProgramOp program_op, const SequenceAnalysis &sequence_analysis) {
   LoopFusionAnalysis analysis(program_op->getContext());
@@ -619,16 +933,51 @@ std::optional<LoopFusionAnalysis> LoopFusionAnalysis::Create(
 
 mlir::LogicalResult LoopFusionAnalysis::Init(
     SairProgramOp program_op, const SequenceAnalysis &sequence_analysis) {
-  llvm::SmallVector<ComputeOpInstance> work_list;
+  llvm::SmallVector<ComputeOpInstance> ops;
   program_op.WalkComputeOpInstances([&](const ComputeOpInstance &compute_op) {
     auto none_expr = MappingNoneExpr::get(context_);
     int domain_size = compute_op.domain_size();
     op_domain_mappings_[compute_op].resize(domain_size, none_expr);
-    work_list.push_back(compute_op);
+    ops.push_back(compute_op);
+  });
+  return RegisterLoops(ops, sequence_analysis);
+}
+
+mlir::LogicalResult LoopFusionAnalysis::UpdateLoopTrees(
+    SairProgramOp program_op, llvm::ArrayRef<mlir::StringAttr> roots,
+    const SequenceAnalysis &sequence_analysis,
+    llvm::SmallVectorImpl<ComputeOpInstance> &ops) {
+  llvm::SmallVector<mlir::Attribute> stale_classes;
+  for (auto &[name, fusion_class] : fusion_classes_) {
+    llvm::ArrayRef<mlir::StringAttr> outer_loops = fusion_class.loop_nest();
+    mlir::StringAttr root =
+        outer_loops.empty() ? fusion_class.name() : outer_loops.front();
+    if (llvm::is_contained(roots, root)) stale_classes.push_back(name);
+  }
+  for (mlir::Attribute name : stale_classes) fusion_classes_.erase(name);
+
+  int first_op = ops.size();
+  program_op.WalkComputeOpInstances([&](const ComputeOpInstance &op) {
+    mlir::StringAttr root = RootLoop(op);
+    if (root != nullptr && llvm::is_contained(roots, root)) ops.push_back(op);
   });
+  return RegisterLoops(llvm::ArrayRef(ops).drop_front(first_op),
+                       sequence_analysis);
+}
+
+mlir::LogicalResult LoopFusionAnalysis::RegisterLoops(
+    llvm::ArrayRef<ComputeOpInstance> ops,
+    const SequenceAnalysis &sequence_analysis) {
+  llvm::SetVector<mlir::Attribute> registered_loops;
+  for (const ComputeOpInstance &op : ops) {
+    for (mlir::Attribute loop : op.Loops()) {
+      registered_loops.insert(loop.cast<LoopAttr>().name());
+    }
+  }
 
   // Handle loops by nesting levels. This ensures that we visited all occurences
   // of a loop before moving to inner loops.
+  llvm::SmallVector<ComputeOpInstance> work_list = llvm::to_vector(ops);
   for (int level = 0; !work_list.empty(); ++level) {
     for (int i = 0; i < work_list.size(); ++i) {
       ComputeOpInstance op = work_list[i];
@@ -647,14 +996,16 @@ mlir::LogicalResult LoopFusionAnalysis::Init(
   }
 
   // Ensure that all iterators are fully specified.
-  for (auto &[name, fusion_class] : fusion_classes_) {
+  for (mlir::Attribute name : registered_loops) {
+    const LoopFusionClass &fusion_class = fusion_classes_.find(name)->second;
     if (fusion_class.mapping().HasNoneExprs()) {
       return fusion_class.EmitError() << "iterator is not fully specified";
     }
   }
 
   // Trim dependencies in each fusion class.
-  for (auto &[name, fusion_class] : fusion_classes_) {
+  for (mlir::Attribute name : registered_loops) {
+    LoopFusionClass &fusion_class = fusion_classes_.find(name)->second;
     DomainShapeDim loop_shape = fusion_class.NestedShape().Dimensions().back();
     int max_dependency = loop_shape.DependencyMask().find_last();
     for (const auto &dimension : fusion_class.getDomain()) {
@@ -677,6 +1028,12 @@ static unsigned ExtractUnrollFactor(const ComputeOpInstance &op, unsigned pos) {
   return 0u;
 }
 
+// Indicates if the `pos`-th loop in the given compute op is marked as
+// parallel. Expects the op to have a well-formed loop nest attribute.
+static bool ExtractParallel(const ComputeOpInstance &op, unsigned pos) {
+  return op.Loops()[pos].cast<LoopAttr>().parallel() != nullptr;
+}
+
 mlir::LogicalResult LoopFusionAnalysis::RegisterLoop(
     const ComputeOpInstance &op, int loop_pos,
     const SequenceAnalysis &sequence_analysis) {
@@ -722,6 +1079,37 @@ mlir::LogicalResult LoopFusionAnalysis::RegisterLoop(
       diag.attachNote(fusion_class.location()) << "previous occurrence here";
       return diag;
     }
+    if (ExtractParallel(op, loop_pos) != fusion_class.parallel()) {
+      mlir::InFlightDiagnostic diag =
+          op.EmitError() << "loop " << loop.name()
+                         << " must be marked as parallel in all operations "
+                            "or in none";
+      diag.attachNote(fusion_class.location()) << "previous occurrence here";
+      return diag;
+    }
+    if (loop.gpu() != fusion_class.gpu()) {
+      mlir::InFlightDiagnostic diag =
+          op.EmitError() << "loop " << loop.name()
+                         << " must be mapped to the same GPU processor in all "
+                            "operations";
+      diag.attachNote(fusion_class.location()) << "previous occurrence here";
+      return diag;
+    }
+    if (loop.accumulators() != fusion_class.accumulators()) {
+      mlir::InFlightDiagnostic diag =
+          op.EmitError() << "loop " << loop.name()
+                         << " must have the same number of accumulators in "
+                            "all operations";
+      diag.attachNote(fusion_class.location()) << "previous occurrence here";
+      return diag;
+    }
+    if (loop.peel() != fusion_class.peel()) {
+      mlir::InFlightDiagnostic diag =
+          op.EmitError() << "loop " << loop.name()
+                         << " must be peeled in all operations or in none";
+      diag.attachNote(fusion_class.location()) << "previous occurrence here";
+      return diag;
+    }
     fusion_class.AddUse(op, sequence_analysis);
   }
 
@@ -756,7 +1144,12 @@ LoopFusionClass::LoopFusionClass(mlir::StringAttr name,
                                  const LoopNest &loop_nest)
     : MappedDomain(op.getLoc(), "loop", name, loop_nest),
       last_op_(op),
-      unroll_factor_(ExtractUnrollFactor(op, loop_nest.size())) {
+      unroll_factor_(ExtractUnrollFactor(op, loop_nest.size())),
+      parallel_(ExtractParallel(op, loop_nest.size())),
+      gpu_(op.Loops()[loop_nest.size()].cast<LoopAttr>().gpu()),
+      accumulators_(
+          op.Loops()[loop_nest.size()].cast<LoopAttr>().accumulators()),
+      peel_(op.Loops()[loop_nest.size()].cast<LoopAttr>().peel()) {
   num_dependencies_ = loop_nest.size();
   AddNonePrefixToMapping(1);
 }
@@ -779,6 +1172,12 @@ mlir::IntegerAttr LoopFusionClass::GetUnrollAttr(
   return mlir::Builder(&context).getI64IntegerAttr(unroll_factor_);
 }
 
+mlir::UnitAttr LoopFusionClass::GetParallelAttr(
+    mlir::MLIRContext &context) const {
+  if (!parallel_) return {};
+  return mlir::UnitAttr::get(&context);
+}
+
 ProgramPoint LoopFusionClass::EndPoint() const {
   return ProgramPoint(last_op_, Direction::kAfter, loop_nest());
 }
@@ -17,10 +17,12 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/Pass/AnalysisManager.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mapped_domain.h"
 #include "sair_op_interfaces.h"
 #include "sair_ops.h"
+#include "scratch_mapping.h"
 #include "sequence.h"
 
 namespace sair {
@@ -98,6 +100,20 @@ class IterationSpaceAnalysis {
   MappingAttr TryTranslateMapping(const OpInstance &from, const OpInstance &to,
                                   MappingAttr map) const;
 
+  // Same as TryTranslateMapping, but works on scratch mappings so that
+  // callers can chain further operations before uniquing the result.
+  std::optional<ScratchMapping> TryTranslateMapping(
+      const OpInstance &from, const OpInstance &to,
+      const ScratchMapping &map) const;
+
+  // Recomputes the iteration space of `op` after its loop nest changed, along
+  // with the iteration spaces of the non-compute operations using its results,
+  // directly or through other non-compute operations.
+  void Update(const ComputeOpInstance &op);
+
+  // Forgets the iteration space of `op` before it is erased.
+  void Erase(const OpInstance &op) { iteration_space_.erase(op); }
+
  private:
   // Computes the iteration space for the given operation.
   const IterationSpace &ComputeIterationSpace(const OpInstance &op);
@@ -129,6 +145,24 @@ class LoopFusionClass : public MappedDomain {
   // constructing a loop nest attribute.
   mlir::IntegerAttr GetUnrollAttr(mlir::MLIRContext &context) const;
 
+  // Indicates if iterations of the loop may execute in parallel.
+  bool parallel() const { return parallel_; }
+
+  // Returns the attribute marking the loop as parallel in a loop nest
+  // attribute, or nullptr if the loop is sequential.
+  mlir::UnitAttr GetParallelAttr(mlir::MLIRContext &context) const;
+
+  // GPU processor the loop is mapped to, or nullptr if the loop runs on the
+  // host. Loops mapped to GPU processors are implicitly parallel.
+  mlir::StringAttr gpu() const { return gpu_; }
+
+  // Number of accumulators reductions carried by the loop are interleaved
+  // across, or nullptr if reductions use a single accumulator.
+  mlir::IntegerAttr accumulators() const { return accumulators_; }
+
+  // Indicates that the last partial tile of the loop is peeled off full tiles.
+  mlir::UnitAttr peel() const { return peel_; }
+
  private:
   // Last loop of the loop nest this loop depends on.
   int num_dependencies_;
@@ -138,6 +172,18 @@ class LoopFusionClass : public MappedDomain {
 
   // Unroll factor of the (current) loop.
   unsigned unroll_factor_;
+
+  // Indicates if the loop is marked as parallel.
+  bool parallel_;
+
+  // GPU processor the loop is mapped to.
+  mlir::StringAttr gpu_;
+
+  // Number of interleaved accumulators of reductions.
+  mlir::IntegerAttr accumulators_;
+
+  // Indicates that the loop is peeled.
+  mlir::UnitAttr peel_;
 };
 
 // A loop nest of fused loops.
@@ -187,6 +233,11 @@ class LoopFusionAnalysis {
       mlir::Operation *operation,
       const SequenceAnalysis *sequence_analysis = nullptr);
 
+  // Builds the analysis for `program_op` from the sequence analysis cached in
+  // `analysis_manager`. Used when the analysis is requested by a pass.
+  LoopFusionAnalysis(SairProgramOp program_op,
+                     mlir::AnalysisManager &analysis_manager);
+
   // Creates a LoopFusionAnalysis populated with the loops appearing in
   // `program_op`. Returns `nullopt` if the analysis fails.
   static std::optional<LoopFusionAnalysis> Create(
@@ -204,6 +255,16 @@ class LoopFusionAnalysis {
   // invalidating the analysis.
   mlir::StringAttr GetFreshLoopName();
 
+  // Rebuilds the fusion classes of the loops nested in the loops of `roots`,
+  // after the loop nests or the sequence numbers of operations nested in these
+  // loops changed. Loops nested in other outermost loops are independent and
+  // left untouched. Appends the operations nested in `roots` to `ops`. The
+  // analysis must be updated again after a failure.
+  mlir::LogicalResult UpdateLoopTrees(
+      SairProgramOp program_op, llvm::ArrayRef<mlir::StringAttr> roots,
+      const SequenceAnalysis &sequence_analysis,
+      llvm::SmallVectorImpl<ComputeOpInstance> &ops);
+
   // Returns the analysis context.
   mlir::MLIRContext *getContext() const { return context_; }
 
@@ -215,6 +276,11 @@ class LoopFusionAnalysis {
   mlir::LogicalResult Init(SairProgramOp program_op,
                            const SequenceAnalysis &sequence_analysis);
 
+  // Registers the loops of `ops`, that must contain all the operations nested
+  // in these loops.
+  mlir::LogicalResult RegisterLoops(llvm::ArrayRef<ComputeOpInstance> ops,
+                                    const SequenceAnalysis &sequence_analysis);
+
   // Registers loop at position `loop_pos` of `op` as a new fusion class or
   // merges it in an existing fusion class.
   mlir::LogicalResult RegisterLoop(const ComputeOpInstance &op, int loop_pos,
@@ -234,6 +300,24 @@ mlir::LogicalResult VerifyLoopNests(
     const IterationSpaceAnalysis &iteration_spaces,
     const SequenceAnalysis &sequence_analysis);
 
+// Verifies loop nest attributes after the iteration spaces of `ops` changed or
+// after operations nested in the loops of `nested_ops` moved, assuming the rest
+// of the program was verified before. `nested_ops` must contain all the
+// operations nested in the outermost loops of its operations.
+mlir::LogicalResult VerifyLoopNests(
+    llvm::ArrayRef<OpInstance> ops,
+    llvm::ArrayRef<ComputeOpInstance> nested_ops,
+    const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const SequenceAnalysis &sequence_analysis);
+
+// Verifies that the loop nests of `ops` are compatible with the constraints
+// imposed by their dependencies. Used to check a change of loop nests without
+// verifying the entire program.
+mlir::LogicalResult VerifyLoopNestDependencies(
+    SairProgramOp program, llvm::ArrayRef<OpInstance> ops,
+    const IterationSpaceAnalysis &iteration_spaces);
+
 // Verifies that the loop_nest attribute is correct with regard to the shape of
 // the operation it is attached to.
 mlir::LogicalResult VerifyLoopNestWellFormed(
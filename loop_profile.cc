@@ -0,0 +1,132 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "loop_profile.h"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace sair {
+namespace {
+
+// Counters of a loop. Probes are owned by the runtime so that they remain valid
+// after the code of instrumented loops is unloaded, as when a JIT-compiled
+// module is destroyed. Counters are updated with relaxed atomic increments so
+// that recording an execution neither locks nor looks the loop up.
+struct LoopProbe {
+  std::atomic<int64_t> executions{0};
+  std::atomic<int64_t> iterations{0};
+  std::atomic<int64_t> cycles{0};
+};
+
+// Handle to a probe, stored in the zero-initialized global emitted by the
+// lowering. Null until the loop first completes.
+using ProbeHandle = std::atomic<LoopProbe *>;
+static_assert(sizeof(ProbeHandle) <= kLoopProbeSize * sizeof(int64_t),
+              "probe handles must fit in the storage emitted by the lowering");
+static_assert(ProbeHandle::is_always_lock_free,
+              "probe handles must not have a lock");
+static_assert(std::atomic<int64_t>::is_always_lock_free,
+              "LoopProbe counters must not have a lock");
+
+// Probes of all loops that recorded an execution, indexed by key. Loops with
+// the same key in different modules share their probe. Only accessed when
+// loops first complete or when reading counters.
+struct ProbeRegistry {
+  std::mutex mutex;
+  std::map<std::string, LoopProbe> probes;
+};
+
+ProbeRegistry &GetProbeRegistry() {
+  static auto *registry = new ProbeRegistry();
+  return *registry;
+}
+
+// Points `handle` to the probe of `key`, unless another thread did it first,
+// and returns the probe.
+LoopProbe *RegisterProbe(ProbeHandle &handle, const char *key) {
+  ProbeRegistry &registry = GetProbeRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  LoopProbe *probe = handle.load(std::memory_order_relaxed);
+  if (probe != nullptr) return probe;
+  probe = &registry.probes[key];
+  handle.store(probe, std::memory_order_release);
+  return probe;
+}
+
+}  // namespace
+
+std::vector<LoopProfile> GetLoopProfiles() {
+  ProbeRegistry &registry = GetProbeRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  std::vector<LoopProfile> profiles;
+  for (const auto &[key, probe] : registry.probes) {
+    int64_t executions = probe.executions.load(std::memory_order_relaxed);
+    if (executions == 0) continue;
+    LoopProfile &profile = profiles.emplace_back();
+    profile.key = key;
+    profile.executions = executions;
+    profile.iterations = probe.iterations.load(std::memory_order_relaxed);
+    profile.cycles = probe.cycles.load(std::memory_order_relaxed);
+  }
+  return profiles;
+}
+
+void ResetLoopProfiles() {
+  ProbeRegistry &registry = GetProbeRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto &[key, probe] : registry.probes) {
+    probe.executions.store(0, std::memory_order_relaxed);
+    probe.iterations.store(0, std::memory_order_relaxed);
+    probe.cycles.store(0, std::memory_order_relaxed);
+  }
+}
+
+void PrintLoopProfiles(llvm::raw_ostream &os) {
+  for (const LoopProfile &profile : GetLoopProfiles()) {
+    os << profile.key << ": " << profile.executions << " executions, "
+       << profile.iterations << " iterations, " << profile.cycles
+       << " cycles\n";
+  }
+}
+
+}  // namespace sair
+
+int64_t sair_loop_profile_begin() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+void sair_loop_profile_end(void *probe, const char *key, int64_t start,
+                           int64_t trip_count) {
+  int64_t cycles = sair_loop_profile_begin() - start;
+  auto &handle = *static_cast<sair::ProbeHandle *>(probe);
+  sair::LoopProbe *loop = handle.load(std::memory_order_acquire);
+  if (loop == nullptr) loop = sair::RegisterProbe(handle, key);
+  loop->executions.fetch_add(1, std::memory_order_relaxed);
+  loop->iterations.fetch_add(trip_count, std::memory_order_relaxed);
+  loop->cycles.fetch_add(cycles, std::memory_order_relaxed);
+}
+
+void sair_loop_profile_dump() { sair::PrintLoopProfiles(llvm::errs()); }
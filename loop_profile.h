@@ -0,0 +1,77 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAIR_LOOP_PROFILE_H_
+#define SAIR_LOOP_PROFILE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Runtime entry points called by loops instrumented with the `profile-loops`
+// option of the loop introduction pass.
+extern "C" {
+
+// Returns the current value of the cycle counter.
+int64_t sair_loop_profile_begin();
+
+// Records, in `probe`, an execution of the loop identified by the
+// null-terminated string `key` that started at cycle `start` and ran
+// `trip_count` iterations. `probe` points to zero-initialized storage of
+// `sair::kLoopProbeSize` 64-bit words owned by the loop. The first call stores
+// there a handle to counters owned by the runtime, which thus outlive the code
+// of the loop; later calls only atomically increment the counters.
+// Thread-safe.
+void sair_loop_profile_end(void *probe, const char *key, int64_t start,
+                           int64_t trip_count);
+
+// Prints the profile to the standard error stream.
+void sair_loop_profile_dump();
+}
+
+namespace sair {
+
+// Names of the runtime functions called by instrumented loops.
+inline constexpr llvm::StringLiteral kLoopProfileBeginFunction =
+    "sair_loop_profile_begin";
+inline constexpr llvm::StringLiteral kLoopProfileEndFunction =
+    "sair_loop_profile_end";
+
+// Number of 64-bit words of the storage allocated by the lowering for each
+// instrumented loop, holding a handle to the counters of the loop.
+inline constexpr int kLoopProbeSize = 1;
+
+// Counters accumulated for a loop, identified by `<function>:<loop>`.
+struct LoopProfile {
+  std::string key;
+  int64_t executions = 0;
+  int64_t iterations = 0;
+  int64_t cycles = 0;
+};
+
+// Returns the counters recorded since the last reset, sorted by key.
+std::vector<LoopProfile> GetLoopProfiles();
+
+// Clears all counters.
+void ResetLoopProfiles();
+
+// Prints the counters recorded since the last reset, one loop per line.
+void PrintLoopProfiles(llvm::raw_ostream &os);
+
+}  // namespace sair
+
+#endif  // SAIR_LOOP_PROFILE_H_
@@ -15,6 +15,7 @@
 #include "mapped_domain.h"
 
 #include "loop_nest.h"
+#include "scratch_mapping.h"
 
 namespace sair {
 
@@ -126,11 +127,14 @@ mlir::LogicalResult MappedDomain::UnifyMapping(
   }
 
   // Apply unification.
-  mapping_ = mapping_.ResizeUseDomain(domain_.size());
   auto constraint_mapping =
       MappingAttr::get(context(), domain_.size(), constraints);
-  mapping_ = constraint_mapping.Compose(new_mapping).Unify(mapping_);
-  assert(mapping_ != nullptr);
+  std::optional<ScratchMapping> unified =
+      ScratchMapping(constraint_mapping)
+          .Compose(ScratchMapping(new_mapping))
+          .Unify(ScratchMapping(mapping_).ResizeUseDomain(domain_.size()));
+  assert(unified.has_value());
+  mapping_ = unified->ToAttr(context());
   return mlir::success();
 }
 
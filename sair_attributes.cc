@@ -1432,52 +1432,88 @@ mlir::ArrayAttr EraseOperandFromDecisions(mlir::ArrayAttr decisions,
                               llvm::to_vector<1>(range));
 }
 
-LoopAttr LoopAttr::get(mlir::StringAttr name, MappingExpr iter,
-                       mlir::IntegerAttr unroll, mlir::MLIRContext *context) {
-  llvm::SmallVector<mlir::NamedAttribute, 3> fields;
-  assert(name);
-  auto name_id = mlir::StringAttr::get(context, "name");
-  fields.emplace_back(name_id, name);
+// Returns the uniqued names of the fields of dictionary-based attributes.
+static const AttributeFieldNames &GetFieldNames(mlir::MLIRContext *context) {
+  return context->getLoadedDialect<SairDialect>()->field_names();
+}
 
-  assert(iter);
-  auto iter_id = mlir::StringAttr::get(context, "iter");
-  fields.emplace_back(iter_id, iter);
+// Fields of dictionary-based attributes below are appended in alphabetical
+// order so that dictionaries can be built without sorting them.
 
-  if (unroll) {
-    auto unroll_id = mlir::StringAttr::get(context, "unroll");
-    fields.emplace_back(unroll_id, unroll);
-  }
+LoopAttr LoopAttr::get(mlir::StringAttr name, MappingExpr iter,
+                       mlir::IntegerAttr unroll, mlir::UnitAttr parallel,
+                       mlir::StringAttr gpu, mlir::IntegerAttr accumulators,
+                       mlir::UnitAttr peel, mlir::MLIRContext *context) {
+  const AttributeFieldNames &names = GetFieldNames(context);
+  llvm::SmallVector<mlir::NamedAttribute, 7> fields;
+  if (accumulators) fields.emplace_back(names.accumulators, accumulators);
+  if (gpu) fields.emplace_back(names.gpu, gpu);
+  assert(iter);
+  fields.emplace_back(names.iter, iter);
+  assert(name);
+  fields.emplace_back(names.name, name);
+  if (parallel) fields.emplace_back(names.parallel, parallel);
+  if (peel) fields.emplace_back(names.peel, peel);
+  if (unroll) fields.emplace_back(names.unroll, unroll);
 
-  mlir::Attribute dict = mlir::DictionaryAttr::get(context, fields);
-  return dict.dyn_cast<LoopAttr>();
+  return mlir::DictionaryAttr::getWithSorted(context, fields).cast<LoopAttr>();
 }
 
 bool LoopAttr::classof(mlir::Attribute attr) {
   if (!attr) return false;
   auto derived = attr.dyn_cast<mlir::DictionaryAttr>();
   if (!derived) return false;
+  const auto *dialect = derived.getContext()->getLoadedDialect<SairDialect>();
+  if (dialect == nullptr) return false;
+  const AttributeFieldNames &names = dialect->field_names();
 
-  auto name = derived.get("name");
+  auto name = derived.get(names.name);
   if (!name.isa_and_nonnull<mlir::StringAttr>()) return false;
 
-  auto iter = derived.get("iter");
+  auto iter = derived.get(names.iter);
   if (!iter.isa_and_nonnull<sair::MappingExpr>()) return false;
 
-  auto unroll = derived.get("unroll");
-  if (!unroll) return derived.size() == 2;
+  int num_fields = 2;
+  if (auto unroll = derived.get(names.unroll)) {
+    auto intUnroll = unroll.dyn_cast<mlir::IntegerAttr>();
+    if (!intUnroll || !intUnroll.getType().isSignlessInteger(64) ||
+        !intUnroll.getValue().isStrictlyPositive()) {
+      return false;
+    }
+    ++num_fields;
+  }
 
-  auto intUnroll = unroll.dyn_cast<mlir::IntegerAttr>();
-  if (!intUnroll || !intUnroll.getType().isSignlessInteger(64) ||
-      !intUnroll.getValue().isStrictlyPositive()) {
-    return false;
+  if (auto parallel = derived.get(names.parallel)) {
+    if (!parallel.isa<mlir::UnitAttr>()) return false;
+    ++num_fields;
+  }
+
+  if (auto gpu = derived.get(names.gpu)) {
+    if (!gpu.isa<mlir::StringAttr>()) return false;
+    ++num_fields;
   }
 
-  return derived.size() == 3;
+  if (auto accumulators = derived.get(names.accumulators)) {
+    auto int_accumulators = accumulators.dyn_cast<mlir::IntegerAttr>();
+    if (!int_accumulators ||
+        !int_accumulators.getType().isSignlessInteger(64) ||
+        !int_accumulators.getValue().isStrictlyPositive()) {
+      return false;
+    }
+    ++num_fields;
+  }
+
+  if (auto peel = derived.get(names.peel)) {
+    if (!peel.isa<mlir::UnitAttr>()) return false;
+    ++num_fields;
+  }
+
+  return derived.size() == num_fields;
 }
 
 mlir::StringAttr LoopAttr::name() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto name = derived.get("name");
+  auto name = derived.get(GetFieldNames(getContext()).name);
   assert(name && "attribute not found.");
   assert(name.isa<mlir::StringAttr>() && "incorrect Attribute type found.");
   return name.cast<mlir::StringAttr>();
@@ -1485,7 +1521,7 @@ mlir::StringAttr LoopAttr::name() const {
 
 MappingExpr LoopAttr::iter() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto iter = derived.get("iter");
+  auto iter = derived.get(GetFieldNames(getContext()).iter);
   assert(iter && "attribute not found.");
   assert(iter.isa<MappingExpr>() && "incorrect Attribute type found.");
   return iter.cast<MappingExpr>();
@@ -1493,64 +1529,180 @@ MappingExpr LoopAttr::iter() const {
 
 mlir::IntegerAttr LoopAttr::unroll() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto unroll = derived.get("unroll");
+  auto unroll = derived.get(GetFieldNames(getContext()).unroll);
   if (!unroll) return nullptr;
   assert(unroll.isa<mlir::IntegerAttr>() && "incorrect Attribute type found.");
   return unroll.cast<mlir::IntegerAttr>();
 }
 
-BufferAttr BufferAttr::get(mlir::StringAttr space, mlir::StringAttr name,
-                           NamedMappingAttr layout,
-                           mlir::MLIRContext *context) {
-  llvm::SmallVector<mlir::NamedAttribute, 3> fields;
+mlir::UnitAttr LoopAttr::parallel() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto parallel = derived.get(GetFieldNames(getContext()).parallel);
+  if (!parallel) return nullptr;
+  assert(parallel.isa<mlir::UnitAttr>() && "incorrect Attribute type found.");
+  return parallel.cast<mlir::UnitAttr>();
+}
 
-  assert(space);
-  auto space_id = mlir::StringAttr::get(context, "space");
-  fields.emplace_back(space_id, space);
+mlir::StringAttr LoopAttr::gpu() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto gpu = derived.get(GetFieldNames(getContext()).gpu);
+  if (!gpu) return nullptr;
+  assert(gpu.isa<mlir::StringAttr>() && "incorrect Attribute type found.");
+  return gpu.cast<mlir::StringAttr>();
+}
 
-  if (name) {
-    auto name_id = mlir::StringAttr::get(context, "name");
-    fields.emplace_back(name_id, name);
-  }
+mlir::IntegerAttr LoopAttr::accumulators() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto accumulators = derived.get(GetFieldNames(getContext()).accumulators);
+  if (!accumulators) return nullptr;
+  assert(accumulators.isa<mlir::IntegerAttr>() &&
+         "incorrect Attribute type found.");
+  return accumulators.cast<mlir::IntegerAttr>();
+}
 
-  if (layout) {
-    auto layout_id = mlir::StringAttr::get(context, "layout");
-    fields.emplace_back(layout_id, layout);
-  }
+mlir::UnitAttr LoopAttr::peel() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto peel = derived.get(GetFieldNames(getContext()).peel);
+  if (!peel) return nullptr;
+  assert(peel.isa<mlir::UnitAttr>() && "incorrect Attribute type found.");
+  return peel.cast<mlir::UnitAttr>();
+}
+
+PrefetchAttr PrefetchAttr::get(mlir::StringAttr loop,
+                               mlir::IntegerAttr distance,
+                               mlir::MLIRContext *context) {
+  const AttributeFieldNames &names = GetFieldNames(context);
+  assert(loop);
+  assert(distance);
+  mlir::NamedAttribute fields[] = {{names.distance, distance},
+                                   {names.loop, loop}};
+  return mlir::DictionaryAttr::getWithSorted(context, fields)
+      .cast<PrefetchAttr>();
+}
+
+bool PrefetchAttr::classof(mlir::Attribute attr) {
+  if (!attr) return false;
+  auto derived = attr.dyn_cast<mlir::DictionaryAttr>();
+  if (!derived) return false;
+  const auto *dialect = derived.getContext()->getLoadedDialect<SairDialect>();
+  if (dialect == nullptr) return false;
+  const AttributeFieldNames &names = dialect->field_names();
 
-  mlir::Attribute dict = mlir::DictionaryAttr::get(context, fields);
-  return dict.dyn_cast<BufferAttr>();
+  auto loop = derived.get(names.loop);
+  if (!loop.isa_and_nonnull<mlir::StringAttr>()) return false;
+
+  auto distance = derived.get(names.distance);
+  if (!distance.isa_and_nonnull<mlir::IntegerAttr>()) return false;
+
+  return derived.size() == 2;
+}
+
+mlir::StringAttr PrefetchAttr::loop() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto loop = derived.get(GetFieldNames(getContext()).loop);
+  assert(loop && "attribute not found.");
+  assert(loop.isa<mlir::StringAttr>() && "incorrect Attribute type found.");
+  return loop.cast<mlir::StringAttr>();
+}
+
+mlir::IntegerAttr PrefetchAttr::distance() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto distance = derived.get(GetFieldNames(getContext()).distance);
+  assert(distance && "attribute not found.");
+  assert(distance.isa<mlir::IntegerAttr>() &&
+         "incorrect Attribute type found.");
+  return distance.cast<mlir::IntegerAttr>();
+}
+
+BufferAttr BufferAttr::get(mlir::StringAttr space, mlir::StringAttr name,
+                           NamedMappingAttr layout, mlir::ArrayAttr padding,
+                           mlir::IntegerAttr alignment, PrefetchAttr prefetch,
+                           mlir::StringAttr double_buffer,
+                           mlir::UnitAttr nontemporal,
+                           mlir::MLIRContext *context) {
+  const AttributeFieldNames &names = GetFieldNames(context);
+  llvm::SmallVector<mlir::NamedAttribute, 8> fields;
+  if (alignment) fields.emplace_back(names.alignment, alignment);
+  if (double_buffer) fields.emplace_back(names.double_buffer, double_buffer);
+  if (layout) fields.emplace_back(names.layout, layout);
+  if (name) fields.emplace_back(names.name, name);
+  if (nontemporal) fields.emplace_back(names.nontemporal, nontemporal);
+  if (padding) fields.emplace_back(names.padding, padding);
+  if (prefetch) fields.emplace_back(names.prefetch, prefetch);
+  assert(space);
+  fields.emplace_back(names.space, space);
+
+  return mlir::DictionaryAttr::getWithSorted(context, fields)
+      .cast<BufferAttr>();
 }
 
 bool BufferAttr::classof(mlir::Attribute attr) {
   if (!attr) return false;
   auto derived = attr.dyn_cast<mlir::DictionaryAttr>();
   if (!derived) return false;
+  const auto *dialect = derived.getContext()->getLoadedDialect<SairDialect>();
+  if (dialect == nullptr) return false;
+  const AttributeFieldNames &names = dialect->field_names();
   int num_absent_attrs = 0;
 
-  auto space = derived.get("space");
+  auto space = derived.get(names.space);
   if (!space.isa_and_nonnull<mlir::StringAttr>()) return false;
 
-  auto name = derived.get("name");
+  auto name = derived.get(names.name);
   if (!name) {
     ++num_absent_attrs;
   } else if (!name.isa<mlir::StringAttr>()) {
     return false;
   }
 
-  auto layout = derived.get("layout");
+  auto layout = derived.get(names.layout);
   if (!layout) {
     ++num_absent_attrs;
   } else if (!layout.isa<NamedMappingAttr>()) {
     return false;
   }
 
-  return derived.size() + num_absent_attrs == 3;
+  auto padding = derived.get(names.padding);
+  if (!padding) {
+    ++num_absent_attrs;
+  } else if (!padding.isa<mlir::ArrayAttr>()) {
+    return false;
+  }
+
+  auto alignment = derived.get(names.alignment);
+  if (!alignment) {
+    ++num_absent_attrs;
+  } else if (!alignment.isa<mlir::IntegerAttr>()) {
+    return false;
+  }
+
+  auto prefetch = derived.get(names.prefetch);
+  if (!prefetch) {
+    ++num_absent_attrs;
+  } else if (!prefetch.isa<PrefetchAttr>()) {
+    return false;
+  }
+
+  auto double_buffer = derived.get(names.double_buffer);
+  if (!double_buffer) {
+    ++num_absent_attrs;
+  } else if (!double_buffer.isa<mlir::StringAttr>()) {
+    return false;
+  }
+
+  auto nontemporal = derived.get(names.nontemporal);
+  if (!nontemporal) {
+    ++num_absent_attrs;
+  } else if (!nontemporal.isa<mlir::UnitAttr>()) {
+    return false;
+  }
+
+  return derived.size() + num_absent_attrs == 8;
 }
 
 mlir::StringAttr BufferAttr::space() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto space = derived.get("space");
+  auto space = derived.get(GetFieldNames(getContext()).space);
   assert(space && "attribute not found.");
   assert(space.isa<mlir::StringAttr>() && "incorrect Attribute type found.");
   return space.cast<mlir::StringAttr>();
@@ -1558,7 +1710,7 @@ mlir::StringAttr BufferAttr::space() const {
 
 mlir::StringAttr BufferAttr::name() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto name = derived.get("name");
+  auto name = derived.get(GetFieldNames(getContext()).name);
   if (!name) return nullptr;
   assert(name.isa<mlir::StringAttr>() && "incorrect Attribute type found.");
   return name.cast<mlir::StringAttr>();
@@ -1566,12 +1718,55 @@ mlir::StringAttr BufferAttr::name() const {
 
 NamedMappingAttr BufferAttr::layout() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto layout = derived.get("layout");
+  auto layout = derived.get(GetFieldNames(getContext()).layout);
   if (!layout) return nullptr;
   assert(layout.isa<NamedMappingAttr>() && "incorrect Attribute type found.");
   return layout.cast<NamedMappingAttr>();
 }
 
+mlir::ArrayAttr BufferAttr::padding() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto padding = derived.get(GetFieldNames(getContext()).padding);
+  if (!padding) return nullptr;
+  assert(padding.isa<mlir::ArrayAttr>() && "incorrect Attribute type found.");
+  return padding.cast<mlir::ArrayAttr>();
+}
+
+mlir::IntegerAttr BufferAttr::alignment() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto alignment = derived.get(GetFieldNames(getContext()).alignment);
+  if (!alignment) return nullptr;
+  assert(alignment.isa<mlir::IntegerAttr>() &&
+         "incorrect Attribute type found.");
+  return alignment.cast<mlir::IntegerAttr>();
+}
+
+PrefetchAttr BufferAttr::prefetch() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto prefetch = derived.get(GetFieldNames(getContext()).prefetch);
+  if (!prefetch) return nullptr;
+  assert(prefetch.isa<PrefetchAttr>() && "incorrect Attribute type found.");
+  return prefetch.cast<PrefetchAttr>();
+}
+
+mlir::StringAttr BufferAttr::double_buffer() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto double_buffer = derived.get(GetFieldNames(getContext()).double_buffer);
+  if (!double_buffer) return nullptr;
+  assert(double_buffer.isa<mlir::StringAttr>() &&
+         "incorrect Attribute type found.");
+  return double_buffer.cast<mlir::StringAttr>();
+}
+
+mlir::UnitAttr BufferAttr::nontemporal() const {
+  auto derived = this->cast<mlir::DictionaryAttr>();
+  auto nontemporal = derived.get(GetFieldNames(getContext()).nontemporal);
+  if (!nontemporal) return nullptr;
+  assert(nontemporal.isa<mlir::UnitAttr>() &&
+         "incorrect Attribute type found.");
+  return nontemporal.cast<mlir::UnitAttr>();
+}
+
 DecisionsAttr DecisionsAttr::get(mlir::IntegerAttr sequence,
                                  mlir::ArrayAttr loop_nest,
                                  mlir::ArrayAttr storage,
@@ -1579,49 +1774,29 @@ DecisionsAttr DecisionsAttr::get(mlir::IntegerAttr sequence,
                                  mlir::Attribute copy_of,
                                  mlir::ArrayAttr operands,
                                  mlir::MLIRContext *context) {
+  const AttributeFieldNames &names = GetFieldNames(context);
   llvm::SmallVector<mlir::NamedAttribute, 6> fields;
+  if (copy_of) fields.emplace_back(names.copy_of, copy_of);
+  if (expansion) fields.emplace_back(names.expansion, expansion);
+  if (loop_nest) fields.emplace_back(names.loop_nest, loop_nest);
+  if (operands) fields.emplace_back(names.operands, operands);
+  if (sequence) fields.emplace_back(names.sequence, sequence);
+  if (storage) fields.emplace_back(names.storage, storage);
 
-  if (sequence) {
-    auto sequence_id = mlir::StringAttr::get(context, "sequence");
-    fields.emplace_back(sequence_id, sequence);
-  }
-
-  if (loop_nest) {
-    auto loop_nest_id = mlir::StringAttr::get(context, "loop_nest");
-    fields.emplace_back(loop_nest_id, loop_nest);
-  }
-
-  if (storage) {
-    auto storage_id = mlir::StringAttr::get(context, "storage");
-    fields.emplace_back(storage_id, storage);
-  }
-
-  if (expansion) {
-    auto expansion_id = mlir::StringAttr::get(context, "expansion");
-    fields.emplace_back(expansion_id, expansion);
-  }
-
-  if (copy_of) {
-    auto copy_of_id = mlir::StringAttr::get(context, "copy_of");
-    fields.emplace_back(copy_of_id, copy_of);
-  }
-
-  if (operands) {
-    auto operands_id = mlir::StringAttr::get(context, "operands");
-    fields.emplace_back(operands_id, operands);
-  }
-
-  mlir::Attribute dict = mlir::DictionaryAttr::get(context, fields);
-  return dict.dyn_cast<DecisionsAttr>();
+  return mlir::DictionaryAttr::getWithSorted(context, fields)
+      .cast<DecisionsAttr>();
 }
 
 bool DecisionsAttr::classof(mlir::Attribute attr) {
   if (!attr) return false;
   auto derived = attr.dyn_cast<mlir::DictionaryAttr>();
   if (!derived) return false;
+  const auto *dialect = derived.getContext()->getLoadedDialect<SairDialect>();
+  if (dialect == nullptr) return false;
+  const AttributeFieldNames &names = dialect->field_names();
   int num_absent_attrs = 0;
 
-  auto sequence = derived.get("sequence");
+  auto sequence = derived.get(names.sequence);
   if (!sequence) {
     ++num_absent_attrs;
   } else {
@@ -1631,7 +1806,7 @@ bool DecisionsAttr::classof(mlir::Attribute attr) {
     }
   }
 
-  auto loop_nest = derived.get("loop_nest");
+  auto loop_nest = derived.get(names.loop_nest);
   if (!loop_nest) {
     ++num_absent_attrs;
   } else {
@@ -1644,28 +1819,28 @@ bool DecisionsAttr::classof(mlir::Attribute attr) {
     }
   }
 
-  auto storage = derived.get("storage");
+  auto storage = derived.get(names.storage);
   if (!storage) {
     ++num_absent_attrs;
   } else if (!storage.isa<mlir::ArrayAttr>()) {
     return false;
   }
 
-  auto expansion = derived.get("expansion");
+  auto expansion = derived.get(names.expansion);
   if (!expansion) {
     ++num_absent_attrs;
   } else if (!expansion.isa<mlir::StringAttr>()) {
     return false;
   }
 
-  auto copy_of = derived.get("copy_of");
+  auto copy_of = derived.get(names.copy_of);
   if (!copy_of) {
     ++num_absent_attrs;
   } else if (!copy_of.isa<CopyAttr, InstanceAttr, mlir::UnitAttr>()) {
     return false;
   }
 
-  auto operands = derived.get("operands");
+  auto operands = derived.get(names.operands);
   if (!operands) {
     ++num_absent_attrs;
   } else {
@@ -1683,7 +1858,7 @@ bool DecisionsAttr::classof(mlir::Attribute attr) {
 
 mlir::IntegerAttr DecisionsAttr::sequence() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto sequence = derived.get("sequence");
+  auto sequence = derived.get(GetFieldNames(getContext()).sequence);
   if (!sequence) return nullptr;
   assert(sequence.isa<mlir::IntegerAttr>() &&
          "incorrect Attribute type found.");
@@ -1692,7 +1867,7 @@ mlir::IntegerAttr DecisionsAttr::sequence() const {
 
 mlir::ArrayAttr DecisionsAttr::loop_nest() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto loop_nest = derived.get("loop_nest");
+  auto loop_nest = derived.get(GetFieldNames(getContext()).loop_nest);
   if (!loop_nest) return nullptr;
   assert(loop_nest.isa<mlir::ArrayAttr>() && "incorrect Attribute type found.");
   return loop_nest.cast<mlir::ArrayAttr>();
@@ -1700,7 +1875,7 @@ mlir::ArrayAttr DecisionsAttr::loop_nest() const {
 
 mlir::ArrayAttr DecisionsAttr::storage() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto storage = derived.get("storage");
+  auto storage = derived.get(GetFieldNames(getContext()).storage);
   if (!storage) return nullptr;
   assert(storage.isa<mlir::ArrayAttr>() && "incorrect Attribute type found.");
   return storage.cast<mlir::ArrayAttr>();
@@ -1708,7 +1883,7 @@ mlir::ArrayAttr DecisionsAttr::storage() const {
 
 mlir::StringAttr DecisionsAttr::expansion() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto expansion = derived.get("expansion");
+  auto expansion = derived.get(GetFieldNames(getContext()).expansion);
   if (!expansion) return nullptr;
   assert(expansion.isa<mlir::StringAttr>() &&
          "incorrect Attribute type found.");
@@ -1717,7 +1892,7 @@ mlir::StringAttr DecisionsAttr::expansion() const {
 
 mlir::Attribute DecisionsAttr::copy_of() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto copy_of = derived.get("copy_of");
+  auto copy_of = derived.get(GetFieldNames(getContext()).copy_of);
   if (!copy_of) return nullptr;
   assert(copy_of.isa<mlir::Attribute>() && "incorrect Attribute type found.");
   return copy_of.cast<mlir::Attribute>();
@@ -1725,7 +1900,7 @@ mlir::Attribute DecisionsAttr::copy_of() const {
 
 mlir::ArrayAttr DecisionsAttr::operands() const {
   auto derived = this->cast<mlir::DictionaryAttr>();
-  auto operands = derived.get("operands");
+  auto operands = derived.get(GetFieldNames(getContext()).operands);
   if (!operands) return nullptr;
   assert(operands.isa<mlir::ArrayAttr>() && "incorrect Attribute type found.");
   return operands.cast<mlir::ArrayAttr>();
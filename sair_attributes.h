@@ -555,11 +555,37 @@ class LoopAttr : public mlir::DictionaryAttr {
   using mlir::DictionaryAttr::DictionaryAttr;
   static bool classof(mlir::Attribute attr);
   static LoopAttr get(mlir::StringAttr name, MappingExpr iter,
-                      mlir::IntegerAttr unroll, mlir::MLIRContext *context);
+                      mlir::IntegerAttr unroll, mlir::UnitAttr parallel,
+                      mlir::StringAttr gpu, mlir::IntegerAttr accumulators,
+                      mlir::UnitAttr peel, mlir::MLIRContext *context);
 
   mlir::StringAttr name() const;
   MappingExpr iter() const;
   mlir::IntegerAttr unroll() const;
+  // Indicates that iterations of the loop may execute in parallel.
+  mlir::UnitAttr parallel() const;
+  // GPU processor the loop is mapped to, e.g. "block_x" or "thread_y", or
+  // nullptr if the loop is executed on the host.
+  mlir::StringAttr gpu() const;
+  // Number of independent accumulators reductions carried by the loop are
+  // interleaved across, or nullptr if reductions use a single accumulator.
+  mlir::IntegerAttr accumulators() const;
+  // Indicates that the last partial tile of the loop executes separately from
+  // the full tiles.
+  mlir::UnitAttr peel() const;
+};
+
+// An attribute that requests to prefetch data accessed `distance` iterations
+// of loop `loop` ahead.
+class PrefetchAttr : public mlir::DictionaryAttr {
+ public:
+  using mlir::DictionaryAttr::DictionaryAttr;
+  static bool classof(mlir::Attribute attr);
+  static PrefetchAttr get(mlir::StringAttr loop, mlir::IntegerAttr distance,
+                          mlir::MLIRContext *context);
+
+  mlir::StringAttr loop() const;
+  mlir::IntegerAttr distance() const;
 };
 
 // An attribute that specifies how a value is stored in a buffer.
@@ -568,11 +594,27 @@ class BufferAttr : public mlir::DictionaryAttr {
   using mlir::DictionaryAttr::DictionaryAttr;
   static bool classof(mlir::Attribute attr);
   static BufferAttr get(mlir::StringAttr space, mlir::StringAttr name,
-                        NamedMappingAttr layout, mlir::MLIRContext *context);
+                        NamedMappingAttr layout, mlir::ArrayAttr padding,
+                        mlir::IntegerAttr alignment, PrefetchAttr prefetch,
+                        mlir::StringAttr double_buffer,
+                        mlir::UnitAttr nontemporal,
+                        mlir::MLIRContext *context);
 
   mlir::StringAttr space() const;
   mlir::StringAttr name() const;
   NamedMappingAttr layout() const;
+  // Number of elements to add at the end of each layout dimension. May be
+  // null.
+  mlir::ArrayAttr padding() const;
+  // Alignment of the buffer in bytes. May be null.
+  mlir::IntegerAttr alignment() const;
+  // Prefetching of data loaded from the buffer. May be null.
+  PrefetchAttr prefetch() const;
+  // Loop along which the buffer rotates between two allocations, so that
+  // consecutive iterations access distinct memory. May be null.
+  mlir::StringAttr double_buffer() const;
+  // Indicates that stores to the buffer bypass caches. May be null.
+  mlir::UnitAttr nontemporal() const;
 };
 
 // An attribute that specifies how to implement an operation.
@@ -0,0 +1,339 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sair_bytecode.h"
+
+#include <cstdint>
+#include <limits>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/MLIRContext.h"
+#include "sair_attributes.h"
+#include "sair_types.h"
+
+namespace sair {
+namespace {
+
+// Codes identifying attribute kinds in the bytecode. Must not be renumbered.
+enum AttributeCode : uint64_t {
+  kMappingExprCode = 0,
+  kMappingCode = 1,
+  kNamedMappingCode = 2,
+  kDomainShapeCode = 3,
+  kCopyCode = 4,
+  kInstanceCode = 5,
+};
+
+// Codes identifying type kinds in the bytecode. Must not be renumbered.
+enum TypeCode : uint64_t {
+  kDynRangeCode = 0,
+  kStaticRangeCode = 1,
+  kValueCode = 2,
+};
+
+// Tags of mapping expressions, stored in the low bits of the first integer of
+// each expression. The remaining bits hold the dimension of dimension
+// expressions and the number of factors of stripe and unstripe expressions.
+enum ExprTag : uint64_t {
+  kDimTag = 0,
+  kNoneTag = 1,
+  kUnknownTag = 2,
+  kStripeTag = 3,
+  kUnStripeTag = 4,
+};
+constexpr int kExprTagBits = 3;
+
+void WriteFactors(llvm::ArrayRef<int> factors,
+                  mlir::DialectBytecodeWriter &writer) {
+  for (int factor : factors) writer.writeVarInt(factor);
+}
+
+void WriteMappingExpr(MappingExpr expr, mlir::DialectBytecodeWriter &writer) {
+  auto write_header = [&](uint64_t payload, ExprTag tag) {
+    writer.writeVarInt((payload << kExprTagBits) | tag);
+  };
+  llvm::TypeSwitch<MappingExpr>(expr)
+      .Case([&](MappingDimExpr dim_expr) {
+        write_header(dim_expr.dimension(), kDimTag);
+      })
+      .Case([&](MappingNoneExpr) { write_header(0, kNoneTag); })
+      .Case([&](MappingUnknownExpr) { write_header(0, kUnknownTag); })
+      .Case([&](MappingStripeExpr stripe) {
+        write_header(stripe.factors().size(), kStripeTag);
+        WriteFactors(stripe.factors(), writer);
+        WriteMappingExpr(stripe.operand(), writer);
+      })
+      .Case([&](MappingUnStripeExpr unstripe) {
+        write_header(unstripe.factors().size(), kUnStripeTag);
+        WriteFactors(unstripe.factors(), writer);
+        for (MappingExpr operand : unstripe.operands()) {
+          WriteMappingExpr(operand, writer);
+        }
+      });
+}
+
+void WriteMapping(MappingAttr mapping, mlir::DialectBytecodeWriter &writer) {
+  writer.writeVarInt(mapping.UseDomainSize());
+  writer.writeList(mapping.Dimensions(), [&](MappingExpr expr) {
+    WriteMappingExpr(expr, writer);
+  });
+}
+
+mlir::LogicalResult ReadInt(mlir::DialectBytecodeReader &reader, int &result) {
+  uint64_t value;
+  if (mlir::failed(reader.readVarInt(value))) return mlir::failure();
+  if (value > std::numeric_limits<int>::max()) {
+    return reader.emitError("integer overflow in Sair attribute");
+  }
+  result = value;
+  return mlir::success();
+}
+
+mlir::LogicalResult ReadFactors(mlir::DialectBytecodeReader &reader,
+                                int num_factors,
+                                llvm::SmallVectorImpl<int> &factors) {
+  factors.resize(num_factors);
+  for (int &factor : factors) {
+    if (mlir::failed(ReadInt(reader, factor))) return mlir::failure();
+  }
+  return mlir::success();
+}
+
+MappingExpr ReadMappingExpr(mlir::DialectBytecodeReader &reader) {
+  mlir::MLIRContext *context = reader.getContext();
+  uint64_t header;
+  if (mlir::failed(reader.readVarInt(header))) return MappingExpr();
+  uint64_t payload = header >> kExprTagBits;
+  if (payload > std::numeric_limits<int>::max()) {
+    reader.emitError("integer overflow in Sair mapping expression");
+    return MappingExpr();
+  }
+
+  switch (header & ((1 << kExprTagBits) - 1)) {
+    case kDimTag:
+      return MappingDimExpr::get(payload, context);
+    case kNoneTag:
+      return MappingNoneExpr::get(context);
+    case kUnknownTag:
+      return MappingUnknownExpr::get(context);
+    case kStripeTag: {
+      llvm::SmallVector<int> factors;
+      if (payload == 0 || mlir::failed(ReadFactors(reader, payload, factors))) {
+        return MappingExpr();
+      }
+      MappingExpr operand = ReadMappingExpr(reader);
+      if (operand == nullptr) return MappingExpr();
+      return MappingStripeExpr::get(operand, factors);
+    }
+    case kUnStripeTag: {
+      llvm::SmallVector<int> factors;
+      if (payload == 0 || mlir::failed(ReadFactors(reader, payload, factors))) {
+        return MappingExpr();
+      }
+      for (int i = 0, e = factors.size(); i < e; ++i) {
+        if (i + 1 < e ? factors[i] <= factors[i + 1] : factors[i] != 1) {
+          reader.emitError("invalid unstripe factors");
+          return MappingExpr();
+        }
+      }
+      llvm::SmallVector<MappingExpr> operands;
+      for (uint64_t i = 0; i < payload; ++i) {
+        operands.push_back(ReadMappingExpr(reader));
+        if (operands.back() == nullptr) return MappingExpr();
+      }
+      return MappingUnStripeExpr::get(operands, factors);
+    }
+  }
+  reader.emitError("unknown Sair mapping expression tag");
+  return MappingExpr();
+}
+
+MappingAttr ReadMapping(mlir::DialectBytecodeReader &reader) {
+  int use_domain_size;
+  llvm::SmallVector<MappingExpr> exprs;
+  if (mlir::failed(ReadInt(reader, use_domain_size)) ||
+      mlir::failed(reader.readList(exprs, [&](MappingExpr &expr) {
+        expr = ReadMappingExpr(reader);
+        return mlir::success(expr != nullptr);
+      }))) {
+    return nullptr;
+  }
+  MappingAttr mapping =
+      MappingAttr::getChecked(reader.getContext(), use_domain_size, exprs);
+  if (mapping == nullptr) reader.emitError("invalid Sair mapping");
+  return mapping;
+}
+
+DomainShapeAttr ReadDomainShape(mlir::DialectBytecodeReader &reader) {
+  llvm::SmallVector<DomainShapeDim> dims;
+  uint64_t num_dims;
+  if (mlir::failed(reader.readVarInt(num_dims))) return nullptr;
+  dims.reserve(num_dims);
+  for (uint64_t i = 0; i < num_dims; ++i) {
+    mlir::Type type;
+    if (mlir::failed(reader.readType(type))) return nullptr;
+    if (!type.isa<DynRangeType, StaticRangeType>()) {
+      reader.emitError("expected a Sair range type in domain shape");
+      return nullptr;
+    }
+    MappingAttr dependency_mapping = ReadMapping(reader);
+    if (dependency_mapping == nullptr) return nullptr;
+    dims.emplace_back(type.cast<DimensionType>(), dependency_mapping);
+  }
+  return DomainShapeAttr::get(reader.getContext(), dims);
+}
+
+}  // namespace
+
+mlir::Attribute SairBytecodeInterface::readAttribute(
+    mlir::DialectBytecodeReader &reader) const {
+  mlir::MLIRContext *context = reader.getContext();
+  uint64_t code;
+  if (mlir::failed(reader.readVarInt(code))) return mlir::Attribute();
+  switch (code) {
+    case kMappingExprCode:
+      return ReadMappingExpr(reader);
+    case kMappingCode:
+      return ReadMapping(reader);
+    case kNamedMappingCode: {
+      llvm::SmallVector<mlir::StringAttr> names;
+      if (mlir::failed(reader.readList(names, [&](mlir::StringAttr &name) {
+            return reader.readAttribute(name);
+          }))) {
+        return mlir::Attribute();
+      }
+      MappingAttr mapping = ReadMapping(reader);
+      if (mapping == nullptr) return mlir::Attribute();
+      if (mapping.UseDomainSize() != names.size()) {
+        reader.emitError("invalid Sair named mapping");
+        return mlir::Attribute();
+      }
+      return NamedMappingAttr::get(names, mapping);
+    }
+    case kDomainShapeCode:
+      return ReadDomainShape(reader);
+    case kCopyCode:
+    case kInstanceCode: {
+      uint64_t value;
+      if (mlir::failed(reader.readVarInt(value))) return mlir::Attribute();
+      if (code == kCopyCode) return CopyAttr::get(context, value);
+      return InstanceAttr::get(context, value);
+    }
+  }
+  reader.emitError("unknown Sair attribute code ") << code;
+  return mlir::Attribute();
+}
+
+mlir::LogicalResult SairBytecodeInterface::writeAttribute(
+    mlir::Attribute attribute, mlir::DialectBytecodeWriter &writer) const {
+  if (auto expr = attribute.dyn_cast<MappingExpr>()) {
+    writer.writeVarInt(kMappingExprCode);
+    WriteMappingExpr(expr, writer);
+    return mlir::success();
+  }
+  return llvm::TypeSwitch<mlir::Attribute, mlir::LogicalResult>(attribute)
+      .Case([&](MappingAttr mapping) {
+        writer.writeVarInt(kMappingCode);
+        WriteMapping(mapping, writer);
+        return mlir::success();
+      })
+      .Case([&](NamedMappingAttr named_mapping) {
+        writer.writeVarInt(kNamedMappingCode);
+        writer.writeList(named_mapping.names(), [&](mlir::StringAttr name) {
+          writer.writeAttribute(name);
+        });
+        WriteMapping(named_mapping.mapping(), writer);
+        return mlir::success();
+      })
+      .Case([&](DomainShapeAttr shape) {
+        writer.writeVarInt(kDomainShapeCode);
+        writer.writeList(shape.Dimensions(), [&](const DomainShapeDim &dim) {
+          writer.writeType(dim.type());
+          WriteMapping(dim.dependency_mapping(), writer);
+        });
+        return mlir::success();
+      })
+      .Case([&](CopyAttr copy) {
+        writer.writeVarInt(kCopyCode);
+        writer.writeVarInt(copy.getValue());
+        return mlir::success();
+      })
+      .Case([&](InstanceAttr instance) {
+        writer.writeVarInt(kInstanceCode);
+        writer.writeVarInt(instance.getValue());
+        return mlir::success();
+      })
+      .Default([](mlir::Attribute) { return mlir::failure(); });
+}
+
+mlir::Type SairBytecodeInterface::readType(
+    mlir::DialectBytecodeReader &reader) const {
+  mlir::MLIRContext *context = reader.getContext();
+  uint64_t code;
+  if (mlir::failed(reader.readVarInt(code))) return mlir::Type();
+  switch (code) {
+    case kDynRangeCode: {
+      DomainShapeAttr shape;
+      if (mlir::failed(reader.readAttribute(shape))) return mlir::Type();
+      return DynRangeType::get(shape);
+    }
+    case kStaticRangeCode: {
+      int size, step;
+      if (mlir::failed(ReadInt(reader, size)) ||
+          mlir::failed(ReadInt(reader, step))) {
+        return mlir::Type();
+      }
+      return StaticRangeType::getChecked(
+          [&]() { return reader.emitError(); }, size, step, context);
+    }
+    case kValueCode: {
+      DomainShapeAttr shape;
+      mlir::Type element_type;
+      if (mlir::failed(reader.readAttribute(shape)) ||
+          mlir::failed(reader.readType(element_type))) {
+        return mlir::Type();
+      }
+      return ValueType::get(shape, element_type);
+    }
+  }
+  reader.emitError("unknown Sair type code ") << code;
+  return mlir::Type();
+}
+
+mlir::LogicalResult SairBytecodeInterface::writeType(
+    mlir::Type type, mlir::DialectBytecodeWriter &writer) const {
+  return llvm::TypeSwitch<mlir::Type, mlir::LogicalResult>(type)
+      .Case([&](DynRangeType range) {
+        writer.writeVarInt(kDynRangeCode);
+        writer.writeAttribute(range.Shape());
+        return mlir::success();
+      })
+      .Case([&](StaticRangeType range) {
+        writer.writeVarInt(kStaticRangeCode);
+        writer.writeVarInt(range.size());
+        writer.writeVarInt(range.getStep());
+        return mlir::success();
+      })
+      .Case([&](ValueType value) {
+        writer.writeVarInt(kValueCode);
+        writer.writeAttribute(value.Shape());
+        writer.writeType(value.ElementType());
+        return mlir::success();
+      })
+      .Default([](mlir::Type) { return mlir::failure(); });
+}
+
+}  // namespace sair
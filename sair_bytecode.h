@@ -0,0 +1,48 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAIR_SAIR_BYTECODE_H_
+#define SAIR_SAIR_BYTECODE_H_
+
+#include "mlir/Bytecode/BytecodeImplementation.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/Types.h"
+#include "mlir/Support/LogicalResult.h"
+
+namespace sair {
+
+// Bytecode encoding of Sair attributes and types. Mapping expressions are
+// encoded inline in the attributes that contain them, as a prefix walk of
+// tagged variable-length integers, so that they do not occupy entries of the
+// attribute table.
+class SairBytecodeInterface : public mlir::BytecodeDialectInterface {
+ public:
+  explicit SairBytecodeInterface(mlir::Dialect *dialect)
+      : mlir::BytecodeDialectInterface(dialect) {}
+
+  mlir::Attribute readAttribute(
+      mlir::DialectBytecodeReader &reader) const override;
+  mlir::Type readType(mlir::DialectBytecodeReader &reader) const override;
+
+  mlir::LogicalResult writeAttribute(
+      mlir::Attribute attribute,
+      mlir::DialectBytecodeWriter &writer) const override;
+  mlir::LogicalResult writeType(
+      mlir::Type type, mlir::DialectBytecodeWriter &writer) const override;
+};
+
+}  // namespace sair
+
+#endif  // SAIR_SAIR_BYTECODE_H_
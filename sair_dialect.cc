@@ -37,6 +37,7 @@
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
 #include "sair_attributes.h"
+#include "sair_bytecode.h"
 #include "sair_ops.h"
 #include "sair_types.h"
 #include "util.h"
@@ -46,19 +47,47 @@ using mlir::succeeded;
 
 namespace sair {
 
+AttributeFieldNames::AttributeFieldNames(mlir::MLIRContext *context)
+    : accumulators(mlir::StringAttr::get(context, "accumulators")),
+      alignment(mlir::StringAttr::get(context, "alignment")),
+      copy_of(mlir::StringAttr::get(context, "copy_of")),
+      distance(mlir::StringAttr::get(context, "distance")),
+      double_buffer(mlir::StringAttr::get(context, "double_buffer")),
+      expansion(mlir::StringAttr::get(context, "expansion")),
+      gpu(mlir::StringAttr::get(context, "gpu")),
+      iter(mlir::StringAttr::get(context, "iter")),
+      layout(mlir::StringAttr::get(context, "layout")),
+      loop(mlir::StringAttr::get(context, "loop")),
+      loop_nest(mlir::StringAttr::get(context, "loop_nest")),
+      name(mlir::StringAttr::get(context, "name")),
+      nontemporal(mlir::StringAttr::get(context, "nontemporal")),
+      operands(mlir::StringAttr::get(context, "operands")),
+      padding(mlir::StringAttr::get(context, "padding")),
+      parallel(mlir::StringAttr::get(context, "parallel")),
+      peel(mlir::StringAttr::get(context, "peel")),
+      prefetch(mlir::StringAttr::get(context, "prefetch")),
+      sequence(mlir::StringAttr::get(context, "sequence")),
+      space(mlir::StringAttr::get(context, "space")),
+      storage(mlir::StringAttr::get(context, "storage")),
+      unroll(mlir::StringAttr::get(context, "unroll")) {}
+
 // Registers Sair types with MLIR.
 SairDialect::SairDialect(mlir::MLIRContext *context)
     : mlir::Dialect(getDialectNamespace(), context,
-                    TypeID::get<SairDialect>()) {
+                    TypeID::get<SairDialect>()),
+      field_names_(context) {
   registerTypes();
   registerAttributes();
   addOperations<
 #define GET_OP_LIST
 #include "sair_ops.cc.inc"
       >();
+  addInterfaces<SairBytecodeInterface>();
 
   register_ = mlir::StringAttr::get(context, "register");
   memory_ = mlir::StringAttr::get(context, "memory");
+  shared_ = mlir::StringAttr::get(context, "shared");
+  local_ = mlir::StringAttr::get(context, "local");
   RegisterExpansionPatterns(expansion_patterns_);
 }
 
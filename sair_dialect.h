@@ -31,6 +31,16 @@
 
 namespace sair {
 
+// Uniqued names of the fields of dictionary-based Sair attributes.
+struct AttributeFieldNames {
+  explicit AttributeFieldNames(mlir::MLIRContext *context);
+
+  mlir::StringAttr accumulators, alignment, copy_of, distance, double_buffer,
+      expansion, gpu, iter, layout, loop, loop_nest, name, nontemporal,
+      operands, padding, parallel, peel, prefetch, sequence, space, storage,
+      unroll;
+};
+
 // Structured Additive IR dialect. Contains and registers with MLIR context the
 // lists of types, attributes and operations, and provides dialect-specific
 // parsing and printing facilities.
@@ -45,6 +55,20 @@ class SairDialect : public mlir::Dialect {
   // Identifiers for memory spaces.
   mlir::StringAttr register_attr() const { return register_; }
   mlir::StringAttr memory_attr() const { return memory_; }
+  // Memory shared by the threads of a GPU block.
+  mlir::StringAttr shared_attr() const { return shared_; }
+  // Small scratchpad memory private to a thread, such as GPU private memory.
+  mlir::StringAttr local_attr() const { return local_; }
+
+  // Names of the fields of LoopAttr, PrefetchAttr, BufferAttr and
+  // DecisionsAttr. Avoids uniquing field names each time one of these
+  // attributes is built.
+  const AttributeFieldNames &field_names() const { return field_names_; }
+
+  // Indicates if values stored in `space` live in a memref.
+  bool IsMemorySpace(mlir::Attribute space) const {
+    return space == memory_ || space == shared_ || space == local_;
+  }
 
   // Constructs the dialect in the provided context.
   explicit SairDialect(mlir::MLIRContext *context);
@@ -79,7 +103,8 @@ class SairDialect : public mlir::Dialect {
   /// Register the types of this dialect.
   void registerTypes();
 
-  mlir::StringAttr register_, memory_;
+  mlir::StringAttr register_, memory_, shared_, local_;
+  AttributeFieldNames field_names_;
   llvm::StringMap<std::unique_ptr<ExpansionPattern>> expansion_patterns_;
 };
 
@@ -0,0 +1,378 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sair_jit.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/Mangling.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/TargetParser/Host.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Target/LLVMIR/Dialect/Builtin/BuiltinToLLVMIRTranslation.h"
+#include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
+#include "mlir/Target/LLVMIR/Export.h"
+#include "loop_profile.h"
+#include "transforms/default_lowering_attributes.h"
+#include "transforms/lowering.h"
+
+namespace sair {
+
+void RegisterSairJitTranslations(mlir::DialectRegistry &registry) {
+  mlir::registerBuiltinDialectTranslation(registry);
+  mlir::registerLLVMDialectTranslation(registry);
+}
+
+namespace {
+
+// Identifies the build of the compiler, so that object code cached by a build
+// is never reused by another one, whose lowering may differ.
+llvm::StringRef GetBuildId() {
+  static const std::string *build_id = [] {
+    std::string id = "llvm-" LLVM_VERSION_STRING;
+#ifdef __VERSION__
+    id += ";compiler-" __VERSION__;
+#endif
+    // Changes to Sair passes result in a different executable.
+    std::string executable = llvm::sys::fs::getMainExecutable(nullptr, nullptr);
+    llvm::sys::fs::file_status status;
+    if (!executable.empty() && !llvm::sys::fs::status(executable, status)) {
+      id += llvm::formatv(
+                ";{0};{1};{2}", executable, status.getSize(),
+                status.getLastModificationTime().time_since_epoch().count())
+                .str();
+    }
+    return new std::string(std::move(id));
+  }();
+  return *build_id;
+}
+
+// Returns the key under which the object code compiled for `module` with
+// `pipeline` on the host is cached. The key only depends on the content of
+// `module`, on the passes of `pipeline` and their options, on the build of
+// the compiler and on the host, and is thus stable across processes.
+std::string GetCacheKey(mlir::ModuleOp module, mlir::OpPassManager &pipeline) {
+  std::string source;
+  llvm::raw_string_ostream os(source);
+  module.print(os);
+  os.flush();
+
+  std::string passes;
+  llvm::raw_string_ostream passes_os(passes);
+  pipeline.printAsTextualPipeline(passes_os);
+  passes_os.flush();
+
+  llvm::MD5 hash;
+  auto update = [&](llvm::StringRef data) {
+    hash.update(data);
+    // Separate fields so that their concatenation is not ambiguous.
+    hash.update(llvm::StringRef("\0", 1));
+  };
+  update(GetBuildId());
+  update(source);
+  update(passes);
+  update(llvm::sys::getProcessTriple());
+  update(llvm::sys::getHostCPUName());
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  return result.digest().str().str();
+}
+
+// Object cache of the JIT storing the object code compiled for a module in
+// `directory`, in a file named after the identifier of the module.
+class DiskObjectCache : public llvm::ObjectCache {
+ public:
+  DiskObjectCache(llvm::StringRef directory, mlir::Location loc)
+      : directory_(directory), loc_(loc) {}
+
+  void notifyObjectCompiled(const llvm::Module *module,
+                            llvm::MemoryBufferRef object) override {
+    std::string path = GetPath(module->getModuleIdentifier());
+    if (mlir::failed(Store(object.getBuffer(), path))) {
+      mlir::emitWarning(loc_) << "cannot write compilation cache entry "
+                              << path;
+    }
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> getObject(
+      const llvm::Module *module) override {
+    return Load(module->getModuleIdentifier());
+  }
+
+  // Returns the object code cached under `key` or nullptr if there is none.
+  std::unique_ptr<llvm::MemoryBuffer> Load(llvm::StringRef key) const {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+        llvm::MemoryBuffer::getFile(GetPath(key));
+    if (!buffer) return nullptr;
+    return std::move(*buffer);
+  }
+
+  // Removes the object code cached under `key`.
+  void Remove(llvm::StringRef key) const {
+    llvm::sys::fs::remove(GetPath(key));
+  }
+
+ private:
+  std::string GetPath(llvm::StringRef key) const {
+    llvm::SmallString<128> path(directory_);
+    llvm::sys::path::append(path, key + ".o");
+    return path.str().str();
+  }
+
+  // Writes `data` to `path`. Writes to a temporary file first so that
+  // concurrent readers never see partial files.
+  static mlir::LogicalResult Store(llvm::StringRef data,
+                                   llvm::StringRef path) {
+    if (llvm::sys::fs::create_directories(
+            llvm::sys::path::parent_path(path))) {
+      return mlir::failure();
+    }
+    int fd;
+    llvm::SmallString<128> temp_path;
+    if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd,
+                                        temp_path)) {
+      return mlir::failure();
+    }
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os << data;
+    os.close();
+    bool written = !os.has_error();
+    os.clear_error();
+    if (!written || llvm::sys::fs::rename(temp_path, path)) {
+      llvm::sys::fs::remove(temp_path);
+      return mlir::failure();
+    }
+    return mlir::success();
+  }
+
+  std::string directory_;
+  mlir::Location loc_;
+};
+
+// Creates a JIT for the host that calls `object_cache`, if not null, before
+// and after generating code. Symbols the JIT does not define are resolved in
+// the current process.
+llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> CreateJit(
+    llvm::ObjectCache *object_cache) {
+  llvm::orc::LLJITBuilder builder;
+  builder.setCompileFunctionCreator(
+      [object_cache](llvm::orc::JITTargetMachineBuilder machine_builder)
+          -> llvm::Expected<
+              std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+        auto machine = machine_builder.createTargetMachine();
+        if (!machine) return machine.takeError();
+        return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(
+            std::move(*machine), object_cache);
+      });
+  auto jit = builder.create();
+  if (!jit) return jit.takeError();
+
+  llvm::orc::JITDylib &dylib = (*jit)->getMainJITDylib();
+  auto process_symbols =
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          (*jit)->getDataLayout().getGlobalPrefix());
+  if (!process_symbols) return process_symbols.takeError();
+  dylib.addGenerator(std::move(*process_symbols));
+
+  // Resolve calls emitted by loops instrumented with `profile-loops`.
+  llvm::orc::MangleAndInterner interner((*jit)->getExecutionSession(),
+                                        (*jit)->getDataLayout());
+  llvm::orc::SymbolMap symbols;
+  auto add_symbol = [&](llvm::StringRef name, auto *function) {
+    symbols[interner(name)] = {llvm::orc::ExecutorAddr::fromPtr(function),
+                               llvm::JITSymbolFlags::Exported};
+  };
+  add_symbol(kLoopProfileBeginFunction, &sair_loop_profile_begin);
+  add_symbol(kLoopProfileEndFunction, &sair_loop_profile_end);
+  add_symbol("sair_loop_profile_dump", &sair_loop_profile_dump);
+  if (llvm::Error error = dylib.define(llvm::orc::absoluteSymbols(symbols))) {
+    return std::move(error);
+  }
+  return jit;
+}
+
+// Lowers a copy of `module` with `pipeline`, translates it to LLVM IR
+// identified by `key` and adds it to `jit`. Emits errors and returns failure
+// if lowering or translation fails.
+mlir::LogicalResult AddLoweredModule(mlir::ModuleOp module,
+                                     mlir::PassManager &pipeline,
+                                     llvm::StringRef key,
+                                     llvm::orc::LLJIT &jit) {
+  mlir::OwningOpRef<mlir::ModuleOp> lowered(module.clone());
+  if (mlir::failed(pipeline.run(*lowered))) return mlir::failure();
+
+  auto llvm_context = std::make_unique<llvm::LLVMContext>();
+  std::unique_ptr<llvm::Module> llvm_module =
+      mlir::translateModuleToLLVMIR(*lowered, *llvm_context, key);
+  if (llvm_module == nullptr) {
+    return mlir::emitError(module.getLoc()) << "cannot translate to LLVM IR";
+  }
+  llvm_module->setDataLayout(jit.getDataLayout());
+  llvm_module->setTargetTriple(jit.getTargetTriple().getTriple());
+
+  auto optimize = mlir::makeOptimizingTransformer(
+      /*optLevel=*/3, /*sizeLevel=*/0, /*targetMachine=*/nullptr);
+  llvm::Error error = optimize(llvm_module.get());
+  if (!error) {
+    error = jit.addIRModule(llvm::orc::ThreadSafeModule(
+        std::move(llvm_module), std::move(llvm_context)));
+  }
+  if (error) {
+    std::string message = llvm::toString(std::move(error));
+    return mlir::emitError(module.getLoc())
+           << "JIT compilation failed: " << message;
+  }
+  return mlir::success();
+}
+
+}  // namespace
+
+llvm::Error CompiledSairModule::Invoke(llvm::StringRef function) {
+  llvm::Expected<llvm::orc::ExecutorAddr> address = jit_->lookup(function);
+  if (!address) return address.takeError();
+  address->toPtr<void (*)()>()();
+  return llvm::Error::success();
+}
+
+std::unique_ptr<CompiledSairModule> CompileSairModule(
+    mlir::ModuleOp module, llvm::StringRef cache_directory) {
+  mlir::PassManager pm(module.getContext(),
+                       mlir::ModuleOp::getOperationName(),
+                       mlir::OpPassManager::Nesting::Implicit);
+  CreateSairToLLVMConversionPipeline(&pm);
+
+  std::string key = "sair";
+  std::unique_ptr<DiskObjectCache> object_cache;
+  if (!cache_directory.empty()) {
+    key = GetCacheKey(module, pm);
+    object_cache =
+        std::make_unique<DiskObjectCache>(cache_directory, module.getLoc());
+  }
+
+  auto jit = CreateJit(object_cache.get());
+  if (!jit) {
+    std::string message = llvm::toString(jit.takeError());
+    mlir::emitError(module.getLoc()) << "JIT compilation failed: " << message;
+    return nullptr;
+  }
+
+  // Load cached object code instead of lowering the module. A corrupted cache
+  // entry is recompiled rather than reported.
+  bool loaded = false;
+  if (object_cache != nullptr) {
+    if (std::unique_ptr<llvm::MemoryBuffer> object = object_cache->Load(key)) {
+      llvm::Error error = (*jit)->addObjectFile(std::move(object));
+      loaded = !error;
+      if (error) {
+        llvm::consumeError(std::move(error));
+        object_cache->Remove(key);
+      }
+    }
+  }
+  if (!loaded &&
+      mlir::failed(AddLoweredModule(module, pm, key, **jit))) {
+    return nullptr;
+  }
+  return std::make_unique<CompiledSairModule>(std::move(object_cache),
+                                              std::move(*jit));
+}
+
+std::optional<double> TimeFunction(CompiledSairModule &compiled,
+                                   llvm::StringRef function, int repetitions) {
+  if (llvm::Error error = compiled.Invoke(function)) {
+    llvm::errs() << "cannot call " << function << ": "
+                 << llvm::toString(std::move(error)) << "\n";
+    return std::nullopt;
+  }
+
+  double best = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < repetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    if (llvm::Error error = compiled.Invoke(function)) {
+      llvm::consumeError(std::move(error));
+      return std::nullopt;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+CompiledSairModule *SairKernelCache::GetOrCompile(mlir::ModuleOp module) {
+  std::string source;
+  llvm::raw_string_ostream os(source);
+  module.print(os);
+  os.flush();
+  llvm::hash_code hash = llvm::hash_value(source);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Kernel> &kernels = kernels_[hash];
+  for (const Kernel &kernel : kernels) {
+    if (kernel.source != source) continue;
+    ++num_hits_;
+    return kernel.compiled.get();
+  }
+
+  mlir::OwningOpRef<mlir::ModuleOp> annotated(module.clone());
+  mlir::PassManager pm(module.getContext(), mlir::ModuleOp::getOperationName(),
+                       mlir::OpPassManager::Nesting::Implicit);
+  CreateSairPreLoweringPipeline(&pm);
+  CreateDefaultLoweringAttributesPipeline(&pm);
+  if (mlir::failed(pm.run(*annotated))) return nullptr;
+  std::unique_ptr<CompiledSairModule> compiled =
+      CompileSairModule(*annotated, cache_directory_);
+  if (compiled == nullptr) return nullptr;
+
+  ++num_compilations_;
+  kernels.push_back({std::move(source), std::move(compiled)});
+  return kernels.back().compiled.get();
+}
+
+int SairKernelCache::num_compilations() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_compilations_;
+}
+
+int SairKernelCache::num_hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_hits_;
+}
+
+}  // namespace sair
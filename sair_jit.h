@@ -0,0 +1,114 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAIR_SAIR_JIT_H_
+#define SAIR_SAIR_JIT_H_
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/Support/Error.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/DialectRegistry.h"
+
+namespace sair {
+
+// Registers the translations to LLVM IR needed to JIT-compile lowered Sair
+// programs.
+void RegisterSairJitTranslations(mlir::DialectRegistry &registry);
+
+// A Sair module JIT-compiled to native code for the host.
+class CompiledSairModule {
+ public:
+  CompiledSairModule(std::unique_ptr<llvm::ObjectCache> object_cache,
+                     std::unique_ptr<llvm::orc::LLJIT> jit)
+      : object_cache_(std::move(object_cache)), jit_(std::move(jit)) {}
+
+  // Calls `function`, which must take no arguments and return no results.
+  // Code is generated on the first call.
+  llvm::Error Invoke(llvm::StringRef function);
+
+ private:
+  // Used by the compiler of `jit_`, and thus destroyed after it.
+  std::unique_ptr<llvm::ObjectCache> object_cache_;
+  std::unique_ptr<llvm::orc::LLJIT> jit_;
+};
+
+// Lowers a copy of `module` to LLVM with CreateSairToLLVMConversionPipeline and
+// JIT-compiles it. All lowering decisions must be specified. Emits errors and
+// returns nullptr on failure.
+//
+// If `cache_directory` is not empty, the object code generated by the JIT is
+// stored in the directory under a hash of the textual form of `module`, of the
+// passes and options of the pipeline, of the build of the compiler and of the
+// host target. Later calls with the same key load the object code instead of
+// running the pipeline and code generation again.
+std::unique_ptr<CompiledSairModule> CompileSairModule(
+    mlir::ModuleOp module, llvm::StringRef cache_directory = "");
+
+// Calls `function`, which takes no arguments and returns no results, once to
+// warm up caches and then `repetitions` times. Returns the minimal running time
+// in seconds or nullopt if the function cannot be called.
+std::optional<double> TimeFunction(CompiledSairModule &compiled,
+                                   llvm::StringRef function, int repetitions);
+
+// In-memory cache of JIT-compiled Sair modules, keyed by a hash of their
+// textual form, which includes programs and their lowering decisions.
+// Thread-safe.
+class SairKernelCache {
+ public:
+  // Compiles modules with the on-disk cache of CompileSairModule stored in
+  // `cache_directory`, if not empty.
+  explicit SairKernelCache(std::string cache_directory = "")
+      : cache_directory_(std::move(cache_directory)) {}
+
+  // Returns the kernel compiled for `module`. If no module with the same
+  // programs and decisions was compiled before, sets the decisions `module`
+  // leaves unspecified with CreateDefaultLoweringAttributesPipeline on a copy
+  // of `module` and compiles it with CompileSairModule. The kernel is owned by
+  // the cache. Emits errors and returns nullptr on failure.
+  CompiledSairModule *GetOrCompile(mlir::ModuleOp module);
+
+  // Number of modules compiled so far.
+  int num_compilations() const;
+  // Number of calls to GetOrCompile that reused a compiled module.
+  int num_hits() const;
+
+ private:
+  struct Kernel {
+    // Textual form of the module, used to tell apart modules whose hashes
+    // collide.
+    std::string source;
+    std::unique_ptr<CompiledSairModule> compiled;
+  };
+
+  std::string cache_directory_;
+  mutable std::mutex mutex_;
+  llvm::DenseMap<llvm::hash_code, std::vector<Kernel>> kernels_;
+  int num_compilations_ = 0;
+  int num_hits_ = 0;
+};
+
+}  // namespace sair
+
+#endif  // SAIR_SAIR_JIT_H_
@@ -31,6 +31,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/raw_ostream.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
@@ -900,7 +901,16 @@ mlir::LogicalResult VerifyLoadFromStoreToMemRef(mlir::Operation *op,
   return mlir::success();
 }
 
-static mlir::LogicalResult VerifyFromToMemRef(mlir::Operation *op,
+// Verifies that `alignment`, if present, is a power of two.
+static mlir::LogicalResult VerifyAlignment(mlir::Operation *op,
+                                           std::optional<uint64_t> alignment) {
+  if (alignment.has_value() && !llvm::isPowerOf2_64(*alignment)) {
+    return op->emitError() << "alignment must be a power of two";
+  }
+  return mlir::success();
+}
+
+static mlir::LogicalResult VerifyFromToMemRef(FromToMemRefOp op,
                                               int parallel_domain_size,
                                               DomainShapeAttr shape,
                                               mlir::Value memref,
@@ -926,7 +936,7 @@ static mlir::LogicalResult VerifyFromToMemRef(mlir::Operation *op,
     }
   }
 
-  return mlir::success();
+  return VerifyAlignment(op, op.getAlignment());
 }
 
 }  // namespace
@@ -977,10 +987,22 @@ mlir::LogicalResult SairAllocOp::verify() {
     return op.emitError() << "expected " << op.MemType().getNumDynamicDims()
                           << " dynamic size operands";
   }
-  return mlir::success();
+  return VerifyAlignment(op, op.getAlignment());
+}
+
+// Verifies that the prefetch distance of `op` is positive if present.
+static mlir::LogicalResult VerifyPrefetch(mlir::Operation *op,
+                                          PrefetchAttr prefetch) {
+  if (prefetch == nullptr || prefetch.distance().getInt() > 0) {
+    return mlir::success();
+  }
+  return op->emitError() << "prefetch distance must be positive";
 }
 
 mlir::LogicalResult SairLoadFromMemRefOp::verify() {
+  if (mlir::failed(VerifyPrefetch(*this, getPrefetchAttr()))) {
+    return mlir::failure();
+  }
   return VerifyLoadFromStoreToMemRef(*this, MemRefType(),
                                      getType().cast<ValueType>(), getLayout());
 }
@@ -991,6 +1013,9 @@ mlir::LogicalResult SairStoreToMemRefOp::verify() {
 }
 
 mlir::LogicalResult SairFromMemRefOp::verify() {
+  if (mlir::failed(VerifyPrefetch(*this, getPrefetchAttr()))) {
+    return mlir::failure();
+  }
   return VerifyFromToMemRef(*this, getParallelDomain().size(), getShape(),
                             getMemref(), getResult());
 }
@@ -1594,8 +1619,9 @@ mlir::LogicalResult SairProgramOp::verify() {
     return program.emitError() << "expected a sair.exit terminator";
   }
 
+  // Build each analysis once and share it between the verifiers below.
+  const SequenceAnalysis &sequence_analysis = *sequence_analysis_res;
   IterationSpaceAnalysis iteration_spaces(program);
-  SequenceAnalysis sequence_analysis(program);
   auto fusion_analysis_res =
       LoopFusionAnalysis::Create(program, sequence_analysis);
   if (!fusion_analysis_res.has_value()) return mlir::failure();
@@ -1832,7 +1858,9 @@ static mlir::ArrayAttr ComposeInstances(MappingAttr mapping,
   auto map_loop = [=](LoopAttr loop) {
     MappingExpr new_iter =
         loop.iter().SubstituteDims(mapping.Dimensions()).Canonicalize();
-    return LoopAttr::get(loop.name(), new_iter, loop.unroll(), context);
+    return LoopAttr::get(loop.name(), new_iter, loop.unroll(),
+                         loop.parallel(), loop.gpu(), loop.accumulators(),
+                         loop.peel(), context);
   };
   return MkArrayAttrMapper(MapLoopNest(MkArrayAttrMapper<LoopAttr>(map_loop)))(
       instances);
@@ -1911,7 +1939,7 @@ SairOp SairLoadFromMemRefOp::ReCreateWithNewDomain(
   auto new_instances = ComposeInstances(new_to_old_mapping, getInstancesAttr());
   auto new_op = builder.create<SairLoadFromMemRefOp>(
       getLoc(), return_type, new_domains[0], new_mappings, getMemref(),
-      new_layout, new_instances, /*copies=*/nullptr);
+      new_layout, new_instances, /*copies=*/nullptr, getPrefetchAttr());
   return llvm::cast<SairOp>(new_op.getOperation());
 }
 
@@ -1935,7 +1963,8 @@ SairOp SairStoreToMemRefOp::ReCreateWithNewDomain(
   auto new_instances = ComposeInstances(new_to_old_mapping, getInstancesAttr());
   auto new_op = builder.create<SairStoreToMemRefOp>(
       getLoc(), new_domains[0], new_mappings, getMemref(), getValue(),
-      new_layout, new_shape, new_instances, /*copies=*/nullptr);
+      new_layout, new_shape, new_instances, /*copies=*/nullptr,
+      getNontemporalAttr());
   return llvm::cast<SairOp>(new_op.getOperation());
 }
 
@@ -2005,7 +2034,8 @@ SairOp SairMapReduceOp::ReCreateWithNewDomain(
   auto new_instances = ComposeInstances(new_to_old_mapping, getInstancesAttr());
   auto new_op = builder.create<SairMapReduceOp>(
       getLoc(), new_return_types, new_domains[0], new_domains[1], new_mappings,
-      getInits(), getInputs(), new_shape, new_instances, /*copies=*/nullptr);
+      getInits(), getInputs(), new_shape, new_instances, /*copies=*/nullptr,
+      getSplitFactorAttr());
   // Create the map body.
   llvm::SmallVector<mlir::Type> block_arg_types(new_shape.NumDimensions(),
                                                 builder.getIndexType());
@@ -2094,7 +2124,8 @@ SairOp SairAllocOp::ReCreateWithNewDomain(
   auto new_instances = ComposeInstances(new_to_old_mapping, getInstancesAttr());
   auto new_op = builder.create<SairAllocOp>(
       getLoc(), new_return_type, new_domains[0], new_mappings,
-      getDynamicSizes(), new_instances, /*copies=*/nullptr);
+      getDynamicSizes(), new_instances, /*copies=*/nullptr,
+      getAlignmentAttr());
   return llvm::cast<SairOp>(new_op.getOperation());
 }
 
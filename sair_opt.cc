@@ -22,7 +22,9 @@
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include "mlir/IR/AsmState.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Dialect.h"
+#include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/InitAllDialects.h"
 #include "mlir/InitAllPasses.h"
@@ -33,6 +35,7 @@
 #include "mlir/Tools/mlir-opt/MlirOptMain.h"
 #include "sair_dialect.h"
 #include "sair_registration.h"
+#include "statistics_report.h"
 
 int main(int argc, char **argv) {
   llvm::cl::opt<std::string> input_filename(llvm::cl::Positional,
@@ -59,6 +62,16 @@ int main(int argc, char **argv) {
       llvm::cl::desc("Allow operation with no registered dialects"),
       llvm::cl::init(false));
 
+  llvm::cl::opt<bool> emit_bytecode(
+      "emit-bytecode", llvm::cl::desc("Emit bytecode when generating output"),
+      llvm::cl::init(false));
+
+  llvm::cl::opt<std::string> statistics_json(
+      "pass-statistics-json",
+      llvm::cl::desc("Write the statistics of passes run on each function to "
+                     "a JSON file"),
+      llvm::cl::value_desc("filename"), llvm::cl::init(""));
+
   llvm::InitLLVM init(argc, argv);
   mlir::registerMLIRContextCLOptions();
 
@@ -90,14 +103,46 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
-  return mlir::failed(mlir::MlirOptMain(
-      outputFile->os(), std::move(inputFile), registry,
+  MlirOptMainConfig config =
       MlirOptMainConfig{}
           .splitInputFile(split_input_file)
           .verifyDiagnostics(verify_diagnostics)
           .verifyPasses(true)
           .allowUnregisteredDialects(allowUnregisteredDialects)
-          .emitBytecode(false)
+          .emitBytecode(emit_bytecode)
           .useExplicitModule(false)
-          .setPassPipelineParser(passPipeline)));
+          .setPassPipelineParser(passPipeline);
+
+  sair::StatisticsReport statistics_report;
+  if (!statistics_json.empty()) {
+    config.setPassPipelineSetupFn(
+        [&](mlir::PassManager &pm) -> mlir::LogicalResult {
+          auto error_handler = [&](const llvm::Twine &message) {
+            mlir::emitError(mlir::UnknownLoc::get(pm.getContext())) << message;
+            return mlir::failure();
+          };
+          if (mlir::failed(passPipeline.addToPipeline(pm, error_handler))) {
+            return mlir::failure();
+          }
+          pm.addInstrumentation(statistics_report.CreateInstrumentation());
+          return mlir::success();
+        });
+  }
+
+  if (mlir::failed(mlir::MlirOptMain(outputFile->os(), std::move(inputFile),
+                                     registry, config))) {
+    return EXIT_FAILURE;
+  }
+
+  if (!statistics_json.empty()) {
+    std::unique_ptr<llvm::ToolOutputFile> statistics_file =
+        mlir::openOutputFile(statistics_json, &errorMessage);
+    if (!statistics_file) {
+      llvm::errs() << errorMessage << "\n";
+      return EXIT_FAILURE;
+    }
+    statistics_report.PrintAsJson(statistics_file->os());
+    statistics_file->keep();
+  }
+  return EXIT_SUCCESS;
 }
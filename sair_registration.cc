@@ -69,12 +69,35 @@ void sair::RegisterSairPasses() {
       },
       [](llvm::function_ref<void(const mlir::detail::PassOptions &)>) {});
 
+  mlir::registerPassPipeline(
+      "convert-sair-to-llvm-openmp",
+      "converts Sair operations to LLVM, running parallel loops with OpenMP",
+      [](mlir::OpPassManager &pm, llvm::StringRef options,
+         function_ref<LogicalResult(const Twine &)> errorHandler) {
+        if (!options.empty()) return mlir::failure();
+        sair::CreateSairToLLVMConversionPipeline(&pm, /*use_openmp=*/true);
+        return mlir::success();
+      },
+      [](llvm::function_ref<void(const mlir::detail::PassOptions &)>) {});
+
+  mlir::registerPassPipeline(
+      "convert-sair-to-gpu",
+      "converts Sair operations to loops and GPU kernels",
+      [](mlir::OpPassManager &pm, llvm::StringRef options,
+         function_ref<LogicalResult(const Twine &)> errorHandler) {
+        if (!options.empty()) return mlir::failure();
+        sair::CreateSairToGpuConversionPipeline(&pm);
+        return mlir::success();
+      },
+      [](llvm::function_ref<void(const mlir::detail::PassOptions &)>) {});
+
   mlir::registerPassPipeline(
       "sair-default-lowering-attributes",
       "annotates Sair operations with the default lowering strategy",
       [](mlir::OpPassManager &pm, llvm::StringRef options,
          function_ref<LogicalResult(const Twine &)> errorHandler) {
         if (!options.empty()) return mlir::failure();
+        sair::CreateSairPreLoweringPipeline(&pm);
         sair::CreateDefaultLoweringAttributesPipeline(&pm);
         return mlir::success();
       },
@@ -0,0 +1,108 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/InitAllDialects.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "loop_profile.h"
+#include "sair_jit.h"
+#include "sair_registration.h"
+
+int main(int argc, char **argv) {
+  llvm::cl::opt<std::string> input_filename(llvm::cl::Positional,
+                                            llvm::cl::desc("<input file>"),
+                                            llvm::cl::init("-"));
+  llvm::cl::opt<std::string> entry(
+      "entry", llvm::cl::desc("Function to run, without arguments or results"),
+      llvm::cl::Required);
+  llvm::cl::opt<int> repetitions(
+      "repetitions", llvm::cl::desc("Number of runs of the entry function"),
+      llvm::cl::init(1));
+  llvm::cl::opt<std::string> cache_directory(
+      "cache-dir",
+      llvm::cl::desc("Directory caching the output of the Sair-to-LLVM "
+                     "pipeline across runs of the tool"),
+      llvm::cl::value_desc("directory"), llvm::cl::init(""));
+  llvm::cl::opt<bool> verbose(
+      "verbose",
+      llvm::cl::desc("Report the running time of each run and the use of the "
+                     "kernel cache"),
+      llvm::cl::init(false));
+  llvm::cl::opt<bool> print_loop_profiles(
+      "print-loop-profiles",
+      llvm::cl::desc("Print the counters of loops instrumented for profiling "
+                     "once all runs are done and the kernel is unloaded"),
+      llvm::cl::init(false));
+
+  llvm::InitLLVM init(argc, argv);
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  mlir::registerMLIRContextCLOptions();
+  mlir::registerPassManagerCLOptions();
+  mlir::registerAsmPrinterCLOptions();
+  llvm::cl::ParseCommandLineOptions(argc, argv, "SAIR JIT runner\n");
+
+  mlir::DialectRegistry registry;
+  mlir::registerAllDialects(registry);
+  sair::RegisterSairJitTranslations(registry);
+  sair::RegisterSairDialect(registry);
+  mlir::MLIRContext context(registry);
+
+  mlir::OwningOpRef<mlir::ModuleOp> module =
+      mlir::parseSourceFile<mlir::ModuleOp>(input_filename, &context);
+  if (!module) return EXIT_FAILURE;
+
+  {
+    // Each run looks the kernel up in the cache, as a service receiving the
+    // same program multiple times would.
+    sair::SairKernelCache cache(cache_directory);
+    for (int i = 0; i < repetitions; ++i) {
+      sair::CompiledSairModule *compiled = cache.GetOrCompile(*module);
+      if (compiled == nullptr) return EXIT_FAILURE;
+      auto start = std::chrono::steady_clock::now();
+      if (llvm::Error error = compiled->Invoke(entry)) {
+        llvm::errs() << "cannot call " << entry << ": "
+                     << llvm::toString(std::move(error)) << "\n";
+        return EXIT_FAILURE;
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      if (verbose) {
+        llvm::errs() << "run " << i << ": " << elapsed.count() << "s\n";
+      }
+    }
+
+    if (verbose) {
+      llvm::errs() << "kernel cache: " << cache.num_compilations()
+                   << " compilations, " << cache.num_hits() << " hits\n";
+    }
+  }
+
+  // Loop counters are owned by the runtime and outlive the kernel.
+  if (print_loop_profiles) sair::PrintLoopProfiles(llvm::outs());
+  return EXIT_SUCCESS;
+}
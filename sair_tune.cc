@@ -0,0 +1,316 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// sair-tune searches for lowering decisions that minimize the running time of
+// a Sair program. Each candidate assigns sampled loop nests and expansion
+// patterns to operations that do not have them yet, completes the remaining
+// decisions with the default lowering attributes, is verified, compiled to LLVM
+// and timed by calling the entry function. Sampled loop nests are checked as
+// they are assigned, so that an invalid loop nest only leaves its operation to
+// the default lowering instead of rejecting the whole candidate. The fastest
+// annotated program is written to the output.
+//
+// The entry function must take no arguments and produce no results. It is
+// expected to prepare inputs and call the functions containing Sair programs.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Verifier.h"
+#include "mlir/InitAllDialects.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Support/LogicalResult.h"
+#include "expansion.h"
+#include "loop_nest.h"
+#include "sair_attributes.h"
+#include "sair_dialect.h"
+#include "sair_jit.h"
+#include "sair_op_interfaces.h"
+#include "sair_ops.h"
+#include "sair_registration.h"
+#include "sair_types.h"
+#include "scheduler.h"
+#include "transforms/default_lowering_attributes.h"
+#include "transforms/lowering.h"
+
+namespace {
+
+// Tile sizes considered when sampling loop nests. Zero stands for no tiling.
+constexpr int kTileSizes[] = {0, 4, 8, 16, 32, 64};
+
+// Unroll factors considered for the innermost loop. Zero stands for no
+// unrolling.
+constexpr int kUnrollFactors[] = {0, 2, 4};
+
+// Returns a uniformly sampled element of `values`.
+template <typename T, size_t N>
+T Sample(const T (&values)[N], std::mt19937 &rng) {
+  return values[std::uniform_int_distribution<size_t>(0, N - 1)(rng)];
+}
+
+// Samples a loop nest for `op`: loops are permuted, unit-step dimensions are
+// optionally striped and the innermost loop is optionally unrolled. Returns
+// nullptr if the loop nest should be left to the default lowering.
+mlir::ArrayAttr SampleLoopNest(const sair::ComputeOpInstance &op,
+                               sair::LoopFusionAnalysis &fusion_analysis,
+                               std::mt19937 &rng) {
+  mlir::MLIRContext *context = op.context();
+  int domain_size = op.domain_size();
+  if (domain_size == 0) return nullptr;
+
+  sair::DomainShapeAttr shape = op.GetShape();
+  llvm::SmallVector<int> tile_sizes(domain_size, 0);
+  for (int i = 0; i < domain_size; ++i) {
+    const sair::DomainShapeDim &dim = shape.Dimension(i);
+    // Dependent dimensions constrain the order of loops.
+    if (dim.DependencyMask().any()) return nullptr;
+    mlir::Operation *dim_op = op.domain(i).defining_op().GetDuplicatedOp();
+    auto range = llvm::dyn_cast<sair::RangeOp>(dim_op);
+    if (range == nullptr || range.Step() != 1) continue;
+    int tile_size = Sample(kTileSizes, rng);
+    auto static_range = dim.type().dyn_cast<sair::StaticRangeType>();
+    if (static_range != nullptr && tile_size >= static_range.size()) continue;
+    tile_sizes[i] = tile_size;
+  }
+
+  llvm::SmallVector<int> order =
+      llvm::to_vector(llvm::seq<int>(0, domain_size));
+  std::shuffle(order.begin(), order.end(), rng);
+
+  llvm::SmallVector<sair::MappingExpr> iters;
+  for (int i : order) {
+    if (tile_sizes[i] == 0) continue;
+    auto dim_expr = sair::MappingDimExpr::get(i, context);
+    iters.push_back(sair::MappingStripeExpr::get(dim_expr, {tile_sizes[i]}));
+  }
+  for (int i : order) {
+    sair::MappingExpr dim_expr = sair::MappingDimExpr::get(i, context);
+    if (tile_sizes[i] == 0) {
+      iters.push_back(dim_expr);
+    } else {
+      iters.push_back(
+          sair::MappingStripeExpr::get(dim_expr, {tile_sizes[i], 1}));
+    }
+  }
+
+  int unroll_factor = Sample(kUnrollFactors, rng);
+  llvm::SmallVector<mlir::Attribute> loop_nest;
+  for (int i = 0, e = iters.size(); i < e; ++i) {
+    mlir::IntegerAttr unroll;
+    if (i == e - 1 && unroll_factor > 0) {
+      unroll = mlir::IntegerAttr::get(mlir::IntegerType::get(context, 64),
+                                      unroll_factor);
+    }
+    loop_nest.push_back(sair::LoopAttr::get(
+        fusion_analysis.GetFreshLoopName(), iters[i], unroll,
+        /*parallel=*/{}, /*gpu=*/{}, /*accumulators=*/{}, /*peel=*/{},
+        context));
+  }
+  return mlir::ArrayAttr::get(context, loop_nest);
+}
+
+// Assigns sampled decisions to operation instances of `module` that do not
+// specify them yet. Fails and emits errors if the decisions already present in
+// `module` are invalid, in which case no decision is sampled.
+mlir::LogicalResult SampleDecisions(mlir::ModuleOp module, std::mt19937 &rng) {
+  llvm::SmallVector<sair::Scheduler> schedulers;
+  mlir::WalkResult result = module.walk([&](sair::SairProgramOp program) {
+    std::optional<sair::Scheduler> scheduler =
+        sair::Scheduler::Create(program);
+    if (!scheduler.has_value()) return mlir::WalkResult::interrupt();
+    schedulers.push_back(std::move(scheduler).value());
+    return mlir::WalkResult::advance();
+  });
+  if (result.wasInterrupted()) return mlir::failure();
+
+  // Rejected loop nests are rolled back by the scheduler and their diagnostics
+  // are not relevant to the user.
+  mlir::ScopedDiagnosticHandler silence(
+      module.getContext(), [](mlir::Diagnostic &) { return mlir::success(); });
+  for (sair::Scheduler &scheduler : schedulers) {
+    sair::SairProgramOp program = scheduler.program();
+    sair::LoopFusionAnalysis fusion_analysis(program.getOperation());
+    program.WalkComputeOpInstances([&](sair::ComputeOpInstance &op) {
+      sair::DecisionsAttr decisions = op.GetDecisions();
+      if (decisions.loop_nest() == nullptr) {
+        if (mlir::ArrayAttr loop_nest =
+                SampleLoopNest(op, fusion_analysis, rng)) {
+          (void)scheduler.SetLoopNest(op, loop_nest);
+        }
+      }
+
+      // Maps may be vectorized along their innermost loop.
+      decisions = op.GetDecisions();
+      if (decisions.expansion() != nullptr || op.is_copy() ||
+          !llvm::isa<sair::SairMapOp>(op.GetDuplicatedOp()) ||
+          std::uniform_int_distribution<int>(0, 1)(rng) == 0) {
+        return;
+      }
+      op.SetDecisions(sair::DecisionsAttr::get(
+          decisions.sequence(), decisions.loop_nest(), decisions.storage(),
+          mlir::StringAttr::get(op.context(), sair::kVectorExpansionPattern),
+          decisions.copy_of(), decisions.operands(), op.context()));
+    });
+  }
+  return mlir::success();
+}
+
+// Runs a pass pipeline populated by `populate` on `module`.
+mlir::LogicalResult RunPipeline(
+    mlir::ModuleOp module,
+    llvm::function_ref<void(mlir::OpPassManager *)> populate) {
+  mlir::PassManager pm(module.getContext(),
+                       mlir::ModuleOp::getOperationName(),
+                       mlir::OpPassManager::Nesting::Implicit);
+  populate(&pm);
+  return pm.run(module);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  llvm::cl::opt<std::string> input_filename(llvm::cl::Positional,
+                                            llvm::cl::desc("<input file>"),
+                                            llvm::cl::init("-"));
+  llvm::cl::opt<std::string> output_filename(
+      "o", llvm::cl::desc("Output filename"), llvm::cl::value_desc("filename"),
+      llvm::cl::init("-"));
+  llvm::cl::opt<std::string> entry(
+      "entry", llvm::cl::desc("Function to time, without arguments or results"),
+      llvm::cl::Required);
+  llvm::cl::opt<int> num_candidates(
+      "num-candidates",
+      llvm::cl::desc("Number of sampled candidates, besides the default "
+                     "lowering decisions"),
+      llvm::cl::init(16));
+  llvm::cl::opt<int> repetitions(
+      "repetitions",
+      llvm::cl::desc("Number of timed runs of each candidate"),
+      llvm::cl::init(3));
+  llvm::cl::opt<unsigned> seed(
+      "seed", llvm::cl::desc("Seed of the candidate sampler"),
+      llvm::cl::init(0));
+  llvm::cl::opt<bool> verbose(
+      "verbose", llvm::cl::desc("Report the outcome of each candidate"),
+      llvm::cl::init(false));
+
+  llvm::InitLLVM init(argc, argv);
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  mlir::registerMLIRContextCLOptions();
+  mlir::registerPassManagerCLOptions();
+  mlir::registerAsmPrinterCLOptions();
+  llvm::cl::ParseCommandLineOptions(argc, argv, "SAIR autotuning driver\n");
+
+  mlir::DialectRegistry registry;
+  mlir::registerAllDialects(registry);
+  sair::RegisterSairJitTranslations(registry);
+  sair::RegisterSairDialect(registry);
+  mlir::MLIRContext context(registry);
+
+  mlir::OwningOpRef<mlir::ModuleOp> original =
+      mlir::parseSourceFile<mlir::ModuleOp>(input_filename, &context);
+  if (!original) return EXIT_FAILURE;
+  if (mlir::failed(RunPipeline(*original, [](mlir::OpPassManager *pm) {
+        sair::CreateSairPreLoweringPipeline(pm);
+        pm->addPass(sair::CreateDefaultInstancePass());
+      }))) {
+    return EXIT_FAILURE;
+  }
+
+  std::mt19937 rng(seed);
+  mlir::OwningOpRef<mlir::ModuleOp> best;
+  double best_time = std::numeric_limits<double>::infinity();
+  for (int i = 0; i <= num_candidates; ++i) {
+    mlir::OwningOpRef<mlir::ModuleOp> candidate(original->clone());
+    // Decisions of the input are the same for all candidates, stop sampling if
+    // they cannot be edited.
+    if (i > 0 && mlir::failed(SampleDecisions(*candidate, rng))) {
+      llvm::errs() << "cannot sample lowering decisions, the input decisions "
+                      "are invalid\n";
+      break;
+    }
+    std::optional<double> time;
+    {
+      // Diagnostics of rejected candidates are not relevant to the user,
+      // except for the default lowering decisions that should always work.
+      std::optional<mlir::ScopedDiagnosticHandler> silence;
+      if (i > 0) {
+        silence.emplace(&context,
+                        [](mlir::Diagnostic &) { return mlir::success(); });
+      }
+      if (mlir::succeeded(mlir::verify(*candidate)) &&
+          mlir::succeeded(RunPipeline(*candidate, [](mlir::OpPassManager *pm) {
+            sair::CreateDefaultLoweringAttributesPipeline(pm);
+          }))) {
+        if (auto compiled = sair::CompileSairModule(*candidate)) {
+          time = sair::TimeFunction(*compiled, entry, repetitions);
+        }
+      }
+    }
+
+    if (verbose) {
+      llvm::errs() << "candidate " << i << ": ";
+      if (time.has_value()) {
+        llvm::errs() << *time << "s\n";
+      } else {
+        llvm::errs() << "rejected\n";
+      }
+    }
+    if (!time.has_value()) {
+      if (i == 0) {
+        llvm::errs() << "default lowering decisions failed\n";
+        return EXIT_FAILURE;
+      }
+      continue;
+    }
+    if (*time < best_time) {
+      best_time = *time;
+      best = std::move(candidate);
+    }
+  }
+
+  std::string error_message;
+  std::unique_ptr<llvm::ToolOutputFile> output_file =
+      mlir::openOutputFile(output_filename, &error_message);
+  if (!output_file) {
+    llvm::errs() << error_message << "\n";
+    return EXIT_FAILURE;
+  }
+  best->print(output_file->os());
+  output_file->os() << "\n";
+  output_file->keep();
+  return EXIT_SUCCESS;
+}
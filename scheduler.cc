@@ -0,0 +1,217 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scheduler.h"
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
+#include "util.h"
+
+namespace sair {
+
+std::optional<Scheduler> Scheduler::Create(SairProgramOp program) {
+  Scheduler scheduler(program);
+  auto sequence_analysis =
+      SequenceAnalysis::Create(program, /*report_errors=*/true);
+  if (!sequence_analysis.has_value()) return std::nullopt;
+  scheduler.sequence_ =
+      std::make_unique<SequenceAnalysis>(std::move(sequence_analysis).value());
+  scheduler.iteration_spaces_ =
+      std::make_unique<IterationSpaceAnalysis>(program);
+
+  auto fusion_analysis =
+      LoopFusionAnalysis::Create(program, *scheduler.sequence_);
+  if (!fusion_analysis.has_value()) return std::nullopt;
+  scheduler.fusion_ =
+      std::make_unique<LoopFusionAnalysis>(std::move(fusion_analysis).value());
+  if (mlir::failed(VerifyLoopNests(program, *scheduler.fusion_,
+                                   *scheduler.iteration_spaces_,
+                                   *scheduler.sequence_))) {
+    return std::nullopt;
+  }
+
+  auto storage_analysis = StorageAnalysis::Create(
+      program, *scheduler.fusion_, *scheduler.iteration_spaces_,
+      *scheduler.sequence_);
+  if (!storage_analysis.has_value()) return std::nullopt;
+  scheduler.storage_ =
+      std::make_unique<StorageAnalysis>(std::move(storage_analysis).value());
+  if (mlir::failed(VerifyStorages(program, *scheduler.storage_,
+                                  *scheduler.fusion_,
+                                  *scheduler.iteration_spaces_,
+                                  *scheduler.sequence_))) {
+    return std::nullopt;
+  }
+  return scheduler;
+}
+
+mlir::LogicalResult Scheduler::SetLoopNest(ComputeOpInstance op,
+                                           mlir::ArrayAttr loop_nest) {
+  DecisionsAttr decisions = op.GetDecisions();
+  return SetDecisions(
+      op,
+      DecisionsAttr::get(decisions.sequence(), loop_nest, decisions.storage(),
+                         decisions.expansion(), decisions.copy_of(),
+                         decisions.operands(), op.context()),
+      EditKind::kLoopNest);
+}
+
+mlir::LogicalResult Scheduler::SetStorage(ComputeOpInstance op,
+                                          mlir::ArrayAttr storage) {
+  DecisionsAttr decisions = op.GetDecisions();
+  return SetDecisions(
+      op,
+      DecisionsAttr::get(decisions.sequence(), decisions.loop_nest(), storage,
+                         decisions.expansion(), decisions.copy_of(),
+                         decisions.operands(), op.context()),
+      EditKind::kStorage);
+}
+
+mlir::LogicalResult Scheduler::SetSequence(ComputeOpInstance op,
+                                           mlir::IntegerAttr sequence) {
+  DecisionsAttr decisions = op.GetDecisions();
+  return SetDecisions(
+      op,
+      DecisionsAttr::get(sequence, decisions.loop_nest(), decisions.storage(),
+                         decisions.expansion(), decisions.copy_of(),
+                         decisions.operands(), op.context()),
+      EditKind::kSequence);
+}
+
+mlir::LogicalResult Scheduler::SetDecisions(ComputeOpInstance op,
+                                            DecisionsAttr decisions,
+                                            EditKind kind) {
+  DecisionsAttr old_decisions = op.GetDecisions();
+  op.SetDecisions(decisions);
+
+  // Only the edited operation needs to be checked on its own, other
+  // operations were already verified.
+  mlir::Operation *operation = op.GetDuplicatedOp();
+  if (mlir::failed(
+          operation->getRegisteredInfo()->verifyInvariants(operation))) {
+    op.SetDecisions(old_decisions);
+    return mlir::failure();
+  }
+  if (mlir::failed(Update(op, old_decisions, kind, /*verify=*/true))) {
+    op.SetDecisions(old_decisions);
+    AssertSuccess(Update(op, decisions, kind, /*verify=*/false));
+    return mlir::failure();
+  }
+  edits_.push_back({op, old_decisions, kind});
+  return mlir::success();
+}
+
+// Returns `op`, the non-compute operations using its results, directly or
+// through other non-compute operations, and the compute operations using the
+// results of all these operations. These are the operations whose loop nest
+// constraints depend on the decisions of `op`.
+static llvm::SmallVector<OpInstance> GetAffectedOps(
+    const ComputeOpInstance &op) {
+  llvm::SetVector<OpInstance> ops;
+  ops.insert(op);
+  for (int i = 0; i < ops.size(); ++i) {
+    if (i > 0 && ops[i].isa<ComputeOpInstance>()) continue;
+    for (ResultInstance result : ops[i].Results()) {
+      for (auto &[user, pos] : result.GetUses()) {
+        (void)pos;
+        ops.insert(user);
+      }
+    }
+  }
+  return llvm::to_vector(ops);
+}
+
+mlir::LogicalResult Scheduler::Update(const ComputeOpInstance &op,
+                                      DecisionsAttr old_decisions,
+                                      EditKind kind, bool verify) {
+  llvm::SmallVector<OpInstance> ops = GetAffectedOps(op);
+  if (kind != EditKind::kStorage) {
+    if (kind == EditKind::kSequence &&
+        mlir::failed(sequence_->Resequence(op, /*report_errors=*/verify))) {
+      return mlir::failure();
+    }
+    if (kind == EditKind::kLoopNest) iteration_spaces_->Update(op);
+
+    // Rebuild the loop trees `op` leaves or enters, along with the ones of
+    // operations depending on `op` whose ranges may now be defined later.
+    llvm::SmallVector<mlir::StringAttr> roots;
+    auto add_root = [&](llvm::ArrayRef<mlir::Attribute> loop_nest) {
+      if (loop_nest.empty()) return;
+      mlir::StringAttr root = loop_nest.front().cast<LoopAttr>().name();
+      if (!llvm::is_contained(roots, root)) roots.push_back(root);
+    };
+    if (old_decisions.loop_nest() != nullptr) {
+      add_root(old_decisions.loop_nest().getValue());
+    }
+    for (const OpInstance &affected_op : ops) {
+      auto compute_op = affected_op.dyn_cast<ComputeOpInstance>();
+      if (compute_op != nullptr) add_root(compute_op.Loops());
+    }
+    llvm::SmallVector<ComputeOpInstance> nested_ops;
+    if (mlir::failed(fusion_->UpdateLoopTrees(program_, roots, *sequence_,
+                                              nested_ops))) {
+      return mlir::failure();
+    }
+    if (verify &&
+        mlir::failed(VerifyLoopNests(ops, nested_ops, *fusion_,
+                                     *iteration_spaces_, *sequence_))) {
+      return mlir::failure();
+    }
+
+    // Storages only depend on the sequence through buffer accesses.
+    if (kind == EditKind::kSequence && !AccessesBuffers(ops)) {
+      return mlir::success();
+    }
+  }
+
+  auto storage_analysis = StorageAnalysis::Create(
+      program_, *fusion_, *iteration_spaces_, *sequence_);
+  if (!storage_analysis.has_value()) return mlir::failure();
+  storage_ =
+      std::make_unique<StorageAnalysis>(std::move(storage_analysis).value());
+  if (!verify) return mlir::success();
+  return VerifyStorages(program_, *storage_, *fusion_, *iteration_spaces_,
+                        *sequence_);
+}
+
+bool Scheduler::AccessesBuffers(llvm::ArrayRef<OpInstance> ops) const {
+  auto in_buffer = [&](ResultInstance value) {
+    return storage_->GetStorage(value).buffer_name() != nullptr;
+  };
+  for (const OpInstance &op : ops) {
+    if (llvm::any_of(op.Results(), in_buffer)) return true;
+    for (OperandInstance operand : op.Operands()) {
+      auto value = operand.GetValue();
+      if (value.has_value() && in_buffer(*value)) return true;
+    }
+  }
+  return false;
+}
+
+bool Scheduler::Undo() {
+  if (edits_.empty()) return false;
+  Edit edit = edits_.pop_back_val();
+  DecisionsAttr decisions = edit.op.GetDecisions();
+  edit.op.SetDecisions(edit.decisions);
+  AssertSuccess(Update(edit.op, decisions, edit.kind, /*verify=*/false));
+  return true;
+}
+
+}  // namespace sair
@@ -0,0 +1,128 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAIR_SCHEDULER_H_
+#define SAIR_SCHEDULER_H_
+
+#include <memory>
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/Support/LogicalResult.h"
+#include "loop_nest.h"
+#include "sair_attributes.h"
+#include "sair_op_interfaces.h"
+#include "sair_ops.h"
+#include "sequence.h"
+#include "storage.h"
+
+namespace sair {
+
+// Edits lowering decisions of a Sair program one operation at a time, checking
+// each edit against the analyses of the program. The scheduler keeps the
+// sequence, iteration space, loop fusion and storage analyses of the program
+// alive and updates them in place: an edit only moves the edited operation in
+// the sequence, recomputes the iteration spaces inferred from it and rebuilds
+// the fusion classes of the loop trees it is nested in. Loop nests are only
+// verified around the edited operation. The storage analysis propagates
+// storages across the whole program and is rebuilt, unless a sequence edit
+// does not move buffer accesses. Rejected edits are rolled back and accepted
+// edits can be undone by restoring the decisions they replaced.
+//
+// Sequence, loop nest and storage decisions must not be modified by other
+// means while the scheduler is alive. Expansion patterns are not checked by the
+// scheduler.
+class Scheduler {
+ public:
+  // Creates a scheduler for `program`. Returns `nullopt` and emits errors if
+  // the lowering decisions of the program are invalid.
+  static std::optional<Scheduler> Create(SairProgramOp program);
+
+  // Sets the loop nest of `op`. Returns a failure, emits an error and leaves
+  // the program unchanged if the new loop nest is invalid.
+  mlir::LogicalResult SetLoopNest(ComputeOpInstance op,
+                                  mlir::ArrayAttr loop_nest);
+
+  // Sets the storage of the results of `op`. Same as above if the new storage
+  // is invalid.
+  mlir::LogicalResult SetStorage(ComputeOpInstance op, mlir::ArrayAttr storage);
+
+  // Sets the sequence number of `op`. Same as above if the new sequence number
+  // is invalid.
+  mlir::LogicalResult SetSequence(ComputeOpInstance op,
+                                  mlir::IntegerAttr sequence);
+
+  // Reverts the last accepted edit that was not committed yet. Returns false if
+  // there is no such edit.
+  bool Undo();
+
+  // Forgets about accepted edits, that can no longer be undone.
+  void Commit() { edits_.clear(); }
+
+  // Number of edits that can be undone.
+  int num_edits() const { return edits_.size(); }
+
+  SairProgramOp program() const { return program_; }
+
+  // Analyses of the program, up to date with the last edit. References are
+  // invalidated by edits.
+  const SequenceAnalysis &sequence_analysis() const { return *sequence_; }
+  const IterationSpaceAnalysis &iteration_spaces() const {
+    return *iteration_spaces_;
+  }
+  const LoopFusionAnalysis &fusion_analysis() const { return *fusion_; }
+  const StorageAnalysis &storage_analysis() const { return *storage_; }
+
+ private:
+  // Decisions an edit modifies.
+  enum class EditKind { kSequence, kLoopNest, kStorage };
+
+  // An accepted edit along with the decisions it replaced.
+  struct Edit {
+    ComputeOpInstance op;
+    DecisionsAttr decisions;
+    EditKind kind;
+  };
+
+  explicit Scheduler(SairProgramOp program) : program_(program) {}
+
+  // Replaces the decisions of `op`, updates the analyses and verifies the
+  // edit. Restores the previous decisions and analyses if verification fails.
+  mlir::LogicalResult SetDecisions(ComputeOpInstance op,
+                                   DecisionsAttr decisions, EditKind kind);
+
+  // Updates the analyses after an edit of kind `kind` replaced the
+  // `old_decisions` of `op`. Verifies the edit if `verify` is set. Rolling
+  // back an edit runs the same update, which cannot fail, without
+  // verification.
+  mlir::LogicalResult Update(const ComputeOpInstance &op,
+                             DecisionsAttr old_decisions, EditKind kind,
+                             bool verify);
+
+  // Indicates if `ops` produce or use values stored in buffers.
+  bool AccessesBuffers(llvm::ArrayRef<OpInstance> ops) const;
+
+  SairProgramOp program_;
+  std::unique_ptr<SequenceAnalysis> sequence_;
+  std::unique_ptr<IterationSpaceAnalysis> iteration_spaces_;
+  std::unique_ptr<LoopFusionAnalysis> fusion_;
+  std::unique_ptr<StorageAnalysis> storage_;
+  llvm::SmallVector<Edit> edits_;
+};
+
+}  // namespace sair
+
+#endif  // SAIR_SCHEDULER_H_
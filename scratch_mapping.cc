@@ -0,0 +1,561 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "scratch_mapping.h"
+
+#include <algorithm>
+
+#include "llvm/ADT/STLExtras.h"
+
+namespace sair {
+
+ScratchMapping::ScratchMapping(MappingAttr mapping)
+    : use_domain_size_(mapping.UseDomainSize()) {
+  dims_.reserve(mapping.size());
+  for (MappingExpr expr : mapping) {
+    dims_.push_back(Import(expr));
+  }
+}
+
+ScratchMapping ScratchMapping::GetIdentity(int num_dimensions,
+                                           int use_domain_size) {
+  if (use_domain_size == -1) use_domain_size = num_dimensions;
+  assert(use_domain_size >= num_dimensions);
+  ScratchMapping result(use_domain_size);
+  for (int i = 0; i < num_dimensions; ++i) {
+    result.dims_.push_back(result.AddDim(i));
+  }
+  return result;
+}
+
+MappingAttr ScratchMapping::ToAttr(mlir::MLIRContext *context) const {
+  llvm::SmallVector<MappingExpr, 4> exprs;
+  exprs.reserve(size());
+  for (ExprId id : dims_) {
+    exprs.push_back(ToMappingExpr(id, context));
+  }
+  return MappingAttr::get(context, use_domain_size_, exprs);
+}
+
+bool ScratchMapping::HasNoneExprs() const {
+  llvm::SmallVector<ExprId, 8> worklist(dims_.begin(), dims_.end());
+  while (!worklist.empty()) {
+    ExprId id = worklist.pop_back_val();
+    if (kind(id) == Kind::kNone) return true;
+    llvm::append_range(worklist, operands(id));
+  }
+  return false;
+}
+
+ScratchMapping ScratchMapping::Compose(const ScratchMapping &other) const {
+  ScratchMapping result(use_domain_size_);
+  llvm::SmallVector<ExprId, 4> substitutions;
+  substitutions.reserve(size());
+  for (ExprId id : dims_) {
+    substitutions.push_back(result.Import(*this, id, [&](int dimension) {
+      return result.AddDim(dimension);
+    }));
+  }
+
+  ExprId none = kInvalidExpr;
+  result.dims_.reserve(other.size());
+  for (ExprId id : other.dims_) {
+    result.dims_.push_back(result.Import(other, id, [&](int dimension) {
+      if (dimension < substitutions.size()) return substitutions[dimension];
+      if (none == kInvalidExpr) none = result.AddNone();
+      return none;
+    }));
+  }
+  return result;
+}
+
+ScratchMapping ScratchMapping::ResizeUseDomain(int new_size) const {
+  if (new_size >= use_domain_size_) {
+    ScratchMapping result = *this;
+    result.use_domain_size_ = new_size;
+    return result;
+  }
+
+  ScratchMapping result(new_size);
+  result.dims_.reserve(size());
+  for (ExprId id : dims_) {
+    result.dims_.push_back(result.Import(*this, id, [&](int dimension) {
+      return dimension < new_size ? result.AddDim(dimension)
+                                  : result.AddNone();
+    }));
+  }
+  return result;
+}
+
+ScratchMapping ScratchMapping::Resize(int new_size) const {
+  if (new_size == size()) return *this;
+
+  ScratchMapping result(use_domain_size_);
+  result.dims_.reserve(new_size);
+  for (ExprId id : llvm::ArrayRef(dims_).take_front(new_size)) {
+    result.dims_.push_back(result.Import(*this, id, [&](int dimension) {
+      return result.AddDim(dimension);
+    }));
+  }
+  if (new_size > size()) {
+    result.dims_.resize(new_size, result.AddNone());
+  }
+  return result;
+}
+
+ScratchMapping ScratchMapping::ShiftRight(int offset, int start_from) const {
+  ScratchMapping result = *this;
+  result.use_domain_size_ += offset;
+  for (Expr &expr : result.exprs_) {
+    if (expr.kind != Kind::kDim || expr.dimension < start_from) continue;
+    expr.dimension += offset;
+  }
+  return result;
+}
+
+ScratchMapping ScratchMapping::Inverse() const {
+  ScratchMapping result(size());
+  result.dims_.assign(use_domain_size_, result.AddNone());
+  for (int i = 0, e = size(); i < e; ++i) {
+    ExprId dim_expr = result.AddDim(i);
+    auto status = result.SetInverse(*this, dims_[i], dim_expr, result.dims_);
+    assert(mlir::succeeded(status));
+    (void)status;
+  }
+  return result;
+}
+
+ScratchMapping ScratchMapping::Canonicalize() const {
+  ScratchMapping result(use_domain_size_);
+  result.dims_.reserve(size());
+  for (ExprId id : dims_) {
+    result.dims_.push_back(result.CanonicalizeExpr(*this, id));
+  }
+  return result;
+}
+
+std::optional<ScratchMapping> ScratchMapping::Unify(
+    const ScratchMapping &other) const {
+  assert(size() == other.size());
+  assert(use_domain_size_ == other.use_domain_size_);
+  ScratchMapping result(use_domain_size_);
+  result.dims_.reserve(size());
+  for (auto [lhs, rhs] : llvm::zip(dims_, other.dims_)) {
+    ExprId unified = result.UnifyExprs(*this, lhs, other, rhs);
+    if (unified == kInvalidExpr) return std::nullopt;
+    result.dims_.push_back(unified);
+  }
+  return result;
+}
+
+ScratchMapping::ExprId ScratchMapping::AddDim(int dimension) {
+  Expr expr{Kind::kDim};
+  expr.dimension = dimension;
+  exprs_.push_back(expr);
+  return exprs_.size() - 1;
+}
+
+ScratchMapping::ExprId ScratchMapping::AddNone() {
+  exprs_.push_back(Expr{Kind::kNone});
+  return exprs_.size() - 1;
+}
+
+ScratchMapping::ExprId ScratchMapping::AddUnknown() {
+  exprs_.push_back(Expr{Kind::kUnknown});
+  return exprs_.size() - 1;
+}
+
+ScratchMapping::ExprId ScratchMapping::AddStripe(ExprId operand,
+                                                 llvm::ArrayRef<int> factors) {
+  assert(!factors.empty());
+  // `factors` may point into `factors_`.
+  llvm::SmallVector<int, 4> factors_copy(factors.begin(), factors.end());
+  Expr expr{Kind::kStripe};
+  expr.operands_begin = operands_.size();
+  expr.num_operands = 1;
+  expr.factors_begin = factors_.size();
+  expr.num_factors = factors_copy.size();
+  operands_.push_back(operand);
+  llvm::append_range(factors_, factors_copy);
+  exprs_.push_back(expr);
+  return exprs_.size() - 1;
+}
+
+ScratchMapping::ExprId ScratchMapping::AddUnStripe(
+    llvm::ArrayRef<ExprId> operands, llvm::ArrayRef<int> factors) {
+  assert(operands.size() == factors.size());
+  assert(factors.back() == 1);
+#ifndef NDEBUG
+  for (int i = 0; i + 1 < factors.size(); ++i) {
+    assert(factors[i] > factors[i + 1]);
+  }
+#endif
+  // `operands` and `factors` may point into `operands_` and `factors_`.
+  llvm::SmallVector<ExprId, 4> operands_copy(operands.begin(), operands.end());
+  llvm::SmallVector<int, 4> factors_copy(factors.begin(), factors.end());
+  Expr expr{Kind::kUnStripe};
+  expr.operands_begin = operands_.size();
+  expr.num_operands = operands_copy.size();
+  expr.factors_begin = factors_.size();
+  expr.num_factors = factors_copy.size();
+  llvm::append_range(operands_, operands_copy);
+  llvm::append_range(factors_, factors_copy);
+  exprs_.push_back(expr);
+  return exprs_.size() - 1;
+}
+
+ScratchMapping::ExprId ScratchMapping::Import(MappingExpr expr) {
+  if (auto dim_expr = expr.dyn_cast<MappingDimExpr>()) {
+    return AddDim(dim_expr.dimension());
+  }
+  if (expr.isa<MappingNoneExpr>()) return AddNone();
+  if (expr.isa<MappingUnknownExpr>()) return AddUnknown();
+  if (auto stripe = expr.dyn_cast<MappingStripeExpr>()) {
+    return AddStripe(Import(stripe.operand()), stripe.factors());
+  }
+  auto unstripe = expr.cast<MappingUnStripeExpr>();
+  llvm::SmallVector<ExprId, 4> operands;
+  operands.reserve(unstripe.operands().size());
+  for (MappingExpr operand : unstripe.operands()) {
+    operands.push_back(Import(operand));
+  }
+  return AddUnStripe(operands, unstripe.factors());
+}
+
+ScratchMapping::ExprId ScratchMapping::Import(const ScratchMapping &source,
+                                              ExprId id,
+                                              DimSubstitution substitution) {
+  switch (source.kind(id)) {
+    case Kind::kDim:
+      return substitution(source.dimension(id));
+    case Kind::kNone:
+      return AddNone();
+    case Kind::kUnknown:
+      return AddUnknown();
+    case Kind::kStripe: {
+      ExprId operand = Import(source, source.operands(id)[0], substitution);
+      return AddStripe(operand, source.factors(id));
+    }
+    case Kind::kUnStripe: {
+      // Copy operands as `source` may be the arena itself.
+      llvm::SmallVector<ExprId, 4> operands =
+          llvm::to_vector<4>(source.operands(id));
+      for (ExprId &operand : operands) {
+        operand = Import(source, operand, substitution);
+      }
+      return AddUnStripe(operands, source.factors(id));
+    }
+  }
+  llvm_unreachable("unknown expression kind");
+}
+
+MappingExpr ScratchMapping::ToMappingExpr(ExprId id,
+                                          mlir::MLIRContext *context) const {
+  switch (kind(id)) {
+    case Kind::kDim:
+      return MappingDimExpr::get(dimension(id), context);
+    case Kind::kNone:
+      return MappingNoneExpr::get(context);
+    case Kind::kUnknown:
+      return MappingUnknownExpr::get(context);
+    case Kind::kStripe:
+      return MappingStripeExpr::get(ToMappingExpr(operands(id)[0], context),
+                                    factors(id));
+    case Kind::kUnStripe: {
+      llvm::SmallVector<MappingExpr, 4> operand_exprs;
+      for (ExprId operand : operands(id)) {
+        operand_exprs.push_back(ToMappingExpr(operand, context));
+      }
+      return MappingUnStripeExpr::get(operand_exprs, factors(id));
+    }
+  }
+  llvm_unreachable("unknown expression kind");
+}
+
+bool ScratchMapping::Equal(ExprId lhs, ExprId rhs) const {
+  if (lhs == rhs) return true;
+  if (kind(lhs) != kind(rhs)) return false;
+  switch (kind(lhs)) {
+    case Kind::kDim:
+      return dimension(lhs) == dimension(rhs);
+    case Kind::kNone:
+    case Kind::kUnknown:
+      return true;
+    case Kind::kStripe:
+    case Kind::kUnStripe:
+      return factors(lhs) == factors(rhs) &&
+             std::equal(operands(lhs).begin(), operands(lhs).end(),
+                        operands(rhs).begin(), operands(rhs).end(),
+                        [&](ExprId x, ExprId y) { return Equal(x, y); });
+  }
+  llvm_unreachable("unknown expression kind");
+}
+
+ScratchMapping::ExprId ScratchMapping::UnifyExprs(
+    const ScratchMapping &lhs_source, ExprId lhs,
+    const ScratchMapping &rhs_source, ExprId rhs) {
+  Kind lhs_kind = lhs_source.kind(lhs);
+  Kind rhs_kind = rhs_source.kind(rhs);
+  auto copy = [&](const ScratchMapping &source, ExprId id) {
+    return Import(source, id, [&](int dimension) { return AddDim(dimension); });
+  };
+
+  // Resolves unification when one of the expressions is `none` or `?`.
+  auto on_mismatch = [&]() -> ExprId {
+    if (lhs_kind == Kind::kNone) return copy(rhs_source, rhs);
+    if (rhs_kind == Kind::kNone) return copy(lhs_source, lhs);
+    if (lhs_kind == Kind::kUnknown) return copy(rhs_source, rhs);
+    if (rhs_kind == Kind::kUnknown) return copy(lhs_source, lhs);
+    return kInvalidExpr;
+  };
+
+  if (lhs_kind != rhs_kind) return on_mismatch();
+  switch (lhs_kind) {
+    case Kind::kDim:
+      if (lhs_source.dimension(lhs) != rhs_source.dimension(rhs)) {
+        return on_mismatch();
+      }
+      return AddDim(lhs_source.dimension(lhs));
+    case Kind::kNone:
+      return AddNone();
+    case Kind::kUnknown:
+      return AddUnknown();
+    case Kind::kStripe: {
+      if (lhs_source.factors(lhs) != rhs_source.factors(rhs)) {
+        return on_mismatch();
+      }
+      ExprId operand = UnifyExprs(lhs_source, lhs_source.operands(lhs)[0],
+                                  rhs_source, rhs_source.operands(rhs)[0]);
+      if (operand == kInvalidExpr) return kInvalidExpr;
+      return AddStripe(operand, lhs_source.factors(lhs));
+    }
+    case Kind::kUnStripe:
+      break;
+  }
+
+  // Unify operands of the expression with the least factors with the prefix of
+  // the operands of the other.
+  const ScratchMapping *max_source = &lhs_source;
+  ExprId max_expr = lhs;
+  const ScratchMapping *min_source = &rhs_source;
+  ExprId min_expr = rhs;
+  if (lhs_source.factors(lhs).size() < rhs_source.factors(rhs).size()) {
+    std::swap(max_source, min_source);
+    std::swap(max_expr, min_expr);
+  }
+
+  // Copy operands and factors as the arena may be one of the sources.
+  llvm::SmallVector<ExprId, 4> max_operands =
+      llvm::to_vector<4>(max_source->operands(max_expr));
+  llvm::SmallVector<int, 4> new_factors =
+      llvm::to_vector<4>(max_source->factors(max_expr));
+  llvm::SmallVector<ExprId, 4> min_operands =
+      llvm::to_vector<4>(min_source->operands(min_expr));
+  llvm::SmallVector<int, 4> min_factors =
+      llvm::to_vector<4>(min_source->factors(min_expr));
+
+  // If the last operand is `none` or `?`, it can be replaced by an arbitrary
+  // number of operands.
+  Kind last_kind = min_source->kind(min_operands.back());
+  if (last_kind == Kind::kNone || last_kind == Kind::kUnknown) {
+    min_operands.pop_back();
+    min_factors.pop_back();
+  }
+
+  if (llvm::ArrayRef(min_factors) !=
+      llvm::ArrayRef(new_factors).take_front(min_factors.size())) {
+    return on_mismatch();
+  }
+
+  llvm::SmallVector<ExprId, 4> new_operands;
+  new_operands.reserve(max_operands.size());
+  for (int i = 0, e = max_operands.size(); i < e; ++i) {
+    ExprId operand =
+        i < min_operands.size()
+            ? UnifyExprs(*max_source, max_operands[i], *min_source,
+                         min_operands[i])
+            : copy(*max_source, max_operands[i]);
+    if (operand == kInvalidExpr) return kInvalidExpr;
+    new_operands.push_back(operand);
+  }
+  return AddUnStripe(new_operands, new_factors);
+}
+
+mlir::LogicalResult ScratchMapping::SetInverse(
+    const ScratchMapping &source, ExprId id, ExprId context_inverse,
+    llvm::MutableArrayRef<ExprId> inverses) {
+  switch (source.kind(id)) {
+    case Kind::kDim: {
+      int dimension = source.dimension(id);
+      ExprId inverse =
+          UnifyExprs(*this, inverses[dimension], *this, context_inverse);
+      if (inverse == kInvalidExpr) return mlir::failure();
+      inverses[dimension] = inverse;
+      return mlir::success();
+    }
+    case Kind::kNone:
+    case Kind::kUnknown:
+      return mlir::success();
+    case Kind::kStripe: {
+      ExprId none = AddNone();
+      llvm::SmallVector<int, 4> unstripe_factors =
+          llvm::to_vector<4>(source.factors(id));
+      // Prefix unstripe operands by none for outer stripes.
+      llvm::SmallVector<ExprId, 4> unstripe_operands(
+          unstripe_factors.size() - 1, none);
+      unstripe_operands.push_back(context_inverse);
+      // Add a `none` operand for inner stripes.
+      if (unstripe_factors.back() != 1) {
+        unstripe_factors.push_back(1);
+        unstripe_operands.push_back(none);
+      }
+      ExprId unstripe = AddUnStripe(unstripe_operands, unstripe_factors);
+      return SetInverse(source, source.operands(id)[0], unstripe, inverses);
+    }
+    case Kind::kUnStripe: {
+      llvm::ArrayRef<int> unstripe_factors = source.factors(id);
+      for (int i = 0, e = unstripe_factors.size(); i < e; ++i) {
+        ExprId stripe =
+            AddStripe(context_inverse, unstripe_factors.take_front(i + 1));
+        if (mlir::failed(SetInverse(source, source.operands(id)[i], stripe,
+                                    inverses))) {
+          return mlir::failure();
+        }
+      }
+      return mlir::success();
+    }
+  }
+  llvm_unreachable("unknown expression kind");
+}
+
+ScratchMapping::ExprId ScratchMapping::CanonicalStripe(
+    ExprId canonical_operand, llvm::ArrayRef<int> stripe_factors) {
+  if (stripe_factors.size() == 1 && stripe_factors.back() == 1) {
+    return canonical_operand;
+  }
+  if (kind(canonical_operand) != Kind::kUnStripe) {
+    return AddStripe(canonical_operand, stripe_factors);
+  }
+
+  llvm::SmallVector<int, 4> new_factors = llvm::to_vector<4>(stripe_factors);
+  llvm::SmallVector<ExprId, 4> unstripe_operands =
+      llvm::to_vector<4>(operands(canonical_operand));
+  llvm::SmallVector<int, 4> unstripe_factors =
+      llvm::to_vector<4>(factors(canonical_operand));
+  auto it = std::mismatch(new_factors.begin(), new_factors.end(),
+                          unstripe_factors.begin(), unstripe_factors.end());
+
+  // If all factors match, stripe(unstripe) is the identity function.
+  if (it.first == new_factors.end()) {
+    return unstripe_operands[new_factors.size() - 1];
+  }
+
+  // Otherwise, we trip common factors.
+  int num_common = std::distance(new_factors.begin(), it.first);
+  ExprId new_unstripe =
+      AddUnStripe(llvm::ArrayRef(unstripe_operands).drop_front(num_common),
+                  llvm::ArrayRef(unstripe_factors).drop_front(num_common));
+  return AddStripe(new_unstripe,
+                   llvm::ArrayRef(new_factors).drop_front(num_common));
+}
+
+ScratchMapping::ExprId ScratchMapping::CanonicalizeExpr(
+    const ScratchMapping &source, ExprId id) {
+  switch (source.kind(id)) {
+    case Kind::kDim:
+      return AddDim(source.dimension(id));
+    case Kind::kNone:
+      return AddNone();
+    case Kind::kUnknown:
+      return AddUnknown();
+    case Kind::kStripe: {
+      ExprId operand = CanonicalizeExpr(source, source.operands(id)[0]);
+      return CanonicalStripe(operand, source.factors(id));
+    }
+    case Kind::kUnStripe:
+      break;
+  }
+
+  llvm::SmallVector<ExprId, 4> new_operands;
+  for (ExprId operand : source.operands(id)) {
+    new_operands.push_back(CanonicalizeExpr(source, operand));
+  }
+  llvm::SmallVector<int, 4> new_factors =
+      llvm::to_vector<4>(source.factors(id));
+
+  // If the last argument is an unstripe, it can be collapsed in the current
+  // expression.
+  auto collapse_unstripes = [&]() {
+    ExprId unstripe = new_operands.back();
+    if (kind(unstripe) != Kind::kUnStripe) return false;
+    // Stripe factors must be strictly decreasing.
+    if (new_factors.size() > 1 &&
+        new_factors[new_factors.size() - 2] <= factors(unstripe).front()) {
+      return false;
+    }
+    new_operands.pop_back();
+    new_factors.pop_back();
+    llvm::append_range(new_operands, operands(unstripe));
+    llvm::append_range(new_factors, factors(unstripe));
+    return true;
+  };
+
+  // Stiches stripe expressions that have the same operand.
+  auto stiche_stripes = [&]() {
+    ExprId stripe = new_operands.back();
+    if (kind(stripe) != Kind::kStripe) return false;
+    llvm::SmallVector<int, 4> stripe_factors =
+        llvm::to_vector<4>(factors(stripe));
+    ExprId stripe_operand = operands(stripe)[0];
+    int min_num_factors = std::min(new_factors.size(), stripe_factors.size());
+    if (llvm::ArrayRef(new_factors).take_back(min_num_factors) !=
+        llvm::ArrayRef(stripe_factors).take_back(min_num_factors)) {
+      return false;
+    }
+
+    // Find how many stripes we can stich together.
+    int first_stripe = new_operands.size() - 1;
+    for (; first_stripe > 0; --first_stripe) {
+      ExprId other_stripe = new_operands[first_stripe - 1];
+      if (kind(other_stripe) != Kind::kStripe ||
+          !Equal(operands(other_stripe)[0], stripe_operand)) {
+        break;
+      }
+    }
+
+    // Only one stripe, we can't stich anything.
+    if (first_stripe == new_operands.size() - 1) return false;
+
+    llvm::SmallVector<int, 4> new_stripe_factors(
+        llvm::ArrayRef(stripe_factors)
+            .drop_back(new_operands.size() - first_stripe));
+    new_stripe_factors.push_back(1);
+
+    new_operands.resize(first_stripe);
+    new_factors.resize(first_stripe);
+    new_operands.push_back(CanonicalStripe(stripe_operand, new_stripe_factors));
+    new_factors.push_back(1);
+    return true;
+  };
+
+  while (collapse_unstripes() || stiche_stripes()) {
+  }
+
+  if (new_factors.size() == 1 && new_factors.back() == 1) {
+    return new_operands[0];
+  }
+  return AddUnStripe(new_operands, new_factors);
+}
+
+}  // namespace sair
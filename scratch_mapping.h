@@ -0,0 +1,167 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAIR_SCRATCH_MAPPING_H_
+#define SAIR_SCRATCH_MAPPING_H_
+
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/MLIRContext.h"
+#include "sair_attributes.h"
+
+namespace sair {
+
+// A value-type equivalent of MappingAttr. Expressions are stored as tagged
+// nodes in a small per-mapping arena instead of being uniqued in the
+// MLIRContext. Analyses chaining many mapping operations should work on
+// scratch mappings and only convert the final result back to a MappingAttr
+// with `ToAttr`.
+//
+// Methods have the same semantics as their MappingAttr counterparts and return
+// new mappings with compact arenas.
+class ScratchMapping {
+ public:
+  // Converts `mapping` into a scratch mapping.
+  explicit ScratchMapping(MappingAttr mapping);
+
+  // Returns the mapping that accesses `num_dimensions` pointwise. If
+  // `use_domain_size` is `-1`, it is considered equal to `num_dimensions`.
+  static ScratchMapping GetIdentity(int num_dimensions,
+                                    int use_domain_size = -1);
+
+  // Uniques the mapping in `context`.
+  MappingAttr ToAttr(mlir::MLIRContext *context) const;
+
+  // Number of dimensions in the use domain.
+  int UseDomainSize() const { return use_domain_size_; }
+
+  // Number of dimensions of the mapping.
+  int size() const { return dims_.size(); }
+
+  // Indicates if any sub-expression is `none`.
+  bool HasNoneExprs() const;
+
+  // Returns the mapping resulting from applying `this` and then `other`.
+  ScratchMapping Compose(const ScratchMapping &other) const;
+
+  // Returns this mapping with a different use domain size. Replaces
+  // expressions that are invalid in the new domain by `none`.
+  ScratchMapping ResizeUseDomain(int new_size) const;
+
+  // Returns this mapping with a different number of dimensions, padded with
+  // `none` expressions.
+  ScratchMapping Resize(int new_size) const;
+
+  // Shifts dimensions starting from `start_from` right by `offset`.
+  ScratchMapping ShiftRight(int offset, int start_from = 0) const;
+
+  // Inverses the mapping.
+  ScratchMapping Inverse() const;
+
+  // Canonicalizes dimension expressions.
+  ScratchMapping Canonicalize() const;
+
+  // Unifies this mapping with `other` by substituting `none` and `?`
+  // expressions. Returns std::nullopt if unification fails.
+  std::optional<ScratchMapping> Unify(const ScratchMapping &other) const;
+
+ private:
+  enum class Kind { kDim, kNone, kUnknown, kStripe, kUnStripe };
+
+  // Index of an expression in `exprs_`.
+  using ExprId = int;
+  static constexpr ExprId kInvalidExpr = -1;
+
+  // Tagged expression node. Stripe and unstripe expressions reference their
+  // operands and factors as ranges of `operands_` and `factors_`.
+  struct Expr {
+    Kind kind;
+    int dimension = 0;
+    int operands_begin = 0;
+    int num_operands = 0;
+    int factors_begin = 0;
+    int num_factors = 0;
+  };
+
+  // Maps a dimension of a source expression to an expression of the
+  // destination arena.
+  using DimSubstitution = llvm::function_ref<ExprId(int)>;
+
+  explicit ScratchMapping(int use_domain_size)
+      : use_domain_size_(use_domain_size) {}
+
+  Kind kind(ExprId id) const { return exprs_[id].kind; }
+  int dimension(ExprId id) const { return exprs_[id].dimension; }
+  llvm::ArrayRef<ExprId> operands(ExprId id) const {
+    const Expr &expr = exprs_[id];
+    return llvm::ArrayRef(operands_).slice(expr.operands_begin,
+                                           expr.num_operands);
+  }
+  llvm::ArrayRef<int> factors(ExprId id) const {
+    const Expr &expr = exprs_[id];
+    return llvm::ArrayRef(factors_).slice(expr.factors_begin,
+                                          expr.num_factors);
+  }
+
+  ExprId AddDim(int dimension);
+  ExprId AddNone();
+  ExprId AddUnknown();
+  ExprId AddStripe(ExprId operand, llvm::ArrayRef<int> factors);
+  ExprId AddUnStripe(llvm::ArrayRef<ExprId> operands,
+                     llvm::ArrayRef<int> factors);
+
+  // Imports a MappingExpr into the arena.
+  ExprId Import(MappingExpr expr);
+
+  // Copies expression `id` of `source` into the arena, replacing dimensions
+  // with `substitution`.
+  ExprId Import(const ScratchMapping &source, ExprId id,
+                DimSubstitution substitution);
+
+  // Builds the MappingExpr corresponding to `id`.
+  MappingExpr ToMappingExpr(ExprId id, mlir::MLIRContext *context) const;
+
+  // Indicates if two expressions of the arena are structurally equal.
+  bool Equal(ExprId lhs, ExprId rhs) const;
+
+  // Unifies expression `lhs` of `lhs_source` with expression `rhs` of
+  // `rhs_source` and stores the result in the arena. Sources may be the arena
+  // itself. Returns kInvalidExpr on failure.
+  ExprId UnifyExprs(const ScratchMapping &lhs_source, ExprId lhs,
+                    const ScratchMapping &rhs_source, ExprId rhs);
+
+  // Fills `inverses` with the inverse of expression `id` of `source`, given
+  // the inverse `context_inverse` of the surrounding expression.
+  mlir::LogicalResult SetInverse(const ScratchMapping &source, ExprId id,
+                                 ExprId context_inverse,
+                                 llvm::MutableArrayRef<ExprId> inverses);
+
+  // Canonicalizes expression `id` of `source` into the arena.
+  ExprId CanonicalizeExpr(const ScratchMapping &source, ExprId id);
+  ExprId CanonicalStripe(ExprId canonical_operand,
+                         llvm::ArrayRef<int> stripe_factors);
+
+  int use_domain_size_;
+  llvm::SmallVector<ExprId, 4> dims_;
+  llvm::SmallVector<Expr, 8> exprs_;
+  llvm::SmallVector<ExprId, 4> operands_;
+  llvm::SmallVector<int, 4> factors_;
+};
+
+}  // namespace sair
+
+#endif  // SAIR_SCRATCH_MAPPING_H_
@@ -17,9 +17,13 @@
 #include <algorithm>
 #include <limits>
 #include <map>
+#include <optional>
+#include <tuple>
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "loop_nest.h"
 #include "sair_op_interfaces.h"
 #include "sair_ops.h"
@@ -309,7 +313,8 @@ mlir::LogicalResult SequenceAnalysis::Init(SairProgramOp program_op,
 }
 
 SequenceAnalysis::RangeType SequenceAnalysis::Ops() const {
-  return RangeType(compute_ops_);
+  return RangeType(IterType(this, first_op_),
+                   IterType(this, ComputeOpInstance()));
 }
 
 void SequenceAnalysis::AssignInferred() const {
@@ -322,19 +327,19 @@ void SequenceAnalysis::AssignInferred() const {
 bool SequenceAnalysis::IsBefore(const ComputeOpInstance &first,
                                 const OpInstance &second) const {
   if (first == second) return false;
-  int64_t first_number = ExplicitSequenceNumber(first);
+  uint64_t first_label = Label(first);
 
-  // If both ops are ComputeOps, just check the sequence numbers.
+  // If both ops are ComputeOps, just check the labels.
   if (auto second_as_compute = second.dyn_cast<ComputeOpInstance>()) {
-    return first_number < ExplicitSequenceNumber(second_as_compute);
+    return first_label < Label(second_as_compute);
   }
-  // If the second op is a non-compute, its implicit sequence number is equal to
-  // the largest explicit sequence number of its operands; so equal numbers mean
-  // the compute op is sequenced before the non-compute op due to a use-def
-  // chain between them.
+  // If the second op is a non-compute, it is implicitly sequenced after the
+  // last compute op producing its operands; so equal labels mean the compute op
+  // is sequenced before the non-compute op due to a use-def chain between them.
   // NOTE: extending this function to query the order between two non-compute
   // ops will require looking for a potential use-def chain between them.
-  return first_number <= ImplicitSequenceNumber(second);
+  ComputeOpInstance predecessor = ImplicitPredecessor(second);
+  return predecessor != nullptr && first_label <= Label(predecessor);
 }
 
 bool SequenceAnalysis::IsBefore(ProgramPoint point,
@@ -353,6 +358,14 @@ bool SequenceAnalysis::IsAfter(ProgramPoint point,
   return IsBefore(op, point.operation());
 }
 
+llvm::SetVector<ComputeOpInstance> SequenceAnalysis::Producers(
+    const ComputeOpInstance &op) const {
+  llvm::SetVector<ComputeOpInstance> producers =
+      ComputeOpFrontier(op, fby_ops_to_cut_);
+  producers.remove(op);
+  return producers;
+}
+
 void SequenceAnalysis::Insert(const ComputeOpInstance &op, ProgramPoint point) {
   Insert(op, point.operation(), point.direction());
 }
@@ -360,97 +373,288 @@ void SequenceAnalysis::Insert(const ComputeOpInstance &op, ProgramPoint point) {
 void SequenceAnalysis::Insert(const ComputeOpInstance &op,
                               const OpInstance &reference,
                               Direction direction) {
-  int64_t sequence_number = -1;
+  ComputeOpInstance anchor;
   if (reference != nullptr) {
     if (auto compute_op = reference.dyn_cast<ComputeOpInstance>()) {
-      sequence_number = ExplicitSequenceNumber(compute_op);
+      anchor = compute_op;
     } else {
-      sequence_number = ImplicitSequenceNumber(reference);
+      anchor = ImplicitPredecessor(reference);
     }
   }
 
-  // Implicit sequence number can be -1 if the reference operation doesn't
+  // The implicit predecessor can be null if the reference operation doesn't
   // depend on any explicitly sequenced operation. In this case, insert the
   // operation at the beginning of the program for the "before" direction and at
   // the end for the "after" direction.
-  if (sequence_number == -1) {
-    sequence_number = direction == Direction::kBefore ? 0 : compute_ops_.size();
+  if (anchor == nullptr) {
+    InsertBefore(op, direction == Direction::kBefore ? first_op_
+                                                     : ComputeOpInstance());
   } else if (direction == Direction::kAfter) {
-    ++sequence_number;
+    InsertBefore(op, NextOp(anchor));
+  } else {
+    InsertBefore(op, anchor);
+  }
+}
+
+void SequenceAnalysis::Erase(const OpInstance &op) {
+  auto compute_op = op.dyn_cast<ComputeOpInstance>();
+  if (compute_op == nullptr) {
+    fby_ops_to_cut_.erase(
+        std::remove(fby_ops_to_cut_.begin(), fby_ops_to_cut_.end(), op),
+        fby_ops_to_cut_.end());
+    return;
+  }
+
+  Node node = GetNode(compute_op);
+  if (node.prev == nullptr) {
+    first_op_ = node.next;
+  } else {
+    nodes_[node.prev].next = node.next;
+  }
+  if (node.next == nullptr) {
+    last_op_ = node.prev;
+  } else {
+    nodes_[node.next].prev = node.prev;
+  }
+  nodes_.erase(compute_op);
+}
+
+void SequenceAnalysis::Replace(const OpInstance &old_op,
+                               const OpInstance &new_op) {
+  assert(!old_op.isa<ComputeOpInstance>() && !new_op.isa<ComputeOpInstance>());
+  std::replace(fby_ops_to_cut_.begin(), fby_ops_to_cut_.end(), old_op, new_op);
+}
+
+mlir::LogicalResult SequenceAnalysis::Resequence(const ComputeOpInstance &op,
+                                                 bool report_errors) {
+  // Dropping the sequence number only relaxes constraints on `op`.
+  DecisionsAttr decisions = op.GetDecisions();
+  if (decisions.sequence() == nullptr) return mlir::success();
+  int64_t number = decisions.sequence().getInt();
+
+  // Find the last operation that must be sequenced before `op` and the first
+  // one that must be sequenced after it. Explicitly sequenced operations appear
+  // in the order of their sequence numbers, so only the operations between the
+  // old and the new position of `op` are visited.
+  ComputeOpInstance lower, upper;
+  auto explicit_number = [](const ComputeOpInstance &other) {
+    mlir::IntegerAttr sequence = other.GetDecisions().sequence();
+    return sequence == nullptr ? std::optional<int64_t>()
+                               : std::optional<int64_t>(sequence.getInt());
+  };
+  for (ComputeOpInstance next = NextOp(op); next != nullptr;
+       next = NextOp(next)) {
+    std::optional<int64_t> next_number = explicit_number(next);
+    if (!next_number.has_value() || *next_number == number) continue;
+    if (*next_number > number) {
+      upper = next;
+      break;
+    }
+    lower = next;
+  }
+  if (lower == nullptr) {
+    for (ComputeOpInstance prev = PrevOp(op); prev != nullptr;
+         prev = PrevOp(prev)) {
+      std::optional<int64_t> prev_number = explicit_number(prev);
+      if (!prev_number.has_value() || *prev_number == number) continue;
+      if (*prev_number < number) {
+        lower = prev;
+        break;
+      }
+      upper = prev;
+    }
+  }
+
+  // Account for use-def chains, stepping over non-compute operations.
+  for (const ComputeOpInstance &producer : Producers(op)) {
+    if (lower == nullptr || Label(lower) < Label(producer)) lower = producer;
+  }
+  llvm::SmallVector<OpInstance> work_list = {op};
+  llvm::DenseSet<OpInstance> visited = {op};
+  while (!work_list.empty()) {
+    OpInstance current = work_list.pop_back_val();
+    for (ResultInstance result : current.Results()) {
+      for (auto &[user, pos] : result.GetUses()) {
+        (void)pos;
+        if (!visited.insert(user).second) continue;
+        auto compute_user = user.dyn_cast<ComputeOpInstance>();
+        if (compute_user == nullptr) {
+          work_list.push_back(user);
+          continue;
+        }
+        // Skip use-def edges cut through "fby" operations.
+        if (!Producers(compute_user).contains(op)) continue;
+        if (upper == nullptr || Label(compute_user) < Label(upper)) {
+          upper = compute_user;
+        }
+      }
+    }
+  }
+
+  // Other operations must be reordered, recompute the whole sequence.
+  if (lower != nullptr && upper != nullptr && Label(upper) < Label(lower)) {
+    SequenceAnalysis analysis;
+    if (mlir::failed(analysis.Init(op.program(), report_errors))) {
+      return mlir::failure();
+    }
+    *this = std::move(analysis);
+    return mlir::success();
+  }
+
+  if (lower != nullptr && Label(op) < Label(lower)) {
+    Erase(op);
+    InsertBefore(op, NextOp(lower));
+  } else if (upper != nullptr && Label(upper) < Label(op)) {
+    Erase(op);
+    InsertBefore(op, upper);
+  }
+  return mlir::success();
+}
+
+// Labels live in [0, 2^kLabelBits). Label 0 is never assigned so that there is
+// always room before the first operation.
+static constexpr int kLabelBits = 62;
+static constexpr uint64_t kLabelSpace = uint64_t{1} << kLabelBits;
+
+void SequenceAnalysis::InsertBefore(const ComputeOpInstance &op,
+                                    ComputeOpInstance next) {
+  assert(!nodes_.count(op) && "op already in the sequence analysis");
+  ComputeOpInstance prev = next == nullptr ? last_op_ : PrevOp(next);
+  auto bounds = [&]() {
+    uint64_t low = prev == nullptr ? 0 : Label(prev);
+    uint64_t high = next == nullptr ? kLabelSpace : Label(next);
+    return std::make_pair(low, high);
+  };
+  auto [low, high] = bounds();
+  if (high - low < 2) {
+    Relabel(prev != nullptr ? prev : next);
+    std::tie(low, high) = bounds();
+    assert(high - low >= 2);
+  }
+
+  nodes_[op] = Node{low + (high - low) / 2, prev, next};
+  if (prev == nullptr) {
+    first_op_ = op;
+  } else {
+    nodes_[prev].next = op;
   }
+  if (next == nullptr) {
+    last_op_ = op;
+  } else {
+    nodes_[next].prev = op;
+  }
+}
+
+void SequenceAnalysis::Relabel(const ComputeOpInstance &op) {
+  // Look for the smallest aligned range of labels around `op` that is sparse
+  // enough, and spread the labels of the operations it contains evenly. The
+  // allowed density decreases geometrically with the size of the range so that
+  // relabeling costs amortized O(log n) per insertion.
+  constexpr double kDensityBase = 2.0 / 1.5;
+  uint64_t label = Label(op);
+  ComputeOpInstance first = op;
+  ComputeOpInstance last = op;
+  int64_t count = 1;
+  double max_count = 1.0;
+  for (int bits = 1; bits <= kLabelBits; ++bits) {
+    max_count *= kDensityBase;
+    uint64_t range_size = uint64_t{1} << bits;
+    uint64_t low = label & ~(range_size - 1);
+    uint64_t high = low + range_size;
+    for (ComputeOpInstance prev = PrevOp(first);
+         prev != nullptr && Label(prev) >= low; prev = PrevOp(first)) {
+      first = prev;
+      ++count;
+    }
+    for (ComputeOpInstance next = NextOp(last);
+         next != nullptr && Label(next) < high; next = NextOp(last)) {
+      last = next;
+      ++count;
+    }
 
-  for (int64_t number = sequence_number, e = compute_ops_.size(); number < e;
-       ++number) {
-    op_to_sequence_number_[compute_ops_[number]] = number + 1;
+    // Leave room for the operation about to be inserted.
+    uint64_t needed = 2 * static_cast<uint64_t>(count + 1);
+    if (range_size < needed) continue;
+    if (bits < kLabelBits && count + 1 > max_count) continue;
+    AssignLabels(first, count, low, high);
+    return;
   }
-  op_to_sequence_number_.try_emplace(op, sequence_number);
-  compute_ops_.insert(compute_ops_.begin() + sequence_number, op);
+  llvm_unreachable("too many operations in the sequence analysis");
 }
 
-void SequenceAnalysis::Erase(const ComputeOpInstance &op) {
-  int64_t sequence_number = ExplicitSequenceNumber(op);
-  for (int64_t number = sequence_number + 1, e = compute_ops_.size();
-       number < e; ++number) {
-    op_to_sequence_number_[compute_ops_[number]] = number - 1;
+void SequenceAnalysis::AssignLabels(ComputeOpInstance first, int64_t count,
+                                    uint64_t low, uint64_t high) {
+  uint64_t step = (high - low) / (count + 1);
+  ComputeOpInstance op = first;
+  for (int64_t i = 0; i < count; ++i) {
+    Node &node = nodes_[op];
+    node.label = low + (i + 1) * step;
+    op = node.next;
   }
-  op_to_sequence_number_.erase(op);
-  compute_ops_.erase(compute_ops_.begin() + sequence_number);
 }
 
-int64_t SequenceAnalysis::ImplicitSequenceNumber(const OpInstance &op) const {
+ComputeOpInstance SequenceAnalysis::ImplicitPredecessor(
+    const OpInstance &op) const {
   assert(!op.isa<ComputeOpInstance>() &&
-         "only non-compute ops have implicit sequence numbers");
+         "only non-compute ops have implicit predecessors");
   llvm::SetVector<ComputeOpInstance> frontier =
       ComputeOpFrontier(op, fby_ops_to_cut_);
-  auto get_explicit_number = [this](ComputeOpInstance compute_op) {
-    return ExplicitSequenceNumber(compute_op);
-  };
-  auto range = llvm::map_range(frontier, get_explicit_number);
-  int64_t number = -1;
-  for (int64_t sequence : range) number = std::max(number, sequence);
-  return number;
+  ComputeOpInstance predecessor;
+  for (ComputeOpInstance compute_op : frontier) {
+    if (predecessor == nullptr || Label(predecessor) < Label(compute_op)) {
+      predecessor = compute_op;
+    }
+  }
+  return predecessor;
 }
 
 std::pair<ComputeOpInstance, ComputeOpInstance> SequenceAnalysis::GetSpan(
     llvm::ArrayRef<ComputeOpInstance> ops) const {
   assert(!ops.empty());
-  int64_t min = std::numeric_limits<int64_t>::max();
-  int64_t max = std::numeric_limits<int64_t>::min();
-  auto get_sequence_number = [&](ComputeOpInstance op) {
-    return ExplicitSequenceNumber(op);
-  };
-  for (int64_t sequence_number : llvm::map_range(ops, get_sequence_number)) {
-    min = std::min(sequence_number, min);
-    max = std::max(sequence_number, max);
+  ComputeOpInstance first = ops.front();
+  ComputeOpInstance last = ops.front();
+  for (ComputeOpInstance op : ops.drop_front()) {
+    if (Label(op) < Label(first)) first = op;
+    if (Label(last) < Label(op)) last = op;
   }
-  return std::make_pair(compute_ops_[min], compute_ops_[max]);
+  return std::make_pair(first, last);
 }
 
 ProgramPoint SequenceAnalysis::FindInsertionPoint(
     const IterationSpaceAnalysis &iter_spaces, const OpInstance &start,
     int num_loops, Direction direction) const {
-  // Compute initial sequence number.
-  int sequence_number;
+  // Compute the initial position. `current` is null if the position is at the
+  // boundary of the program indicated by `boundary`.
+  ComputeOpInstance current;
+  Direction boundary = Direction::kBefore;
   if (auto compute_op = start.dyn_cast<ComputeOpInstance>()) {
-    sequence_number = ExplicitSequenceNumber(compute_op);
+    current = compute_op;
   } else {
-    sequence_number = ImplicitSequenceNumber(start);
+    current = ImplicitPredecessor(start);
     // If the operation is not a ComputeOp and we want to schedule before the
     // operation, then any point that is before the next ComputeOp is fine as
     // the current operation is implicitly scheduled.
-    if (sequence_number >= 0 && direction == Direction::kBefore) {
-      ++sequence_number;
+    if (current != nullptr && direction == Direction::kBefore) {
+      ComputeOpInstance next = NextOp(current);
+      if (next == nullptr) boundary = Direction::kAfter;
+      current = next;
     }
   }
 
   llvm::ArrayRef<mlir::StringAttr> start_loop_nest =
       iter_spaces.Get(start).loop_names();
   int num_common_loops = start_loop_nest.size();
-  int delta = direction == Direction::kBefore ? -1 : 1;
+  auto step = [&](ComputeOpInstance op) {
+    if (op == nullptr) {
+      // Stepping from a boundary only enters the program from the other side.
+      if (boundary == direction) return ComputeOpInstance();
+      return direction == Direction::kBefore ? last_op_ : first_op_;
+    }
+    return direction == Direction::kBefore ? PrevOp(op) : NextOp(op);
+  };
 
-  sequence_number += delta;
-  while (sequence_number >= 0 && sequence_number < compute_ops_.size()) {
-    ComputeOpInstance new_op = compute_ops_[sequence_number];
+  for (ComputeOpInstance new_op = step(current); new_op != nullptr;
+       new_op = step(current)) {
     llvm::ArrayRef<mlir::Attribute> new_loops = new_op.Loops();
     num_common_loops = std::min<int>(new_loops.size(), num_common_loops);
     for (; num_common_loops > 0; --num_common_loops) {
@@ -458,20 +662,14 @@ ProgramPoint SequenceAnalysis::FindInsertionPoint(
       if (loop.name() == start_loop_nest[num_common_loops - 1]) break;
     }
     if (num_common_loops <= num_loops) break;
-    sequence_number += delta;
+    current = new_op;
   }
 
-  sequence_number -= delta;
-
   auto target_loop_nest = start_loop_nest.take_front(num_loops);
-  if (sequence_number < 0) {
-    return ProgramPoint(start.program(), Direction::kBefore, target_loop_nest);
-  } else if (sequence_number >= compute_ops_.size()) {
-    return ProgramPoint(start.program(), Direction::kAfter, target_loop_nest);
-  } else {
-    return ProgramPoint(compute_ops_[sequence_number], direction,
-                        target_loop_nest);
+  if (current == nullptr) {
+    return ProgramPoint(start.program(), boundary, target_loop_nest);
   }
+  return ProgramPoint(current, direction, target_loop_nest);
 }
 
 // Detects use-def cycles in the program and if they can be cut by removing the
@@ -631,11 +829,17 @@ mlir::LogicalResult SequenceAnalysis::ComputeDefaultSequence(
   // compute op after visiting all of its predecessors, and assign new sequence
   // numbers.
   DFSPostorderTraversal<ComputeOpInstance> traversal(predecessors);
-  compute_ops_.reserve(predecessors.keys().size());
+  int64_t num_ops = 0;
   for (auto it = traversal.begin(), eit = traversal.end(); it != eit; ++it) {
     if (*it != nullptr) {
-      op_to_sequence_number_.try_emplace(*it, compute_ops_.size());
-      compute_ops_.push_back(*it);
+      nodes_[*it] = Node{0, last_op_, ComputeOpInstance()};
+      if (last_op_ == nullptr) {
+        first_op_ = *it;
+      } else {
+        nodes_[last_op_].next = *it;
+      }
+      last_op_ = *it;
+      ++num_ops;
       continue;
     }
 
@@ -671,6 +875,7 @@ mlir::LogicalResult SequenceAnalysis::ComputeDefaultSequence(
 
     return diag;
   }
+  AssignLabels(first_op_, num_ops, 0, kLabelSpace);
   return mlir::success();
 }
 
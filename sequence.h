@@ -15,9 +15,12 @@
 #ifndef SAIR_SEQUENCE_H_
 #define SAIR_SEQUENCE_H_
 
+#include <cstdint>
+
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/iterator.h"
 #include "llvm/ADT/iterator_range.h"
 #include "sair_op_interfaces.h"
 #include "sair_ops.h"
@@ -72,9 +75,32 @@ class IterationSpaceAnalysis;
 
 // An analysis of the relative positions of Sair operations indicated by their
 // sequence attributes.
+//
+// Operations are kept in a doubly-linked list and carry integer labels whose
+// order matches the sequence order. Labels are spaced out so that inserting or
+// erasing an operation does not renumber the rest of the program; when no gap
+// is left, only a small neighborhood of labels is redistributed.
 class SequenceAnalysis {
  public:
-  using IterType = llvm::SmallVector<ComputeOpInstance>::const_iterator;
+  // Iterates over compute operations in sequence order.
+  class IterType
+      : public llvm::iterator_facade_base<IterType, std::forward_iterator_tag,
+                                          const ComputeOpInstance> {
+   public:
+    IterType(const SequenceAnalysis *analysis, ComputeOpInstance op)
+        : analysis_(analysis), op_(op) {}
+
+    bool operator==(const IterType &other) const { return op_ == other.op_; }
+    const ComputeOpInstance &operator*() const { return op_; }
+    IterType &operator++() {
+      op_ = analysis_->NextOp(op_);
+      return *this;
+    }
+
+   private:
+    const SequenceAnalysis *analysis_;
+    ComputeOpInstance op_;
+  };
   using RangeType = llvm::iterator_range<IterType>;
 
   // Performs the analysis in the given Sair program.
@@ -109,35 +135,46 @@ class SequenceAnalysis {
   // Returns true if the program point is sequenced after the given op.
   bool IsAfter(ProgramPoint point, const ComputeOpInstance &op) const;
 
+  // Returns the compute operations producing the operands and the domain of
+  // `op`, stepping over non-compute operations. Ignores the use-def edges cut
+  // to break cycles through "fby" operations.
+  llvm::SetVector<ComputeOpInstance> Producers(
+      const ComputeOpInstance &op) const;
+
   // Inserts the given `op` into the analysis, sequencing before or after the
   // `reference` op, depending on `direction`.
   void Insert(const ComputeOpInstance &op, ProgramPoint point);
   void Insert(const ComputeOpInstance &op, const OpInstance &reference,
               Direction direction);
 
-  // Erases the given `op` from the analysis.
-  void Erase(const ComputeOpInstance &op);
+  // Erases the given `op` from the analysis. Non-compute operations are only
+  // dropped from the list of use-def edges to cut.
+  void Erase(const OpInstance &op);
+
+  // Updates the analysis after the non-compute operation `old_op` was replaced
+  // by `new_op` with the same operands.
+  void Replace(const OpInstance &old_op, const OpInstance &new_op);
+
+  // Updates the position of `op` after its sequence attribute changed. Only
+  // moves `op` if other operations can keep their relative order, and
+  // recomputes the whole sequence otherwise. Returns a failure and leaves the
+  // analysis unchanged if the new sequence attribute contradicts use-def
+  // chains. Emits errors only if `report_errors` is set.
+  mlir::LogicalResult Resequence(const ComputeOpInstance &op,
+                                 bool report_errors);
 
   // Returns the Sair operation of the given kind preceding `op` if any; steps
   // over the operations of other kinds.
   ComputeOpInstance PrevOp(const ComputeOpInstance &op) const {
     if (op == nullptr) return ComputeOpInstance();
-    auto iter = op_to_sequence_number_.find(op);
-    assert(iter != op_to_sequence_number_.end() &&
-           "op not in sequence analysis");
-    if (iter->getSecond() == 0) return ComputeOpInstance();
-    return compute_ops_[iter->getSecond() - 1];
+    return GetNode(op).prev;
   }
 
-  // Returns the Sair operation of the given kind preceding `op` if any; steps
+  // Returns the Sair operation of the given kind following `op` if any; steps
   // over the operations of other kinds.
   ComputeOpInstance NextOp(const ComputeOpInstance &op) const {
     if (op == nullptr) return ComputeOpInstance();
-    auto iter = op_to_sequence_number_.find(op);
-    assert(iter != op_to_sequence_number_.end());
-    if (iter->getSecond() == compute_ops_.size() - 1)
-      return ComputeOpInstance();
-    return compute_ops_[iter->getSecond() + 1];
+    return GetNode(op).next;
   }
 
   // Returns the pair (first, last) of the given ops according to their sequence
@@ -171,26 +208,50 @@ class SequenceAnalysis {
   mlir::LogicalResult ComputeDefaultSequence(SairProgramOp program,
                                              bool report_errors);
 
-  // Returns the sequence number of the given op.
-  int64_t ExplicitSequenceNumber(const ComputeOpInstance &op) const {
-    auto it = op_to_sequence_number_.find(op);
-    assert(it != op_to_sequence_number_.end() &&
-           "op not in the sequence analysis");
+  // Position of a compute operation in the sequence.
+  struct Node {
+    // Labels are ordered like operations but are not contiguous.
+    uint64_t label;
+    ComputeOpInstance prev;
+    ComputeOpInstance next;
+  };
+
+  // Returns the position of the given op.
+  const Node &GetNode(const ComputeOpInstance &op) const {
+    auto it = nodes_.find(op);
+    assert(it != nodes_.end() && "op not in the sequence analysis");
     return it->getSecond();
   }
 
-  // Returns the sequence number of the last explicitly sequenceable op that
-  // (transitively) produces the operands for this implicitly sequenceable op.
-  // In other words, the given op should be sequenced between result and
-  // result+1.
-  int64_t ImplicitSequenceNumber(const OpInstance &op) const;
-
-  // Sequence state: the position in the vector indicates the sequence number of
-  // the operation.
-  llvm::SmallVector<ComputeOpInstance> compute_ops_;
+  // Returns the label of the given op.
+  uint64_t Label(const ComputeOpInstance &op) const {
+    return GetNode(op).label;
+  }
 
-  // Lookup cache for the position of the (compute) operation in the vector.
-  llvm::DenseMap<ComputeOpInstance, int64_t> op_to_sequence_number_;
+  // Returns the last explicitly sequenceable op that (transitively) produces
+  // the operands for this implicitly sequenceable op, or nullptr if there is
+  // none. In other words, the given op should be sequenced between the result
+  // and the operation that follows it.
+  ComputeOpInstance ImplicitPredecessor(const OpInstance &op) const;
+
+  // Links `op` in the sequence immediately before `next`, or at the end of the
+  // sequence if `next` is null. Relabels neighboring operations if there is no
+  // free label between `next` and its predecessor.
+  void InsertBefore(const ComputeOpInstance &op, ComputeOpInstance next);
+
+  // Spreads labels of the operations around `op` so that there is a free label
+  // on both sides of `op`.
+  void Relabel(const ComputeOpInstance &op);
+
+  // Assigns evenly spaced labels in [low, high) to `count` operations starting
+  // with `first`.
+  void AssignLabels(ComputeOpInstance first, int64_t count, uint64_t low,
+                    uint64_t high);
+
+  // Sequence state: compute operations form a linked list in sequence order.
+  llvm::DenseMap<ComputeOpInstance, Node> nodes_;
+  ComputeOpInstance first_op_;
+  ComputeOpInstance last_op_;
 
   // List of "fby" operations that create a use-def cycle, which can be removed
   // by dropping the use-def edge entering into their "value" operand.
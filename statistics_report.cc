@@ -0,0 +1,121 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "statistics_report.h"
+
+#include <utility>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/JSON.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+
+namespace sair {
+
+// Returns the stack of instrumented pass runs executing on the current thread,
+// innermost last. Passes of nested pass managers run within the run of their
+// parent pass on the same thread.
+static std::vector<StatisticsReport::PassRun> &CurrentPassRuns() {
+  thread_local std::vector<StatisticsReport::PassRun> runs;
+  return runs;
+}
+
+PassCounter &PassCounter::operator+=(uint64_t value) {
+  std::vector<StatisticsReport::PassRun> &runs = CurrentPassRuns();
+  if (runs.empty()) return *this;
+  auto &statistics = runs.back().statistics;
+  auto it = llvm::find_if(statistics, [&](const auto &statistic) {
+    return statistic.first == name_;
+  });
+  if (it == statistics.end()) {
+    statistics.emplace_back(name_, value);
+  } else {
+    it->second += value;
+  }
+  return *this;
+}
+
+// Records the counters incremented by each pass run. Pass runs on different
+// operations may execute concurrently on different threads.
+class StatisticsInstrumentation : public mlir::PassInstrumentation {
+ public:
+  explicit StatisticsInstrumentation(StatisticsReport &report)
+      : report_(report) {}
+
+  void runBeforePass(mlir::Pass *pass, mlir::Operation *op) override {
+    StatisticsReport::PassRun &run = CurrentPassRuns().emplace_back();
+    run.pass = pass->getArgument().empty() ? pass->getName().str()
+                                           : pass->getArgument().str();
+  }
+
+  void runAfterPass(mlir::Pass *pass, mlir::Operation *op) override {
+    Record(op);
+  }
+
+  void runAfterPassFailed(mlir::Pass *pass, mlir::Operation *op) override {
+    Record(op);
+  }
+
+ private:
+  // Moves the innermost run of the current thread to the report if it
+  // incremented counters.
+  void Record(mlir::Operation *op) {
+    std::vector<StatisticsReport::PassRun> &runs = CurrentPassRuns();
+    StatisticsReport::PassRun run = std::move(runs.back());
+    runs.pop_back();
+    if (run.statistics.empty()) return;
+
+    auto symbol = llvm::dyn_cast<mlir::SymbolOpInterface>(op);
+    llvm::StringRef function =
+        symbol ? symbol.getName() : op->getName().getStringRef();
+    report_.AddRun(function, std::move(run));
+  }
+
+  StatisticsReport &report_;
+};
+
+std::unique_ptr<mlir::PassInstrumentation>
+StatisticsReport::CreateInstrumentation() {
+  return std::make_unique<StatisticsInstrumentation>(*this);
+}
+
+void StatisticsReport::AddRun(llvm::StringRef function, PassRun run) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  runs_[function.str()].push_back(std::move(run));
+}
+
+void StatisticsReport::PrintAsJson(llvm::raw_ostream &os) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  llvm::json::OStream json(os, /*IndentSize=*/2);
+  json.object([&]() {
+    for (const auto &[function, runs] : runs_) {
+      json.attributeArray(function, [&]() {
+        for (const PassRun &run : runs) {
+          json.object([&]() {
+            json.attribute("pass", run.pass);
+            json.attributeObject("statistics", [&]() {
+              for (const auto &[name, value] : run.statistics) {
+                json.attribute(name, static_cast<int64_t>(value));
+              }
+            });
+          });
+        }
+      });
+    }
+  });
+  os << "\n";
+}
+
+}  // namespace sair
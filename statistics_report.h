@@ -0,0 +1,81 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAIR_STATISTICS_REPORT_H_
+#define SAIR_STATISTICS_REPORT_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Pass/PassInstrumentation.h"
+
+namespace sair {
+
+// A counter of events in a pass, such as the number of allocations it
+// creates. Unlike mlir::Pass::Statistic, which only counts in LLVM builds with
+// statistics enabled, counters are compiled in all builds. Increments are
+// recorded in the pass run executing on the current thread if its pass manager
+// is instrumented by a StatisticsReport, and are ignored otherwise. Work a pass
+// dispatches to other threads must thus count events locally and add them to
+// the counter on the thread running the pass.
+class PassCounter {
+ public:
+  explicit PassCounter(const char *name) : name_(name) {}
+
+  PassCounter &operator++() { return *this += 1; }
+  PassCounter &operator+=(uint64_t value);
+
+ private:
+  const char *name_;
+};
+
+// Collects the counters of passes for each function they run on. The report
+// records how much each pass run incremented the counters of its pass.
+class StatisticsReport {
+ public:
+  // Counters of a single run of a pass on a function, in the order they were
+  // first incremented.
+  struct PassRun {
+    std::string pass;
+    std::vector<std::pair<std::string, uint64_t>> statistics;
+  };
+
+  // Returns an instrumentation that records statistics in this report. The
+  // instrumentation must not outlive the report. May be called once per pass
+  // manager to collect statistics of several pipelines in the same report.
+  std::unique_ptr<mlir::PassInstrumentation> CreateInstrumentation();
+
+  // Prints the report as a JSON object mapping function names to the list of
+  // passes that ran on them, with their statistics.
+  void PrintAsJson(llvm::raw_ostream &os) const;
+
+ private:
+  friend class StatisticsInstrumentation;
+
+  // Records a pass run on function `function`.
+  void AddRun(llvm::StringRef function, PassRun run);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, std::vector<PassRun>> runs_;
+};
+
+}  // namespace sair
+
+#endif  // SAIR_STATISTICS_REPORT_H_
@@ -14,9 +14,12 @@
 
 #include "storage.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MathExtras.h"
 #include "loop_nest.h"
 #include "sair_dialect.h"
+#include "scratch_mapping.h"
 #include "sequence.h"
 
 namespace sair {
@@ -43,6 +46,75 @@ Buffer::Buffer(FromToMemRefOp import_op, mlir::StringAttr name,
     : Buffer(import_op.getLoc(), name, import_op.MemRefType().getElementType(),
              loop_nest) {
   import_op_ = import_op;
+  if (auto from_memref =
+          llvm::dyn_cast<SairFromMemRefOp>(import_op.getOperation())) {
+    prefetch_ = from_memref.getPrefetchAttr();
+  }
+  if (auto to_memref =
+          llvm::dyn_cast<SairToMemRefOp>(import_op.getOperation())) {
+    nontemporal_ = to_memref.getNontemporal();
+  }
+}
+
+mlir::LogicalResult Buffer::MergePadding(mlir::ArrayAttr padding) {
+  if (padding == nullptr) return mlir::success();
+  if (padding_ == nullptr) padding_ = padding;
+  return mlir::success(padding_ == padding);
+}
+
+mlir::LogicalResult Buffer::MergeAlignment(mlir::IntegerAttr alignment) {
+  if (alignment == nullptr) return mlir::success();
+  if (alignment_ == nullptr) alignment_ = alignment;
+  return mlir::success(alignment_ == alignment);
+}
+
+mlir::LogicalResult Buffer::MergePrefetch(PrefetchAttr prefetch) {
+  if (prefetch == nullptr) return mlir::success();
+  if (prefetch_ == nullptr) prefetch_ = prefetch;
+  return mlir::success(prefetch_ == prefetch);
+}
+
+mlir::LogicalResult Buffer::MergeDoubleBuffer(mlir::StringAttr loop) {
+  if (loop == nullptr) return mlir::success();
+  if (double_buffer_ == nullptr) double_buffer_ = loop;
+  return mlir::success(double_buffer_ == loop);
+}
+
+std::optional<int64_t> StaticLayoutExtent(MappingExpr expr,
+                                          DomainShapeAttr shape) {
+  if (auto dim_expr = expr.dyn_cast<MappingDimExpr>()) {
+    auto range = shape.Dimension(dim_expr.dimension())
+                     .type()
+                     .dyn_cast<StaticRangeType>();
+    if (range == nullptr) return std::nullopt;
+    return llvm::divideCeil(range.size(), range.getStep());
+  }
+  auto stripe_expr = expr.dyn_cast<MappingStripeExpr>();
+  if (stripe_expr == nullptr) return std::nullopt;
+  llvm::ArrayRef<int> factors = stripe_expr.factors();
+  // Inner stripes span exactly the factor of the enclosing stripe.
+  if (factors.size() > 1) {
+    return llvm::divideCeil(factors[factors.size() - 2], factors.back());
+  }
+  std::optional<int64_t> operand_extent =
+      StaticLayoutExtent(stripe_expr.operand(), shape);
+  if (!operand_extent.has_value()) return std::nullopt;
+  return llvm::divideCeil(*operand_extent, factors.back());
+}
+
+std::optional<int64_t> Buffer::StaticSize() const {
+  if (!element_type_.isIntOrFloat()) return std::nullopt;
+  int64_t size = llvm::divideCeil(element_type_.getIntOrFloatBitWidth(), 8);
+  DomainShapeAttr shape = DomainShape();
+  for (auto [dimension, expr] : llvm::enumerate(mapping())) {
+    std::optional<int64_t> extent = StaticLayoutExtent(expr, shape);
+    if (!extent.has_value()) return std::nullopt;
+    if (padding_ != nullptr) {
+      *extent += padding_[dimension].cast<mlir::IntegerAttr>().getInt();
+    }
+    size *= *extent;
+  }
+  return size;
 }
 
 void Buffer::AddValue(ResultInstance value) {
@@ -67,6 +139,21 @@ StorageAnalysis::StorageAnalysis(mlir::Operation *operation)
   (void)result;
 }
 
+StorageAnalysis::StorageAnalysis(SairProgramOp program,
+                                 mlir::AnalysisManager &analysis_manager)
+    : StorageAnalysis(program.getContext()) {
+  auto &sequence_analysis =
+      analysis_manager.getAnalysis<SequenceAnalysis, SairProgramOp>();
+  auto &fusion_analysis =
+      analysis_manager.getAnalysis<LoopFusionAnalysis, SairProgramOp>();
+  auto &iteration_spaces =
+      analysis_manager.getAnalysis<IterationSpaceAnalysis, SairProgramOp>();
+  mlir::LogicalResult result =
+      Init(program, fusion_analysis, iteration_spaces, sequence_analysis);
+  assert(mlir::succeeded(result));
+  (void)result;
+}
+
 std::optional<StorageAnalysis> StorageAnalysis::Create(SairProgramOp program) {
   StorageAnalysis analysis(program.getContext());
   if (mlir::failed(analysis.Init(program))) {
@@ -75,6 +162,18 @@ std::optional<StorageAnalysis> StorageAnalysis::Create(SairProgramOp program) {
   return analysis;
 }
 
+std::optional<StorageAnalysis> StorageAnalysis::Create(
+    SairProgramOp program, const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const SequenceAnalysis &sequence_analysis) {
+  StorageAnalysis analysis(program.getContext());
+  if (mlir::failed(analysis.Init(program, fusion_analysis, iteration_spaces,
+                                 sequence_analysis))) {
+    return std::nullopt;
+  }
+  return analysis;
+}
+
 mlir::LogicalResult VerifyStorageAttrWellFormed(
     mlir::Location loc, SairDialect *sair_dialect, mlir::TypeRange result_types,
     llvm::DenseSet<mlir::Attribute> loop_names,
@@ -93,23 +192,23 @@ mlir::LogicalResult VerifyStorageAttrWellFormed(
                 "or unit attributes";
     }
 
-    if (buffer.space() != sair_dialect->register_attr() &&
-        buffer.space() != sair_dialect->memory_attr()) {
+    bool in_memory = sair_dialect->IsMemorySpace(buffer.space());
+    if (buffer.space() != sair_dialect->register_attr() && !in_memory) {
       return mlir::emitError(loc) << "invalid memory space " << buffer.space();
     }
 
+    // Named buffers in registers hold small multi-dimensional values, such as
+    // accumulator tiles, and are materialized like buffers in memory.
+    bool is_named = buffer.name() != nullptr;
     auto element_type = type.cast<ValueType>().ElementType();
-    if (buffer.space() == sair_dialect->memory_attr() &&
-        element_type.isa<mlir::IndexType, mlir::MemRefType>()) {
+    if (is_named && element_type.isa<mlir::IndexType, mlir::MemRefType>()) {
       return mlir::emitError(loc)
              << "index and memref variables cannot be allocated in memory";
     }
 
-    if ((buffer.space() == sair_dialect->memory_attr()) ^
-        buffer.name() != nullptr) {
+    if (in_memory && !is_named) {
       return mlir::emitError(loc)
-             << "buffers must have a name if and only if they "
-                "are stored in memory";
+             << "buffers stored in memory must have a name";
     }
 
     if (buffer.name() != nullptr &&
@@ -118,16 +217,72 @@ mlir::LogicalResult VerifyStorageAttrWellFormed(
              << "operation cannot store two results in the same buffer";
     }
 
+    if (!in_memory && (buffer.padding() != nullptr ||
+                       buffer.alignment() != nullptr)) {
+      return mlir::emitError(loc)
+             << "padding and alignment are only supported for buffers in "
+                "memory";
+    }
+
+    if (PrefetchAttr prefetch = buffer.prefetch()) {
+      if (!in_memory) {
+        return mlir::emitError(loc)
+               << "prefetching is only supported for buffers in memory";
+      }
+      if (prefetch.distance().getInt() <= 0) {
+        return mlir::emitError(loc) << "prefetch distance must be positive";
+      }
+      if (!loop_names.contains(prefetch.loop())) {
+        return mlir::emitError(loc)
+               << "unknown loop name " << prefetch.loop();
+      }
+    }
+
+    if (mlir::StringAttr loop = buffer.double_buffer()) {
+      if (!in_memory) {
+        return mlir::emitError(loc)
+               << "double buffering is only supported for buffers in memory";
+      }
+      if (!loop_names.contains(loop)) {
+        return mlir::emitError(loc) << "unknown loop name " << loop;
+      }
+    }
+
+    if (!in_memory && buffer.nontemporal() != nullptr) {
+      return mlir::emitError(loc)
+             << "non-temporal stores are only supported for buffers in memory";
+    }
+
+    if (buffer.alignment() != nullptr &&
+        (buffer.alignment().getInt() <= 0 ||
+         !llvm::isPowerOf2_64(buffer.alignment().getInt()))) {
+      return mlir::emitError(loc) << "alignment must be a power of two";
+    }
+
+    if (buffer.padding() != nullptr) {
+      for (mlir::Attribute padding : buffer.padding()) {
+        auto int_attr = padding.dyn_cast<mlir::IntegerAttr>();
+        if (int_attr == nullptr || int_attr.getInt() < 0) {
+          return mlir::emitError(loc)
+                 << "padding must be an array of non-negative integers";
+        }
+      }
+      if (buffer.layout() != nullptr &&
+          buffer.padding().size() != buffer.layout().mapping().size()) {
+        return mlir::emitError(loc)
+               << "padding must have one entry per layout dimension";
+      }
+    }
+
     if (buffer.layout() == nullptr) continue;
 
     if (buffer.layout().mapping().HasUnknownExprs()) {
       return mlir::emitError(loc) << "layouts cannot contain `?` expressions";
     }
 
-    if (buffer.space() == sair_dialect->register_attr() &&
-        !buffer.layout().mapping().empty()) {
+    if (!in_memory && !is_named && !buffer.layout().mapping().empty()) {
       return mlir::emitError(loc)
-             << "only 0D buffers can be stored in registers";
+             << "only 0D buffers can be stored in registers without a name";
     }
 
     for (mlir::StringAttr loop_name : buffer.layout().names()) {
@@ -200,10 +355,15 @@ static mlir::LogicalResult UnifyBufferShape(
 
   auto renaming = MappingAttr::get(context, domain.size(), constraints);
   auto domain_to_loops = loop_nest_mapping.ResizeUseDomain(domain.size());
-  auto domain_to_iter_space =
-      renaming.Compose(op_iter_space.mapping())
-          .Unify(domain_to_loops.Resize(iter_space_size));
-  auto domain_to_layout = domain_to_iter_space.Compose(layout).Canonicalize();
+  std::optional<ScratchMapping> domain_to_iter_space =
+      ScratchMapping(renaming)
+          .Compose(ScratchMapping(op_iter_space.mapping()))
+          .Unify(ScratchMapping(domain_to_loops).Resize(iter_space_size));
+  assert(domain_to_iter_space.has_value());
+  MappingAttr domain_to_layout =
+      domain_to_iter_space->Compose(ScratchMapping(layout))
+          .Canonicalize()
+          .ToAttr(context);
   return buffer.UnifyMapping(op, domain_to_loops, domain_to_layout, domain);
 }
 
@@ -257,6 +417,46 @@ static mlir::LogicalResult DeclareBuffer(
     return mlir::failure();
   }
 
+  // Check that padding and alignment match.
+  if (attr.padding() != nullptr || attr.alignment() != nullptr) {
+    if (buffer.is_external()) {
+      return op.EmitError() << "cannot specify padding or alignment of "
+                               "external buffer "
+                            << attr.name();
+    }
+    if (mlir::failed(buffer.MergePadding(attr.padding())) ||
+        mlir::failed(buffer.MergeAlignment(attr.alignment()))) {
+      mlir::InFlightDiagnostic diag =
+          op.EmitError() << "buffer " << attr.name()
+                         << " has different padding or alignment than in "
+                            "previous occurence";
+      diag.attachNote(buffer.location()) << "previous occurence here";
+      return mlir::failure();
+    }
+  }
+
+  if (mlir::failed(buffer.MergePrefetch(attr.prefetch()))) {
+    mlir::InFlightDiagnostic diag =
+        op.EmitError() << "buffer " << attr.name()
+                       << " has different prefetch than in previous occurence";
+    diag.attachNote(buffer.location()) << "previous occurence here";
+    return mlir::failure();
+  }
+
+  if (attr.double_buffer() != nullptr && buffer.is_external()) {
+    return op.EmitError() << "cannot double-buffer external buffer "
+                          << attr.name();
+  }
+  if (mlir::failed(buffer.MergeDoubleBuffer(attr.double_buffer()))) {
+    mlir::InFlightDiagnostic diag =
+        op.EmitError() << "buffer " << attr.name()
+                       << " is double-buffered along a different loop than in "
+                          "previous occurence";
+    diag.attachNote(buffer.location()) << "previous occurence here";
+    return mlir::failure();
+  }
+  buffer.MergeNontemporal(attr.nontemporal());
+
   MappingAttr layout = GetBufferLayout(op, attr, iteration_spaces);
   TrimBufferLoopNestForAccess(iter_space, layout, loop_analysis, buffer);
   if (layout == nullptr) return mlir::success();
@@ -404,11 +604,16 @@ mlir::LogicalResult StorageAnalysis::ComputeValueStorages(
 }
 
 mlir::LogicalResult StorageAnalysis::Init(SairProgramOp program) {
-  // TODO(b/181938550): use cached analysis.
   SequenceAnalysis sequence_analysis(program);
   LoopFusionAnalysis fusion_analysis(program, &sequence_analysis);
   IterationSpaceAnalysis iteration_spaces(program);
+  return Init(program, fusion_analysis, iteration_spaces, sequence_analysis);
+}
 
+mlir::LogicalResult StorageAnalysis::Init(
+    SairProgramOp program, const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const SequenceAnalysis &sequence_analysis) {
   if (mlir::failed(DeclareBuffers(program, iteration_spaces, fusion_analysis,
                                   buffers_))) {
     return mlir::failure();
@@ -1038,15 +1243,236 @@ static mlir::LogicalResult VerifyCommunicationVolume(
   return mlir::failure(result.wasInterrupted());
 }
 
+// Ensures that internal buffers stored in registers have a static size and
+// that buffers allocated in memory spaces listed in the `memory_budgets`
+// attribute of the program fit in their budget.
+static mlir::LogicalResult VerifyBufferSizes(
+    SairProgramOp program, const StorageAnalysis &storage_analysis) {
+  auto *sair_dialect = program.getContext()->getLoadedDialect<SairDialect>();
+  llvm::DenseMap<mlir::Attribute, int64_t> remaining;
+  std::optional<mlir::DictionaryAttr> budgets = program.getMemoryBudgets();
+  for (mlir::NamedAttribute budget :
+       budgets.value_or(mlir::DictionaryAttr::get(program.getContext()))) {
+    if (!sair_dialect->IsMemorySpace(budget.getName())) {
+      return program.emitError()
+             << "invalid memory space " << budget.getName() << " in budgets";
+    }
+    auto size = budget.getValue().dyn_cast<mlir::IntegerAttr>();
+    if (size == nullptr || size.getInt() < 0) {
+      return program.emitError()
+             << "memory budgets must be non-negative integers";
+    }
+    remaining[budget.getName()] = size.getInt();
+  }
+
+  // Iterate on buffers in a deterministic order to report errors consistently.
+  llvm::SmallVector<const Buffer *> buffers;
+  for (auto &[name, buffer] : storage_analysis.buffers()) {
+    if (buffer.is_external() || buffer.values().empty()) continue;
+    buffers.push_back(&buffer);
+  }
+  llvm::sort(buffers, [](const Buffer *lhs, const Buffer *rhs) {
+    return lhs->name().getValue() < rhs->name().getValue();
+  });
+
+  for (const Buffer *buffer : buffers) {
+    mlir::StringAttr space =
+        storage_analysis.GetStorage(buffer->values().front()).space();
+    // Layouts may not be fully specified yet.
+    if (buffer->mapping().HasUnknownExprs()) continue;
+    std::optional<int64_t> size = buffer->StaticSize();
+    // Double-buffered buffers are allocated twice.
+    if (size.has_value() && buffer->double_buffer() != nullptr) *size *= 2;
+    if (space == sair_dialect->register_attr() && !size.has_value()) {
+      return buffer->EmitError()
+             << "must have a static size to be stored in registers";
+    }
+    auto it = remaining.find(space);
+    if (it == remaining.end()) continue;
+    if (!size.has_value()) {
+      return buffer->EmitError()
+             << "must have a static size to be allocated in space " << space
+             << " with a memory budget";
+    }
+    if (*size > it->second) {
+      return buffer->EmitError()
+             << "exceeds the memory budget of space " << space << " ("
+             << *size << " bytes requested, " << it->second
+             << " bytes available)";
+    }
+    it->second -= *size;
+  }
+  return mlir::success();
+}
+
+// Verifies that double-buffered buffers are accessed inside the loop they
+// rotate along, which must not be part of the buffer loop nest, and that
+// values stored in the buffer do not outlive an iteration of that loop.
+static mlir::LogicalResult VerifyDoubleBuffers(
+    const IterationSpaceAnalysis &iteration_spaces,
+    const StorageAnalysis &storage_analysis) {
+  for (auto &[name, buffer] : storage_analysis.buffers()) {
+    mlir::StringAttr loop = buffer.double_buffer();
+    if (loop == nullptr) continue;
+
+    auto verify_access = [&](const ComputeOpInstance &op,
+                             MappingAttr layout) -> mlir::LogicalResult {
+      llvm::ArrayRef<mlir::StringAttr> loop_names =
+          iteration_spaces.Get(op).loop_names();
+      auto it = llvm::find(loop_names, loop);
+      int level = it - loop_names.begin();
+      if (it == loop_names.end() || level < buffer.loop_nest().size()) {
+        return op.EmitError()
+               << "buffer " << buffer.name()
+               << " must be accessed in loop " << loop
+               << ", outside of the buffer loop nest, to be double-buffered";
+      }
+      if (layout != nullptr && layout.DependencyMask().test(level)) {
+        return op.EmitError()
+               << "buffer " << buffer.name()
+               << " cannot be double-buffered along loop " << loop
+               << " as it holds values across its iterations";
+      }
+      return mlir::success();
+    };
+
+    for (auto [op, result] : buffer.writes()) {
+      const ValueStorage &storage =
+          storage_analysis.GetStorage(op.Result(result));
+      if (mlir::failed(verify_access(op, storage.layout()))) {
+        return mlir::failure();
+      }
+    }
+    for (auto [op, operand] : buffer.reads()) {
+      OperandInstance operand_instance = op.Operand(operand);
+      std::optional<ValueStorage> storage =
+          storage_analysis.GetStorage(*operand_instance.GetValue())
+              .Map(operand_instance, iteration_spaces);
+      MappingAttr layout = storage.has_value() ? storage->layout() : nullptr;
+      if (mlir::failed(verify_access(op, layout))) return mlir::failure();
+    }
+  }
+  return mlir::success();
+}
+
+mlir::StringAttr FindRolledLoopIndexing(
+    const Buffer &buffer, const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const StorageAnalysis &storage_analysis) {
+  auto find_rolled_loop = [&](const ComputeOpInstance &op,
+                              MappingAttr layout) -> mlir::StringAttr {
+    if (layout == nullptr) return nullptr;
+    const IterationSpace &iter_space = iteration_spaces.Get(op);
+    for (int level : layout.DependencyMask().set_bits()) {
+      // Dimensions past the loop nest are not lowered to loops yet.
+      if (level >= iter_space.num_loops()) continue;
+      mlir::StringAttr name = iter_space.loop_names()[level];
+      const LoopFusionClass &fusion_class = fusion_analysis.GetClass(name);
+      std::optional<int64_t> trip_count = StaticLayoutExtent(
+          fusion_class.mapping().Dimension(0), fusion_class.DomainShape());
+      if (trip_count.has_value() &&
+          fusion_class.unroll_factor() >= *trip_count) {
+        continue;
+      }
+      return name;
+    }
+    return nullptr;
+  };
+
+  for (auto [op, result] : buffer.writes()) {
+    const ValueStorage &storage =
+        storage_analysis.GetStorage(op.Result(result));
+    if (mlir::StringAttr loop = find_rolled_loop(op, storage.layout())) {
+      return loop;
+    }
+  }
+  for (auto [op, operand] : buffer.reads()) {
+    OperandInstance operand_instance = op.Operand(operand);
+    std::optional<ValueStorage> storage =
+        storage_analysis.GetStorage(*operand_instance.GetValue())
+            .Map(operand_instance, iteration_spaces);
+    if (!storage.has_value()) continue;
+    if (mlir::StringAttr loop = find_rolled_loop(op, storage->layout())) {
+      return loop;
+    }
+  }
+  return nullptr;
+}
+
+// Verifies that multi-dimensional buffers in registers are only indexed by
+// fully unrolled loops.
+static mlir::LogicalResult VerifyRegisterTiles(
+    SairProgramOp program, const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const StorageAnalysis &storage_analysis) {
+  auto *sair_dialect = static_cast<SairDialect *>(program->getDialect());
+  for (auto &[name, buffer] : storage_analysis.buffers()) {
+    if (buffer.rank() == 0 || buffer.values().empty()) continue;
+    mlir::StringAttr space =
+        storage_analysis.GetStorage(buffer.values().front()).space();
+    if (space != sair_dialect->register_attr()) continue;
+    if (mlir::StringAttr loop = FindRolledLoopIndexing(
+            buffer, fusion_analysis, iteration_spaces, storage_analysis)) {
+      return buffer.EmitError()
+             << "loop " << loop
+             << " must be fully unrolled to index a buffer in registers";
+    }
+  }
+  return mlir::success();
+}
+
+// Verifies that iterations of parallel loops, or of loops mapped to GPU
+// processors, write to distinct locations of buffers allocated outside of the
+// loop. Registers are private to each iteration.
+static mlir::LogicalResult VerifyParallelWrites(
+    SairProgramOp program, const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const StorageAnalysis &storage_analysis) {
+  auto *sair_dialect = static_cast<SairDialect *>(program->getDialect());
+  for (auto &[name, buffer] : storage_analysis.buffers()) {
+    for (auto [op, result] : buffer.writes()) {
+      const ValueStorage &storage =
+          storage_analysis.GetStorage(op.Result(result));
+      MappingAttr layout = storage.layout();
+      if (storage.space() == sair_dialect->register_attr() ||
+          layout == nullptr || layout.HasUnknownExprs()) {
+        continue;
+      }
+      llvm::SmallBitVector layout_loops = layout.DependencyMask();
+      llvm::ArrayRef<mlir::StringAttr> loop_names =
+          iteration_spaces.Get(op).loop_names();
+      for (auto [level, loop] : llvm::enumerate(loop_names)) {
+        // Buffers nested in the loop are allocated for each iteration.
+        if (level < buffer.loop_nest().size()) continue;
+        const LoopFusionClass &fusion_class = fusion_analysis.GetClass(loop);
+        if (!fusion_class.parallel() && fusion_class.gpu() == nullptr) continue;
+        if (level < layout_loops.size() && layout_loops.test(level)) continue;
+        return op.EmitError()
+               << "iterations of parallel loop " << loop
+               << " write to the same elements of buffer " << buffer.name();
+      }
+    }
+  }
+  return mlir::success();
+}
+
 mlir::LogicalResult VerifyStorages(
     SairProgramOp program, const LoopFusionAnalysis &fusion_analysis,
     const IterationSpaceAnalysis &iteration_spaces,
     const SequenceAnalysis &sequence_analysis) {
   // Ensure storage attributes are compatibles with each other.
-  auto analysis_result = StorageAnalysis::Create(program);
+  auto analysis_result = StorageAnalysis::Create(
+      program, fusion_analysis, iteration_spaces, sequence_analysis);
   if (!analysis_result.has_value()) return mlir::failure();
-  StorageAnalysis analysis = std::move(analysis_result).value();
+  return VerifyStorages(program, *analysis_result, fusion_analysis,
+                        iteration_spaces, sequence_analysis);
+}
 
+mlir::LogicalResult VerifyStorages(
+    SairProgramOp program, const StorageAnalysis &analysis,
+    const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const SequenceAnalysis &sequence_analysis) {
   // Ensure that operation updating a buffers in place use the same layout for
   // both inputs and outputs.
   auto result = program.TryWalkComputeOpInstances(
@@ -1082,6 +1508,20 @@ mlir::LogicalResult VerifyStorages(
           VerifyCommunicationVolume(program, iteration_spaces, analysis))) {
     return mlir::failure();
   }
+  if (mlir::failed(VerifyBufferSizes(program, analysis))) {
+    return mlir::failure();
+  }
+  if (mlir::failed(VerifyDoubleBuffers(iteration_spaces, analysis))) {
+    return mlir::failure();
+  }
+  if (mlir::failed(VerifyParallelWrites(program, fusion_analysis,
+                                        iteration_spaces, analysis))) {
+    return mlir::failure();
+  }
+  if (mlir::failed(VerifyRegisterTiles(program, fusion_analysis,
+                                       iteration_spaces, analysis))) {
+    return mlir::failure();
+  }
   return VerifyValuesNotOverwritten(fusion_analysis, iteration_spaces, analysis,
                                     sequence_analysis);
 }
@@ -1091,7 +1531,9 @@ BufferAttr GetRegister0DBuffer(mlir::MLIRContext *context) {
   return BufferAttr::get(/*space=*/sair_dialect->register_attr(),
                          /*name=*/nullptr,
                          /*layout=*/NamedMappingAttr::GetIdentity(context, {}),
-                         context);
+                         /*padding=*/nullptr, /*alignment=*/nullptr,
+                         /*prefetch=*/nullptr, /*double_buffer=*/nullptr,
+                         /*nontemporal=*/nullptr, context);
 }
 
 bool operator==(const ValueStorage &lhs, const ValueStorage &rhs) {
@@ -1144,12 +1586,15 @@ ValueStorage ValueStorage::Map(
   if (layout_ != nullptr) {
     // We need to resize mapping to match operations domain size as values may
     // have a smaller rank than the operations that creates them.
-    MappingAttr domain_mapping =
-        mapping.Resize(from.domain_size()).ResizeUseDomain(to.domain_size());
-    MappingAttr iter_space_mapping =
-        iteration_spaces.TranslateMapping(to, from, domain_mapping);
-    assert(iter_space_mapping != nullptr);
-    layout = iter_space_mapping.Compose(layout_).Canonicalize();
+    ScratchMapping domain_mapping = ScratchMapping(mapping)
+                                        .Resize(from.domain_size())
+                                        .ResizeUseDomain(to.domain_size());
+    std::optional<ScratchMapping> iter_space_mapping =
+        iteration_spaces.TryTranslateMapping(to, from, domain_mapping);
+    assert(iter_space_mapping.has_value());
+    layout = iter_space_mapping->Compose(ScratchMapping(layout_))
+                 .Canonicalize()
+                 .ToAttr(layout_.getContext());
   }
   return ValueStorage(space_, buffer_name_, layout);
 }
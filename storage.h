@@ -17,6 +17,7 @@
 
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Operation.h"
+#include "mlir/Pass/AnalysisManager.h"
 #include "loop_nest.h"
 #include "mapped_domain.h"
 #include "sair_op_interfaces.h"
@@ -26,6 +27,7 @@
 namespace sair {
 
 class SairDialect;
+class StorageAnalysis;
 
 // Verifies that storage attributes in the program are correct. Assumes that
 // Sair operands are defined in the same program.
@@ -34,9 +36,22 @@ mlir::LogicalResult VerifyStorages(
     const IterationSpaceAnalysis &iteration_spaces,
     const SequenceAnalysis &sequence_analysis);
 
+// Same as above, but reuses a storage analysis built from the storage
+// attributes of the program.
+mlir::LogicalResult VerifyStorages(
+    SairProgramOp program, const StorageAnalysis &storage_analysis,
+    const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const SequenceAnalysis &sequence_analysis);
+
 // Returns the buffer attribute representing a 0-dimensional register.
 BufferAttr GetRegister0DBuffer(mlir::MLIRContext *context);
 
+// Returns the number of elements spanned by layout dimension `expr` of a
+// buffer with domain `shape`, or std::nullopt if it is not statically known.
+std::optional<int64_t> StaticLayoutExtent(MappingExpr expr,
+                                          DomainShapeAttr shape);
+
 // A buffer declared by one or more storage attributes.
 class Buffer : public MappedDomain {
  public:
@@ -75,12 +90,51 @@ class Buffer : public MappedDomain {
   // List of values stored in the buffer.
   llvm::ArrayRef<ResultInstance> values() const { return values_; }
 
+  // Number of elements added at the end of each dimension of the buffer. May
+  // be null. MergePadding fails if `padding` differs from a previously set
+  // padding.
+  mlir::ArrayAttr padding() const { return padding_; }
+  mlir::LogicalResult MergePadding(mlir::ArrayAttr padding);
+
+  // Alignment of the buffer in bytes. May be null. MergeAlignment fails if
+  // `alignment` differs from a previously set alignment.
+  mlir::IntegerAttr alignment() const { return alignment_; }
+  mlir::LogicalResult MergeAlignment(mlir::IntegerAttr alignment);
+
+  // Prefetching of data loaded from the buffer. May be null. MergePrefetch
+  // fails if `prefetch` differs from a previously set prefetch.
+  PrefetchAttr prefetch() const { return prefetch_; }
+  mlir::LogicalResult MergePrefetch(PrefetchAttr prefetch);
+
+  // Loop along which the buffer alternates between two allocations. May be
+  // null. MergeDoubleBuffer fails if `loop` differs from a previously set
+  // loop.
+  mlir::StringAttr double_buffer() const { return double_buffer_; }
+  mlir::LogicalResult MergeDoubleBuffer(mlir::StringAttr loop);
+
+  // Indicates that stores to the buffer bypass caches. Set as soon as one
+  // storage attribute of the buffer, or the sair.to_memref operation exporting
+  // it, requests it.
+  bool nontemporal() const { return nontemporal_; }
+  void MergeNontemporal(mlir::UnitAttr nontemporal) {
+    nontemporal_ |= nontemporal != nullptr;
+  }
+
+  // Size of the buffer in bytes, including padding. Returns std::nullopt if
+  // the size is not statically known.
+  std::optional<int64_t> StaticSize() const;
+
   // Registers a value stored in the buffer.
   void AddValue(ResultInstance value);
 
  private:
   mlir::Type element_type_;
   FromToMemRefOp import_op_ = nullptr;
+  mlir::ArrayAttr padding_;
+  mlir::IntegerAttr alignment_;
+  PrefetchAttr prefetch_;
+  mlir::StringAttr double_buffer_;
+  bool nontemporal_ = false;
 
   llvm::SmallVector<std::pair<ComputeOpInstance, int>> writes_;
   llvm::SmallVector<std::pair<ComputeOpInstance, int>> reads_;
@@ -149,10 +203,23 @@ class StorageAnalysis {
   // operation. Asserts that the analysis succeeded.
   explicit StorageAnalysis(mlir::Operation *operation);
 
+  // Creates and populates the analysis using the sequence, fusion and
+  // iteration space analyses cached in `analysis_manager`. Used when the
+  // analysis is requested by a pass. Asserts that the analysis succeeded.
+  StorageAnalysis(SairProgramOp program,
+                  mlir::AnalysisManager &analysis_manager);
+
   // Creates and populates the analysis. Returns `nullopt` and emits an error if
   // the analysis fails because storage attributes are invalid.
   static std::optional<StorageAnalysis> Create(SairProgramOp program);
 
+  // Same as above but reuses already computed analyses instead of building
+  // them from scratch.
+  static std::optional<StorageAnalysis> Create(
+      SairProgramOp program, const LoopFusionAnalysis &fusion_analysis,
+      const IterationSpaceAnalysis &iteration_spaces,
+      const SequenceAnalysis &sequence_analysis);
+
   // Retrieves the analysis result for a buffer.
   const Buffer &GetBuffer(mlir::StringAttr buffer) const {
     return buffers_.find(buffer)->second;
@@ -208,6 +275,10 @@ class StorageAnalysis {
 
   // Populates the analysis.
   mlir::LogicalResult Init(SairProgramOp program);
+  mlir::LogicalResult Init(SairProgramOp program,
+                           const LoopFusionAnalysis &fusion_analysis,
+                           const IterationSpaceAnalysis &iteration_spaces,
+                           const SequenceAnalysis &sequence_analysis);
 
   // Fills value_storages_.
   mlir::LogicalResult ComputeValueStorages(
@@ -235,13 +306,21 @@ mlir::LogicalResult VerifyValuesNotOverwritten(
     const StorageAnalysis &storage_analysis,
     const SequenceAnalysis &sequence_analysis);
 
+// Returns the first loop indexing `buffer` that is not fully unrolled, or
+// nullptr if there is none. Multi-dimensional buffers in registers are only
+// promoted to SSA values once all loops indexing them are fully unrolled.
+mlir::StringAttr FindRolledLoopIndexing(
+    const Buffer &buffer, const LoopFusionAnalysis &fusion_analysis,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const StorageAnalysis &storage_analysis);
+
 // Verifies that the storage attribute is well-formed:
 // - that storage attributes are arrays of buffer or unit attributes,
 // - that the number of entries in the storage array matches the number of,
 //   results of the operation,
 // - that indexes are not stored in memory,
 // - that memory spaces referenced by the attribute exist,
-// - that multi-dimensional buffers are not stored in registers,
+// - that unnamed multi-dimensional buffers are not stored in registers,
 // - that loops referenced by the attribute exist and
 // - that the buffer has a name if and only if the memory space is addressable.
 mlir::LogicalResult VerifyStorageAttrWellFormed(
@@ -0,0 +1,57 @@
+// RUN: sair-opt -allow-unregistered-dialect -emit-bytecode %s \
+// RUN:   | sair-opt -allow-unregistered-dialect | FileCheck %s
+
+// CHECK-LABEL: @attributes
+func.func @attributes() {
+  // CHECK: "foo"() {mapping_expr = #sair.mapping_expr<d1>}
+  "foo"() {mapping_expr = #sair.mapping_expr<d1>} : () -> ()
+  // CHECK: "foo"() {mapping_expr = #sair.mapping_expr<?>}
+  "foo"() {mapping_expr = #sair.mapping_expr<?>} : () -> ()
+  // CHECK: "foo"() {mapping_expr = #sair.mapping_expr<stripe(d0, [4, 1])>}
+  "foo"() {mapping_expr = #sair.mapping_expr<stripe(d0, [4, 1])>} : () -> ()
+  // CHECK: "foo"() {mapping_expr = #sair.mapping_expr<unstripe(d0, d1, [4, 1])>}
+  "foo"() {mapping_expr = #sair.mapping_expr<unstripe(d0, d1, [4, 1])>} : () -> ()
+  // CHECK: "foo"() {mapping = #sair.mapping<3 : d0, d2, d1, none>}
+  "foo"() {mapping = #sair.mapping<3 : d0, d2, d1, none>} : () -> ()
+  // CHECK: "foo"() {mapping = #sair.mapping<0>}
+  "foo"() {mapping = #sair.mapping<0>} : () -> ()
+  // CHECK: #sair.named_mapping<[d0:"A", d1:"B"] -> (d0, d1)>
+  "foo"() {bar = #sair.named_mapping<[d0:"A", d1:"B"] -> (d0, d1)>} : () -> ()
+  // CHECK: #sair.shape<d0:dyn_range x d1:dyn_range(d0)>
+  "foo"() {bar = #sair.shape<d0:dyn_range x d1:dyn_range(d0)>} : () -> ()
+  // CHECK: [#sair.copy<2>, #sair.instance<3>]
+  "foo"() {bar = [#sair.copy<2>, #sair.instance<3>]} : () -> ()
+  func.return
+}
+
+// CHECK-LABEL: @program
+func.func @program(%arg0: f32) {
+  %n = arith.constant 8 : index
+  sair.program {
+    %sn = sair.from_scalar %n : !sair.value<(), index>
+    // CHECK: %[[D0:.*]] = sair.static_range : !sair.static_range<8, 2>
+    %0 = sair.static_range : !sair.static_range<8, 2>
+    // CHECK: %[[D1:.*]] = sair.dyn_range %{{.*}} : !sair.dyn_range
+    %1 = sair.dyn_range %sn : !sair.dyn_range
+    // CHECK: %[[V0:.*]] = sair.from_scalar %{{.*}} : !sair.value<(), f32>
+    %2 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // CHECK: sair.copy[d0:%[[D1]]] %[[V0]]
+    // CHECK-SAME: {iter = #sair.mapping_expr<stripe(d0, [4])>, name = "A"}
+    // CHECK-SAME: {iter = #sair.mapping_expr<stripe(d0, [4, 1])>, name = "B"}
+    // CHECK-SAME: : !sair.value<d0:dyn_range, f32>
+    %3 = sair.copy[d0:%1] %2 {
+      decisions = {
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<stripe(d0, [4])>},
+          {name = "B", iter = #sair.mapping_expr<stripe(d0, [4, 1])>}
+        ]
+      }
+    } : !sair.value<d0:dyn_range, f32>
+    // CHECK: sair.copy[d0:%[[D0]], d1:%[[D1]]] %{{.*}}(d1)
+    // CHECK-SAME: : !sair.value<d0:static_range<8, 2> x d1:dyn_range, f32>
+    %4 = sair.copy[d0:%0, d1:%1] %3(d1)
+      : !sair.value<d0:static_range<8, 2> x d1:dyn_range, f32>
+    sair.exit
+  }
+  func.return
+}
@@ -1,4 +1,5 @@
 // RUN: sair-opt -sair-assign-default-loop-nest %s | FileCheck %s
+// RUN: sair-opt -sair-assign-default-loop-nest="cache-sizes=16384,262144" %s | FileCheck %s --check-prefix=TILED
 
 func.func @default_loop_nest(%arg0: f32) {
   sair.program {
@@ -15,3 +16,71 @@ func.func @default_loop_nest(%arg0: f32) {
   }
   func.return
 }
+
+// TILED-LABEL: @tiled_copy
+func.func @tiled_copy(%arg0: memref<256x256xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<256>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<256x256xf32>>
+    %2 = sair.from_memref %1 memref[d0:%0, d1:%0] {buffer_name = "A"}
+      : #sair.shape<d0:static_range<256> x d1:static_range<256>>, memref<256x256xf32>
+    // TILED: sair.copy[d0:%{{.*}}, d1:%{{.*}}] %{{.*}}(d0, d1) {instances = [{loop_nest = [
+    // TILED:   {iter = #sair.mapping_expr<stripe(d0, [128])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d1, [128])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d0, [128, 32])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d1, [128, 32])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d0, [128, 32, 1])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d1, [128, 32, 1])>, name = "{{.*}}"}
+    // TILED: ]}]}
+    %3 = sair.copy[d0:%0, d1:%0] %2(d0, d1) {
+      instances = [{}]
+    } : !sair.value<d0:static_range<256> x d1:static_range<256>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// Dimensions accessed contiguously by most operands are iterated innermost.
+// TILED-LABEL: @tiled_loop_order
+func.func @tiled_loop_order(%arg0: memref<256x256xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<256>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<256x256xf32>>
+    %2 = sair.from_memref %1 memref[d0:%0, d1:%0] {buffer_name = "A"}
+      : #sair.shape<d0:static_range<256> x d1:static_range<256>>, memref<256x256xf32>
+    // TILED: sair.map[d0:%{{.*}}, d1:%{{.*}}] %{{.*}}(d1, d0), %{{.*}}(d1, d0) attributes {instances = [{loop_nest = [
+    // TILED:   {iter = #sair.mapping_expr<stripe(d1, [128])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d0, [128])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d1, [128, 32])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d0, [128, 32])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d1, [128, 32, 1])>, name = "{{.*}}"},
+    // TILED:   {iter = #sair.mapping_expr<stripe(d0, [128, 32, 1])>, name = "{{.*}}"}
+    // TILED: ]}]}
+    %3 = sair.map[d0:%0, d1:%0] %2(d1, d0), %2(d1, d0) attributes {
+      instances = [{}]
+    } {
+    ^bb0(%arg1: index, %arg2: index, %arg3: f32, %arg4: f32):
+      %4 = arith.addf %arg3, %arg4 : f32
+      sair.return %4 : f32
+    } : #sair.shape<d0:static_range<256> x d1:static_range<256>>, (f32, f32) -> f32
+    sair.exit
+  }
+  func.return
+}
+
+// Operations whose working set already fits in the cache are not tiled.
+// TILED-LABEL: @small_domain
+func.func @small_domain(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // TILED: sair.copy[d0:%{{.*}}] %{{.*}} {instances = [{loop_nest = [
+    // TILED:   {iter = #sair.mapping_expr<d0>, name = "{{.*}}"}
+    // TILED: ]}]}
+    sair.copy[d0:%0] %1 {
+      instances = [{}]
+    } : !sair.value<d0:static_range<16>, f32>
+    sair.exit
+  }
+  func.return
+}
@@ -1,4 +1,5 @@
 // RUN: sair-opt -sair-assign-default-sequence %s | FileCheck %s
+// RUN: sair-opt -sair-assign-default-sequence="minimize-memory" %s | FileCheck %s --check-prefix=MEMORY
 
 // CHECK-LABEL: @empty
 // Shouldn't fail here.
@@ -383,3 +384,88 @@ func.func @reordered_remat(%arg0: f32) {
   func.return
 }
 
+
+// CHECK-LABEL: @independent_buffers
+// MEMORY-LABEL: @independent_buffers
+func.func @independent_buffers(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<1024>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // When minimizing memory, each value is used right after it is produced so
+    // that a single buffer is live at a time.
+    // CHECK: %[[V0:.*]] = sair.copy
+    // CHECK-SAME: sequence = 0
+    // MEMORY: %[[V0:.*]] = sair.copy
+    // MEMORY-SAME: sequence = 0
+    %2 = sair.copy[d0:%0] %1 {
+      instances = [{}]
+    } : !sair.value<d0:static_range<1024>, f32>
+    // CHECK: %[[V1:.*]] = sair.copy
+    // CHECK-SAME: sequence = 1
+    // MEMORY: %[[V1:.*]] = sair.copy
+    // MEMORY-SAME: sequence = 2
+    %3 = sair.copy[d0:%0] %1 {
+      instances = [{}]
+    } : !sair.value<d0:static_range<1024>, f32>
+    // CHECK: sair.map[d0:%{{.*}}] %[[V0]](d0)
+    // CHECK-SAME: sequence = 2
+    // MEMORY: sair.map[d0:%{{.*}}] %[[V0]](d0)
+    // MEMORY-SAME: sequence = 1
+    sair.map[d0:%0] %2(d0) attributes {
+      instances = [{}]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<1024>>, (f32) -> ()
+    // CHECK: sair.map[d0:%{{.*}}] %[[V1]](d0)
+    // CHECK-SAME: sequence = 3
+    // MEMORY: sair.map[d0:%{{.*}}] %[[V1]](d0)
+    // MEMORY-SAME: sequence = 3
+    sair.map[d0:%0] %3(d0) attributes {
+      instances = [{}]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<1024>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// MEMORY-LABEL: @sequenced_buffers
+// Check that existing sequence attributes are preserved when minimizing
+// memory.
+func.func @sequenced_buffers(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<1024>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // MEMORY: sair.copy
+    // MEMORY-SAME: sequence = 0
+    %2 = sair.copy[d0:%0] %1 {
+      instances = [{sequence = 0}]
+    } : !sair.value<d0:static_range<1024>, f32>
+    // MEMORY: sair.copy
+    // MEMORY-SAME: sequence = 1
+    %3 = sair.copy[d0:%0] %1 {
+      instances = [{sequence = 1}]
+    } : !sair.value<d0:static_range<1024>, f32>
+    // MEMORY: sair.map
+    // MEMORY-SAME: sequence = 2
+    sair.map[d0:%0] %2(d0) attributes {
+      instances = [{sequence = 2}]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<1024>>, (f32) -> ()
+    // MEMORY: sair.map
+    // MEMORY-SAME: sequence = 3
+    sair.map[d0:%0] %3(d0) attributes {
+      instances = [{}]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<1024>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
@@ -1,4 +1,5 @@
 // RUN: sair-opt %s -sair-assign-default-storage | FileCheck %s
+// RUN: sair-opt %s -sair-assign-default-storage="register-tile-limit=128" | FileCheck %s --check-prefix=REGISTER
 
 // CHECK-LABEL: @memory_space_is_set
 func.func @memory_space_is_set() {
@@ -35,6 +36,61 @@ func.func @preserve_memory_space() {
   func.return
 }
 
+// CHECK-LABEL: @register_tile
+// REGISTER-LABEL: @register_tile
+func.func @register_tile(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<4>
+    %1 = sair.static_range : !sair.static_range<8>
+    %2 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %3 = sair.copy[d0:%0, d1:%1] %2 {
+      instances = [{
+        loop_nest = [
+          {name = "loopA", iter = #sair.mapping_expr<d0>, unroll = 4},
+          {name = "loopB", iter = #sair.mapping_expr<d1>, unroll = 8}
+        ]
+      }]
+      // CHECK: name = "buffer_0", space = "memory"
+      // REGISTER: storage = [{
+      // REGISTER:   layout = #sair.named_mapping<[d0:"loopA", d1:"loopB"] -> (d0, d1)>
+      // REGISTER:   name = "buffer_0", space = "register"
+      // REGISTER: }]
+    } : !sair.value<d0:static_range<4> x d1:static_range<8>, f32>
+    %4 = sair.copy[d0:%0, d1:%1] %3(d0, d1) {
+      instances = [{
+        loop_nest = [
+          {name = "loopC", iter = #sair.mapping_expr<d0>, unroll = 4},
+          {name = "loopD", iter = #sair.mapping_expr<d1>, unroll = 8}
+        ]
+      }]
+    } : !sair.value<d0:static_range<4> x d1:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// REGISTER-LABEL: @register_tile_not_unrolled
+func.func @register_tile_not_unrolled(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<4>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // Loop B is not unrolled, so the buffer stays in memory.
+    // REGISTER: name = "buffer_0", space = "memory"
+    %2 = sair.copy[d0:%0] %1 {
+      instances = [{
+        loop_nest = [{name = "loopA", iter = #sair.mapping_expr<d0>, unroll = 4}]
+      }]
+    } : !sair.value<d0:static_range<4>, f32>
+    %3 = sair.copy[d0:%0] %2(d0) {
+      instances = [{
+        loop_nest = [{name = "loopB", iter = #sair.mapping_expr<d0>}]
+      }]
+    } : !sair.value<d0:static_range<4>, f32>
+    sair.exit
+  }
+  func.return
+}
+
 // CHECK-LABEL: @multi_dim
 func.func @multi_dim(%arg0: f32, %arg1: memref<8x8xf32>) {
   %n = arith.constant 8 : index
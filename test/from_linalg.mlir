@@ -174,3 +174,83 @@ func.func @indices(%arg0: memref<1x2x3xf32>, %arg1: memref<2x3x1xf32>) {
   }
   func.return
 }
+
+// CHECK-LABEL: @matmul
+func.func @matmul(%arg0: memref<8x16xf32>, %arg1: memref<16x64xf32>,
+                  %arg2: memref<8x64xf32>) {
+  // CHECK: %[[d0:.*]] = sair.static_range : !sair.static_range<8>
+  // CHECK: %[[d1:.*]] = sair.static_range : !sair.static_range<64>
+  // CHECK: %[[d2:.*]] = sair.static_range : !sair.static_range<16>
+  // CHECK: sair.map_reduce[d0:%[[d0]], d1:%[[d1]]] %{{.*}}(d0, d1)
+  // CHECK:   reduce[d2:%[[d2]]] %{{.*}}(d0, d2), %{{.*}}(d2, d1)
+  // CHECK: instances = [{loop_nest = [
+  // CHECK:   {iter = #sair.mapping_expr<stripe(d1, [32])>, name = "loop_0"},
+  // CHECK:   {iter = #sair.mapping_expr<d0>, name = "loop_1"},
+  // CHECK:   {iter = #sair.mapping_expr<stripe(d1, [32, 1])>, name = "loop_2"},
+  // CHECK:   {iter = #sair.mapping_expr<d2>, name = "loop_3"}
+  // CHECK: ]}]
+  // CHECK: ^{{.*}}(%{{.*}}: index, %{{.*}}: index, %{{.*}}: index, %[[C:.*]]: f32, %[[A:.*]]: f32, %[[B:.*]]: f32):
+  // CHECK:   %[[MUL:.*]] = arith.mulf %[[A]], %[[B]]
+  // CHECK:   %[[ADD:.*]] = arith.addf %[[C]], %[[MUL]]
+  // CHECK:   sair.return %[[ADD]]
+  linalg.matmul ins(%arg0, %arg1 : memref<8x16xf32>, memref<16x64xf32>)
+               outs(%arg2 : memref<8x64xf32>)
+  func.return
+}
+
+// CHECK-LABEL: @conv
+// CHECK: (%[[INPUT:.*]]: memref<1x10x10x3xf32>
+func.func @conv(%arg0: memref<1x10x10x3xf32>, %arg1: memref<3x3x3x8xf32>,
+                %arg2: memref<1x8x8x8xf32>) {
+  // The input is accessed with a window. It is loaded into a value with the
+  // shape of the iteration domain, accessed with an identity mapping.
+  // CHECK: %[[INPUT_VAL:.*]] = sair.from_scalar %[[INPUT]] : !sair.value<(), memref<1x10x10x3xf32>>
+  // CHECK: %[[WINDOW:.*]] = sair.map[d0:%{{.*}}, d1:%{{.*}}, d2:%{{.*}}, d3:%{{.*}}, d4:%{{.*}}, d5:%{{.*}}, d6:%{{.*}}] %[[INPUT_VAL]]
+  // CHECK: ^{{.*}}(%[[N:.*]]: index, %[[OH:.*]]: index, %[[OW:.*]]: index, %{{.*}}: index, %[[KH:.*]]: index, %[[KW:.*]]: index, %[[CH:.*]]: index, %[[MEMREF:.*]]: memref<1x10x10x3xf32>):
+  // CHECK:   %[[I0:.*]] = affine.apply affine_map<(d0, d1, d2, d3, d4, d5, d6) -> (d0)>(%[[N]], %[[OH]], %[[OW]], %{{.*}}, %[[KH]], %[[KW]], %[[CH]])
+  // CHECK:   %[[I1:.*]] = affine.apply affine_map<(d0, d1, d2, d3, d4, d5, d6) -> (d1 + d4)>
+  // CHECK:   %[[I2:.*]] = affine.apply affine_map<(d0, d1, d2, d3, d4, d5, d6) -> (d2 + d5)>
+  // CHECK:   %[[I3:.*]] = affine.apply affine_map<(d0, d1, d2, d3, d4, d5, d6) -> (d6)>
+  // CHECK:   %[[LOADED:.*]] = memref.load %[[MEMREF]][%[[I0]], %[[I1]], %[[I2]], %[[I3]]]
+  // CHECK:   sair.return %[[LOADED]] : f32
+  // CHECK: sair.map_reduce[d0:%{{.*}}, d1:%{{.*}}, d2:%{{.*}}, d3:%{{.*}}] %{{.*}}(d0, d1, d2, d3)
+  // CHECK:   reduce[d4:%{{.*}}, d5:%{{.*}}, d6:%{{.*}}] %[[WINDOW]](d0, d1, d2, d3, d4, d5, d6), %{{.*}}(d4, d5, d6, d3)
+  // CHECK: ^{{.*}}(%{{.*}}: index, %{{.*}}: index, %{{.*}}: index, %{{.*}}: index, %{{.*}}: index, %{{.*}}: index, %{{.*}}: index, %[[OUT:.*]]: f32, %[[IN:.*]]: f32, %[[FILTER:.*]]: f32):
+  // CHECK:   arith.mulf %[[IN]], %[[FILTER]]
+  linalg.conv_2d_nhwc_hwcf
+    ins(%arg0, %arg1 : memref<1x10x10x3xf32>, memref<3x3x3x8xf32>)
+   outs(%arg2 : memref<1x8x8x8xf32>)
+  func.return
+}
+
+func.func private @scale(memref<8x16xf32>, memref<8x16xf32>)
+  attributes {sair.microkernel = @scale_impl}
+func.func private @scale_impl(memref<f32>, index, index, index, memref<f32>,
+                              index, index, index)
+
+// CHECK-LABEL: @library_call
+// CHECK: (%[[ARG0:.*]]: memref<8x16xf32>, %[[ARG1:.*]]: memref<8x16xf32>)
+func.func @library_call(%arg0: memref<8x16xf32>, %arg1: memref<8x16xf32>) {
+  // Operations whose library call is implemented by a microkernel become a
+  // single call expanded with the libcall pattern.
+  // CHECK: sair.program
+  // CHECK:   %[[V0:.*]] = sair.from_scalar %[[ARG0]] : !sair.value<(), memref<8x16xf32>>
+  // CHECK:   %[[V1:.*]] = sair.from_scalar %[[ARG1]] : !sair.value<(), memref<8x16xf32>>
+  // CHECK:   sair.map %[[V0]], %[[V1]] attributes
+  // CHECK-SAME: expansion = "libcall"
+  // CHECK:   ^{{.*}}(%[[M0:.*]]: memref<8x16xf32>, %[[M1:.*]]: memref<8x16xf32>):
+  // CHECK:     call @scale(%[[M0]], %[[M1]])
+  // CHECK:     sair.return
+  // CHECK:   sair.exit
+  // CHECK-NOT: linalg.generic
+  linalg.generic {
+    indexing_maps = [affine_map<(i, j) -> (i, j)>,
+                     affine_map<(i, j) -> (i, j)>],
+    iterator_types = ["parallel", "parallel"],
+    library_call = "scale"
+  } ins(%arg0 : memref<8x16xf32>) outs(%arg1 : memref<8x16xf32>) {
+  ^bb0(%a: f32, %b: f32):
+    linalg.yield %a : f32
+  }
+  func.return
+}
@@ -19,3 +19,11 @@ func.func @shape_mismatch(%arg0: memref<?xf32>, %arg1: memref<2xf32>) {
   }
   func.return
 }
+
+// -----
+
+func.func @fill(%arg0: f32, %arg1: memref<2xf32>) {
+  // expected-error @+1 {{Linalg op is not compatible with Sair}}
+  linalg.fill ins(%arg0 : f32) outs(%arg1 : memref<2xf32>)
+  func.return
+}
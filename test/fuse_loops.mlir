@@ -0,0 +1,114 @@
+// RUN: sair-opt -sair-fuse-loops %s | FileCheck %s
+
+// CHECK-LABEL: @elementwise_chain
+func.func @elementwise_chain(%arg0: memref<8x16xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.static_range : !sair.static_range<16>
+    %2 = sair.from_scalar %arg0 : !sair.value<(), memref<8x16xf32>>
+    %3 = sair.from_memref %2 memref[d0:%0, d1:%1] {buffer_name = "A"}
+      : #sair.shape<d0:static_range<8> x d1:static_range<16>>, memref<8x16xf32>
+    // CHECK: sair.copy
+    // CHECK-SAME: loop_nest = [
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d0>, name = "A"},
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d1>, name = "B"}
+    %4 = sair.copy[d0:%0, d1:%1] %3(d0, d1) {
+      instances = [{loop_nest = [
+        {name = "A", iter = #sair.mapping_expr<d0>},
+        {name = "B", iter = #sair.mapping_expr<d1>}
+      ]}]
+    } : !sair.value<d0:static_range<8> x d1:static_range<16>, f32>
+    // CHECK: sair.map
+    // CHECK-SAME: loop_nest = [
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d0>, name = "A"},
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d1>, name = "B"}
+    %5 = sair.map[d0:%0, d1:%1] %4(d0, d1) attributes {
+      instances = [{loop_nest = [
+        {name = "C", iter = #sair.mapping_expr<d0>},
+        {name = "D", iter = #sair.mapping_expr<d1>}
+      ]}]
+    } {
+    ^bb0(%arg1: index, %arg2: index, %arg3: f32):
+      %6 = arith.addf %arg3, %arg3 : f32
+      sair.return %6 : f32
+    } : #sair.shape<d0:static_range<8> x d1:static_range<16>>, (f32) -> f32
+    // Loops are matched through the mapping of the operand.
+    // CHECK: sair.copy
+    // CHECK-SAME: loop_nest = [
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d1>, name = "A"},
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d0>, name = "B"}
+    %7 = sair.copy[d0:%1, d1:%0] %5(d1, d0) {
+      instances = [{loop_nest = [
+        {name = "E", iter = #sair.mapping_expr<d1>},
+        {name = "F", iter = #sair.mapping_expr<d0>}
+      ]}]
+    } : !sair.value<d0:static_range<16> x d1:static_range<8>, f32>
+    // Loops iterating in a different order are not fused.
+    // CHECK: sair.copy
+    // CHECK-SAME: loop_nest = [
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d1>, name = "G"},
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d0>, name = "H"}
+    %8 = sair.copy[d0:%0, d1:%1] %5(d0, d1) {
+      instances = [{loop_nest = [
+        {name = "G", iter = #sair.mapping_expr<d1>},
+        {name = "H", iter = #sair.mapping_expr<d0>}
+      ]}]
+    } : !sair.value<d0:static_range<8> x d1:static_range<16>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// Only the outermost loop is fused when inner loops iterate along different
+// dimensions.
+// CHECK-LABEL: @partial_fusion
+func.func @partial_fusion(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // CHECK: sair.copy
+    %2 = sair.copy[d0:%0] %1 {
+      instances = [{loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]}]
+    } : !sair.value<d0:static_range<8>, f32>
+    // CHECK: sair.copy
+    // CHECK-SAME: loop_nest = [
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d0>, name = "A"},
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d1>, name = "C"}
+    %3 = sair.copy[d0:%0, d1:%0] %2(d0) {
+      instances = [{loop_nest = [
+        {name = "B", iter = #sair.mapping_expr<d0>},
+        {name = "C", iter = #sair.mapping_expr<d1>}
+      ]}]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// Loops are not fused when an operation sequenced between the producer and the
+// consumer is not nested in the fused loops.
+// CHECK-LABEL: @interleaved_operation
+func.func @interleaved_operation(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.copy[d0:%0] %1 {
+      instances = [{sequence = 0,
+                    loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]}]
+    } : !sair.value<d0:static_range<8>, f32>
+    %3 = sair.copy[d0:%0] %1 {
+      instances = [{sequence = 1,
+                    loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>}]}]
+    } : !sair.value<d0:static_range<8>, f32>
+    // CHECK: sair.copy
+    // CHECK: sair.copy
+    // CHECK: sair.copy
+    // CHECK-SAME: loop_nest = [{iter = #sair.mapping_expr<d0>, name = "C"}]
+    %4 = sair.copy[d0:%0] %2(d0) {
+      instances = [{sequence = 2,
+                    loop_nest = [{name = "C", iter = #sair.mapping_expr<d0>}]}]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
@@ -0,0 +1,96 @@
+// RUN: sair-opt %s -sair-hoist-loop-invariants | FileCheck %s
+
+// CHECK-LABEL: @scale_factor
+func.func @scale_factor(%arg0: f32, %arg1: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.static_range : !sair.static_range<16>
+    // CHECK: %[[ALPHA:.*]] = sair.from_scalar
+    %2 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %3 = sair.from_scalar %arg1 : !sair.value<(), f32>
+    // CHECK: %[[SCALE:.*]] = sair.copy
+    %4 = sair.copy[d0:%0] %3 : !sair.value<d0:static_range<8>, f32>
+    // CHECK: %[[INPUT:.*]] = sair.copy
+    %5 = sair.copy[d0:%0, d1:%1] %3
+      : !sair.value<d0:static_range<8> x d1:static_range<16>, f32>
+
+    // CHECK: %[[TWICE:.*]] = sair.map %[[ALPHA]] {
+    // CHECK: ^{{.*}}(%[[A0:.*]]: f32):
+    // CHECK:   %[[C2:.*]] = arith.constant 2.000000e+00 : f32
+    // CHECK:   %[[V0:.*]] = arith.mulf %[[A0]], %[[C2]] : f32
+    // CHECK:   sair.return %[[V0]] : f32
+    // CHECK: } : #sair.shape<()>, (f32) -> f32
+
+    // CHECK: %[[FACTOR:.*]] = sair.map[d0:%{{.*}}] %[[SCALE]](d0), %[[TWICE]] {
+    // CHECK: ^{{.*}}(%{{.*}}: index, %[[A1:.*]]: f32, %[[A2:.*]]: f32):
+    // CHECK:   %[[V1:.*]] = arith.mulf %[[A1]], %[[A2]] : f32
+    // CHECK:   %[[V2:.*]] = arith.negf %[[V1]] : f32
+    // CHECK:   sair.return %[[V2]] : f32
+    // CHECK: } : #sair.shape<d0:static_range<8>>, (f32, f32) -> f32
+
+    // CHECK: sair.map[d0:%{{.*}}, d1:%{{.*}}] %[[INPUT]](d0, d1), %[[FACTOR]](d0) {
+    // CHECK: ^{{.*}}(%{{.*}}: index, %{{.*}}: index, %[[X:.*]]: f32, %[[F:.*]]: f32):
+    // CHECK-NOT: arith.negf
+    // CHECK:   %[[V3:.*]] = arith.mulf %[[F]], %[[X]] : f32
+    // CHECK:   sair.return %[[V3]] : f32
+    // CHECK: } : #sair.shape<d0:static_range<8> x d1:static_range<16>>
+    %6 = sair.map[d0:%0, d1:%1] %2, %4(d0), %5(d0, d1) {
+      ^bb0(%arg2: index, %arg3: index, %arg4: f32, %arg5: f32, %arg6: f32):
+        %c2 = arith.constant 2.0 : f32
+        %7 = arith.mulf %arg4, %c2 : f32
+        %8 = arith.mulf %arg5, %7 : f32
+        %9 = arith.negf %8 : f32
+        %10 = arith.mulf %9, %arg6 : f32
+        sair.return %10 : f32
+    } : #sair.shape<d0:static_range<8> x d1:static_range<16>>,
+        (f32, f32, f32) -> f32
+    sair.exit
+  }
+  func.return
+}
+
+// CHECK-LABEL: @dependent_dimension
+func.func @dependent_dimension(%arg0: index) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<4>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), index>
+    %2 = sair.copy[d0:%0] %1 : !sair.value<d0:static_range<4>, index>
+    %3 = sair.dyn_range[d0:%0] %2(d0) : !sair.dyn_range<d0:static_range<4>>
+    %4 = sair.static_range : !sair.static_range<8>
+    // The computation depends on d1, which depends on d0.
+    // CHECK: %[[V0:.*]] = sair.map[d0:%{{.*}}, d1:%{{.*}}] {
+    // CHECK: ^{{.*}}(%{{.*}}: index, %[[I:.*]]: index):
+    // CHECK:   arith.muli %[[I]], %[[I]] : index
+    // CHECK: } : #sair.shape<d0:static_range<4> x d1:dyn_range(d0)>, () -> index
+    // CHECK: sair.map[d0:%{{.*}}, d1:%{{.*}}, d2:%{{.*}}] %[[V0]](d0, d1)
+    %5 = sair.map[d0:%0, d1:%3, d2:%4] {
+      ^bb0(%arg1: index, %arg2: index, %arg3: index):
+        %6 = arith.muli %arg2, %arg2 : index
+        %7 = arith.addi %6, %arg3 : index
+        sair.return %7 : index
+    } : #sair.shape<d0:static_range<4> x d1:dyn_range(d0) x d2:static_range<8>>,
+        () -> index
+    sair.exit
+  }
+  func.return
+}
+
+func.func private @side_effect(%arg0: index)
+
+// CHECK-LABEL: @not_hoisted
+func.func @not_hoisted() {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<4>
+    %1 = sair.static_range : !sair.static_range<8>
+    // CHECK: sair.map
+    // CHECK:   func.call @side_effect
+    // CHECK-NOT: sair.map
+    sair.map[d0:%0, d1:%1] {
+      ^bb0(%arg0: index, %arg1: index):
+        func.call @side_effect(%arg0) : (index) -> ()
+        sair.return
+    } : #sair.shape<d0:static_range<4> x d1:static_range<8>>, () -> ()
+    sair.exit
+  }
+  func.return
+}
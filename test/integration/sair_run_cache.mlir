@@ -0,0 +1,38 @@
+// RUN: rm -rf %t
+// RUN: sair-run %s -entry=main -cache-dir=%t
+// RUN: ls %t | FileCheck %s
+// RUN: sair-run %s -entry=main -cache-dir=%t
+// RUN: ls %t | FileCheck %s
+
+// The object code is stored once and reused by the second run.
+// CHECK: {{^[0-9a-f]+}}.o
+// CHECK-NOT: .o
+func.func @scale(%arg0: memref<64x64xf32>, %arg1: memref<64x64xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<64>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<64x64xf32>>
+    %2 = sair.from_scalar %arg1 : !sair.value<(), memref<64x64xf32>>
+    %3 = sair.from_memref %1 memref[d0:%0, d1:%0] {
+      buffer_name = "A"
+    } : #sair.shape<d0:static_range<64> x d1:static_range<64>>, memref<64x64xf32>
+    %4 = sair.map[d0:%0, d1:%0] %3(d0, d1) {
+      ^bb0(%arg2: index, %arg3: index, %arg4: f32):
+        %5 = arith.addf %arg4, %arg4 : f32
+        sair.return %5 : f32
+    } : #sair.shape<d0:static_range<64> x d1:static_range<64>>, (f32) -> f32
+    sair.to_memref %2 memref[d0:%0, d1:%0] %4(d0, d1) {
+      buffer_name = "B"
+    } : #sair.shape<d0:static_range<64> x d1:static_range<64>>, memref<64x64xf32>
+    sair.exit
+  }
+  func.return
+}
+
+func.func @main() {
+  %0 = memref.alloc() : memref<64x64xf32>
+  %1 = memref.alloc() : memref<64x64xf32>
+  func.call @scale(%0, %1) : (memref<64x64xf32>, memref<64x64xf32>) -> ()
+  memref.dealloc %1 : memref<64x64xf32>
+  memref.dealloc %0 : memref<64x64xf32>
+  func.return
+}
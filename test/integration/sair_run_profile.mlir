@@ -0,0 +1,12 @@
+// RUN: sair-run %s -entry=main -repetitions=2 -print-loop-profiles \
+// RUN:   | FileCheck %s
+
+// Loop profiles are printed after the kernel is destroyed and its code
+// unloaded, so counters must not live in the kernel.
+// CHECK: main:A: 2 executions, 8 iterations
+func.func @main() {
+  %c4 = arith.constant 4 : index
+  %0 = sair.loop_profile_begin
+  sair.loop_profile_end "A" %0, %c4
+  func.return
+}
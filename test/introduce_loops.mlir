@@ -378,3 +378,366 @@ func.func @nested_unroll() {
   func.return
 }
 
+// CHECK-LABEL: @fby_unroll
+func.func @fby_unroll(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<5>
+    %1 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %2 = sair.fby %1 then[d0:%0] %3(d0) { instances = [{}] } : !sair.value<d0:static_range<5>, f32>
+    // CHECK: sair.map
+    // CHECK: %[[LOOP:.*]] = scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[ARG:.*]] = %{{.*}}) -> (f32) {
+    // CHECK:   %[[V0:.*]] = func.call @bar(%[[ARG]])
+    // CHECK:   %[[V1:.*]] = func.call @bar(%[[V0]])
+    // CHECK:   scf.yield %[[V1]] : f32
+    // CHECK: }
+    // Epilogue loop is simplified and uses the value carried by the main loop.
+    // CHECK-NOT: scf.for
+    // CHECK: func.call @bar(%[[LOOP]])
+    %3 = sair.map[d0: %0] %2(d0) attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, unroll = 2}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } {
+      ^bb0(%arg1: index, %5: f32):
+        %6 = func.call @bar(%5) : (f32) -> f32
+        sair.return %6 : f32
+    } : #sair.shape<d0:static_range<5>>, (f32) -> (f32)
+    %4 = sair.proj_last of[d0:%0] %3(d0) { instances = [{}] } : #sair.shape<d0:static_range<5>>, f32
+    sair.exit %4 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
+
+// CHECK-LABEL: @fby_accumulators
+func.func @fby_accumulators(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<10>
+    %1 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %2 = sair.fby %1 then[d0:%0] %3(d0) { instances = [{}] } : !sair.value<d0:static_range<10>, f32>
+    // CHECK: sair.map
+    // CHECK: %[[ZERO:.*]] = arith.constant -0.000000e+00 : f32
+    // CHECK: %[[LOOP:.*]]:4 = scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}}
+    // CHECK-SAME: iter_args(%[[A0:.*]] = %{{.*}}, %[[A1:.*]] = %[[ZERO]], %[[A2:.*]] = %[[ZERO]], %[[A3:.*]] = %[[ZERO]]) -> (f32, f32, f32, f32) {
+    // CHECK:   %[[V0:.*]] = arith.addf %[[A0]], %{{.*}} fastmath<reassoc>
+    // CHECK:   %[[V1:.*]] = arith.addf %[[A1]], %{{.*}} fastmath<reassoc>
+    // CHECK:   %[[V2:.*]] = arith.addf %[[A2]], %{{.*}} fastmath<reassoc>
+    // CHECK:   %[[V3:.*]] = arith.addf %[[A3]], %{{.*}} fastmath<reassoc>
+    // CHECK:   scf.yield %[[V0]], %[[V1]], %[[V2]], %[[V3]] : f32, f32, f32, f32
+    // CHECK: }
+    // CHECK: %[[C1:.*]] = arith.addf %[[LOOP]]#0, %[[LOOP]]#1
+    // CHECK: %[[C2:.*]] = arith.addf %[[C1]], %[[LOOP]]#2
+    // CHECK: %[[C3:.*]] = arith.addf %[[C2]], %[[LOOP]]#3
+    // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[R:.*]] = %[[C3]]) -> (f32) {
+    // CHECK:   arith.addf %[[R]], %{{.*}} fastmath<reassoc>
+    %3 = sair.map[d0: %0] %2(d0) attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, accumulators = 4}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } {
+      ^bb0(%arg1: index, %5: f32):
+        %c = arith.constant 1.0 : f32
+        %6 = arith.addf %5, %c fastmath<reassoc> : f32
+        sair.return %6 : f32
+    } : #sair.shape<d0:static_range<10>>, (f32) -> (f32)
+    %4 = sair.proj_last of[d0:%0] %3(d0) { instances = [{}] } : #sair.shape<d0:static_range<10>>, f32
+    sair.exit %4 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
+
+// CHECK-LABEL: @vector
+func.func @vector(%arg0: memref<8xf32>) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), memref<8xf32>>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // CHECK: sair.map
+    // CHECK-SAME: expansion = "map"
+    // CHECK-NOT: scf.for
+    sair.map[d0:%1] %0 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        expansion = "vector"
+      }]
+    } {
+      ^bb0(%arg1: index, %arg2: memref<8xf32>):
+        // CHECK: %[[C0:.*]] = arith.constant 0 : index
+        // CHECK: %[[V0:.*]] = vector.load %{{.*}}[%[[C0]]] : memref<8xf32>, vector<8xf32>
+        %2 = memref.load %arg2[%arg1] : memref<8xf32>
+        // CHECK: %[[V1:.*]] = arith.addf %[[V0]], %[[V0]] : vector<8xf32>
+        %3 = arith.addf %2, %2 : f32
+        // CHECK: vector.store %[[V1]], %{{.*}}[%[[C0]]] : memref<8xf32>, vector<8xf32>
+        memref.store %3, %arg2[%arg1] : memref<8xf32>
+        sair.return
+    } : #sair.shape<d0:static_range<8>>, (memref<8xf32>) -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @vector_noalias
+func.func @vector_noalias(%arg0: memref<8xf32> {llvm.noalias},
+                          %arg1: memref<8xf32> {llvm.noalias}) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), memref<8xf32>>
+    %1 = sair.from_scalar %arg1 { instances = [{}] } : !sair.value<(), memref<8xf32>>
+    %2 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // Memrefs that do not alias can be accessed at different indices.
+    // CHECK: vector.load
+    // CHECK: vector.store
+    sair.map[d0:%2] %0, %1 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        expansion = "vector"
+      }]
+    } {
+      ^bb0(%arg2: index, %arg3: memref<8xf32>, %arg4: memref<8xf32>):
+        %3 = memref.load %arg3[%arg2] : memref<8xf32>
+        memref.store %3, %arg4[%arg2] : memref<8xf32>
+        sair.return
+    } : #sair.shape<d0:static_range<8>>, (memref<8xf32>, memref<8xf32>) -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @vector_partial_tile
+func.func @vector_partial_tile(%arg0: memref<10xf32>) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), memref<10xf32>>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<10, 4>
+    // CHECK: scf.for %[[I:.*]] = %{{.*}} to %{{.*}} step %{{.*}} {
+    %2, %3 = sair.map[d0:%1] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [
+          {space = "register", layout = #sair.named_mapping<[] -> ()>},
+          {space = "register", layout = #sair.named_mapping<[] -> ()>}
+        ]
+      }]
+    } {
+      ^bb0(%arg1: index):
+        %c4 = arith.constant 4 : index
+        %c10 = arith.constant 10 : index
+        %4 = arith.addi %arg1, %c4 : index
+        %5 = arith.cmpi ult, %c10, %4 : index
+        // CHECK: %[[END:.*]] = arith.select
+        %6 = arith.select %5, %c10, %4 : index
+        sair.return %arg1, %6 : index, index
+    } : #sair.shape<d0:static_range<10, 4>>, () -> (index, index)
+    %7 = sair.dyn_range[d0:%1] %2(d0), %3(d0) { instances = [{}] } : !sair.dyn_range<d0:static_range<10, 4>>
+    // CHECK: %[[N:.*]] = arith.subi %[[END]], %[[I]] : index
+    // CHECK: %[[MASK:.*]] = vector.create_mask %[[N]] : vector<4xi1>
+    // CHECK: %[[V0:.*]] = vector.maskedload %{{.*}}[%[[I]]], %[[MASK]], %{{.*}}
+    // CHECK: %[[V1:.*]] = arith.mulf %[[V0]], %[[V0]] : vector<4xf32>
+    // CHECK: vector.maskedstore %{{.*}}[%[[I]]], %[[MASK]], %[[V1]]
+    // CHECK-NOT: scf.for
+    sair.map[d0:%1, d1:%7] %0 attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        expansion = "vector"
+      }]
+    } {
+      ^bb0(%arg1: index, %arg2: index, %arg3: memref<10xf32>):
+        %8 = memref.load %arg3[%arg2] : memref<10xf32>
+        %9 = arith.mulf %8, %8 : f32
+        memref.store %9, %arg3[%arg2] : memref<10xf32>
+        sair.return
+    } : #sair.shape<d0:static_range<10, 4> x d1:dyn_range(d0)>, (memref<10xf32>) -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @vector_partial_tile_division
+func.func @vector_partial_tile_division(%arg0: memref<10xi32>) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), memref<10xi32>>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<10, 4>
+    // CHECK: scf.for %[[I:.*]] = %{{.*}} to %{{.*}} step %{{.*}} {
+    %2, %3 = sair.map[d0:%1] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [
+          {space = "register", layout = #sair.named_mapping<[] -> ()>},
+          {space = "register", layout = #sair.named_mapping<[] -> ()>}
+        ]
+      }]
+    } {
+      ^bb0(%arg1: index):
+        %c4 = arith.constant 4 : index
+        %c10 = arith.constant 10 : index
+        %4 = arith.addi %arg1, %c4 : index
+        %5 = arith.cmpi ult, %c10, %4 : index
+        // CHECK: %[[END:.*]] = arith.select
+        %6 = arith.select %5, %c10, %4 : index
+        sair.return %arg1, %6 : index, index
+    } : #sair.shape<d0:static_range<10, 4>>, () -> (index, index)
+    %7 = sair.dyn_range[d0:%1] %2(d0), %3(d0) { instances = [{}] } : !sair.dyn_range<d0:static_range<10, 4>>
+    // CHECK: %[[N:.*]] = arith.subi %[[END]], %[[I]] : index
+    // CHECK: %[[MASK:.*]] = vector.create_mask %[[N]] : vector<4xi1>
+    // CHECK: %[[V0:.*]] = vector.maskedload %{{.*}}[%[[I]]], %[[MASK]], %{{.*}}
+    // Inactive lanes are divided by one.
+    // CHECK: %[[ONES:.*]] = arith.constant dense<1> : vector<4xi32>
+    // CHECK: %[[DIVISOR:.*]] = arith.select %[[MASK]], %[[V0]], %[[ONES]]
+    // CHECK: %[[V1:.*]] = arith.divsi %[[V0]], %[[DIVISOR]] : vector<4xi32>
+    // CHECK: vector.maskedstore %{{.*}}[%[[I]]], %[[MASK]], %[[V1]]
+    // CHECK-NOT: scf.for
+    sair.map[d0:%1, d1:%7] %0 attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        expansion = "vector"
+      }]
+    } {
+      ^bb0(%arg1: index, %arg2: index, %arg3: memref<10xi32>):
+        %8 = memref.load %arg3[%arg2] : memref<10xi32>
+        %9 = arith.divsi %8, %8 : i32
+        memref.store %9, %arg3[%arg2] : memref<10xi32>
+        sair.return
+    } : #sair.shape<d0:static_range<10, 4> x d1:dyn_range(d0)>, (memref<10xi32>) -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @peel
+func.func @peel() {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<10, 4>
+    // Full tiles are executed by a first loop, where the end of tiles is not
+    // clamped and the inner loop has a version with a static trip count.
+    // CHECK: %[[SPLIT:.*]] = arith.addi
+    // CHECK: scf.for %[[I:.*]] = %{{.*}} to %[[SPLIT]] step %{{.*}} {
+    // CHECK-NOT: arith.select
+    // CHECK:   %[[END:.*]] = arith.addi %[[I]], %{{.*}} : index
+    // CHECK:   %[[DIST:.*]] = arith.subi %[[END]], %[[I]] : index
+    // CHECK:   scf.if
+    // CHECK:     scf.for
+    // CHECK:       func.call @foo
+    // CHECK:   } else {
+    // CHECK:     scf.for %{{.*}} = %[[I]] to %[[END]] step %{{.*}} {
+    // CHECK:       func.call @foo
+    // The last partial tile is executed by a second loop.
+    // CHECK: scf.for %[[I2:.*]] = %[[SPLIT]] to %{{.*}} step %{{.*}} {
+    // CHECK:   %[[END2:.*]] = arith.select
+    // CHECK:   scf.for %{{.*}} = %[[I2]] to %[[END2]] step %{{.*}} {
+    // CHECK:     func.call @foo
+    %1, %2 = sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, peel}],
+        storage = [
+          {space = "register", layout = #sair.named_mapping<[] -> ()>},
+          {space = "register", layout = #sair.named_mapping<[] -> ()>}
+        ]
+      }]
+    } {
+      ^bb0(%arg0: index):
+        %c4 = arith.constant 4 : index
+        %c10 = arith.constant 10 : index
+        %3 = arith.addi %arg0, %c4 : index
+        %4 = arith.cmpi ult, %c10, %3 : index
+        %5 = arith.select %4, %c10, %3 : index
+        sair.return %arg0, %5 : index, index
+    } : #sair.shape<d0:static_range<10, 4>>, () -> (index, index)
+    %6 = sair.dyn_range[d0:%0] %1(d0), %2(d0) { instances = [{}] }
+      : !sair.dyn_range<d0:static_range<10, 4>>
+    sair.map[d0:%0, d1:%6] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, peel},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ]
+      }]
+    } {
+      ^bb0(%arg0: index, %arg1: index):
+        func.call @foo(%arg1, %arg1) : (index, index) -> ()
+        sair.return
+    } : #sair.shape<d0:static_range<10, 4> x d1:dyn_range(d0)>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @parallel
+func.func @parallel() {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // CHECK: sair.map
+    // CHECK-NOT: scf.for
+    // CHECK: scf.parallel (%[[I:.*]]) = (%{{.*}}) to (%{{.*}}) step (%{{.*}}) {
+    // CHECK:   func.call @foo(%[[I]], %[[I]])
+    // CHECK: }
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, parallel}]
+      }]
+    } {
+      ^bb0(%arg0: index):
+        func.call @foo(%arg0, %arg0) : (index, index) -> ()
+        sair.return
+    } : #sair.shape<d0:static_range<8>>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @gpu
+func.func @gpu() {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<32>
+    // CHECK: scf.parallel (%[[I:.*]]) = (%{{.*}}) to (%{{.*}}) step (%{{.*}}) {
+    // CHECK:   scf.parallel (%[[J:.*]]) = (%{{.*}}) to (%{{.*}}) step (%{{.*}}) {
+    // CHECK:     func.call @foo(%[[I]], %[[J]])
+    // CHECK:   } {mapping = [#gpu.loop_dim_map<processor = thread_x, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+    // CHECK: } {mapping = [#gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+    sair.map[d0:%0, d1:%1] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, gpu = "block_x"},
+          {name = "B", iter = #sair.mapping_expr<d1>, gpu = "thread_x"}
+        ]
+      }]
+    } {
+      ^bb0(%arg0: index, %arg1: index):
+        func.call @foo(%arg0, %arg1) : (index, index) -> ()
+        sair.return
+    } : #sair.shape<d0:static_range<8> x d1:static_range<32>>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+func.func private @use_memref(%arg0: memref<4xf32>)
+
+// CHECK-LABEL: @stack_allocation
+func.func @stack_allocation() {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // CHECK: scf.for
+    // CHECK:   memref.alloca_scope {
+    // CHECK:     %[[V0:.*]] = memref.alloca() : memref<4xf32>
+    // CHECK:     func.call @use_memref(%[[V0]])
+    // CHECK:   }
+    // CHECK: }
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+      }]
+    } {
+      ^bb0(%arg0: index):
+        %1 = memref.alloca() : memref<4xf32>
+        func.call @use_memref(%1) : (memref<4xf32>) -> ()
+        sair.return
+    } : #sair.shape<d0:static_range<8>>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
@@ -186,3 +186,124 @@ func.func @copies(%arg0: f32) {
   }
   func.return
 }
+
+// -----
+
+func.func private @foo(f32)
+
+func.func @vector_call(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    // expected-error @+1 {{expansion pattern does not apply to the operation}}
+    sair.map[d0:%0] %1 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        expansion = "vector"
+      }]
+    } {
+      ^bb0(%arg1: index, %arg2: f32):
+        func.call @foo(%arg2) : (f32) -> ()
+        sair.return
+    } : #sair.shape<d0:static_range<8>>, (f32) -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// -----
+
+func.func @vector_dependency(%arg0: memref<9xf32>) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), memref<9xf32>>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    sair.map[d0:%1] %0 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        expansion = "vector"
+      }]
+    } {
+      ^bb0(%arg1: index, %arg2: memref<9xf32>):
+        %2 = affine.apply affine_map<(d0) -> (d0 + 1)>(%arg1)
+        %3 = memref.load %arg2[%2] : memref<9xf32>
+        // expected-error @+1 {{unable to vectorize a loop with memory dependencies between iterations}}
+        memref.store %3, %arg2[%arg1] : memref<9xf32>
+        sair.return
+    } : #sair.shape<d0:static_range<8>>, (memref<9xf32>) -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// -----
+
+func.func @vector_may_alias(%arg0: memref<8xf32>, %arg1: memref<8xf32>) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), memref<8xf32>>
+    %1 = sair.from_scalar %arg1 { instances = [{}] } : !sair.value<(), memref<8xf32>>
+    %2 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    sair.map[d0:%2] %0, %1 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        expansion = "vector"
+      }]
+    } {
+      ^bb0(%arg2: index, %arg3: memref<8xf32>, %arg4: memref<8xf32>):
+        %3 = memref.load %arg3[%arg2] : memref<8xf32>
+        // expected-error @+1 {{unable to vectorize a loop with memory dependencies between iterations}}
+        memref.store %3, %arg4[%arg2] : memref<8xf32>
+        sair.return
+    } : #sair.shape<d0:static_range<8>>, (memref<8xf32>, memref<8xf32>) -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// -----
+
+func.func @vector_fby(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %2 = sair.fby %1 then[d0:%0] %3(d0) { instances = [{}] } : !sair.value<d0:static_range<8>, f32>
+    // expected-error @+1 {{vector loops cannot carry values between iterations}}
+    %3 = sair.map[d0:%0] %2(d0) attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}],
+        expansion = "vector"
+      }]
+    } {
+      ^bb0(%arg1: index, %arg2: f32):
+        %4 = arith.addf %arg2, %arg2 : f32
+        sair.return %4 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
+    %5 = sair.proj_last of[d0:%0] %3(d0) { instances = [{}] } : #sair.shape<d0:static_range<8>>, f32
+    sair.exit %5 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
+
+// -----
+
+func.func @accumulators_without_reassoc(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %2 = sair.fby %1 then[d0:%0] %3(d0) { instances = [{}] } : !sair.value<d0:static_range<8>, f32>
+    // expected-error @+1 {{loop A does not carry a reduction that can be interleaved; floating-point reductions require the 'reassoc' flag}}
+    %3 = sair.map[d0:%0] %2(d0) attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, accumulators = 2}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } {
+      ^bb0(%arg1: index, %arg2: f32):
+        %4 = arith.addf %arg2, %arg2 : f32
+        sair.return %4 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
+    %5 = sair.proj_last of[d0:%0] %3(d0) { instances = [{}] } : #sair.shape<d0:static_range<8>>, f32
+    sair.exit %5 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
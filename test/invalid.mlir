@@ -1309,7 +1309,7 @@ func.func @index_variable_in_memory(%arg0: index) {
 func.func @buffer_must_have_name_if_in_memory(%arg0: f32) {
   sair.program {
     %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
-    // expected-error @+1 {{buffers must have a name if and only if they are stored in memory}}
+    // expected-error @+1 {{buffers stored in memory must have a name}}
     %2 = sair.copy %0 {
       instances = [{
         loop_nest = [],
@@ -1347,6 +1347,123 @@ func.func @storage_1D_buffer_register(%arg0: f32) {
 
 // -----
 
+func.func @register_buffer_dynamic_size(%arg0: f32, %arg1: index) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %1 = sair.from_scalar %arg1 : !sair.value<(), index>
+    %2 = sair.dyn_range %1 : !sair.dyn_range
+    // expected-error @+1 {{in buffer "A": must have a static size to be stored in registers}}
+    %3 = sair.copy[d0:%2] %0 {
+      instances = [{
+        loop_nest = [{name = "loopA", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          space = "register", name = "A",
+          layout = #sair.named_mapping<[d0:"loopA"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:dyn_range, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @register_buffer_not_unrolled(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %1 = sair.static_range : !sair.static_range<8>
+    // expected-error @+1 {{in buffer "A": loop "loopA" must be fully unrolled to index a buffer in registers}}
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "loopA", iter = #sair.mapping_expr<d0>, unroll = 4}],
+        storage = [{
+          space = "register", name = "A",
+          layout = #sair.named_mapping<[d0:"loopA"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @prefetch_register(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error @+1 {{prefetching is only supported for buffers in memory}}
+    %1 = sair.copy %0 {
+      instances = [{
+        loop_nest = [],
+        storage = [{
+          space = "register",
+          layout = #sair.named_mapping<[] -> ()>,
+          prefetch = {loop = "A", distance = 1}
+        }]
+      }]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @nontemporal_register(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error @+1 {{non-temporal stores are only supported for buffers in memory}}
+    %1 = sair.copy %0 {
+      instances = [{
+        loop_nest = [],
+        storage = [{
+          space = "register",
+          layout = #sair.named_mapping<[] -> ()>,
+          nontemporal
+        }]
+      }]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @from_memref_alignment(%arg0: memref<8xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<8xf32>>
+    // expected-error @+1 {{alignment must be a power of two}}
+    %2 = sair.from_memref %1 memref[d0:%0] {
+      buffer_name = "A",
+      alignment = 12
+    } : #sair.shape<d0:static_range<8>>, memref<8xf32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @prefetch_negative_distance(%arg0: memref<8xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<8xf32>>
+    // expected-error @+1 {{prefetch distance must be positive}}
+    %2 = sair.from_memref %1 memref[d0:%0] {
+      buffer_name = "A",
+      prefetch = {loop = "B", distance = 0}
+    } : #sair.shape<d0:static_range<8>>, memref<8xf32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
 func.func @storage_unknown_loop_name(%arg0: f32) {
   sair.program {
     %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
@@ -2549,13 +2666,32 @@ func.func @mismatching_unroll_missing() {
 
 // -----
 
-func.func @invalid_expansion_pattern_name(%arg0: f32) {
+func.func @mismatching_parallel() {
   sair.program {
-    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
-    // expected-error @+1 {{invalid expansion pattern name "invalid_name"}}
-    %1 = sair.copy %0 {
-      instances = [{expansion = "invalid_name"}]
-    } : !sair.value<(), f32>
+    %0 = sair.static_range : !sair.static_range<3>
+    // expected-note@below {{previous occurrence here}}
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, parallel}
+        ]
+      }]
+    } {
+    ^bb0(%arg0: index):
+      sair.return
+    } : #sair.shape<d0:static_range<3>>, () -> ()
+
+    // expected-error@below {{loop "A" must be marked as parallel in all operations or in none}}
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>}
+        ]
+      }]
+    } {
+    ^bb0(%arg0: index):
+      sair.return
+    } : #sair.shape<d0:static_range<3>>, () -> ()
     sair.exit
   }
   func.return
@@ -2563,13 +2699,20 @@ func.func @invalid_expansion_pattern_name(%arg0: f32) {
 
 // -----
 
-func.func @invalid_expansion_pattern(%arg0: f32) {
+func.func @parallel_fby(%arg0: f32) {
   sair.program {
-    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
-    // expected-error @+1 {{expansion pattern does not apply to the operation}}
-    %1 = sair.copy %0 {
-      instances = [{expansion = "alloc"}]
-    } : !sair.value<(), f32>
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error@below {{loop "A" cannot be parallel as it carries a value across iterations}}
+    %2 = sair.fby %1 then[d0:%0] %3(d0) : !sair.value<d0:static_range<8>, f32>
+    %3 = sair.map[d0:%0] %2(d0) attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, parallel}]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return %arg2 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
     sair.exit
   }
   func.return
@@ -2577,40 +2720,59 @@ func.func @invalid_expansion_pattern(%arg0: f32) {
 
 // -----
 
-func.func @copies_arity(%arg0: f32) {
+func.func @parallel_proj_last(%arg0: f32) {
   sair.program {
-    // expected-error @+1 {{the `copies` attribute must have one entry per operation result}}
-    %0 = sair.from_scalar %arg0 {
-      copies = []
-    } : !sair.value<(), f32>
-    sair.exit
-  }
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.map[d0:%0] %1 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, parallel}]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return %arg2 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
+    // expected-error@below {{loop "A" cannot be parallel as it carries a value across iterations}}
+    %3 = sair.proj_last of[d0:%0] %2(d0) : #sair.shape<d0:static_range<8>>, f32
+    sair.exit %3 : f32
+  } : f32
   func.return
 }
 
 // -----
 
-func.func @copies_invalid_loop_nest(%arg0: f32) {
+func.func @parallel_map_reduce(%arg0: f32) {
   sair.program {
-    // expected-error @+1 {{dimension 'd0' is out of range of the domain}}
-    %0 = sair.from_scalar %arg0 {
-      copies = [[{
-        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
-      }]]
-    } : !sair.value<(), f32>
-    sair.exit
-  }
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error@below {{loop "A" cannot be parallel as it iterates along a reduction; use split_factor to split the reduction into parallel partial reductions}}
+    %2 = sair.map_reduce %1 reduce[d0:%0] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, parallel}]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return %arg2 : f32
+    } : #sair.shape<d0:static_range<8>>, () -> f32
+    sair.exit %2 : f32
+  } : f32
   func.return
 }
 
 // -----
 
-func.func @copies_invalid_expansion(%arg0: f32) {
+func.func @invalid_gpu_processor() {
   sair.program {
-    // expected-error @+1 {{in copy 0 of result 0: expansion pattern does not apply to the operation}}
-    %0 = sair.from_scalar %arg0 {
-      copies = [[{expansion = "map"}]]
-    } : !sair.value<(), f32>
+    %0 = sair.static_range : !sair.static_range<8>
+    // expected-error@below {{invalid GPU processor "warp_x"}}
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, gpu = "warp_x"}]
+      }]
+    } {
+    ^bb0(%arg0: index):
+      sair.return
+    } : #sair.shape<d0:static_range<8>>, () -> ()
     sair.exit
   }
   func.return
@@ -2618,13 +2780,21 @@ func.func @copies_invalid_expansion(%arg0: f32) {
 
 // -----
 
-func.func @non_existent_self_instance(%arg0: f32) {
+func.func @gpu_processor_used_twice() {
   sair.program {
-    // expected-error @below {{'copy_of' refers to non-existent instance}}
-    %0 = sair.from_scalar %arg0 {
-      instances = [{},{}],
-      copies = [[{copy_of = #sair.instance<2>}]]
-    } : !sair.value<(), f32>
+    %0 = sair.static_range : !sair.static_range<8>
+    // expected-error@below {{GPU processor "block_x" used twice in a loop nest}}
+    sair.map[d0:%0, d1:%0] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, gpu = "block_x"},
+          {name = "B", iter = #sair.mapping_expr<d1>, gpu = "block_x"}
+        ]
+      }]
+    } {
+    ^bb0(%arg0: index, %arg1: index):
+      sair.return
+    } : #sair.shape<d0:static_range<8> x d1:static_range<8>>, () -> ()
     sair.exit
   }
   func.return
@@ -2632,12 +2802,22 @@ func.func @non_existent_self_instance(%arg0: f32) {
 
 // -----
 
-func.func @non_existent_self_copy(%arg0: f32) {
+func.func @gpu_loops_not_adjacent() {
   sair.program {
-    // expected-error @below {{'copy_of' refers to non-existent copy}}
-    %0 = sair.from_scalar %arg0 {
-      copies = [[{copy_of = #sair.copy<2>}]]
-    } : !sair.value<(), f32>
+    %0 = sair.static_range : !sair.static_range<8>
+    // expected-error@below {{loops mapped to GPU processors must be adjacent}}
+    sair.map[d0:%0, d1:%0, d2:%0] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, gpu = "block_x"},
+          {name = "B", iter = #sair.mapping_expr<d1>},
+          {name = "C", iter = #sair.mapping_expr<d2>, gpu = "thread_x"}
+        ]
+      }]
+    } {
+    ^bb0(%arg0: index, %arg1: index, %arg2: index):
+      sair.return
+    } : #sair.shape<d0:static_range<8> x d1:static_range<8> x d2:static_range<8>>, () -> ()
     sair.exit
   }
   func.return
@@ -2645,12 +2825,32 @@ func.func @non_existent_self_copy(%arg0: f32) {
 
 // -----
 
-func.func @copy_of_in_instance(%arg0: f32) {
+func.func @mismatching_gpu_processor() {
   sair.program {
-    // expected-error @below {{cannot specify 'copy_of' in 'instances'}}
-    %0 = sair.from_scalar %arg0 {
-      instances = [{copy_of = unit}]
-    } : !sair.value<(), f32>
+    %0 = sair.static_range : !sair.static_range<3>
+    // expected-note@below {{previous occurrence here}}
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, gpu = "block_x"}
+        ]
+      }]
+    } {
+    ^bb0(%arg0: index):
+      sair.return
+    } : #sair.shape<d0:static_range<3>>, () -> ()
+
+    // expected-error@below {{loop "A" must be mapped to the same GPU processor in all operations}}
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, gpu = "thread_x"}
+        ]
+      }]
+    } {
+    ^bb0(%arg0: index):
+      sair.return
+    } : #sair.shape<d0:static_range<3>>, () -> ()
     sair.exit
   }
   func.return
@@ -2658,13 +2858,20 @@ func.func @copy_of_in_instance(%arg0: f32) {
 
 // -----
 
-func.func @producer_cannot_have_copies(%arg0: f32) {
+func.func @gpu_fby(%arg0: f32) {
   sair.program {
-    %0 = sair.static_range : !sair.static_range<4>
-    // expected-error @below {{'operands' attribute expects as many entries as op has operands (1, got 0) in instance #0}}
-    %1 = sair.from_scalar %arg0 {
-      instances = [{operands = []}]
-    } : !sair.value<(), f32>
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error@below {{loop "A" cannot be parallel as it carries a value across iterations}}
+    %2 = sair.fby %1 then[d0:%0] %3(d0) : !sair.value<d0:static_range<8>, f32>
+    %3 = sair.map[d0:%0] %2(d0) attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, gpu = "thread_x"}]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return %arg2 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
     sair.exit
   }
   func.return
@@ -2672,16 +2879,19 @@ func.func @producer_cannot_have_copies(%arg0: f32) {
 
 // -----
 
-func.func @producer_cannot_have_copies(%arg0: f32) {
+func.func @shared_memory_without_name(%arg0: f32) {
   sair.program {
-    %0 = sair.static_range : !sair.static_range<4>
-    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
-    // expected-error @below {{operand #0 of instance #0 refers to a copy, but the producing op cannot have copies}}
-    sair.copy[d0:%0] %1 {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error@below {{buffers stored in memory must have a name}}
+    %1 = sair.copy %0 {
       instances = [{
-        operands = [#sair.copy<0>, unit]
+        loop_nest = [],
+        storage = [{
+          space = "shared",
+          layout = #sair.named_mapping<[] -> ()>
+        }]
       }]
-    } : !sair.value<d0:static_range<4>, f32>
+    } : !sair.value<(), f32>
     sair.exit
   }
   func.return
@@ -2689,12 +2899,262 @@ func.func @producer_cannot_have_copies(%arg0: f32) {
 
 // -----
 
-func.func @producer_cannot_have_copies(%arg0: f32) {
-  sair.program {
-    %0 = sair.static_range : !sair.static_range<4>
-    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
-    // expected-error @below {{cannot specify 'operands' in 'copies'}}
-    sair.copy[d0:%0] %1 {
+func.func @memory_budget_invalid_space(%arg0: f32) {
+  // expected-error @+1 {{invalid memory space "register" in budgets}}
+  sair.program attributes {memory_budgets = {register = 16}} {
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @memory_budget_exceeded(%arg0: f32) {
+  sair.program attributes {memory_budgets = {local = 16}} {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %1 = sair.static_range : !sair.static_range<8>
+    // expected-error @+1 {{in buffer "B": exceeds the memory budget of space "local" (32 bytes requested, 16 bytes available)}}
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          name = "B", space = "local",
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @invalid_expansion_pattern_name(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error @+1 {{invalid expansion pattern name "invalid_name"}}
+    %1 = sair.copy %0 {
+      instances = [{expansion = "invalid_name"}]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @invalid_expansion_pattern(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error @+1 {{expansion pattern does not apply to the operation}}
+    %1 = sair.copy %0 {
+      instances = [{expansion = "alloc"}]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func private @not_a_microkernel(memref<8xf32>, f32)
+
+func.func @libcall_not_a_microkernel(%arg0: memref<8xf32>, %arg1: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8, 4>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<8xf32>>
+    %2 = sair.from_scalar %arg1 : !sair.value<(), f32>
+    // expected-error @+1 {{expansion pattern does not apply to the operation}}
+    sair.map[d0:%0] %1, %2 attributes {
+      instances = [{expansion = "libcall"}]
+    } {
+    ^bb0(%arg2: index, %arg3: memref<8xf32>, %arg4: f32):
+      func.call @not_a_microkernel(%arg3, %arg4) : (memref<8xf32>, f32) -> ()
+      sair.return
+    } : #sair.shape<d0:static_range<8, 4>>, (memref<8xf32>, f32) -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @vector_dynamic_range(%arg0: f32, %arg1: index) {
+  sair.program {
+    %0 = sair.from_scalar %arg1 : !sair.value<(), index>
+    %1 = sair.dyn_range %0 : !sair.dyn_range
+    %2 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error @+1 {{expansion pattern does not apply to the operation}}
+    sair.map[d0:%1] %2 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        expansion = "vector"
+      }]
+    } {
+    ^bb0(%arg2: index, %arg3: f32):
+      %3 = arith.addf %arg3, %arg3 : f32
+      sair.return
+    } : #sair.shape<d0:dyn_range>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func private @foo(f32)
+
+func.func @vector_fused_with_call(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    sair.map[d0:%0] %1 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        expansion = "vector"
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      %2 = arith.addf %arg2, %arg2 : f32
+      sair.return
+    } : #sair.shape<d0:static_range<8>>, (f32) -> ()
+    // expected-error @+1 {{operation fused in vector loop A cannot be vectorized}}
+    sair.map[d0:%0] %1 attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        expansion = "map"
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      func.call @foo(%arg2) : (f32) -> ()
+      sair.return
+    } : #sair.shape<d0:static_range<8>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @copies_arity(%arg0: f32) {
+  sair.program {
+    // expected-error @+1 {{the `copies` attribute must have one entry per operation result}}
+    %0 = sair.from_scalar %arg0 {
+      copies = []
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @copies_invalid_loop_nest(%arg0: f32) {
+  sair.program {
+    // expected-error @+1 {{dimension 'd0' is out of range of the domain}}
+    %0 = sair.from_scalar %arg0 {
+      copies = [[{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+      }]]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @copies_invalid_expansion(%arg0: f32) {
+  sair.program {
+    // expected-error @+1 {{in copy 0 of result 0: expansion pattern does not apply to the operation}}
+    %0 = sair.from_scalar %arg0 {
+      copies = [[{expansion = "map"}]]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @non_existent_self_instance(%arg0: f32) {
+  sair.program {
+    // expected-error @below {{'copy_of' refers to non-existent instance}}
+    %0 = sair.from_scalar %arg0 {
+      instances = [{},{}],
+      copies = [[{copy_of = #sair.instance<2>}]]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @non_existent_self_copy(%arg0: f32) {
+  sair.program {
+    // expected-error @below {{'copy_of' refers to non-existent copy}}
+    %0 = sair.from_scalar %arg0 {
+      copies = [[{copy_of = #sair.copy<2>}]]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @copy_of_in_instance(%arg0: f32) {
+  sair.program {
+    // expected-error @below {{cannot specify 'copy_of' in 'instances'}}
+    %0 = sair.from_scalar %arg0 {
+      instances = [{copy_of = unit}]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @producer_cannot_have_copies(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<4>
+    // expected-error @below {{'operands' attribute expects as many entries as op has operands (1, got 0) in instance #0}}
+    %1 = sair.from_scalar %arg0 {
+      instances = [{operands = []}]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @producer_cannot_have_copies(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<4>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error @below {{operand #0 of instance #0 refers to a copy, but the producing op cannot have copies}}
+    sair.copy[d0:%0] %1 {
+      instances = [{
+        operands = [#sair.copy<0>, unit]
+      }]
+    } : !sair.value<d0:static_range<4>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @producer_cannot_have_copies(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<4>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error @below {{cannot specify 'operands' in 'copies'}}
+    sair.copy[d0:%0] %1 {
       instances = [{}],
       copies = [[{operands = []}]]
     } : !sair.value<d0:static_range<4>, f32>
@@ -2787,3 +3247,221 @@ func.func @malformed_instances(%arg0: f32) {
   }
   func.return
 }
+
+// -----
+
+func.func @padding_in_register(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error@below {{padding and alignment are only supported for buffers in memory}}
+    %1 = sair.copy %0 {
+      instances = [{
+        loop_nest = [],
+        storage = [{
+          space = "register", padding = [],
+          layout = #sair.named_mapping<[] -> ()>
+        }]
+      }]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @alignment_not_power_of_two(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %1 = sair.static_range : !sair.static_range<8>
+    // expected-error@below {{alignment must be a power of two}}
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          space = "memory", name = "A", alignment = 24,
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @padding_rank_mismatch(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %1 = sair.static_range : !sair.static_range<8>
+    // expected-error@below {{padding must have one entry per layout dimension}}
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          space = "memory", name = "A", padding = [1, 1],
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @mismatching_padding(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %1 = sair.static_range : !sair.static_range<8>
+    // expected-note@below {{previous occurence here}}
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          space = "memory", name = "buf", padding = [1],
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    // expected-error@below {{buffer "buf" has different padding or alignment than in previous occurence}}
+    %3 = sair.copy[d0:%1] %2(d0) {
+      instances = [{
+        loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          space = "memory", name = "buf", padding = [2],
+          layout = #sair.named_mapping<[d0:"B"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @parallel_accumulators() {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    // expected-error@below {{loop A cannot be parallel and interleave accumulators}}
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, parallel, accumulators = 2}
+        ]
+      }]
+    } {
+    ^bb0(%arg0: index):
+      sair.return
+    } : #sair.shape<d0:static_range<8>>, () -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @parallel_peel() {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8, 4>
+    // expected-error@below {{loop A cannot be parallel and peeled}}
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, parallel, peel}]
+      }]
+    } {
+    ^bb0(%arg0: index):
+      sair.return
+    } : #sair.shape<d0:static_range<8, 4>>, () -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @parallel_unroll() {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    // expected-error@below {{loop A cannot be parallel and unrolled}}
+    sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, parallel, unroll = 2}
+        ]
+      }]
+    } {
+    ^bb0(%arg0: index):
+      sair.return
+    } : #sair.shape<d0:static_range<8>>, () -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @parallel_write_race(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %1 = sair.static_range : !sair.static_range<8>
+    // expected-error @+1 {{iterations of parallel loop "A" write to the same elements of buffer "bufferA"}}
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, parallel}],
+        storage = [{
+          name = "bufferA", space = "memory",
+          layout = #sair.named_mapping<[] -> ()>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @double_buffer_register(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // expected-error @+1 {{double buffering is only supported for buffers in memory}}
+    %1 = sair.copy %0 {
+      instances = [{
+        loop_nest = [],
+        storage = [{
+          space = "register",
+          layout = #sair.named_mapping<[] -> ()>,
+          double_buffer = "A"
+        }]
+      }]
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @double_buffer_across_iterations(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %1 = sair.static_range : !sair.static_range<8>
+    // expected-error @+1 {{buffer "B" cannot be double-buffered along loop "A" as it holds values across its iterations}}
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          name = "B", space = "memory",
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>,
+          double_buffer = "A"
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
@@ -66,6 +66,8 @@ llvm_config.with_environment('PATH', config.llvm_tools_dir, append_path=True)
 tool_dirs = [config.sair_tools_dir, config.llvm_tools_dir]
 tools = [
     'sair-opt',
+    'sair-run',
+    'sair-tune',
 ]
 
 llvm_config.add_tool_substitutions(tools, tool_dirs)
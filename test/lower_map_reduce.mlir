@@ -95,3 +95,32 @@ func.func @map_reduce_multi_instance(%r1: index, %r2: index, %in1: f32) {
   }
   func.return
 }
+
+func.func private @accumulate_tile(f32, memref<8xf32>, index) -> f32
+  attributes {sair.microkernel = @accumulate_tile_impl}
+func.func private @accumulate_tile_impl(f32, memref<f32>, index, index, index)
+  -> f32
+
+// CHECK-LABEL: @map_reduce_libcall
+func.func @map_reduce_libcall(%arg0: f32, %arg1: memref<8xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8, 4>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.from_scalar %arg1 : !sair.value<(), memref<8xf32>>
+    // The libcall expansion pattern applies to the reduction and is kept when
+    // lowering it to sair.map.
+    // CHECK: sair.map[d0:%{{.*}}] %{{.*}}(d0), %{{.*}} attributes
+    // CHECK-SAME: expansion = "libcall"
+    // CHECK:   call @accumulate_tile
+    %3 = sair.map_reduce %1 reduce[d0:%0] %2 attributes {
+      instances = [{expansion = "libcall"}]
+    } {
+    ^bb0(%arg2: index, %arg3: f32, %arg4: memref<8xf32>):
+      %4 = func.call @accumulate_tile(%arg3, %arg4, %arg2)
+        : (f32, memref<8xf32>, index) -> f32
+      sair.return %4 : f32
+    } : #sair.shape<d0:static_range<8, 4>>, (memref<8xf32>) -> f32
+    sair.exit
+  }
+  func.return
+}
@@ -0,0 +1,17 @@
+// RUN: sair-opt -sair-lower-map-reduce -verify-diagnostics %s
+
+func.func @split_factor_not_applied(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.copy[d0:%0] %1 : !sair.value<d0:static_range<8>, f32>
+    // expected-error @+1 {{split_factor must be applied by -sair-split-reductions before lowering}}
+    %3 = sair.map_reduce %1 reduce[d0:%0] %2(d0) attributes {split_factor = 4} {
+      ^bb0(%arg1: index, %arg2: f32, %arg3: f32):
+        %4 = arith.addf %arg2, %arg3 : f32
+        sair.return %4 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
+    sair.exit
+  }
+  func.return
+}
@@ -6,3 +6,18 @@ func.func @undef() {
   %0 = sair.undef : f32
   func.return
 }
+
+// CHECK: llvm.mlir.global internal @"__sair_loop_probe.loop_profile:A"(dense<0> : tensor<1xi64>) {{.*}} : !llvm.array<1 x i64>
+// CHECK: llvm.mlir.global internal constant @"__sair_loop_profile.loop_profile:A"("loop_profile:A\00")
+// CHECK-LABEL: @loop_profile
+func.func @loop_profile(%arg0: index) {
+  // CHECK: %[[START:.*]] = llvm.call @sair_loop_profile_begin() : () -> i64
+  %0 = sair.loop_profile_begin
+  // CHECK: %[[PROBE_ADDR:.*]] = llvm.mlir.addressof @"__sair_loop_probe.loop_profile:A"
+  // CHECK: %[[PROBE:.*]] = llvm.bitcast %[[PROBE_ADDR]]
+  // CHECK: %[[KEY:.*]] = llvm.mlir.addressof @"__sair_loop_profile.loop_profile:A"
+  // CHECK: %[[NAME:.*]] = llvm.bitcast %[[KEY]]
+  // CHECK: llvm.call @sair_loop_profile_end(%[[PROBE]], %[[NAME]], %[[START]], %{{.*}})
+  sair.loop_profile_end "A" %0, %arg0
+  func.return
+}
@@ -119,6 +119,57 @@ func.func @load_from_memref(%arg0 : memref<?x?xf32>) {
   func.return
 }
 
+// CHECK-LABEL: @load_with_prefetch
+func.func @load_with_prefetch(%arg0 : memref<?xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<?xf32>>
+    // CHECK: sair.map[d0:%{{.*}}] %{{.*}}
+    // CHECK: ^{{.*}}(%[[ARG1:.*]]: index, %[[MEMREF:.*]]: memref<?xf32>):
+    // CHECK:   %[[I0:.*]] = affine.apply affine_map<(d0)[s0] -> (d0 - s0)>(%[[ARG1]])
+    // CHECK:   %[[VALUE:.*]] = memref.load %[[MEMREF]][%[[I0]]] : memref<?xf32>
+    // CHECK:   %[[AHEAD:.*]] = affine.apply affine_map<(d0) -> (d0 + 4)>(%[[ARG1]])
+    // CHECK:   %[[I1:.*]] = affine.apply affine_map<(d0)[s0] -> (d0 - s0)>(%[[AHEAD]])
+    // CHECK:   memref.prefetch %[[MEMREF]][%[[I1]]], read, locality<3>, data : memref<?xf32>
+    // CHECK:   sair.return %[[VALUE]] : f32
+    %2 = sair.load_from_memref[d0:%0] %1 {
+      layout = #sair.mapping<1 : d0>,
+      instances = [{
+        expansion = "load",
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+      }],
+      prefetch = {loop = "A", distance = 4}
+    } : memref<?xf32> -> !sair.value<d0:static_range<16>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// CHECK-LABEL: @load_with_prefetch_stripe
+func.func @load_with_prefetch_stripe(%arg0 : memref<?xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<?xf32>>
+    // Prefetching along a stripe-tiled loop is skipped.
+    // CHECK: memref.load
+    // CHECK-NOT: memref.prefetch
+    // CHECK: sair.return
+    %2 = sair.load_from_memref[d0:%0] %1 {
+      layout = #sair.mapping<1 : d0>,
+      instances = [{
+        expansion = "load",
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<stripe(d0, [4])>},
+          {name = "B", iter = #sair.mapping_expr<stripe(d0, [4, 1])>}
+        ]
+      }],
+      prefetch = {loop = "A", distance = 1}
+    } : memref<?xf32> -> !sair.value<d0:static_range<16>, f32>
+    sair.exit
+  }
+  func.return
+}
+
 // CHECK-LABEL: @store_to_memref
 func.func @store_to_memref(%arg0 : f32, %arg1 : memref<?x?xf32>) {
   sair.program {
@@ -147,3 +198,52 @@ func.func @store_to_memref(%arg0 : f32, %arg1 : memref<?x?xf32>) {
   }
   func.return
 }
+
+// CHECK-LABEL: @nontemporal_store
+func.func @nontemporal_store(%arg0 : f32, %arg1 : memref<8xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.from_scalar %arg1 : !sair.value<(), memref<8xf32>>
+    %3 = sair.copy[d0:%0] %1 {
+      instances = [{expansion = "copy"}]
+    } : !sair.value<d0:static_range<8>, f32>
+    // CHECK: sair.map[d0:%{{.*}}] %{{.*}}, %{{.*}}(d0)
+    // CHECK:   memref.store %{{.*}}, %{{.*}}[%{{.*}}] {nontemporal = true} : memref<8xf32>
+    sair.store_to_memref[d0:%0] %2, %3(d0) {
+      layout = #sair.mapping<1 : d0>,
+      instances = [{expansion = "store"}],
+      nontemporal
+    } : #sair.shape<d0:static_range<8>>, memref<8xf32>
+    sair.exit
+  }
+  func.return
+}
+
+func.func private @scale_tile(memref<8x?xf32>, index, f32)
+  attributes {sair.microkernel = @scale_tile_impl}
+func.func private @scale_tile_impl(memref<f32>, index, index, index, index, f32)
+
+// CHECK-LABEL: @libcall
+func.func @libcall(%arg0: memref<8x?xf32>, %arg1: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8, 4>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<8x?xf32>>
+    %2 = sair.from_scalar %arg1 : !sair.value<(), f32>
+    // CHECK: sair.map[d0:%{{.*}}] %{{.*}}, %{{.*}} attributes
+    // CHECK: ^{{.*}}(%[[I:.*]]: index, %[[MEMREF:.*]]: memref<8x?xf32>, %[[SCALE:.*]]: f32):
+    // CHECK:   %[[BASE:.*]], %[[OFFSET:.*]], %{{.*}}:2, %[[STRIDES:.*]]:2 = memref.extract_strided_metadata %[[MEMREF]]
+    // CHECK:   call @scale_tile_impl(%[[BASE]], %[[OFFSET]], %[[STRIDES]]#0, %[[STRIDES]]#1, %[[I]], %[[SCALE]])
+    // CHECK:   sair.return
+    sair.map[d0:%0] %1, %2 attributes {
+      instances = [{expansion = "libcall"}]
+    } {
+    ^bb0(%arg2: index, %arg3: memref<8x?xf32>, %arg4: f32):
+      func.call @scale_tile(%arg3, %arg2, %arg4)
+        : (memref<8x?xf32>, index, f32) -> ()
+      sair.return
+    } : #sair.shape<d0:static_range<8, 4>>, (memref<8x?xf32>, f32) -> ()
+    sair.exit
+  }
+  func.return
+}
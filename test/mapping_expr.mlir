@@ -279,4 +279,47 @@ module {
   expr = #sair.mapping_expr<unstripe(d0, unstripe(d1, d2, [7, 1]), [11, 1])>
 } : () -> ()
 
+// CHECK: "test.scratch_canonicalize"() {label = @scratch_stripe_unstripe,
+// CHECK-SAME: result = #sair.mapping<3 : stripe(unstripe(d1, d2, [4, 1]), [3])>
+"test.scratch_canonicalize"() {
+  label = @scratch_stripe_unstripe,
+  expr = #sair.mapping_expr<stripe(unstripe(d0, d1, d2, [8, 4, 1]), [8, 3])>
+} : () -> ()
+
+// CHECK: "test.scratch_canonicalize"() {label = @scratch_unstripe_stripe,
+// CHECK-SAME: result = #sair.mapping<3 : unstripe(d0, d1, d2, [11, 7, 1])>
+"test.scratch_canonicalize"() {
+  label = @scratch_unstripe_stripe,
+  expr = #sair.mapping_expr<unstripe(d0, d1, stripe(d2, [4]), stripe(d2, [4, 1]), [11, 7, 4, 1])>
+} : () -> ()
+
+// CHECK: "test.scratch_inverse"() {label = @scratch_stripe,
+// CHECK-SAME: result = #sair.mapping<1 : unstripe(d0, none, [4, 1])>
+"test.scratch_inverse"() {
+  label = @scratch_stripe,
+  expr = #sair.mapping_expr<stripe(d0, [4])>
+} : () -> ()
+
+// CHECK: "test.scratch_inverse"() {label = @scratch_unstripe,
+// CHECK-SAME: result = #sair.mapping<1 : stripe(d0, [4]), stripe(d0, [4, 1])>
+"test.scratch_inverse"() {
+  label = @scratch_unstripe,
+  expr = #sair.mapping_expr<unstripe(d0, d1, [4, 1])>
+} : () -> ()
+
+// CHECK: "test.scratch_unify"() {label = @scratch_unstripe_compatible_factors,
+// CHECK-SAME: result = #sair.mapping<2 : unstripe(d0, none, d1, [4, 2, 1])>
+"test.scratch_unify"() {
+  label = @scratch_unstripe_compatible_factors,
+  expr = #sair.mapping_expr<unstripe(d0, none, [4, 1])>,
+  other = #sair.mapping_expr<unstripe(none, none, d1, [4, 2, 1])>
+} : () -> ()
+
+// CHECK: "test.scratch_unify"() {label = @scratch_different_dims, result}
+"test.scratch_unify"() {
+  label = @scratch_different_dims,
+  expr = #sair.mapping_expr<d0>,
+  other = #sair.mapping_expr<d1>
+} : () -> ()
+
 }
@@ -1,4 +1,7 @@
 // RUN: sair-opt %s -sair-materialize-buffers -mlir-print-local-scope | FileCheck %s
+// RUN: sair-opt %s -sair-materialize-buffers="reuse-buffers" -mlir-print-local-scope | FileCheck %s --check-prefix=REUSE
+// RUN: sair-opt %s -sair-materialize-buffers="stack-allocation-limit=64" -mlir-print-local-scope | FileCheck %s --check-prefix=STACK
+// RUN: sair-opt %s -sair-materialize-buffers="hoist-allocations" -mlir-print-local-scope | FileCheck %s --check-prefix=HOIST
 
 // CHECK-LABEL: @from_to_memref
 func.func @from_to_memref(%arg0: memref<?xf32>, %arg1: memref<?xf32>) {
@@ -38,10 +41,16 @@ func.func @from_to_memref(%arg0: memref<?xf32>, %arg1: memref<?xf32>) {
 }
 
 // CHECK-LABEL: @static_shape
+// STACK-LABEL: @static_shape
 func.func @static_shape(%arg0: f32) {
   sair.program {
     %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
     %1 = sair.static_range { instances = [{}] } : !sair.static_range<16, 2>
+    // Buffers small enough are allocated on the stack and never freed.
+    // STACK: sair.alloc
+    // STACK-SAME: expansion = "alloca"
+    // STACK-SAME: : !sair.value<(), memref<8xf32>>
+    // STACK-NOT: sair.free
     // CHECK: %[[V0:.*]] = sair.alloc
     // CHECK-SAME: expansion = "alloc", loop_nest = [], operands = [], sequence = 0
     // CHECK-SAME: storage = [{layout = #sair.named_mapping<[] -> ()>, space = "register"}]
@@ -81,6 +90,147 @@ func.func @static_shape(%arg0: f32) {
   func.return
 }
 
+// CHECK-LABEL: @shared_memory
+// STACK-LABEL: @shared_memory
+// Buffers in GPU shared memory are never allocated on the stack.
+// STACK: sair.alloc
+// STACK-SAME: expansion = "alloc"
+func.func @shared_memory(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // CHECK: %[[V0:.*]] = sair.alloc
+    // CHECK-SAME: : !sair.value<(), memref<8xf32, #gpu.address_space<workgroup>>>
+    // CHECK: sair.store_to_memref[d0:%{{.*}}] %[[V0]]
+    // CHECK:   loop_nest = [{gpu = "thread_x", iter = #sair.mapping_expr<d0>, name = "A"}]
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>,
+                      gpu = "thread_x"}],
+        storage = [{
+          name = "B", space = "shared",
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    // CHECK: sair.load_from_memref[d0:%{{.*}}] %[[V0]]
+    // CHECK:   : memref<8xf32, #gpu.address_space<workgroup>> -> !sair.value<d0:static_range<8>, f32>
+    %3 = sair.copy[d0:%1] %2(d0) {
+      instances = [{
+        loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    %4 = sair.proj_last of[d0:%1] %3(d0) { instances = [{}] } : #sair.shape<d0:static_range<8>>, f32
+    sair.exit %4 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
+
+// CHECK-LABEL: @local_memory
+// STACK-LABEL: @local_memory
+// Local buffers are allocated in the private address space, on the stack if
+// they fit in the stack allocation limit.
+func.func @local_memory(%arg0: f32) {
+  // CHECK: sair.program attributes {memory_budgets = {local = 32 : i64}}
+  sair.program attributes {memory_budgets = {local = 32}} {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // CHECK: %[[V0:.*]] = sair.alloc
+    // CHECK-SAME: expansion = "alloc"
+    // CHECK-SAME: : !sair.value<(), memref<8xf32, #gpu.address_space<private>>>
+    // STACK: sair.alloc
+    // STACK-SAME: expansion = "alloca"
+    // STACK-SAME: : !sair.value<(), memref<8xf32, #gpu.address_space<private>>>
+    // STACK-NOT: sair.free
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          name = "B", space = "local",
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    // CHECK: sair.load_from_memref[d0:%{{.*}}] %[[V0]]
+    // CHECK:   : memref<8xf32, #gpu.address_space<private>> -> !sair.value<d0:static_range<8>, f32>
+    %3 = sair.copy[d0:%1] %2(d0) {
+      instances = [{
+        loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    %4 = sair.proj_last of[d0:%1] %3(d0) { instances = [{}] } : #sair.shape<d0:static_range<8>>, f32
+    sair.exit %4 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
+
+// CHECK-LABEL: @register_tile
+// STACK-LABEL: @register_tile
+// Multi-dimensional values in registers are allocated on the stack so that
+// they can be promoted to SSA values.
+func.func @register_tile(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<4>
+    // CHECK: %[[V0:.*]] = sair.alloc
+    // CHECK-SAME: expansion = "alloca"
+    // CHECK-SAME: : !sair.value<(), memref<4xf32>>
+    // CHECK-NOT: sair.free
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>, unroll = 4}],
+        storage = [{
+          name = "B", space = "register",
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<4>, f32>
+    // CHECK: sair.load_from_memref[d0:%{{.*}}] %[[V0]]
+    %3 = sair.copy[d0:%1] %2(d0) {
+      instances = [{
+        loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>, unroll = 4}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<4>, f32>
+    %4 = sair.proj_last of[d0:%1] %3(d0) { instances = [{}] } : #sair.shape<d0:static_range<4>>, f32
+    sair.exit %4 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
+
+// CHECK-LABEL: @prefetch
+func.func @prefetch(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // CHECK: sair.store_to_memref
+    // CHECK-NOT: prefetch
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          name = "B", space = "memory",
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>,
+          prefetch = {loop = "B", distance = 2}
+        }]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    // CHECK: sair.load_from_memref
+    // CHECK-SAME: prefetch = {distance = 2 : i64, loop = "B"}
+    %3 = sair.copy[d0:%1] %2(d0) {
+      instances = [{
+        loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    %4 = sair.proj_last of[d0:%1] %3(d0) { instances = [{}] } : #sair.shape<d0:static_range<8>>, f32
+    sair.exit %4 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
+
 // CHECK-LABEL: @dynamic_shape
 func.func @dynamic_shape(%arg0: f32, %arg1: index, %arg2: index) {
   sair.program {
@@ -271,3 +421,293 @@ func.func @sequence_attr(%arg0: f32) {
   }
   func.return
 }
+
+// CHECK-LABEL: @reuse_buffers
+// REUSE-LABEL: @reuse_buffers
+func.func @reuse_buffers(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<16>
+
+    // Without reuse, each buffer gets its own allocation.
+    // CHECK-COUNT-3: sair.alloc
+    // CHECK-NOT: sair.alloc
+
+    // buf3 is first accessed after the last access to buf1 and reuses its
+    // allocation. buf2 is live at the same time as buf1 and buf3.
+    // REUSE: %[[BUF1:.*]] = sair.alloc
+    // REUSE: sair.free %[[BUF1]]
+    // REUSE: %[[BUF2:.*]] = sair.alloc
+    // REUSE: sair.free %[[BUF2]]
+    // REUSE-NOT: sair.alloc
+    // REUSE-NOT: sair.free
+
+    // REUSE: sair.store_to_memref %[[BUF1]]
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          name = "buf1", space = "memory",
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }],
+        sequence = 1
+      }]
+    } : !sair.value<d0:static_range<16>, f32>
+    // REUSE: sair.load_from_memref %[[BUF1]]
+    // REUSE: sair.store_to_memref %[[BUF2]]
+    %3 = sair.copy[d0:%1] %2(d0) {
+      instances = [{
+        loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          name = "buf2", space = "memory",
+          layout = #sair.named_mapping<[d0:"B"] -> (d0)>
+        }],
+        sequence = 2
+      }]
+    } : !sair.value<d0:static_range<16>, f32>
+    // REUSE: sair.load_from_memref %[[BUF2]]
+    // REUSE: sair.store_to_memref %[[BUF1]]
+    %4 = sair.copy[d0:%1] %3(d0) {
+      instances = [{
+        loop_nest = [{name = "C", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          name = "buf3", space = "memory",
+          layout = #sair.named_mapping<[d0:"C"] -> (d0)>
+        }],
+        sequence = 3
+      }]
+    } : !sair.value<d0:static_range<16>, f32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @hoist_allocation
+// HOIST-LABEL: @hoist_allocation
+func.func @hoist_allocation(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+
+    // By default, the buffer is allocated at each iteration of loop A.
+    // CHECK: %[[V0:.*]] = sair.alloc[d0:%{{.*}}]
+    // CHECK: : !sair.value<d0:static_range<8>, memref<8xf32>>
+    // CHECK: sair.free[d0:%{{.*}}] %[[V0]](d0)
+
+    // The buffer has a static shape and is allocated once outside of loop A.
+    // HOIST: %[[V0:.*]] = sair.alloc
+    // HOIST-SAME: loop_nest = []
+    // HOIST-SAME: : !sair.value<(), memref<8xf32>>
+    // HOIST: sair.free %[[V0]]
+    // HOIST-SAME: loop_nest = []
+
+    // HOIST: %[[V1:.*]] = sair.copy
+    %2 = sair.copy[d0:%1, d1:%1] %0 {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{
+          name = "buf", space = "memory",
+          layout = #sair.named_mapping<[d0:"B"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    // HOIST: sair.store_to_memref[d0:%{{.*}}, d1:%{{.*}}] %[[V0]], %[[V1]](d0, d1)
+    // HOIST: sair.load_from_memref[d0:%{{.*}}, d1:%{{.*}}] %[[V0]]
+    %3 = sair.copy[d0:%1, d1:%1] %2(d0, d1) {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "C", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// HOIST-LABEL: @hoist_allocation_parallel
+func.func @hoist_allocation_parallel(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+
+    // Each iteration of the parallel loop A needs its own allocation.
+    // HOIST: %[[V0:.*]] = sair.alloc[d0:%{{.*}}]
+    // HOIST-SAME: loop_nest = [{iter = #sair.mapping_expr<d0>, name = "A", parallel}]
+    // HOIST-SAME: : !sair.value<d0:static_range<8>, memref<8xf32>>
+    // HOIST: sair.free[d0:%{{.*}}] %[[V0]](d0)
+    %2 = sair.copy[d0:%1, d1:%1] %0 {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, parallel},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{
+          name = "buf", space = "memory",
+          layout = #sair.named_mapping<[d0:"B"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    %3 = sair.copy[d0:%1, d1:%1] %2(d0, d1) {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>, parallel},
+          {name = "C", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @padding_and_alignment
+func.func @padding_and_alignment(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<16>
+    // CHECK: %[[V0:.*]] = sair.alloc
+    // CHECK-SAME: alignment = 64
+    // CHECK-SAME: : !sair.value<(), memref<16x17xf32>>
+    // CHECK: %[[V1:.*]] = sair.copy
+    %2 = sair.copy[d0:%1, d1:%1] %0 {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{
+          name = "buf", space = "memory", padding = [0, 1], alignment = 64,
+          layout = #sair.named_mapping<[d0:"A", d1:"B"] -> (d0, d1)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<16> x d1:static_range<16>, f32>
+    // CHECK: sair.store_to_memref[d0:%{{.*}}, d1:%{{.*}}] %[[V0]], %[[V1]](d0, d1)
+    // CHECK-SAME: memref<16x17xf32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @double_buffer
+func.func @double_buffer(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<4>
+    // CHECK: %[[ALLOC0:.*]] = sair.alloc
+    // CHECK-SAME: : !sair.value<(), memref<4xf32>>
+    // CHECK: sair.free %[[ALLOC0]]
+    // CHECK: %[[ALLOC1:.*]] = sair.alloc
+    // CHECK-SAME: : !sair.value<(), memref<4xf32>>
+    // CHECK: sair.free %[[ALLOC1]]
+    // CHECK: %[[CUR:.*]] = sair.fby %[[ALLOC0]] then[d0:%{{.*}}] %[[SWAP:[0-9]+]]#0(d0)
+    // CHECK: %[[NEXT:.*]] = sair.fby %[[ALLOC1]] then[d0:%{{.*}}] %[[SWAP]]#1(d0)
+    // CHECK: %[[SWAP]]:2 = sair.map[d0:%{{.*}}] %[[CUR]](d0), %[[NEXT]](d0)
+    // CHECK-SAME: loop_nest = [{iter = #sair.mapping_expr<d0>, name = "A"}]
+    // CHECK: ^{{.*}}(%{{.*}}: index, %[[V0:[^:]*]]: memref<4xf32>, %[[V1:[^:]*]]: memref<4xf32>):
+    // CHECK: sair.return %[[V1]], %[[V0]]
+    %2 = sair.copy[d0:%1, d1:%1] %0 {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{
+          name = "T", space = "memory",
+          layout = #sair.named_mapping<[d0:"B"] -> (d0)>,
+          double_buffer = "A"
+        }]
+      }]
+    } : !sair.value<d0:static_range<4> x d1:static_range<4>, f32>
+    // CHECK: sair.store_to_memref[d0:%{{.*}}, d1:%{{.*}}] %[[CUR]](d0)
+    // CHECK: sair.load_from_memref[d0:%{{.*}}, d1:%{{.*}}] %[[CUR]](d0)
+    %3 = sair.copy[d0:%1, d1:%1] %2(d0, d1) {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "C", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<4> x d1:static_range<4>, f32>
+    %4 = sair.proj_last of[d0:%1, d1:%1] %3(d0, d1) { instances = [{}] }
+      : #sair.shape<d0:static_range<4> x d1:static_range<4>>, f32
+    sair.exit %4 { instances = [{}] } : f32
+  } : f32
+  func.return
+}
+
+// CHECK-LABEL: @nontemporal
+func.func @nontemporal(%arg0: f32, %arg1: memref<8xf32>) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.from_scalar %arg1 { instances = [{}] }
+      : !sair.value<(), memref<8xf32>>
+    %2 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // CHECK: sair.store_to_memref[d0:%{{.*}}] %{{.*}}, %{{.*}}(d0)
+    // CHECK-SAME: nontemporal
+    %3 = sair.copy[d0:%2] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{name = "T", space = "memory",
+                    layout = #sair.named_mapping<[d0:"A"] -> (d0)>,
+                    nontemporal}]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    // CHECK: sair.store_to_memref[d0:%{{.*}}] %{{.*}}, %{{.*}}(d0)
+    // CHECK-SAME: nontemporal
+    %4 = sair.copy[d0:%2] %3(d0) {
+      instances = [{
+        loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>}],
+        storage = [{name = "OUT", space = "memory",
+                    layout = #sair.named_mapping<[d0:"B"] -> (d0)>}]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.to_memref %1 memref[d0:%2] %4(d0) {
+      instances = [{}],
+      buffer_name = "OUT",
+      nontemporal
+    } : #sair.shape<d0:static_range<8>>, memref<8xf32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @memref_facts
+// CHECK-SAME: %{{.*}}: memref<8xf32> {llvm.noalias}, %[[ARG1:.*]]: memref<8xf32>)
+func.func @memref_facts(%arg0: memref<8xf32>, %arg1: memref<8xf32>) {
+  // CHECK: memref.assume_alignment %[[ARG1]], 64 : memref<8xf32>
+  // CHECK: sair.program
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] }
+      : !sair.value<(), memref<8xf32>>
+    %1 = sair.from_scalar %arg1 { instances = [{}] }
+      : !sair.value<(), memref<8xf32>>
+    %2 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    %3 = sair.from_memref %0 memref[d0:%2] {
+      instances = [{}],
+      buffer_name = "IN",
+      noalias
+    } : #sair.shape<d0:static_range<8>>, memref<8xf32>
+    %4 = sair.copy[d0:%2] %3(d0) {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{name = "OUT", space = "memory",
+                    layout = #sair.named_mapping<[d0:"A"] -> (d0)>}]
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.to_memref %1 memref[d0:%2] %4(d0) {
+      instances = [{}],
+      buffer_name = "OUT",
+      alignment = 64
+    } : #sair.shape<d0:static_range<8>>, memref<8xf32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
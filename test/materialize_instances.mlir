@@ -1,4 +1,6 @@
-// RUN: sair-opt -sair-materialize-instances %s | FileCheck %s
+// RUN: sair-opt -sair-materialize-instances='deduplicate=false' %s | FileCheck %s
+// RUN: sair-opt -sair-materialize-instances %s \
+// RUN:   | FileCheck %s --check-prefix=DEDUP
 
 // CHECK-LABEL: @instances
 func.func @instances(%arg0: f32) {
@@ -137,3 +139,73 @@ func.func @erase_zero_instance(%arg0: f32) {
   func.return
 }
 
+// DEDUP-LABEL: @deduplicate_instances
+func.func @deduplicate_instances(%arg0: f32) {
+  sair.program {
+    // DEDUP: %[[SCALAR:.*]] = sair.from_scalar
+    // DEDUP-NOT: sair.from_scalar
+    %0 = sair.from_scalar %arg0 { instances = [
+      {operands = [#sair.instance<0>]},
+      {operands = [#sair.instance<0>]}] } : !sair.value<(), f32>
+    // DEDUP: %[[RANGE:.*]] = sair.static_range
+    // DEDUP-NOT: sair.static_range
+    %1 = sair.static_range {
+      instances = [{operands = []}, {operands = []}] } : !sair.static_range<4>
+    // Instances that only differ by the instance of equivalent operands are
+    // also merged.
+    // DEDUP: sair.copy[d0:%[[RANGE]]] %[[SCALAR]]
+    // DEDUP-NOT: sair.copy
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [
+        {operands = [#sair.instance<0>, #sair.instance<0>]},
+        {operands = [#sair.instance<1>, #sair.instance<1>]}]
+    } : !sair.value<d0:static_range<4>, f32>
+    sair.exit { instances = [{operands = []}] }
+  }
+  func.return
+}
+
+// DEDUP-LABEL: @deduplicate_copies
+func.func @deduplicate_copies(%arg0: f32) {
+  sair.program {
+    // DEDUP: %[[SCALAR:.*]] = sair.from_scalar
+    %0 = sair.from_scalar %arg0 {
+      instances = [{operands = [#sair.instance<0>]}],
+      copies = [[
+        {copy_of = #sair.instance<0>},
+        {copy_of = #sair.instance<0>}]] }
+    : !sair.value<(), f32>
+    // DEDUP: %[[COPY:.*]] = sair.copy %[[SCALAR]]
+    // DEDUP-NOT: sair.copy %[[SCALAR]]
+    %1 = sair.static_range {
+      instances = [{operands = []}] } : !sair.static_range<4>
+    // DEDUP: sair.copy[d0:%{{.*}}] %[[COPY]]
+    %2 = sair.copy[d0:%1] %0 {
+      instances = [{operands = [#sair.instance<0>, #sair.copy<1>]}]
+    } : !sair.value<d0:static_range<4>, f32>
+    sair.exit { instances = [{operands = []}] }
+  }
+  func.return
+}
+
+func.func private @side_effect(%arg0: index) -> f32
+
+// DEDUP-LABEL: @side_effects
+func.func @side_effects() {
+  sair.program {
+    %0 = sair.static_range {
+      instances = [{operands = []}] } : !sair.static_range<4>
+    // DEDUP-COUNT-2: func.call @side_effect
+    %1 = sair.map[d0:%0] attributes {
+      instances = [
+        {operands = [#sair.instance<0>]},
+        {operands = [#sair.instance<0>]}]
+    } {
+      ^bb0(%arg0: index):
+        %2 = func.call @side_effect(%arg0) : (index) -> f32
+        sair.return %2 : f32
+    } : #sair.shape<d0:static_range<4>>, () -> f32
+    sair.exit { instances = [{operands = []}] }
+  }
+  func.return
+}
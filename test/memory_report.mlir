@@ -0,0 +1,100 @@
+// RUN: sair-opt %s -sair-memory-report -verify-diagnostics -split-input-file | FileCheck %s
+
+// CHECK-LABEL: @static_buffer
+func.func @static_buffer(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // expected-remark@+2 {{writes buffer "buf": 256 bytes moved, reuse distance A=32 (reused), B=4}}
+    // expected-remark@+1 {{buffer "buf": footprint of 32 bytes per iteration of loop A, 512 bytes moved}}
+    %2 = sair.copy[d0:%1, d1:%1] %0 {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{
+          name = "buf", space = "memory",
+          layout = #sair.named_mapping<[d0:"B"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    // expected-remark@+1 {{reads buffer "buf": 256 bytes moved, reuse distance A=32 (reused), C=4}}
+    %3 = sair.copy[d0:%1, d1:%1] %2(d0, d1) {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "C", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// -----
+
+// CHECK-LABEL: @dynamic_buffer
+func.func @dynamic_buffer(%arg0: f32, %arg1: index) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.from_scalar %arg1 { instances = [{}] } : !sair.value<(), index>
+    %2 = sair.dyn_range %1 { instances = [{}] } : !sair.dyn_range
+    // expected-remark@+2 {{writes buffer "buf": ? bytes moved, reuse distance A=4}}
+    // expected-remark@+1 {{buffer "buf": footprint of ? bytes, ? bytes moved}}
+    %3 = sair.copy[d0:%2] %0 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [{
+          name = "buf", space = "memory",
+          layout = #sair.named_mapping<[d0:"A"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:dyn_range, f32>
+    // expected-remark@+1 {{reads buffer "buf": ? bytes moved, reuse distance B=4}}
+    %4 = sair.copy[d0:%2] %3(d0) {
+      instances = [{
+        loop_nest = [{name = "B", iter = #sair.mapping_expr<d0>}],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:dyn_range, f32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// -----
+
+// Reuse distances and footprints are unknown when layouts are not specified.
+// CHECK-LABEL: @unspecified_layout
+func.func @unspecified_layout(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    // expected-remark@+2 {{writes buffer "buf": 256 bytes moved, reuse distance A=?, B=?}}
+    // expected-remark@+1 {{buffer "buf": footprint of ? bytes}}
+    %2 = sair.copy[d0:%1, d1:%1] %0 {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{name = "buf", space = "memory"}]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    // expected-remark@+1 {{reads buffer "buf": 256 bytes moved, reuse distance A=?, C=?}}
+    %3 = sair.copy[d0:%1, d1:%1] %2(d0, d1) {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "C", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
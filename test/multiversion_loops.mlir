@@ -0,0 +1,103 @@
+// RUN: sair-opt %s -sair-introduce-loops='multiversion-loops' | FileCheck %s
+// RUN: sair-opt %s -sair-introduce-loops='specialize-sizes=16,32' \
+// RUN:   | FileCheck %s --check-prefix=SIZES
+
+func.func private @foo(%arg0: index)
+
+// CHECK-LABEL: @partial_tile
+func.func @partial_tile() {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<10, 4>
+    // CHECK: scf.for %[[I:.*]] = %{{.*}} to %{{.*}} step %{{.*}} {
+    %1, %2 = sair.map[d0:%0] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        storage = [
+          {space = "register", layout = #sair.named_mapping<[] -> ()>},
+          {space = "register", layout = #sair.named_mapping<[] -> ()>}
+        ]
+      }]
+    } {
+      ^bb0(%arg0: index):
+        %c4 = arith.constant 4 : index
+        %c10 = arith.constant 10 : index
+        %3 = arith.addi %arg0, %c4 : index
+        %4 = arith.cmpi ult, %c10, %3 : index
+        // CHECK: %[[END:.*]] = arith.select
+        %5 = arith.select %4, %c10, %3 : index
+        sair.return %arg0, %5 : index, index
+    } : #sair.shape<d0:static_range<10, 4>>, () -> (index, index)
+    %6 = sair.dyn_range[d0:%0] %1(d0), %2(d0) { instances = [{}] }
+      : !sair.dyn_range<d0:static_range<10, 4>>
+    // Full tiles execute a loop with a static trip count.
+    // CHECK: %[[DIST:.*]] = arith.subi %[[END]], %[[I]] : index
+    // CHECK: %[[C0:.*]] = arith.constant 0 : index
+    // CHECK: %[[C4:.*]] = arith.constant 4 : index
+    // CHECK: %[[COND:.*]] = arith.cmpi eq, %[[DIST]], %[[C4]] : index
+    // CHECK: scf.if %[[COND]] {
+    // CHECK:   scf.for %[[J:.*]] = %[[C0]] to %[[C4]] step %{{.*}} {
+    // CHECK:     %[[K:.*]] = arith.addi %[[I]], %[[J]] : index
+    // CHECK:     func.call @foo(%[[K]])
+    // CHECK:   }
+    // CHECK: } else {
+    // CHECK:   scf.for %[[L:.*]] = %[[I]] to %[[END]] step %{{.*}} {
+    // CHECK:     func.call @foo(%[[L]])
+    // CHECK:   }
+    // CHECK: }
+    sair.map[d0:%0, d1:%6] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ]
+      }]
+    } {
+      ^bb0(%arg0: index, %arg1: index):
+        func.call @foo(%arg1) : (index) -> ()
+        sair.return
+    } : #sair.shape<d0:static_range<10, 4> x d1:dyn_range(d0)>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @dynamic_size
+// SIZES-LABEL: @dynamic_size
+func.func @dynamic_size(%arg0: index) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), index>
+    %1 = sair.dyn_range %0 { instances = [{}] } : !sair.dyn_range
+    // Loops that do not iterate on partial tiles are only specialized for the
+    // sizes given as options.
+    // CHECK-NOT: scf.if
+
+    // SIZES: ^{{.*}}(%[[N:.*]]: index):
+    // SIZES: %[[C16:.*]] = arith.constant 16 : index
+    // SIZES: %[[COND16:.*]] = arith.cmpi eq, %{{.*}}, %[[C16]] : index
+    // SIZES: scf.if %[[COND16]] {
+    // SIZES:   scf.for %{{.*}} = %{{.*}} to %[[C16]] step %{{.*}} {
+    // SIZES:     func.call @foo
+    // SIZES:   }
+    // SIZES: } else {
+    // SIZES:   %[[C32:.*]] = arith.constant 32 : index
+    // SIZES:   %[[COND32:.*]] = arith.cmpi eq, %{{.*}}, %[[C32]] : index
+    // SIZES:   scf.if %[[COND32]] {
+    // SIZES:     scf.for %{{.*}} = %{{.*}} to %[[C32]] step %{{.*}} {
+    // SIZES:       func.call @foo
+    // SIZES:     }
+    // SIZES:   } else {
+    // SIZES:     scf.for %{{.*}} = %{{.*}} to %[[N]] step %{{.*}} {
+    // SIZES:       func.call @foo
+    sair.map[d0:%1] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+      }]
+    } {
+      ^bb0(%arg1: index):
+        func.call @foo(%arg1) : (index) -> ()
+        sair.return
+    } : #sair.shape<d0:dyn_range>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
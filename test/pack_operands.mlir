@@ -0,0 +1,140 @@
+// RUN: sair-opt -sair-pack-operands %s | FileCheck %s
+
+// CHECK-LABEL: @transposed_access
+func.func @transposed_access(%arg0: memref<16x16xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<16x16xf32>>
+    // CHECK: %[[B:.*]] = sair.from_memref
+    %2 = sair.from_memref %1 memref[d0:%0, d1:%0] {buffer_name = "B"}
+      : #sair.shape<d0:static_range<16> x d1:static_range<16>>, memref<16x16xf32>
+    // Each iteration of loop "A" packs a column of B into a buffer read
+    // contiguously by loop "B".
+    // CHECK: %[[PACKED:.*]] = sair.copy[d0:%{{.*}}, d1:%{{.*}}] %[[B]](d0, d1)
+    // CHECK-SAME: loop_nest = [
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d1>, name = "A"},
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d0>, name = "[[LOOP:.*]]"}
+    // CHECK-SAME: ]
+    // CHECK-SAME: storage = [{
+    // CHECK-SAME:   layout = #sair.named_mapping<[d0:"[[LOOP]]"] -> (d0)>
+    // CHECK-SAME:   space = "memory"
+    // CHECK: sair.map[d0:%{{.*}}, d1:%{{.*}}] %[[PACKED]](d1, d0)
+    sair.map[d0:%0, d1:%0] %2(d1, d0) attributes {
+      instances = [{
+        sequence = 0,
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: index, %arg3: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<16> x d1:static_range<16>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// CHECK-LABEL: @contiguous_access
+func.func @contiguous_access(%arg0: memref<16x16xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<16x16xf32>>
+    %2 = sair.from_memref %1 memref[d0:%0, d1:%0] {buffer_name = "B"}
+      : #sair.shape<d0:static_range<16> x d1:static_range<16>>, memref<16x16xf32>
+    // The innermost loop already iterates along rows.
+    // CHECK-NOT: sair.copy
+    sair.map[d0:%0, d1:%0] %2(d0, d1) attributes {
+      instances = [{
+        sequence = 0,
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: index, %arg3: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<16> x d1:static_range<16>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// CHECK-LABEL: @small_stride
+func.func @small_stride(%arg0: memref<16x4xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.static_range : !sair.static_range<4>
+    %2 = sair.from_scalar %arg0 : !sair.value<(), memref<16x4xf32>>
+    %3 = sair.from_memref %2 memref[d0:%0, d1:%1] {buffer_name = "B"}
+      : #sair.shape<d0:static_range<16> x d1:static_range<4>>, memref<16x4xf32>
+    // Consecutive elements are only 16 bytes apart.
+    // CHECK-NOT: sair.copy
+    sair.map[d0:%1, d1:%0] %3(d1, d0) attributes {
+      instances = [{
+        sequence = 0,
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: index, %arg3: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<4> x d1:static_range<16>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// CHECK-LABEL: @transposed_buffer
+func.func @transposed_buffer(%arg0: memref<16x16xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<16x16xf32>>
+    %2 = sair.from_memref %1 memref[d0:%0, d1:%0] {buffer_name = "B"}
+      : #sair.shape<d0:static_range<16> x d1:static_range<16>>, memref<16x16xf32>
+    // CHECK: %[[C:.*]] = sair.copy
+    %3 = sair.copy[d0:%0, d1:%0] %2(d0, d1) {
+      instances = [{
+        sequence = 0,
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{
+          name = "C", space = "memory",
+          layout = #sair.named_mapping<[d0:"A", d1:"B"] -> (d0, d1)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<16> x d1:static_range<16>, f32>
+    // Buffer "C" is laid out in rows but read along columns by loop "D".
+    // CHECK: %[[PACKED:.*]] = sair.copy[d0:%{{.*}}, d1:%{{.*}}] %[[C]](d0, d1)
+    // CHECK-SAME: loop_nest = [
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d1>, name = "C"},
+    // CHECK-SAME:   {iter = #sair.mapping_expr<d0>, name = "[[LOOP:.*]]"}
+    // CHECK-SAME: ]
+    // CHECK-SAME: sequence = 1
+    // CHECK-SAME: storage = [{
+    // CHECK-SAME:   layout = #sair.named_mapping<[d0:"[[LOOP]]"] -> (d0)>
+    // CHECK-SAME:   space = "memory"
+    // CHECK: sair.map[d0:%{{.*}}, d1:%{{.*}}] %[[PACKED]](d1, d0)
+    // CHECK-SAME: sequence = 2
+    sair.map[d0:%0, d1:%0] %3(d1, d0) attributes {
+      instances = [{
+        sequence = 1,
+        loop_nest = [
+          {name = "C", iter = #sair.mapping_expr<d0>},
+          {name = "D", iter = #sair.mapping_expr<d1>}
+        ]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: index, %arg3: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<16> x d1:static_range<16>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
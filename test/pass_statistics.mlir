@@ -0,0 +1,53 @@
+// RUN: sair-opt %s -sair-materialize-buffers -pass-statistics-json=%t \
+// RUN:   -o /dev/null
+// RUN: FileCheck %s < %t
+
+// CHECK: "buffer": [
+// CHECK-NEXT: {
+// CHECK-NEXT: "pass": "sair-materialize-buffers",
+// CHECK-NEXT: "statistics": {
+// CHECK-NEXT: "num-allocations": 1,
+// CHECK-NEXT: "num-stack-allocations": 0,
+// CHECK-NEXT: "num-reused-allocations": 0,
+// CHECK-NEXT: "num-allocated-bytes": 32
+func.func @buffer(%arg0: f32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), f32>
+    %1 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    %2 = sair.copy[d0:%1, d1:%1] %0 {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{
+          name = "buf", space = "memory",
+          layout = #sair.named_mapping<[d0:"B"] -> (d0)>
+        }]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    %3 = sair.copy[d0:%1, d1:%1] %2(d0, d1) {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "C", iter = #sair.mapping_expr<d1>}
+        ],
+        storage = [{space = "register", layout = #sair.named_mapping<[] -> ()>}]
+      }]
+    } : !sair.value<d0:static_range<8> x d1:static_range<8>, f32>
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK: "no_buffer": [
+// CHECK-NEXT: {
+// CHECK-NEXT: "pass": "sair-materialize-buffers",
+// CHECK-NEXT: "statistics": {
+// CHECK-NEXT: "num-allocations": 0,
+func.func @no_buffer() {
+  sair.program {
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
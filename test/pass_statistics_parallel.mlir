@@ -0,0 +1,113 @@
+// Programs of a function are processed in parallel when threading is enabled.
+// Check that counters incremented while processing programs on other threads
+// are recorded.
+
+// RUN: sair-opt %s -mlir-disable-threading=false -sair-pack-operands \
+// RUN:   -pass-statistics-json=%t.pack -o /dev/null
+// RUN: FileCheck %s --check-prefix=PACK < %t.pack
+// RUN: sair-opt %s -mlir-disable-threading=false \
+// RUN:   -sair-assign-default-sequence="minimize-memory" \
+// RUN:   -pass-statistics-json=%t.sequence -o /dev/null
+// RUN: FileCheck %s --check-prefix=SEQUENCE < %t.sequence
+
+// PACK: "transposed_access": [
+// PACK-NEXT: {
+// PACK-NEXT: "pass": "sair-pack-operands",
+// PACK-NEXT: "statistics": {
+// PACK-NEXT: "num-packed-operands": 2
+func.func @transposed_access(%arg0: memref<16x16xf32>) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<16x16xf32>>
+    %2 = sair.from_memref %1 memref[d0:%0, d1:%0] {buffer_name = "B"}
+      : #sair.shape<d0:static_range<16> x d1:static_range<16>>, memref<16x16xf32>
+    sair.map[d0:%0, d1:%0] %2(d1, d0) attributes {
+      instances = [{
+        sequence = 0,
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: index, %arg3: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<16> x d1:static_range<16>>, (f32) -> ()
+    sair.exit
+  }
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<16>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), memref<16x16xf32>>
+    %2 = sair.from_memref %1 memref[d0:%0, d1:%0] {buffer_name = "B"}
+      : #sair.shape<d0:static_range<16> x d1:static_range<16>>, memref<16x16xf32>
+    sair.map[d0:%0, d1:%0] %2(d1, d0) attributes {
+      instances = [{
+        sequence = 0,
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d0>},
+          {name = "B", iter = #sair.mapping_expr<d1>}
+        ]
+      }]
+    } {
+    ^bb0(%arg1: index, %arg2: index, %arg3: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<16> x d1:static_range<16>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
+
+// SEQUENCE: "independent_buffers": [
+// SEQUENCE-NEXT: {
+// SEQUENCE-NEXT: "pass": "sair-assign-default-sequence",
+// SEQUENCE-NEXT: "statistics": {
+// SEQUENCE-NEXT: "num-reordered-programs": 2
+func.func @independent_buffers(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<1024>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.copy[d0:%0] %1 {
+      instances = [{}]
+    } : !sair.value<d0:static_range<1024>, f32>
+    %3 = sair.copy[d0:%0] %1 {
+      instances = [{}]
+    } : !sair.value<d0:static_range<1024>, f32>
+    sair.map[d0:%0] %2(d0) attributes {
+      instances = [{}]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<1024>>, (f32) -> ()
+    sair.map[d0:%0] %3(d0) attributes {
+      instances = [{}]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<1024>>, (f32) -> ()
+    sair.exit
+  }
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<1024>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.copy[d0:%0] %1 {
+      instances = [{}]
+    } : !sair.value<d0:static_range<1024>, f32>
+    %3 = sair.copy[d0:%0] %1 {
+      instances = [{}]
+    } : !sair.value<d0:static_range<1024>, f32>
+    sair.map[d0:%0] %2(d0) attributes {
+      instances = [{}]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<1024>>, (f32) -> ()
+    sair.map[d0:%0] %3(d0) attributes {
+      instances = [{}]
+    } {
+    ^bb0(%arg1: index, %arg2: f32):
+      sair.return
+    } : #sair.shape<d0:static_range<1024>>, (f32) -> ()
+    sair.exit
+  }
+  func.return
+}
@@ -14,14 +14,21 @@
 
 #include "test/passes.h"
 
+#include <optional>
+
 #include "mlir/IR/Builders.h"
 #include "sair_attributes.h"
 #include "sair_dialect.h"
+#include "sair_op_interfaces.h"
+#include "sair_ops.h"
+#include "scheduler.h"
+#include "scratch_mapping.h"
 
 namespace sair {
 
 #define GEN_PASS_DEF_TESTDOMAINSHAPEPASS
 #define GEN_PASS_DEF_TESTMAPPINGEXPRSPASS
+#define GEN_PASS_DEF_TESTSCHEDULERPASS
 #include "test/passes.h.inc"
 
 // Retrieves the attribute `name` from `op` and converts it into a vector of
@@ -53,6 +60,13 @@ mlir::ArrayAttr GetArrayAttr(llvm::SmallVectorImpl<T> &attributes,
 class TestMappingExprsPass
     : public impl::TestMappingExprsPassBase<TestMappingExprsPass> {
  public:
+  // Wraps `expr` in a one-dimensional mapping. Defaults the use domain size to
+  // the minimal domain size of `expr`.
+  MappingAttr GetMapping(MappingExpr expr, int domain_size = -1) {
+    if (domain_size == -1) domain_size = expr.MinDomainSize();
+    return MappingAttr::get(&getContext(), domain_size, {expr});
+  }
+
   mlir::Attribute DispatchTest(llvm::StringRef op_name, MappingExpr expr,
                                mlir::Operation *op) {
     mlir::Builder builder(&getContext());
@@ -100,6 +114,21 @@ class TestMappingExprsPass
       return mlir::AffineMapAttr::get(map);
     } else if (op_name == "canonicalize") {
       return expr.Canonicalize();
+    } else if (op_name == "scratch_canonicalize") {
+      return ScratchMapping(GetMapping(expr))
+          .Canonicalize()
+          .ToAttr(&getContext());
+    } else if (op_name == "scratch_inverse") {
+      return ScratchMapping(GetMapping(expr)).Inverse().ToAttr(&getContext());
+    } else if (op_name == "scratch_unify") {
+      auto other = op->getAttrOfType<MappingExpr>("other");
+      assert(other != nullptr);
+      int domain_size = std::max(expr.MinDomainSize(), other.MinDomainSize());
+      std::optional<ScratchMapping> result =
+          ScratchMapping(GetMapping(expr, domain_size))
+              .Unify(ScratchMapping(GetMapping(other, domain_size)));
+      if (!result.has_value()) return nullptr;
+      return result->ToAttr(&getContext());
     }
     llvm_unreachable("unknown test name");
   }
@@ -176,4 +205,44 @@ CreateTestDomainShapePass() {
   return std::make_unique<TestDomainShapePass>();
 }
 
+// Walks Sair programs and applies the edits specified by test attributes with
+// a Scheduler. Rejected edits emit errors but do not make the pass fail.
+class TestSchedulerPass
+    : public impl::TestSchedulerPassBase<TestSchedulerPass> {
+ public:
+  void runOnOperation() override {
+    getOperation().walk([&](SairProgramOp program) {
+      std::optional<Scheduler> scheduler = Scheduler::Create(program);
+      if (!scheduler.has_value()) {
+        signalPassFailure();
+        return;
+      }
+      program.walk([&](ComputeOp op) {
+        ComputeOpInstance instance(op, 0);
+        mlir::Operation *operation = op.getOperation();
+        if (auto sequence = operation->removeAttr("test.sequence")) {
+          (void)scheduler->SetSequence(instance,
+                                       sequence.cast<mlir::IntegerAttr>());
+        }
+        if (auto loop_nest = operation->removeAttr("test.loop_nest")) {
+          (void)scheduler->SetLoopNest(instance,
+                                       loop_nest.cast<mlir::ArrayAttr>());
+        }
+        if (auto storage = operation->removeAttr("test.storage")) {
+          (void)scheduler->SetStorage(instance,
+                                      storage.cast<mlir::ArrayAttr>());
+        }
+      });
+      if (program->removeAttr("test.undo") != nullptr) {
+        while (scheduler->Undo()) continue;
+      }
+    });
+  }
+};
+
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
+CreateTestSchedulerPass() {
+  return std::make_unique<TestSchedulerPass>();
+}
+
 }  // namespace sair
@@ -28,6 +28,10 @@ CreateTestMappingExprsPass();
 std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
 CreateTestDomainShapePass();
 
+// Returns a pass that tests the Scheduler class.
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
+CreateTestSchedulerPass();
+
 }  // namespace sair
 
 #endif  // SAIR_TEST_PASSES_H_
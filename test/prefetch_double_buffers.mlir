@@ -0,0 +1,85 @@
+// RUN: sair-opt %s -sair-prefetch-double-buffers | FileCheck %s
+
+// CHECK-LABEL: @tiles
+// CHECK: %[[ARG0:.*]]: memref<?xf32> {llvm.noalias}, %[[ARG1:.*]]: memref<?xf32> {llvm.noalias}
+func.func @tiles(%arg0: memref<?xf32> {llvm.noalias},
+                 %arg1: memref<?xf32> {llvm.noalias}, %arg2: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c4 = arith.constant 4 : index
+  // CHECK: %[[A:.*]] = memref.alloc() : memref<4xf32>
+  // CHECK: %[[B:.*]] = memref.alloc() : memref<4xf32>
+  %a = memref.alloc() : memref<4xf32>
+  %b = memref.alloc() : memref<4xf32>
+  // The tile of the first iteration is loaded before the loop.
+  // CHECK: %[[NON_EMPTY:.*]] = arith.cmpi slt, %{{.*}}, %[[UB:.*]] : index
+  // CHECK: scf.if %[[NON_EMPTY]] {
+  // CHECK:   scf.for
+  // CHECK:     memref.load %[[ARG0]]
+  // CHECK:     memref.store %{{.*}}, %[[A]]
+  // CHECK: }
+  // CHECK: scf.for %[[I:.*]] = %{{.*}} to %[[UB]] step %[[STEP:[^ ]*]]
+  // CHECK-SAME: iter_args(%[[CUR:.*]] = %[[A]], %[[NEXT:.*]] = %[[B]])
+  %0:2 = scf.for %i = %c0 to %arg2 step %c4
+      iter_args(%cur = %a, %next = %b) -> (memref<4xf32>, memref<4xf32>) {
+    // The tile of the next iteration is loaded into the other buffer before
+    // computing on the tile of the current iteration.
+    // CHECK: %[[NEXT_I:.*]] = arith.addi %[[I]], %[[STEP]] : index
+    // CHECK: %[[HAS_NEXT:.*]] = arith.cmpi slt, %[[NEXT_I]], %[[UB]] : index
+    // CHECK: scf.if %[[HAS_NEXT]] {
+    // CHECK:   scf.for
+    // CHECK:     arith.addi %[[NEXT_I]]
+    // CHECK:     memref.load %[[ARG0]]
+    // CHECK:     memref.store %{{.*}}, %[[NEXT]]
+    // CHECK: }
+    scf.for %j = %c0 to %c4 step %c1 {
+      %1 = arith.addi %i, %j : index
+      %2 = memref.load %arg0[%1] : memref<?xf32>
+      memref.store %2, %cur[%j] : memref<4xf32>
+    }
+    // CHECK-NOT: memref.store %{{.*}}, %[[CUR]]
+    // CHECK: scf.for
+    // CHECK:   memref.load %[[CUR]]
+    // CHECK:   memref.store %{{.*}}, %[[ARG1]]
+    // CHECK: scf.yield %[[NEXT]], %[[CUR]]
+    scf.for %j = %c0 to %c4 step %c1 {
+      %1 = arith.addi %i, %j : index
+      %2 = memref.load %cur[%j] : memref<4xf32>
+      %3 = arith.addf %2, %2 : f32
+      memref.store %3, %arg1[%1] : memref<?xf32>
+    }
+    scf.yield %next, %cur : memref<4xf32>, memref<4xf32>
+  }
+  memref.dealloc %a : memref<4xf32>
+  memref.dealloc %b : memref<4xf32>
+  func.return
+}
+
+// CHECK-LABEL: @in_place
+func.func @in_place(%arg0: memref<?xf32>, %arg1: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c4 = arith.constant 4 : index
+  %a = memref.alloc() : memref<4xf32>
+  %b = memref.alloc() : memref<4xf32>
+  // The loop writes the memref tiles are loaded from, so tiles cannot be
+  // loaded ahead.
+  // CHECK-NOT: scf.if
+  %0:2 = scf.for %i = %c0 to %arg1 step %c4
+      iter_args(%cur = %a, %next = %b) -> (memref<4xf32>, memref<4xf32>) {
+    scf.for %j = %c0 to %c4 step %c1 {
+      %1 = arith.addi %i, %j : index
+      %2 = memref.load %arg0[%1] : memref<?xf32>
+      memref.store %2, %cur[%j] : memref<4xf32>
+    }
+    scf.for %j = %c0 to %c4 step %c1 {
+      %1 = arith.addi %i, %j : index
+      %2 = memref.load %cur[%j] : memref<4xf32>
+      memref.store %2, %arg0[%1] : memref<?xf32>
+    }
+    scf.yield %next, %cur : memref<4xf32>, memref<4xf32>
+  }
+  memref.dealloc %a : memref<4xf32>
+  memref.dealloc %b : memref<4xf32>
+  func.return
+}
@@ -0,0 +1,88 @@
+// RUN: sair-opt %s -sair-introduce-loops='profile-loops' | FileCheck %s
+
+func.func @foo(%arg0: index, %arg1: index) { return }
+
+// CHECK-LABEL: @sequential
+func.func @sequential(%arg0: index) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 { instances = [{}] } : !sair.value<(), index>
+    %1 = sair.dyn_range %0 { instances = [{}] } : !sair.dyn_range
+    %2 = sair.static_range { instances = [{}] } : !sair.static_range<8, 2>
+    sair.map[d0: %1, d1: %2] attributes {
+      instances = [{
+        loop_nest = [
+          {name = "A", iter = #sair.mapping_expr<d1>},
+          {name = "B", iter = #sair.mapping_expr<d0>}
+        ]
+      }]
+    } {
+      // CHECK: ^{{.*}}(%[[ARG1:.*]]: index):
+      ^bb0(%arg1: index, %arg2: index):
+        // CHECK: %[[START_A:.*]] = sair.loop_profile_begin
+        // CHECK: scf.for
+        // CHECK:   %[[START_B:.*]] = sair.loop_profile_begin
+        // CHECK:   scf.for %{{.*}} = %{{.*}} to %[[ARG1]]
+        // CHECK:     call @foo
+                      func.call @foo(%arg1, %arg2) : (index, index) -> ()
+        // CHECK:   }
+        // CHECK:   sair.loop_profile_end "B" %[[START_B]], %{{.*}}
+        // CHECK: }
+        // CHECK: sair.loop_profile_end "A" %[[START_A]], %{{.*}}
+        // CHECK: sair.return
+        sair.return
+    } : #sair.shape<d0:dyn_range x d1:static_range<8, 2>>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @trip_count
+func.func @trip_count() {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8, 3>
+    sair.map[d0: %0] attributes {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+      }]
+    } {
+      ^bb0(%arg0: index):
+        // CHECK-DAG: %[[LB:.*]] = arith.constant 0 : index
+        // CHECK-DAG: %[[UB:.*]] = arith.constant 8 : index
+        // CHECK-DAG: %[[C2:.*]] = arith.constant 2 : index
+        // CHECK-DAG: %[[C3:.*]] = arith.constant 3 : index
+        // CHECK-DAG: %[[C0:.*]] = arith.constant 0 : index
+        // CHECK: %[[SIZE:.*]] = arith.subi %[[UB]], %[[LB]]
+        // CHECK: %[[ROUNDED:.*]] = arith.addi %[[SIZE]], %[[C2]]
+        // CHECK: %[[DIV:.*]] = arith.divsi %[[ROUNDED]], %[[C3]]
+        // CHECK: %[[TRIPS:.*]] = arith.maxsi %[[DIV]], %[[C0]]
+        // CHECK: %[[START:.*]] = sair.loop_profile_begin
+        // CHECK: scf.for
+        // CHECK: sair.loop_profile_end "A" %[[START]], %[[TRIPS]]
+        sair.return
+    } : #sair.shape<d0:static_range<8, 3>>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
+
+// CHECK-LABEL: @gpu
+func.func @gpu() {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    sair.map[d0: %0] attributes {
+      instances = [{
+        loop_nest = [{
+          name = "A", iter = #sair.mapping_expr<d0>, gpu = "block_x"
+        }]
+      }]
+    } {
+      ^bb0(%arg0: index):
+        // CHECK-NOT: sair.loop_profile_begin
+        // CHECK: scf.parallel
+        // CHECK-NOT: sair.loop_profile_end
+        sair.return
+    } : #sair.shape<d0:static_range<8>>, () -> ()
+    sair.exit { instances = [{}] }
+  }
+  func.return
+}
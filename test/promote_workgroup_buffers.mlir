@@ -0,0 +1,40 @@
+// RUN: sair-opt %s -sair-promote-workgroup-buffers -split-input-file -verify-diagnostics | FileCheck %s
+
+// CHECK-LABEL: @promote
+func.func @promote(%arg0: f32) {
+  %c1 = arith.constant 1 : index
+  %c8 = arith.constant 8 : index
+  // CHECK-NOT: memref.alloc
+  %0 = memref.alloc() : memref<8xf32, #gpu.address_space<workgroup>>
+  // CHECK: gpu.launch
+  // CHECK-SAME: workgroup(%[[V0:.*]] : memref<8xf32, #gpu.address_space<workgroup>>)
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %c1, %gy = %c1, %gz = %c1)
+             threads(%tx, %ty, %tz) in (%sx = %c8, %sy = %c1, %sz = %c1) {
+    // CHECK: memref.store %{{.*}}, %[[V0]][%{{.*}}]
+    memref.store %arg0, %0[%tx] : memref<8xf32, #gpu.address_space<workgroup>>
+    gpu.terminator
+  }
+  // CHECK-NOT: memref.dealloc
+  memref.dealloc %0 : memref<8xf32, #gpu.address_space<workgroup>>
+  func.return
+}
+
+// -----
+
+func.func @host_access(%arg0: f32) {
+  %c0 = arith.constant 0 : index
+  // expected-error @+1 {{GPU shared memory buffers must only be accessed from a single GPU kernel}}
+  %0 = memref.alloc() : memref<8xf32, #gpu.address_space<workgroup>>
+  memref.store %arg0, %0[%c0] : memref<8xf32, #gpu.address_space<workgroup>>
+  memref.dealloc %0 : memref<8xf32, #gpu.address_space<workgroup>>
+  func.return
+}
+
+// -----
+
+func.func @dynamic_shape(%arg0: index) {
+  // expected-error @+1 {{GPU shared memory buffers must have a static shape}}
+  %0 = memref.alloc(%arg0) : memref<?xf32, #gpu.address_space<workgroup>>
+  memref.dealloc %0 : memref<?xf32, #gpu.address_space<workgroup>>
+  func.return
+}
@@ -0,0 +1,81 @@
+// RUN: sair-opt %s -sair-replace-sliding-windows | FileCheck %s
+
+// CHECK-LABEL: @three_points
+// CHECK: %[[ARG0:.*]]: memref<?xf32> {llvm.noalias}
+func.func @three_points(%arg0: memref<?xf32> {llvm.noalias},
+                        %arg1: memref<?xf32> {llvm.noalias}, %arg2: index) {
+  %c1 = arith.constant 1 : index
+  // The first two elements of the window are loaded before the loop.
+  // CHECK: %[[NON_EMPTY:.*]] = arith.cmpi slt
+  // CHECK: %[[INIT:.*]]:2 = scf.if %[[NON_EMPTY]] -> (f32, f32) {
+  // CHECK:   %[[V0:.*]] = memref.load %[[ARG0]]
+  // CHECK:   %[[V1:.*]] = memref.load %[[ARG0]]
+  // CHECK:   scf.yield %[[V0]], %[[V1]] : f32, f32
+  // CHECK: } else {
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}}
+  // CHECK-SAME: iter_args(%[[W0:.*]] = %[[INIT]]#0, %[[W1:.*]] = %[[INIT]]#1)
+  scf.for %i = %c1 to %arg2 step %c1 {
+    // Only the last element of the window is loaded in the loop.
+    // CHECK: %[[W2:.*]] = memref.load %[[ARG0]]
+    // CHECK-NOT: memref.load
+    // CHECK: arith.addf %[[W0]], %[[W1]]
+    // CHECK: arith.addf %{{.*}}, %[[W2]]
+    // CHECK: scf.yield %[[W1]], %[[W2]] : f32, f32
+    %0 = affine.apply affine_map<(d0) -> (d0 - 1)>(%i)
+    %1 = affine.apply affine_map<(d0) -> (d0 + 1)>(%i)
+    %2 = memref.load %arg0[%0] : memref<?xf32>
+    %3 = memref.load %arg0[%i] : memref<?xf32>
+    %4 = memref.load %arg0[%1] : memref<?xf32>
+    %5 = arith.addf %2, %3 : f32
+    %6 = arith.addf %5, %4 : f32
+    memref.store %6, %arg1[%i] : memref<?xf32>
+  }
+  func.return
+}
+
+// CHECK-LABEL: @rows
+func.func @rows(%arg0: memref<?x?xf32>, %arg1: index, %arg2: index) {
+  %c0 = arith.constant 0 : index
+  %c2 = arith.constant 2 : index
+  %alloc = memref.alloc(%arg1, %arg2) : memref<?x?xf32>
+  // Each row forms its own window. Windows slide by 2 elements, as the step
+  // of the loop, so elements at offset 2 are reused.
+  // CHECK: scf.if %{{.*}} -> (f32, f32)
+  // CHECK: scf.for %{{.*}} iter_args(%[[A:.*]] = %{{.*}}, %[[B:.*]] = %{{.*}})
+  // CHECK-COUNT-2: memref.load
+  // CHECK-NOT: memref.load
+  // CHECK: scf.yield
+  scf.for %j = %c0 to %arg2 step %c2 {
+    %0 = affine.apply affine_map<(d0) -> (d0 + 2)>(%j)
+    %1 = memref.load %arg0[%arg1, %j] : memref<?x?xf32>
+    %2 = memref.load %arg0[%arg1, %0] : memref<?x?xf32>
+    %3 = arith.addi %arg1, %c2 : index
+    %4 = memref.load %arg0[%3, %j] : memref<?x?xf32>
+    %5 = memref.load %arg0[%3, %0] : memref<?x?xf32>
+    %6 = arith.addf %1, %2 : f32
+    %7 = arith.addf %4, %5 : f32
+    %8 = arith.addf %6, %7 : f32
+    memref.store %8, %alloc[%arg1, %j] : memref<?x?xf32>
+  }
+  memref.dealloc %alloc : memref<?x?xf32>
+  func.return
+}
+
+// CHECK-LABEL: @may_alias
+func.func @may_alias(%arg0: memref<?xf32>, %arg1: memref<?xf32>,
+                     %arg2: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  // Loads of a memref that the loop may write to are left untouched.
+  // CHECK-NOT: scf.if
+  // CHECK: scf.for
+  // CHECK-COUNT-2: memref.load
+  scf.for %i = %c0 to %arg2 step %c1 {
+    %0 = affine.apply affine_map<(d0) -> (d0 + 1)>(%i)
+    %1 = memref.load %arg0[%i] : memref<?xf32>
+    %2 = memref.load %arg0[%0] : memref<?xf32>
+    %3 = arith.addf %1, %2 : f32
+    memref.store %3, %arg1[%i] : memref<?xf32>
+  }
+  func.return
+}
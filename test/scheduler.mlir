@@ -0,0 +1,128 @@
+// RUN: sair-opt %s -test-scheduler -split-input-file -verify-diagnostics | FileCheck %s
+
+// CHECK-LABEL: @set_loop_nest
+func.func @set_loop_nest(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // CHECK: sair.copy[d0:%{{.*}}] %{{.*}} {
+    // CHECK-SAME: loop_nest = [{iter = #sair.mapping_expr<d0>, name = "A"}]
+    sair.copy[d0: %0] %1 {
+      instances = [{}],
+      test.loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+// CHECK-LABEL: @rejected_loop_nest
+func.func @rejected_loop_nest(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    sair.copy[d0: %0] %1 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        sequence = 0
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.copy %1 {
+      instances = [{sequence = 1}]
+    } : !sair.value<(), f32>
+    // The edit is rolled back.
+    // CHECK: sair.copy[d0:%{{.*}}] %{{.*}} {instances = [{sequence = 2
+    // expected-error @+1 {{occurrences of loop "A" must be contiguous}}
+    sair.copy[d0: %0] %1 {
+      instances = [{sequence = 2}],
+      test.loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+// CHECK-LABEL: @set_sequence
+func.func @set_sequence(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    sair.copy[d0: %0] %1 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        sequence = 0
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    // Moving this operation after the last one makes loop "A" contiguous.
+    // CHECK: sair.copy %{{.*}} {instances = [{sequence = 3
+    sair.copy %1 {
+      instances = [{sequence = 1}],
+      test.sequence = 3
+    } : !sair.value<(), f32>
+    // CHECK: sair.copy[d0:%{{.*}}] %{{.*}} {
+    // CHECK-SAME: loop_nest = [{iter = #sair.mapping_expr<d0>, name = "A"}]
+    sair.copy[d0: %0] %1 {
+      instances = [{sequence = 2}],
+      test.loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+    } : !sair.value<d0:static_range<8>, f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+// CHECK-LABEL: @undo
+func.func @undo(%arg0: f32) {
+  sair.program attributes {test.undo} {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // CHECK: sair.copy[d0:%{{.*}}] %{{.*}} {instances = [{}]}
+    sair.copy[d0: %0] %1 {
+      instances = [{}],
+      test.loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}]
+    } : !sair.value<d0:static_range<8>, f32>
+    // CHECK: sair.copy %{{.*}} {instances = [{sequence = 1
+    sair.copy %1 {
+      instances = [{sequence = 1}],
+      test.sequence = 2
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+// CHECK-LABEL: @split_loop
+func.func @split_loop(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    sair.copy[d0: %0] %1 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        sequence = 0
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    // expected-error @+1 {{occurrences of loop "A" must be contiguous}}
+    sair.copy[d0: %0] %1 {
+      instances = [{
+        loop_nest = [{name = "A", iter = #sair.mapping_expr<d0>}],
+        sequence = 2
+      }]
+    } : !sair.value<d0:static_range<8>, f32>
+    // The edit would move the operation inside loop "A" and is rolled back.
+    // CHECK: sair.copy %{{.*}} {instances = [{sequence = 3
+    sair.copy %1 {
+      instances = [{sequence = 3}],
+      test.sequence = 1
+    } : !sair.value<(), f32>
+    sair.exit
+  }
+  func.return
+}
@@ -0,0 +1,83 @@
+// RUN: sair-opt %s -sair-split-reductions | FileCheck %s
+
+// CHECK-LABEL: @split_static
+func.func @split_static(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    // CHECK: %[[INPUT:.*]] = sair.copy
+    %2 = sair.copy[d0:%0] %1 : !sair.value<d0:static_range<8>, f32>
+    // CHECK: %[[CHUNKS:.*]] = sair.static_range : !sair.static_range<8, 4>
+    // CHECK: %[[BOUNDS:.*]]:2 = sair.map[d0:%[[CHUNKS]]] {
+    // CHECK: ^{{.*}}(%[[BEGIN:.*]]: index):
+    // CHECK:   %[[UB:.*]] = arith.constant 8 : index
+    // CHECK:   %[[SIZE:.*]] = arith.constant 4 : index
+    // CHECK:   %[[END:.*]] = arith.addi %[[BEGIN]], %[[SIZE]] : index
+    // CHECK:   %[[MIN:.*]] = arith.minsi %[[END]], %[[UB]] : index
+    // CHECK:   sair.return %[[BEGIN]], %[[MIN]] : index, index
+    // CHECK: } : #sair.shape<d0:static_range<8, 4>>, () -> (index, index)
+    // CHECK: %[[INNER:.*]] = sair.dyn_range[d0:%[[CHUNKS]]] %[[BOUNDS]]#0(d0), %[[BOUNDS]]#1(d0)
+    // CHECK-SAME: : !sair.dyn_range<d0:static_range<8, 4>>
+    // CHECK: %[[IDENTITY:.*]] = sair.map[d0:%[[CHUNKS]]] {
+    // CHECK:   %[[ZERO:.*]] = arith.constant -0.000000e+00 : f32
+    // CHECK:   sair.return %[[ZERO]] : f32
+    // CHECK: } : #sair.shape<d0:static_range<8, 4>>, () -> f32
+    // CHECK: %[[PARTIAL:.*]] = sair.map_reduce[d0:%[[CHUNKS]]] %[[IDENTITY]](d0)
+    // CHECK-SAME: reduce[d1:%[[INNER]]] %[[INPUT]](unstripe(d0, d1, [4, 1])) {
+    // CHECK: ^{{.*}}(%{{.*}}: index, %{{.*}}: index, %{{.*}}: f32, %{{.*}}: f32):
+    // CHECK:   arith.addf
+    // CHECK: } : #sair.shape<d0:static_range<8, 4> x d1:dyn_range(d0)>, (f32) -> f32
+    // CHECK: sair.map_reduce %{{.*}} reduce[d0:%[[CHUNKS]]] %[[PARTIAL]](d0) {
+    // CHECK: ^{{.*}}(%{{.*}}: index, %[[ACC:.*]]: f32, %[[VALUE:.*]]: f32):
+    // CHECK:   %[[SUM:.*]] = arith.addf %[[ACC]], %[[VALUE]] : f32
+    // CHECK:   sair.return %[[SUM]] : f32
+    // CHECK: } : #sair.shape<d0:static_range<8, 4>>, (f32) -> f32
+    // CHECK-NOT: split_factor
+    %3 = sair.map_reduce %1 reduce[d0:%0] %2(d0) attributes {split_factor = 4} {
+      ^bb0(%arg1: index, %arg2: f32, %arg3: f32):
+        %4 = arith.addf %arg2, %arg3 : f32
+        sair.return %4 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
+    sair.exit
+  }
+  func.return
+}
+
+// CHECK-LABEL: @split_dynamic
+func.func @split_dynamic(%arg0: index, %arg1: i32) {
+  sair.program {
+    %0 = sair.from_scalar %arg0 : !sair.value<(), index>
+    // CHECK: sair.dyn_range %[[N:.*]] : !sair.dyn_range
+    %1 = sair.dyn_range %0 : !sair.dyn_range
+    %2 = sair.static_range : !sair.static_range<4>
+    %3 = sair.from_scalar %arg1 : !sair.value<(), i32>
+    %4 = sair.copy[d0:%2, d1:%1] %3
+      : !sair.value<d0:static_range<4> x d1:dyn_range, i32>
+    %5 = sair.copy[d0:%2] %3 : !sair.value<d0:static_range<4>, i32>
+    // CHECK: %[[CHUNKS:.*]] = sair.dyn_range %[[N]] step 16 : !sair.dyn_range
+    // CHECK: %[[BOUNDS:.*]]:2 = sair.map[d0:%[[CHUNKS]]] %[[N]] {
+    // CHECK: ^{{.*}}(%[[BEGIN:.*]]: index, %[[UB:.*]]: index):
+    // CHECK:   arith.minsi %{{.*}}, %[[UB]] : index
+    // CHECK: %[[INNER:.*]] = sair.dyn_range[d0:%[[CHUNKS]]] %[[BOUNDS]]#0(d0), %[[BOUNDS]]#1(d0)
+    // CHECK-SAME: : !sair.dyn_range<d0:dyn_range>
+    // CHECK: %[[IDENTITY:.*]] = sair.map[d0:%{{.*}}, d1:%[[CHUNKS]]] {
+    // CHECK:   arith.constant -2147483648 : i32
+    // CHECK: %[[PARTIAL:.*]] = sair.map_reduce[d0:%{{.*}}, d1:%[[CHUNKS]]] %[[IDENTITY]](d0, d1)
+    // CHECK-SAME: reduce[d2:%[[INNER]]] %{{.*}}(d0, unstripe(d1, d2, [16, 1]))
+    // CHECK: ^{{.*}}(%{{.*}}: index, %{{.*}}: index, %{{.*}}: index, %{{.*}}: i32, %{{.*}}: i32):
+    // CHECK: } : #sair.shape<d0:static_range<4> x d1:dyn_range x d2:dyn_range(d1)>, (i32) -> i32
+    // CHECK: sair.map_reduce[d0:%{{.*}}] %{{.*}}(d0) reduce[d1:%[[CHUNKS]]] %[[PARTIAL]](d0, d1) {
+    // CHECK: ^{{.*}}(%{{.*}}: index, %{{.*}}: index, %[[ACC:.*]]: i32, %[[VALUE:.*]]: i32):
+    // CHECK:   arith.maxsi %[[VALUE]], %[[ACC]] : i32
+    // CHECK: } : #sair.shape<d0:static_range<4> x d1:dyn_range>, (i32) -> i32
+    %6 = sair.map_reduce[d0:%2] %5(d0) reduce[d1:%1] %4(d0, d1) attributes {
+      split_factor = 16
+    } {
+      ^bb0(%arg2: index, %arg3: index, %arg4: i32, %arg5: i32):
+        %7 = arith.maxsi %arg5, %arg4 : i32
+        sair.return %7 : i32
+    } : #sair.shape<d0:static_range<4> x d1:dyn_range>, (i32) -> i32
+    sair.exit
+  }
+  func.return
+}
@@ -0,0 +1,57 @@
+// RUN: sair-opt -sair-split-reductions -split-input-file -verify-diagnostics %s
+
+func.func @decisions_already_set(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range { instances = [{}] } : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.copy[d0:%0] %1 { instances = [{}] }
+      : !sair.value<d0:static_range<8>, f32>
+    // expected-error @+1 {{reductions must be split before lowering decisions are set}}
+    %3 = sair.map_reduce %1 reduce[d0:%0] %2(d0) attributes {
+      split_factor = 4,
+      instances = [{}]
+    } {
+      ^bb0(%arg1: index, %arg2: f32, %arg3: f32):
+        %4 = arith.addf %arg2, %arg3 : f32
+        sair.return %4 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @non_unit_step(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8, 2>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.copy[d0:%0] %1 : !sair.value<d0:static_range<8, 2>, f32>
+    // expected-error @+1 {{can only split a reduction dimension defined by a range with unit step and without dependencies}}
+    %3 = sair.map_reduce %1 reduce[d0:%0] %2(d0) attributes {split_factor = 2} {
+      ^bb0(%arg1: index, %arg2: f32, %arg3: f32):
+        %4 = arith.addf %arg2, %arg3 : f32
+        sair.return %4 : f32
+    } : #sair.shape<d0:static_range<8, 2>>, (f32) -> f32
+    sair.exit
+  }
+  func.return
+}
+
+// -----
+
+func.func @unsupported_combiner(%arg0: f32) {
+  sair.program {
+    %0 = sair.static_range : !sair.static_range<8>
+    %1 = sair.from_scalar %arg0 : !sair.value<(), f32>
+    %2 = sair.copy[d0:%0] %1 : !sair.value<d0:static_range<8>, f32>
+    // expected-error @+1 {{result 0 is not reduced by a supported associative operation}}
+    %3 = sair.map_reduce %1 reduce[d0:%0] %2(d0) attributes {split_factor = 4} {
+      ^bb0(%arg1: index, %arg2: f32, %arg3: f32):
+        %4 = arith.subf %arg2, %arg3 : f32
+        sair.return %4 : f32
+    } : #sair.shape<d0:static_range<8>>, (f32) -> f32
+    sair.exit
+  }
+  func.return
+}
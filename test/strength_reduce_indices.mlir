@@ -0,0 +1,66 @@
+// RUN: sair-opt %s -sair-strength-reduce-indices | FileCheck %s
+
+// CHECK-LABEL: @tiled_copy
+// CHECK: %[[ARG0:.*]]: memref<?xf32>, %[[ARG1:.*]]: memref<?xf32>
+func.func @tiled_copy(%arg0: memref<?xf32>, %arg1: memref<?xf32>,
+                      %arg2: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c8 = arith.constant 8 : index
+  // The index at the start of the outer loop is incremented by 8.
+  // CHECK: %[[START:.*]] = affine.apply
+  // CHECK: %[[C8:.*]] = arith.constant 8 : index
+  // CHECK: %[[OUTER_STEP:.*]] = arith.muli %{{.*}}, %[[C8]] : index
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}}
+  // CHECK-SAME: iter_args(%[[I:.*]] = %[[START]]) -> (index) {
+  scf.for %i = %c0 to %arg2 step %c1 {
+    // The innermost index is incremented by 1.
+    // CHECK-NOT: affine.apply
+    // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[STEP:[^ ]*]]
+    // CHECK-SAME: iter_args(%[[J:.*]] = %[[I]]) -> (index) {
+    scf.for %j = %c0 to %c8 step %c1 {
+      // CHECK-NOT: affine.apply
+      // CHECK: %[[V:.*]] = memref.load %[[ARG0]][%[[J]]]
+      // CHECK: memref.store %[[V]], %[[ARG1]][%[[J]]]
+      // CHECK: %[[NEXT_J:.*]] = arith.addi %[[J]], %[[STEP]] : index
+      // CHECK: scf.yield %[[NEXT_J]] : index
+      %0 = affine.apply affine_map<(d0, d1) -> (d0 * 8 + d1)>(%i, %j)
+      %1 = memref.load %arg0[%0] : memref<?xf32>
+      memref.store %1, %arg1[%0] : memref<?xf32>
+    }
+    // CHECK: %[[NEXT_I:.*]] = arith.addi %[[I]], %[[OUTER_STEP]] : index
+    // CHECK: scf.yield %[[NEXT_I]] : index
+  }
+  func.return
+}
+
+// CHECK-LABEL: @non_affine
+func.func @non_affine(%arg0: memref<?xf32>, %arg1: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  // Indices that do not increase by a constant are left untouched.
+  // CHECK: scf.for %[[I:.*]] = %{{.*}} to %{{.*}} step %{{.*}} {
+  // CHECK:   affine.apply #{{.*}}(%[[I]])
+  scf.for %i = %c0 to %arg1 step %c1 {
+    %0 = affine.apply affine_map<(d0) -> (d0 mod 4 + d0 floordiv 4)>(%i)
+    %1 = memref.load %arg0[%0] : memref<?xf32>
+    memref.store %1, %arg0[%0] : memref<?xf32>
+  }
+  func.return
+}
+
+// CHECK-LABEL: @single_op
+func.func @single_op(%arg0: memref<?xf32>, %arg1: index, %arg2: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  // Indices computed with a single operation are not carried by the loop.
+  // CHECK: scf.for %[[I:.*]] = %{{.*}} to %{{.*}} step %{{.*}} {
+  // CHECK:   %[[INDEX:.*]] = arith.addi %{{.*}}, %[[I]] : index
+  // CHECK:   memref.load %{{.*}}[%[[INDEX]]]
+  scf.for %i = %c0 to %arg1 step %c1 {
+    %0 = arith.addi %arg2, %i : index
+    %1 = memref.load %arg0[%0] : memref<?xf32>
+    memref.store %1, %arg0[%0] : memref<?xf32>
+  }
+  func.return
+}
@@ -14,25 +14,43 @@
 
 #include "transforms/default_lowering_attributes.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iterator>
 #include <memory>
+#include <optional>
+#include <tuple>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/Threading.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/Pass/AnalysisManager.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
+#include "loop_nest.h"
 #include "sair_attributes.h"
 #include "sair_dialect.h"
 #include "sair_op_interfaces.h"
 #include "sair_ops.h"
 #include "sequence.h"
+#include "statistics_report.h"
 #include "storage.h"
+#include "util.h"
 
 namespace sair {
 namespace {
@@ -47,8 +65,47 @@ namespace {
 #define GEN_PASS_DEF_DEFAULTLOOPNESTPASS
 #define GEN_PASS_DEF_DEFAULTSEQUENCEPASS
 #define GEN_PASS_DEF_DEFAULTSTORAGEPASS
+#define GEN_PASS_DEF_FUSELOOPSPASS
+#define GEN_PASS_DEF_PACKOPERANDSPASS
 #include "transforms/default_lowering_attributes.h.inc"
 
+// Runs `function` on each Sair program nested in `root`. Programs are processed
+// in parallel when multithreading is enabled as passes of this file only modify
+// operations nested in the program they process. `function`
+// receives the analysis manager of the program. Returns a failure if
+// `function` fails on any program.
+static mlir::LogicalResult ForEachProgram(
+    mlir::Operation *root, mlir::AnalysisManager analysis_manager,
+    llvm::function_ref<mlir::LogicalResult(SairProgramOp,
+                                           mlir::AnalysisManager)>
+        function) {
+  struct ProgramWork {
+    int order;
+    SairProgramOp program;
+    mlir::AnalysisManager analysis_manager;
+  };
+  // Nesting analysis managers is not thread-safe, so programs analysis managers
+  // are created before entering the parallel section.
+  llvm::SmallVector<ProgramWork> programs;
+  root->walk([&](SairProgramOp program) {
+    programs.push_back(
+        {static_cast<int>(programs.size()), program,
+         analysis_manager.nest(program)});
+  });
+
+  // Emit diagnostics in program order, independently of thread scheduling.
+  mlir::MLIRContext *context = root->getContext();
+  mlir::ParallelDiagnosticHandler diagnostic_handler(context);
+  return mlir::failableParallelForEach(
+      context, programs, [&](ProgramWork &work) {
+        diagnostic_handler.setOrderIDForThread(work.order);
+        mlir::LogicalResult result =
+            function(work.program, work.analysis_manager);
+        diagnostic_handler.eraseOrderIDForThread();
+        return result;
+      });
+}
+
 // Creates a blank instance for ComputeOp with no instances.
 class DefaultInstance : public impl::DefaultInstancePassBase<DefaultInstance> {
  public:
@@ -62,10 +119,12 @@ class DefaultInstance : public impl::DefaultInstancePassBase<DefaultInstance> {
 };
 
 // Writes the storage information infered by the storage analysis pass to
-// Compute operations.
+// Compute operations. Buffers in `register_buffers` are stored in registers
+// instead of the space computed by the analysis.
 mlir::LogicalResult CommitStorage(
     ComputeOpInstance &op, const IterationSpaceAnalysis &iteration_spaces,
-    const StorageAnalysis &storage_analysis) {
+    const StorageAnalysis &storage_analysis,
+    const llvm::DenseSet<mlir::Attribute> &register_buffers) {
   mlir::MLIRContext *context = op.context();
   const IterationSpace &iter_space = iteration_spaces.Get(op);
 
@@ -87,8 +146,29 @@ mlir::LogicalResult CommitStorage(
       layout = NamedMappingAttr::get(loop_names, renaming, context)
                    .Compose(storage.layout());
     }
-    auto attr = BufferAttr::get(storage.space(), storage.buffer_name(), layout,
-                                context);
+    // Padding, alignment, prefetching, double buffering and non-temporal
+    // stores are not inferred and only come from the existing storage
+    // attribute.
+    mlir::ArrayAttr padding;
+    mlir::IntegerAttr alignment;
+    PrefetchAttr prefetch;
+    mlir::StringAttr double_buffer;
+    mlir::UnitAttr nontemporal;
+    if (BufferAttr old_attr = op.Storage(i)) {
+      padding = old_attr.padding();
+      alignment = old_attr.alignment();
+      prefetch = old_attr.prefetch();
+      double_buffer = old_attr.double_buffer();
+      nontemporal = old_attr.nontemporal();
+    }
+    mlir::StringAttr space = storage.space();
+    if (register_buffers.contains(storage.buffer_name())) {
+      space = op.GetSairDialect()->register_attr();
+    }
+    auto attr =
+        BufferAttr::get(space, storage.buffer_name(), layout, padding,
+                        alignment, prefetch, double_buffer, nontemporal,
+                        context);
     op.SetStorage(i, attr);
   }
   return mlir::success();
@@ -223,11 +303,13 @@ void MakeLayoutFullySpecified(const ResultInstance &value,
                                 iteration_spaces);
 }
 
-// Assings a buffer name to the operand if it cannot fit in registers.
+// Assings a buffer name to the operand if it cannot fit in registers. Adds the
+// names of created buffers to `new_buffers`.
 static mlir::LogicalResult CreateBufferIfNeeded(
     const OperandInstance &operand, const LoopFusionAnalysis &fusion_analysis,
     const IterationSpaceAnalysis &iteration_spaces,
-    StorageAnalysis &storage_analysis) {
+    StorageAnalysis &storage_analysis,
+    llvm::SmallVectorImpl<mlir::StringAttr> &new_buffers) {
   auto value = operand.GetValue();
   if (!value.has_value()) return mlir::success();
   const ValueStorage &storage = storage_analysis.GetStorage(*value);
@@ -243,6 +325,7 @@ static mlir::LogicalResult CreateBufferIfNeeded(
   const IterationSpace iter_space = iteration_spaces.Get(operand.owner());
   storage_analysis.CreateBuffer(*value, iter_space.loop_names(),
                                 fusion_analysis, iteration_spaces);
+  new_buffers.push_back(storage_analysis.GetStorage(*value).buffer_name());
   return mlir::success();
 }
 
@@ -251,44 +334,58 @@ static mlir::LogicalResult CreateBufferIfNeeded(
 // the sub-domain of dimensions to materialize is a dependent domain.
 class DefaultStorage : public impl::DefaultStoragePassBase<DefaultStorage> {
  public:
+  DefaultStorage() = default;
+  explicit DefaultStorage(int64_t register_tile_limit) {
+    this->register_tile_limit = register_tile_limit;
+  }
+
   void runOnOperation() override {
-    auto result = getOperation().walk([&](SairProgramOp program) {
-      return program.TryWalkComputeOpInstances(
-          [](const ComputeOpInstance &op) -> mlir::WalkResult {
-            DecisionsAttr decisions = op.GetDecisions();
-            if (decisions.loop_nest() == nullptr) {
-              return op.EmitError() << "expected a loop-nest attribute";
-            }
-            return mlir::success();
-          });
-    });
-    if (result.wasInterrupted()) {
+    if (mlir::failed(ForEachProgram(
+            getOperation(), getAnalysisManager(),
+            [&](SairProgramOp program, mlir::AnalysisManager analysis_manager) {
+              return RunOnProgram(program, analysis_manager);
+            }))) {
       signalPassFailure();
       return;
     }
 
-    getOperation().walk([&](SairProgramOp program) -> mlir::WalkResult {
-      mlir::LogicalResult result = RunOnProgram(program);
-      if (mlir::failed(result)) signalPassFailure();
-      return result;
-    });
+    // Storage attributes do not influence the order of operations or loop
+    // nests.
+    markAnalysesPreserved<SequenceAnalysis, LoopFusionAnalysis,
+                          IterationSpaceAnalysis>();
   }
 
  private:
-  mlir::LogicalResult RunOnProgram(SairProgramOp program) {
-    auto &iteration_spaces = getChildAnalysis<IterationSpaceAnalysis>(program);
-    auto &fusion_analysis = getChildAnalysis<LoopFusionAnalysis>(program);
-    auto &storage_analysis = getChildAnalysis<StorageAnalysis>(program);
-    auto &sequence_analysis = getChildAnalysis<SequenceAnalysis>(program);
+  mlir::LogicalResult RunOnProgram(SairProgramOp program,
+                                   mlir::AnalysisManager analysis_manager) {
+    auto loop_nest_check = program.TryWalkComputeOpInstances(
+        [](const ComputeOpInstance &op) -> mlir::WalkResult {
+          DecisionsAttr decisions = op.GetDecisions();
+          if (decisions.loop_nest() == nullptr) {
+            return op.EmitError() << "expected a loop-nest attribute";
+          }
+          return mlir::success();
+        });
+    if (loop_nest_check.wasInterrupted()) return mlir::failure();
+
+    auto &iteration_spaces =
+        analysis_manager.getAnalysis<IterationSpaceAnalysis, SairProgramOp>();
+    auto &fusion_analysis =
+        analysis_manager.getAnalysis<LoopFusionAnalysis, SairProgramOp>();
+    auto &storage_analysis =
+        analysis_manager.getAnalysis<StorageAnalysis, SairProgramOp>();
+    auto &sequence_analysis =
+        analysis_manager.getAnalysis<SequenceAnalysis, SairProgramOp>();
 
     // Assign memory space and buffer names to values that won't fit in
     // register.
+    llvm::SmallVector<mlir::StringAttr> new_buffers;
     auto result = program.TryWalkOpInstances(
         [&](const OpInstance &op) -> mlir::WalkResult {
           for (OperandInstance operand : op.Operands()) {
-            if (mlir::failed(CreateBufferIfNeeded(operand, fusion_analysis,
-                                                  iteration_spaces,
-                                                  storage_analysis))) {
+            if (mlir::failed(CreateBufferIfNeeded(
+                    operand, fusion_analysis, iteration_spaces,
+                    storage_analysis, new_buffers))) {
               return mlir::failure();
             }
           }
@@ -340,10 +437,25 @@ class DefaultStorage : public impl::DefaultStoragePassBase<DefaultStorage> {
                 "errors for more information";
     }
 
+    // Keep small statically-shaped buffers indexed by fully unrolled loops in
+    // registers.
+    llvm::DenseSet<mlir::Attribute> register_buffers;
+    for (mlir::StringAttr name : new_buffers) {
+      const Buffer &buffer = storage_analysis.GetBuffer(name);
+      std::optional<int64_t> size = buffer.StaticSize();
+      if (!size.has_value() || *size > register_tile_limit) continue;
+      if (FindRolledLoopIndexing(buffer, fusion_analysis, iteration_spaces,
+                                 storage_analysis) != nullptr) {
+        continue;
+      }
+      register_buffers.insert(name);
+    }
+
     // Commit storage decisions.
     result = program.TryWalkComputeOpInstances([&](ComputeOpInstance &op)
                                                    -> mlir::WalkResult {
-      if (mlir::failed(CommitStorage(op, iteration_spaces, storage_analysis))) {
+      if (mlir::failed(CommitStorage(op, iteration_spaces, storage_analysis,
+                                     register_buffers))) {
         return mlir::failure();
       }
       return mlir::success();
@@ -375,47 +487,1035 @@ mlir::ArrayAttr GetDefaultLoopNest(int num_dimensions,
   for (MappingExpr expr :
        new_iter_exprs.Dimensions().drop_front(prefix.size())) {
     mlir::StringAttr name = fusion_analysis.GetFreshLoopName();
-    loop_nest.push_back(LoopAttr::get(name, expr, /*unroll=*/{}, context));
+    loop_nest.push_back(LoopAttr::get(name, expr, /*unroll=*/{},
+                                      /*parallel=*/{}, /*gpu=*/{},
+                                      /*accumulators=*/{}, /*peel=*/{},
+                                      context));
+  }
+
+  return mlir::ArrayAttr::get(context, loop_nest);
+}
+
+// Largest tile size considered by the cache-aware loop nest.
+constexpr int64_t kMaxTileSize = 1024;
+
+// A value accessed by an operation, with the mapping from the operation domain
+// to the value domain.
+struct TileAccess {
+  MappingAttr mapping;
+  int64_t element_size;
+};
+
+// Returns the size in bytes of an element of a Sair value of the given type.
+static int64_t ElementSize(mlir::Type type) {
+  mlir::Type element_type = type.cast<ValueType>().ElementType();
+  if (element_type.isIntOrFloat()) {
+    return llvm::divideCeil(element_type.getIntOrFloatBitWidth(), 8);
+  }
+  return 8;
+}
+
+// Returns the number of bytes touched by `accesses` when executing a block of
+// the iteration domain spanning `extents` iterations along each dimension.
+static int64_t Footprint(llvm::ArrayRef<TileAccess> accesses,
+                         llvm::ArrayRef<int64_t> extents) {
+  int64_t footprint = 0;
+  for (const TileAccess &access : accesses) {
+    int64_t size = access.element_size;
+    for (MappingExpr expr : access.mapping) {
+      for (int dim : expr.DependencyMask(extents.size()).set_bits()) {
+        size *= extents[dim];
+      }
+    }
+    footprint += size;
+  }
+  return footprint;
+}
+
+// Returns the largest power-of-two tile size such that a block of `tile_size`
+// iterations along each dimension of size `sizes` fits in `cache_size` bytes.
+// A negative size indicates a dimension of unknown size. Returns 0 if no tile
+// fits in the cache.
+static int64_t PickTileSize(llvm::ArrayRef<TileAccess> accesses,
+                            llvm::ArrayRef<int64_t> sizes,
+                            int64_t cache_size) {
+  int64_t best = 0;
+  llvm::SmallVector<int64_t> extents(sizes.size());
+  for (int64_t tile_size = 2; tile_size <= kMaxTileSize; tile_size *= 2) {
+    bool covers_domain = true;
+    for (int i = 0, e = sizes.size(); i < e; ++i) {
+      bool is_static = sizes[i] >= 0;
+      extents[i] = is_static ? std::min(tile_size, sizes[i]) : tile_size;
+      covers_domain &= is_static && tile_size >= sizes[i];
+    }
+    if (Footprint(accesses, extents) > cache_size) break;
+    best = tile_size;
+    // Larger tiles would not change the working set.
+    if (covers_domain) break;
+  }
+  return best;
+}
+
+// Generates a loop nest that tiles the domain of `op` so that the working set
+// of each tile fits in the caches of sizes `cache_sizes`, ordered from the
+// innermost cache level. Point loops are ordered so that the innermost loop
+// iterates along the last dimension of as many accessed bytes as possible.
+// Returns nullptr if the operation cannot be tiled, in which case the default
+// loop nest should be used.
+static mlir::ArrayAttr GetTiledLoopNest(const ComputeOpInstance &op,
+                                        llvm::ArrayRef<int64_t> cache_sizes,
+                                        LoopFusionAnalysis &fusion_analysis) {
+  mlir::MLIRContext *context = op.context();
+  int domain_size = op.domain_size();
+  if (domain_size == 0) return nullptr;
+
+  // Only tile independent dimensions with a unit step.
+  DomainShapeAttr shape = op.GetShape();
+  llvm::SmallVector<int64_t> sizes;
+  for (int i = 0; i < domain_size; ++i) {
+    const DomainShapeDim &dim = shape.Dimension(i);
+    if (dim.DependencyMask().any()) return nullptr;
+    mlir::Operation *dim_op = op.domain(i).defining_op().GetDuplicatedOp();
+    auto range = dyn_cast<RangeOp>(dim_op);
+    if (range == nullptr || range.Step() != 1) return nullptr;
+    auto static_range = dim.type().dyn_cast<StaticRangeType>();
+    sizes.push_back(static_range == nullptr ? -1 : static_range.size());
+  }
+
+  // Collect accessed values. Loop-carried values constrain the order of
+  // iterations so their users are left untiled.
+  llvm::SmallVector<TileAccess> accesses;
+  for (OperandInstance operand : op.Operands()) {
+    if (operand.CarryingDims().any()) return nullptr;
+    std::optional<ResultInstance> value = operand.GetValue();
+    if (!value.has_value()) continue;
+    accesses.push_back({operand.Mapping(), ElementSize(value->GetType())});
   }
+  for (ResultInstance result : op.Results()) {
+    if (!result.GetType().isa<ValueType>()) continue;
+    accesses.push_back({MappingAttr::GetIdentity(context, domain_size),
+                        ElementSize(result.GetType())});
+  }
+
+  // Pick one tile size per cache level, from the outermost level.
+  llvm::SmallVector<int64_t> tile_sizes;
+  for (int64_t cache_size : llvm::reverse(cache_sizes)) {
+    int64_t tile_size = PickTileSize(accesses, sizes, cache_size);
+    if (tile_size == 0) continue;
+    if (!tile_sizes.empty() && tile_size >= tile_sizes.back()) continue;
+    tile_sizes.push_back(tile_size);
+  }
+
+  // Dimensions whose last accessed dimension is contiguous in memory go last.
+  llvm::SmallVector<int64_t> contiguous_bytes(domain_size, 0);
+  for (const TileAccess &access : accesses) {
+    if (access.mapping.empty()) continue;
+    auto last_dim =
+        access.mapping.Dimensions().back().dyn_cast<MappingDimExpr>();
+    if (last_dim == nullptr) continue;
+    contiguous_bytes[last_dim.dimension()] += access.element_size;
+  }
+  llvm::SmallVector<int> order =
+      llvm::to_vector(llvm::seq<int>(0, domain_size));
+  llvm::stable_sort(order, [&](int lhs, int rhs) {
+    return contiguous_bytes[lhs] < contiguous_bytes[rhs];
+  });
+
+  // Stripe factors of each dimension. Tiles that span a whole dimension are
+  // not materialized.
+  llvm::SmallVector<llvm::SmallVector<int>> factors(domain_size);
+  bool is_tiled = false;
+  for (int i = 0; i < domain_size; ++i) {
+    for (int64_t tile_size : tile_sizes) {
+      if (sizes[i] >= 0 && tile_size >= sizes[i]) continue;
+      factors[i].push_back(tile_size);
+      is_tiled = true;
+    }
+  }
+  if (!is_tiled) return nullptr;
 
+  // Create one band of tile loops per level, followed by point loops.
+  llvm::SmallVector<mlir::Attribute> loop_nest;
+  auto add_loop = [&](MappingExpr iter) {
+    mlir::StringAttr name = fusion_analysis.GetFreshLoopName();
+    loop_nest.push_back(LoopAttr::get(name, iter, /*unroll=*/{},
+                                      /*parallel=*/{}, /*gpu=*/{},
+                                      /*accumulators=*/{}, /*peel=*/{},
+                                      context));
+  };
+  for (int64_t tile_size : tile_sizes) {
+    for (int i : order) {
+      auto *it = llvm::find(factors[i], tile_size);
+      if (it == factors[i].end()) continue;
+      llvm::ArrayRef<int> prefix(factors[i].begin(), std::next(it));
+      add_loop(MappingStripeExpr::get(MappingDimExpr::get(i, context), prefix));
+    }
+  }
+  for (int i : order) {
+    MappingExpr dim_expr = MappingDimExpr::get(i, context);
+    if (factors[i].empty()) {
+      add_loop(dim_expr);
+      continue;
+    }
+    llvm::SmallVector<int> point_factors = factors[i];
+    point_factors.push_back(1);
+    add_loop(MappingStripeExpr::get(dim_expr, point_factors));
+  }
   return mlir::ArrayAttr::get(context, loop_nest);
 }
 
 // Sets the `loop_nest` attribute to its default value. The default loop nest
 // iterates over each dimension of the domain, in order, without
-// rematerialization or strip-mining.
+// rematerialization or strip-mining. If cache sizes are provided, operations
+// are instead tiled so that their working set fits in each cache level.
 class DefaultLoopNest : public impl::DefaultLoopNestPassBase<DefaultLoopNest> {
  public:
+  DefaultLoopNest() = default;
+  explicit DefaultLoopNest(llvm::ArrayRef<int64_t> cache_sizes) {
+    this->cache_sizes = cache_sizes;
+  }
+
   void runOnOperation() override {
-    getOperation().walk([&](SairProgramOp program) {
-      auto &fusion_analysis = getChildAnalysis<LoopFusionAnalysis>(program);
-      program.WalkComputeOpInstances([&](ComputeOpInstance &op) {
-        DecisionsAttr decisions = op.GetDecisions();
-        if (decisions.loop_nest() != nullptr) return;
-        int num_dimensions = op.domain_size();
-        op.SetLoopNest(GetDefaultLoopNest(num_dimensions, {}, fusion_analysis));
+    llvm::SmallVector<int64_t> sizes = llvm::to_vector(cache_sizes);
+    AssertSuccess(ForEachProgram(
+        getOperation(), getAnalysisManager(),
+        [&](SairProgramOp program, mlir::AnalysisManager analysis_manager) {
+          auto &fusion_analysis =
+              analysis_manager.getAnalysis<LoopFusionAnalysis, SairProgramOp>();
+          program.WalkComputeOpInstances([&](ComputeOpInstance &op) {
+            DecisionsAttr decisions = op.GetDecisions();
+            if (decisions.loop_nest() != nullptr) return;
+            if (!sizes.empty()) {
+              if (mlir::ArrayAttr loop_nest =
+                      GetTiledLoopNest(op, sizes, fusion_analysis)) {
+                op.SetLoopNest(loop_nest);
+                return;
+              }
+            }
+            int num_dimensions = op.domain_size();
+            op.SetLoopNest(
+                GetDefaultLoopNest(num_dimensions, {}, fusion_analysis));
+          });
+          return mlir::success();
+        }));
+    markAnalysesPreserved<SequenceAnalysis>();
+  }
+};
+
+// Returns the loop nest of `consumer` where the outermost loops iterating along
+// the same points of the domain of `producer` as its outermost loops are
+// renamed after the loops of `producer`. The `mapping` maps the domain of
+// `consumer` to the domain of `producer`. Returns nullptr if no loop can be
+// fused.
+static mlir::ArrayAttr FuseLoopNests(const ComputeOpInstance &producer,
+                                     const ComputeOpInstance &consumer,
+                                     MappingAttr mapping) {
+  mlir::MLIRContext *context = consumer.context();
+  llvm::ArrayRef<mlir::Attribute> producer_loops = producer.Loops();
+  llvm::ArrayRef<mlir::Attribute> consumer_loops = consumer.Loops();
+  llvm::SmallVector<mlir::Attribute> loop_nest =
+      llvm::to_vector(consumer_loops);
+  int num_fused_loops = 0;
+  for (auto [producer_attr, consumer_attr] :
+       llvm::zip(producer_loops, consumer_loops)) {
+    auto producer_loop = producer_attr.cast<LoopAttr>();
+    auto consumer_loop = consumer_attr.cast<LoopAttr>();
+    if (producer_loop.name() == consumer_loop.name()) return nullptr;
+    MappingExpr iter = producer_loop.iter()
+                           .SubstituteDims(mapping.Dimensions())
+                           .Canonicalize();
+    if (iter != consumer_loop.iter().Canonicalize()) break;
+    loop_nest[num_fused_loops++] = LoopAttr::get(
+        producer_loop.name(), consumer_loop.iter(), producer_loop.unroll(),
+        producer_loop.parallel(), producer_loop.gpu(),
+        producer_loop.accumulators(), producer_loop.peel(), context);
+  }
+  if (num_fused_loops == 0) return nullptr;
+  return mlir::ArrayAttr::get(context, loop_nest);
+}
+
+// Indicates if loop nests and storages of `program` remain valid when compute
+// operations are sequenced as in `sequence_analysis`, which may differ from
+// their sequence attributes. Other lowering decisions do not depend on the
+// order of operations and are not checked. Does not report errors.
+static bool IsValidSequence(SairProgramOp program,
+                            const SequenceAnalysis &sequence_analysis,
+                            const IterationSpaceAnalysis &iteration_spaces) {
+  // Programs may be verified concurrently: only silence diagnostics emitted by
+  // the current thread.
+  mlir::ScopedDiagnosticHandler silence(
+      program.getContext(),
+      [thread_id = llvm::get_threadid()](mlir::Diagnostic &) {
+        return mlir::success(thread_id == llvm::get_threadid());
+      });
+  std::optional<LoopFusionAnalysis> fusion_analysis =
+      LoopFusionAnalysis::Create(program, sequence_analysis);
+  if (!fusion_analysis.has_value() ||
+      mlir::failed(VerifyLoopNests(program, *fusion_analysis,
+                                   iteration_spaces, sequence_analysis))) {
+    return false;
+  }
+  std::optional<StorageAnalysis> storage_analysis = StorageAnalysis::Create(
+      program, *fusion_analysis, iteration_spaces, sequence_analysis);
+  return storage_analysis.has_value() &&
+         mlir::succeeded(VerifyStorages(program, *storage_analysis,
+                                        *fusion_analysis, iteration_spaces,
+                                        sequence_analysis));
+}
+
+// Indicates if fusing the outermost loops of `consumer` with the loops of
+// `producer` keeps loop nests valid. Only checks the fusion classes of the
+// program, the operations sequenced between `producer` and `consumer`, and
+// the dependencies from and to `consumer`, which are the only constraints
+// changed by renaming the loops of `consumer`. Does not report errors.
+static bool IsValidFusion(SairProgramOp program,
+                          const ComputeOpInstance &producer,
+                          const ComputeOpInstance &consumer,
+                          const SequenceAnalysis &sequence_analysis) {
+  // Programs may be processed concurrently: only silence diagnostics emitted
+  // by the current thread.
+  mlir::ScopedDiagnosticHandler silence(
+      program.getContext(),
+      [thread_id = llvm::get_threadid()](mlir::Diagnostic &) {
+        return mlir::success(thread_id == llvm::get_threadid());
       });
+  if (!LoopFusionAnalysis::Create(program, sequence_analysis).has_value()) {
+    return false;
+  }
+
+  // Fused loops must stay open for operations sequenced between the producer
+  // and the consumer.
+  llvm::SmallVector<mlir::StringAttr> fused_loops;
+  for (auto [producer_attr, consumer_attr] :
+       llvm::zip(producer.Loops(), consumer.Loops())) {
+    mlir::StringAttr name = producer_attr.cast<LoopAttr>().name();
+    if (consumer_attr.cast<LoopAttr>().name() != name) break;
+    fused_loops.push_back(name);
+  }
+  for (ComputeOpInstance op : sequence_analysis.Ops()) {
+    if (!sequence_analysis.IsBefore(producer, op)) continue;
+    if (!sequence_analysis.IsBefore(op, consumer)) break;
+    llvm::ArrayRef<mlir::Attribute> loops = op.Loops();
+    if (loops.size() < fused_loops.size()) return false;
+    for (auto [attr, name] : llvm::zip(loops, fused_loops)) {
+      if (attr.cast<LoopAttr>().name() != name) return false;
+    }
+  }
+
+  llvm::SmallVector<OpInstance> ops = {consumer};
+  for (ResultInstance result : consumer.Results()) {
+    for (auto [user, position] : result.GetUses()) ops.push_back(user);
+  }
+  IterationSpaceAnalysis iteration_spaces(program);
+  return mlir::succeeded(
+      VerifyLoopNestDependencies(program, ops, iteration_spaces));
+}
+
+// Fuses the loops of operations with the loops of the operations producing
+// their operands. Each operation is fused with the first producer whose
+// outermost loops iterate along the same points, as long as the loop nests
+// and the dependencies of the operation remain valid. Operations with fused
+// loops can then keep intermediate values in registers.
+class FuseLoops : public impl::FuseLoopsPassBase<FuseLoops> {
+ public:
+  void runOnOperation() override {
+    AssertSuccess(ForEachProgram(
+        getOperation(), getAnalysisManager(),
+        [&](SairProgramOp program, mlir::AnalysisManager analysis_manager) {
+          // Fusion does not change the sequence of operations.
+          const auto &sequence_analysis =
+              analysis_manager.getAnalysis<SequenceAnalysis, SairProgramOp>();
+          // Operations sharing loops with an earlier operation are left
+          // untouched so that fusing them again does not break existing
+          // fusion.
+          llvm::DenseSet<mlir::Attribute> seen_loops;
+          program.WalkComputeOpInstances([&](ComputeOpInstance &consumer) {
+            DecisionsAttr decisions = consumer.GetDecisions();
+            if (decisions.loop_nest() == nullptr) return;
+            bool is_fused =
+                llvm::any_of(consumer.Loops(), [&](mlir::Attribute attr) {
+                  return seen_loops.contains(attr.cast<LoopAttr>().name());
+                });
+            if (!is_fused) {
+              TryFuseWithProducer(program, consumer, sequence_analysis);
+            }
+            for (mlir::Attribute attr : consumer.Loops()) {
+              seen_loops.insert(attr.cast<LoopAttr>().name());
+            }
+          });
+          return mlir::success();
+        }));
+    markAnalysesPreserved<SequenceAnalysis>();
+  }
+
+ private:
+  // Fuses `consumer` with the first producer of its operands it can be fused
+  // with.
+  void TryFuseWithProducer(SairProgramOp program, ComputeOpInstance &consumer,
+                           const SequenceAnalysis &sequence_analysis) {
+    mlir::ArrayAttr old_loop_nest = consumer.GetDecisions().loop_nest();
+    for (OperandInstance operand : consumer.Operands()) {
+      std::optional<ResultInstance> value = operand.GetValue();
+      if (!value.has_value() || operand.CarryingDims().any()) continue;
+      auto producer = value->defining_op().dyn_cast<ComputeOpInstance>();
+      if (!producer || producer.GetDecisions().loop_nest() == nullptr) {
+        continue;
+      }
+
+      MappingAttr mapping =
+          operand.Mapping().Resize(producer.domain_size());
+      mlir::ArrayAttr loop_nest = FuseLoopNests(producer, consumer, mapping);
+      if (loop_nest == nullptr) continue;
+      consumer.SetLoopNest(loop_nest);
+      if (IsValidFusion(program, producer, consumer, sequence_analysis)) {
+        return;
+      }
+      consumer.SetLoopNest(old_loop_nest);
+    }
+  }
+};
+
+// Indicates if consecutive elements along dimension `strided_dim` of the value
+// stored in the external memref of `from_memref` are at least `min_stride`
+// bytes apart. Dimensions of unknown size are assumed to be large.
+static bool IsStridedInMemRef(SairFromMemRefOp from_memref,
+                              ValueOperand operand, int strided_dim,
+                              int64_t min_stride) {
+  if (!from_memref.MemRefType().getLayout().isIdentity()) return false;
+  int rank = operand.Mapping().size();
+  int num_parallel_dims = from_memref.getParallelDomain().size();
+  if (strided_dim == rank - 1 || strided_dim < num_parallel_dims) return false;
+
+  DomainShapeAttr shape = operand.GetType().Shape();
+  int64_t stride = ElementSize(operand.GetType());
+  for (int dim = strided_dim + 1; dim < rank; ++dim) {
+    auto range = shape.Dimension(dim).type().dyn_cast<StaticRangeType>();
+    if (range == nullptr) return true;
+    stride *= range.size();
+  }
+  return stride >= min_stride;
+}
+
+// Indicates if consecutive iterations of the innermost loop of `consumer`
+// access elements at least `min_stride` bytes apart in the memory buffer of the
+// Sair program that stores the value of `operand`. The layout of the buffer
+// must be known. Dimensions of unknown size are assumed to be large.
+static bool IsStridedInBuffer(const ComputeOpInstance &consumer,
+                              ValueOperand operand, int64_t min_stride,
+                              const IterationSpaceAnalysis &iteration_spaces,
+                              const StorageAnalysis &storage_analysis) {
+  OperandInstance operand_instance(operand, consumer);
+  std::optional<ResultInstance> value = operand_instance.GetValue();
+  if (!value.has_value()) return false;
+  const ValueStorage &storage = storage_analysis.GetStorage(*value);
+  if (storage.space() != consumer.GetSairDialect()->memory_attr() ||
+      storage.buffer_name() == nullptr || storage.layout() == nullptr) {
+    return false;
+  }
+  const Buffer &buffer = storage_analysis.GetBuffer(storage.buffer_name());
+  if (buffer.is_external()) return false;
+
+  // Find the last dimension of the buffer the innermost loop iterates along,
+  // with the layout expressed in the iteration space of `consumer`.
+  MappingAttr layout =
+      storage.Map(operand_instance, iteration_spaces)->layout();
+  if (layout.HasUnknownExprs()) return false;
+  int innermost_loop = consumer.Loops().size() - 1;
+  std::optional<int> strided_dim;
+  for (auto [dim, expr] : llvm::enumerate(layout)) {
+    if (expr.DependencyMask(layout.UseDomainSize()).test(innermost_loop)) {
+      strided_dim = dim;
+    }
+  }
+  if (!strided_dim.has_value() || *strided_dim == layout.size() - 1) {
+    return false;
+  }
+
+  DomainShapeAttr shape = buffer.DomainShape();
+  int64_t stride = ElementSize(operand.GetType());
+  for (MappingExpr expr :
+       buffer.mapping().Dimensions().drop_front(*strided_dim + 1)) {
+    std::optional<int64_t> extent = StaticLayoutExtent(expr, shape);
+    if (!extent.has_value()) return true;
+    stride *= *extent;
+  }
+  return stride >= min_stride;
+}
+
+// Returns the dimension of the value accessed by `operand` that the innermost
+// loop of `consumer` iterates along, if the value is stored in memory, either
+// in an external memref or in a buffer of the Sair program, and if
+// consecutive iterations access elements at least `min_stride` bytes apart.
+// Returns std::nullopt otherwise.
+static std::optional<int> GetStridedDimension(
+    const ComputeOpInstance &consumer, ValueOperand operand, int64_t min_stride,
+    const IterationSpaceAnalysis &iteration_spaces,
+    const StorageAnalysis &storage_analysis) {
+  MappingAttr mapping = operand.Mapping();
+  if (mapping.HasNoneExprs() || mapping.HasUnknownExprs()) {
+    return std::nullopt;
+  }
+
+  // Find the last dimension of the value the innermost loop iterates along.
+  int domain_size = consumer.domain_size();
+  llvm::SmallBitVector inner_dims = consumer.Loops()
+                                        .back()
+                                        .cast<LoopAttr>()
+                                        .iter()
+                                        .DependencyMask(domain_size);
+  std::optional<int> strided_dim;
+  for (auto [dim, expr] : llvm::enumerate(mapping.Dimensions())) {
+    if (expr.DependencyMask(domain_size).anyCommon(inner_dims)) {
+      strided_dim = dim;
+    }
+  }
+  if (!strided_dim.has_value()) return std::nullopt;
+
+  auto from_memref = operand.value().getDefiningOp<SairFromMemRefOp>();
+  bool is_strided =
+      from_memref != nullptr
+          ? IsStridedInMemRef(from_memref, operand, *strided_dim, min_stride)
+          : IsStridedInBuffer(consumer, operand, min_stride, iteration_spaces,
+                              storage_analysis);
+  if (!is_strided) return std::nullopt;
+  return strided_dim;
+}
+
+// Copies the value accessed by `operand` of `consumer` into a buffer laid out
+// so that the innermost loop of `consumer` accesses contiguous elements. The
+// value must be stored in memory and be accessed with a stride along
+// dimension `strided_dim`. The copy is nested in the outermost loops of
+// `consumer` that iterate along dimensions of the value, so that the buffer
+// only holds the tile of the value used by the remaining loops. Returns the
+// copy.
+static SairCopyOp PackOperand(ComputeOpInstance &consumer,
+                              ValueOperand operand, int strided_dim,
+                              LoopFusionAnalysis &fusion_analysis,
+                              StorageAnalysis &storage_analysis) {
+  mlir::MLIRContext *context = consumer.context();
+  MappingAttr mapping = operand.Mapping();
+  int rank = mapping.size();
+
+  // Share loops iterating along dimensions of the consumer that directly map
+  // to dimensions of the value. The innermost loop is never shared.
+  auto none = MappingNoneExpr::get(context);
+  llvm::SmallVector<MappingExpr> consumer_to_value(consumer.domain_size(),
+                                                   none);
+  for (auto [dim, expr] : llvm::enumerate(mapping.Dimensions())) {
+    if (auto dim_expr = expr.dyn_cast<MappingDimExpr>()) {
+      consumer_to_value[dim_expr.dimension()] =
+          MappingDimExpr::get(dim, context);
+    }
+  }
+  llvm::SmallVector<mlir::Attribute> shared_loops;
+  for (mlir::Attribute attr : consumer.Loops().drop_back()) {
+    auto loop = attr.cast<LoopAttr>();
+    MappingExpr iter = loop.iter().SubstituteDims(consumer_to_value);
+    if (iter.HasNoneExprs()) break;
+    shared_loops.push_back(LoopAttr::get(
+        loop.name(), iter, loop.unroll(), loop.parallel(), loop.gpu(),
+        /*accumulators=*/{}, loop.peel(), context));
+  }
+  mlir::ArrayAttr loop_nest =
+      GetDefaultLoopNest(rank, shared_loops, fusion_analysis);
+
+  // Index the buffer with the loops of the copy that are not shared, with
+  // loops iterating along the strided dimension last.
+  llvm::ArrayRef<mlir::Attribute> tile_loops =
+      loop_nest.getValue().drop_front(shared_loops.size());
+  llvm::SmallVector<mlir::StringAttr> loop_names;
+  llvm::SmallVector<MappingExpr> layout, strided_layout;
+  for (auto [pos, attr] : llvm::enumerate(tile_loops)) {
+    auto loop = attr.cast<LoopAttr>();
+    loop_names.push_back(loop.name());
+    MappingExpr expr = MappingDimExpr::get(pos, context);
+    if (loop.iter().DependencyMask(rank).test(strided_dim)) {
+      strided_layout.push_back(expr);
+    } else {
+      layout.push_back(expr);
+    }
+  }
+  llvm::append_range(layout, strided_layout);
+  auto buffer = BufferAttr::get(
+      consumer.GetSairDialect()->memory_attr(),
+      storage_analysis.GetFreshBufferName(),
+      NamedMappingAttr::get(loop_names, layout, context),
+      /*padding=*/nullptr, /*alignment=*/nullptr, /*prefetch=*/nullptr,
+      /*double_buffer=*/nullptr, /*nontemporal=*/nullptr, context);
+
+  // The domain of the value is a prefix of the domain of its defining op.
+  auto defining_op = operand.value().getDefiningOp<SairOp>();
+  mlir::OpBuilder builder(consumer.GetDuplicatedOp());
+  auto decisions = DecisionsAttr::get(
+      /*sequence=*/nullptr, loop_nest,
+      /*storage=*/builder.getArrayAttr({buffer}), /*expansion=*/nullptr,
+      /*copy_of=*/nullptr,
+      /*operands=*/GetInstanceZeroOperands(context, rank + 1), context);
+  auto copy = builder.create<SairCopyOp>(
+      defining_op.getLoc(), operand.value().getType(),
+      defining_op.getDomain().take_front(rank),
+      builder.getArrayAttr(MappingAttr::GetIdentity(context, rank)),
+      operand.value(), builder.getArrayAttr({decisions}), /*copies=*/nullptr);
+  operand.set_value(copy.getResult());
+  return copy;
+}
+
+// Packs operands stored in memory that the innermost loop of their user
+// accesses with a large stride into contiguous tiles. Packing copies are only
+// kept if lowering decisions remain valid.
+class PackOperands : public impl::PackOperandsPassBase<PackOperands> {
+ public:
+  void runOnOperation() override {
+    // Programs may be processed on other threads, where counters are not
+    // recorded, so packed operands are counted locally.
+    std::atomic<int> num_packed = 0;
+    AssertSuccess(ForEachProgram(
+        getOperation(), getAnalysisManager(),
+        [&](SairProgramOp program, mlir::AnalysisManager analysis_manager) {
+          num_packed += RunOnProgram(program, analysis_manager);
+          return mlir::success();
+        }));
+    num_packed_operands += num_packed;
+  }
+
+ private:
+  // Packs operands of `program` and returns the number of operands packed.
+  int RunOnProgram(SairProgramOp program,
+                   mlir::AnalysisManager analysis_manager) {
+    // Analyses are updated in place as copies are inserted.
+    auto &sequence_analysis =
+        analysis_manager.getAnalysis<SequenceAnalysis, SairProgramOp>();
+    auto &iteration_spaces =
+        analysis_manager.getAnalysis<IterationSpaceAnalysis, SairProgramOp>();
+    auto &fusion_analysis =
+        analysis_manager.getAnalysis<LoopFusionAnalysis, SairProgramOp>();
+    auto &storage_analysis =
+        analysis_manager.getAnalysis<StorageAnalysis, SairProgramOp>();
+
+    llvm::SmallVector<ComputeOpInstance> consumers;
+    program.WalkComputeOpInstances([&](ComputeOpInstance &op) {
+      if (op.is_copy() || op.Loops().empty()) return;
+      auto sair_op = cast<SairOp>(op.GetDuplicatedOp());
+      if (isa<SairCopyOp>(sair_op.getOperation()) ||
+          sair_op.NumInstances() != 1) {
+        return;
+      }
+      consumers.push_back(op);
+    });
+
+    int num_packed = 0;
+    for (ComputeOpInstance &consumer : consumers) {
+      auto sair_op = cast<SairOp>(consumer.GetDuplicatedOp());
+      mlir::ArrayAttr operand_attrs = consumer.GetDecisions().operands();
+      int num_domain_operands = sair_op.getDomain().size();
+      for (ValueOperand operand : sair_op.ValueOperands()) {
+        if (operand_attrs != nullptr &&
+            operand_attrs[num_domain_operands + operand.position()] !=
+                InstanceAttr::get(&getContext(), 0)) {
+          continue;
+        }
+        std::optional<int> strided_dim =
+            GetStridedDimension(consumer, operand, min_stride,
+                                iteration_spaces, storage_analysis);
+        if (!strided_dim.has_value()) continue;
+
+        mlir::Value source = operand.value();
+        SairCopyOp copy = PackOperand(consumer, operand, *strided_dim,
+                                      fusion_analysis, storage_analysis);
+        if (InsertCopy(program, copy, consumer, operand, source,
+                       sequence_analysis, iteration_spaces, fusion_analysis,
+                       storage_analysis)) {
+          ++num_packed;
+        }
+      }
+    }
+
+    // Sequence attributes are only rewritten once all copies are sequenced.
+    if (num_packed > 0) sequence_analysis.AssignInferred();
+    return num_packed;
+  }
+
+  // Sequences `copy`, that replaced `source` as the value of `operand`,
+  // immediately before `consumer` and updates the analyses in place. Only
+  // verifies the copy, the loop trees it is nested in and the dependencies of
+  // `consumer`, plus storages that are recomputed as the copy introduces a
+  // new buffer. If lowering decisions become invalid, restores `operand`,
+  // erases the copy, leaves the analyses as they were and returns false. Does
+  // not report errors.
+  static bool InsertCopy(SairProgramOp program, SairCopyOp copy,
+                         const ComputeOpInstance &consumer,
+                         ValueOperand operand, mlir::Value source,
+                         SequenceAnalysis &sequence_analysis,
+                         IterationSpaceAnalysis &iteration_spaces,
+                         LoopFusionAnalysis &fusion_analysis,
+                         StorageAnalysis &storage_analysis) {
+    // Programs may be processed concurrently: only silence diagnostics
+    // emitted by the current thread.
+    mlir::ScopedDiagnosticHandler silence(
+        program.getContext(),
+        [thread_id = llvm::get_threadid()](mlir::Diagnostic &) {
+          return mlir::success(thread_id == llvm::get_threadid());
+        });
+
+    auto copy_instance =
+        ComputeOpInstance::Unique(cast<ComputeOp>(copy.getOperation()));
+    sequence_analysis.Insert(copy_instance, consumer, Direction::kBefore);
+    iteration_spaces.Update(copy_instance);
+
+    // The copy is nested in the loop tree of `consumer` if they share loops.
+    llvm::SmallVector<mlir::StringAttr> roots;
+    for (const ComputeOpInstance &op : {consumer, copy_instance}) {
+      mlir::StringAttr root = op.Loops().front().cast<LoopAttr>().name();
+      if (!llvm::is_contained(roots, root)) roots.push_back(root);
+    }
+
+    auto verify = [&]() -> std::optional<StorageAnalysis> {
+      mlir::Operation *operation = copy.getOperation();
+      llvm::SmallVector<ComputeOpInstance> nested_ops;
+      llvm::SmallVector<OpInstance> ops = {copy_instance, consumer};
+      if (mlir::failed(
+              operation->getRegisteredInfo()->verifyInvariants(operation)) ||
+          mlir::failed(fusion_analysis.UpdateLoopTrees(
+              program, roots, sequence_analysis, nested_ops)) ||
+          mlir::failed(VerifyLoopNests(ops, nested_ops, fusion_analysis,
+                                       iteration_spaces, sequence_analysis))) {
+        return std::nullopt;
+      }
+      std::optional<StorageAnalysis> new_storage = StorageAnalysis::Create(
+          program, fusion_analysis, iteration_spaces, sequence_analysis);
+      if (!new_storage.has_value() ||
+          mlir::failed(VerifyStorages(program, *new_storage, fusion_analysis,
+                                      iteration_spaces, sequence_analysis))) {
+        return std::nullopt;
+      }
+      return new_storage;
+    };
+
+    if (std::optional<StorageAnalysis> new_storage = verify()) {
+      storage_analysis = std::move(new_storage).value();
+      return true;
+    }
+    operand.set_value(source);
+    sequence_analysis.Erase(copy_instance);
+    iteration_spaces.Erase(copy_instance);
+    copy.erase();
+    llvm::SmallVector<ComputeOpInstance> nested_ops;
+    AssertSuccess(fusion_analysis.UpdateLoopTrees(program, roots,
+                                                  sequence_analysis,
+                                                  nested_ops));
+    return false;
+  }
+
+  // Number of operands copied into contiguous tiles.
+  PassCounter num_packed_operands{"num-packed-operands"};
+};
+
+// Size in bytes assumed for buffers whose size is not statically known.
+static constexpr int64_t kLargeBufferSize = int64_t{1} << 32;
+
+// Returns the size in bytes of a buffer holding the whole Sair value of type
+// `type`.
+static int64_t ValueSize(mlir::Type type) {
+  int64_t size = ElementSize(type);
+  for (const DomainShapeDim &dim :
+       type.cast<ValueType>().Shape().Dimensions()) {
+    auto range = dim.type().dyn_cast<StaticRangeType>();
+    if (range == nullptr) return kLargeBufferSize;
+    size *= range.size();
+  }
+  return size;
+}
+
+// Adds the compute operations using `value` to `users`, stepping over
+// non-compute operations.
+static void CollectComputeUsers(const ResultInstance &value,
+                                llvm::DenseSet<OpInstance> &visited,
+                                llvm::SetVector<ComputeOpInstance> &users) {
+  for (auto [user, position] : value.GetUses()) {
+    if (auto compute_user = user.dyn_cast<ComputeOpInstance>()) {
+      users.insert(compute_user);
+    } else if (visited.insert(user).second) {
+      for (ResultInstance result : user.Results()) {
+        CollectComputeUsers(result, visited, users);
+      }
+    }
+  }
+}
+
+// Tracks the bytes of buffers live while executing the compute operations of
+// a program one after the other. A buffer is live from its first write to its
+// last read. Values without storage are assumed to get their own buffer, in
+// registers for 0-dimensional values and in memory otherwise. Registers and
+// external buffers are not counted.
+class LiveBuffers {
+ public:
+  LiveBuffers(SairProgramOp program, const StorageAnalysis &storage_analysis) {
+    auto *sair_dialect = static_cast<SairDialect *>(program->getDialect());
+    llvm::DenseMap<mlir::Attribute, int> buffer_ranges;
+    program.WalkComputeOpInstances([&](const ComputeOpInstance &op) {
+      for (int i = 0, e = op.num_results(); i < e; ++i) {
+        ResultInstance value = op.Result(i);
+        BufferAttr storage = op.Storage(i);
+        if (storage != nullptr &&
+            storage.space() == sair_dialect->register_attr()) {
+          continue;
+        }
+
+        int range;
+        if (storage != nullptr && storage.name() != nullptr) {
+          const Buffer &buffer = storage_analysis.GetBuffer(storage.name());
+          if (buffer.is_external()) continue;
+          auto [it, inserted] =
+              buffer_ranges.try_emplace(storage.name(), ranges_.size());
+          if (inserted) {
+            ranges_.push_back(
+                {buffer.StaticSize().value_or(kLargeBufferSize)});
+          }
+          range = it->second;
+        } else {
+          if (value.GetType().Shape().Is0d()) continue;
+          range = ranges_.size();
+          ranges_.push_back({ValueSize(value.GetType())});
+        }
+
+        writes_[op].insert(range);
+        llvm::DenseSet<OpInstance> visited;
+        llvm::SetVector<ComputeOpInstance> users;
+        CollectComputeUsers(value, visited, users);
+        for (const ComputeOpInstance &user : users) {
+          if (reads_[user].insert(range)) ++ranges_[range].pending_reads;
+        }
+      }
     });
   }
+
+  // Bytes allocated minus bytes released by executing `op` next.
+  int64_t Delta(const ComputeOpInstance &op) const {
+    int64_t delta = 0;
+    for (int range : Writes(op)) {
+      if (ranges_[range].state == State::kUnallocated) {
+        delta += ranges_[range].size;
+      }
+    }
+    for (int range : Reads(op)) {
+      const LiveRange &live_range = ranges_[range];
+      bool allocated = live_range.state == State::kLive ||
+                       (live_range.state == State::kUnallocated &&
+                        Writes(op).count(range));
+      if (allocated && live_range.pending_reads == 1) {
+        delta -= live_range.size;
+      }
+    }
+    return delta;
+  }
+
+  // Executes `op`, allocating the buffers it writes to first and then
+  // releasing buffers it is the last reader of.
+  void Execute(const ComputeOpInstance &op) {
+    for (int range : Writes(op)) {
+      LiveRange &live_range = ranges_[range];
+      if (live_range.state != State::kUnallocated) continue;
+      live_range.state = State::kLive;
+      live_bytes_ += live_range.size;
+    }
+    peak_bytes_ = std::max(peak_bytes_, live_bytes_);
+    for (int range : Reads(op)) {
+      LiveRange &live_range = ranges_[range];
+      if (--live_range.pending_reads > 0 ||
+          live_range.state != State::kLive) {
+        continue;
+      }
+      live_range.state = State::kReleased;
+      live_bytes_ -= live_range.size;
+    }
+  }
+
+  // Largest number of bytes live at the same time so far.
+  int64_t peak_bytes() const { return peak_bytes_; }
+
+ private:
+  enum class State { kUnallocated, kLive, kReleased };
+
+  struct LiveRange {
+    int64_t size;
+    int pending_reads = 0;
+    State state = State::kUnallocated;
+  };
+
+  const llvm::SetVector<int> &Writes(const ComputeOpInstance &op) const {
+    auto it = writes_.find(op);
+    return it == writes_.end() ? empty_ : it->second;
+  }
+
+  const llvm::SetVector<int> &Reads(const ComputeOpInstance &op) const {
+    auto it = reads_.find(op);
+    return it == reads_.end() ? empty_ : it->second;
+  }
+
+  llvm::SmallVector<LiveRange> ranges_;
+  llvm::DenseMap<ComputeOpInstance, llvm::SetVector<int>> writes_;
+  llvm::DenseMap<ComputeOpInstance, llvm::SetVector<int>> reads_;
+  llvm::SetVector<int> empty_;
+  int64_t live_bytes_ = 0;
+  int64_t peak_bytes_ = 0;
 };
 
-// Modifies the "sequence" attribute of all compute ops in the given program to
-// be the canonical sequence value inferred from use-def dependencies of Sair
-// values and available sequence attributes. The relative order is preserved but
-// not the absolute sequence numbers. The traversal order is deterministic but
-// otherwise unspecified for operations that do not have "sequence" attribute
-// and belong to different connected components of the use-def dependency graph.
-void UpdateSequence(SairProgramOp program) {
-  SequenceAnalysis(program).AssignInferred();
+// Returns the peak number of live bytes when executing `order`.
+static int64_t PeakBytes(llvm::ArrayRef<ComputeOpInstance> order,
+                         LiveBuffers live_buffers) {
+  for (const ComputeOpInstance &op : order) live_buffers.Execute(op);
+  return live_buffers.peak_bytes();
+}
+
+// Orders compute operations so as to reduce the peak number of live bytes,
+// while sequencing operations after their producers and preserving the
+// relative order of operations with a "sequence" attribute. Among operations
+// that can be executed next, greedily picks the ones that increase the number
+// of live bytes the least, then the ones using values produced by the last
+// picked operation to keep producers next to consumers, and then the first one
+// in the order of `sequence_analysis`.
+static llvm::SmallVector<ComputeOpInstance> MinimizeLiveBuffers(
+    const SequenceAnalysis &sequence_analysis, LiveBuffers live_buffers) {
+  auto ops = llvm::to_vector(sequence_analysis.Ops());
+  llvm::DenseMap<ComputeOpInstance, int> positions;
+  llvm::DenseMap<ComputeOpInstance, llvm::SetVector<ComputeOpInstance>>
+      producers;
+  llvm::DenseMap<ComputeOpInstance, int> num_predecessors;
+  llvm::DenseMap<ComputeOpInstance, llvm::SmallVector<ComputeOpInstance>>
+      successors;
+  // Operations with a "sequence" attribute appear in the order of their
+  // sequence numbers: ordering each after the previous one preserves their
+  // relative order.
+  ComputeOpInstance previous_sequenced;
+  for (auto [position, op] : llvm::enumerate(ops)) {
+    positions[op] = position;
+    producers[op] = sequence_analysis.Producers(op);
+    llvm::SetVector<ComputeOpInstance> predecessors = producers[op];
+    if (op.GetDecisions().sequence() != nullptr) {
+      if (previous_sequenced != nullptr) {
+        predecessors.insert(previous_sequenced);
+      }
+      previous_sequenced = op;
+    }
+    num_predecessors[op] = predecessors.size();
+    for (const ComputeOpInstance &predecessor : predecessors) {
+      successors[predecessor].push_back(op);
+    }
+  }
+
+  llvm::SmallVector<ComputeOpInstance> ready;
+  for (const ComputeOpInstance &op : ops) {
+    if (num_predecessors[op] == 0) ready.push_back(op);
+  }
+
+  llvm::SmallVector<ComputeOpInstance> order;
+  while (!ready.empty()) {
+    auto priority = [&](const ComputeOpInstance &op) {
+      bool follows_producer =
+          !order.empty() && producers[op].count(order.back());
+      return std::make_tuple(live_buffers.Delta(op), !follows_producer,
+                             positions[op]);
+    };
+    auto best = llvm::min_element(ready, [&](const ComputeOpInstance &lhs,
+                                             const ComputeOpInstance &rhs) {
+      return priority(lhs) < priority(rhs);
+    });
+    ComputeOpInstance op = *best;
+    ready.erase(best);
+    live_buffers.Execute(op);
+    order.push_back(op);
+    for (const ComputeOpInstance &successor : successors[op]) {
+      if (--num_predecessors[successor] == 0) ready.push_back(successor);
+    }
+  }
+  assert(order.size() == ops.size() && "predecessor graph has cycles");
+  return order;
+}
+
+// Sequences operations in `sequence_analysis` following `order`.
+static void SetOrder(SequenceAnalysis &sequence_analysis,
+                     llvm::ArrayRef<ComputeOpInstance> order) {
+  for (const ComputeOpInstance &op : order) {
+    sequence_analysis.Erase(op);
+    sequence_analysis.Insert(op, ComputeOpInstance(), Direction::kAfter);
+  }
 }
 
+// Modifies the "sequence" attribute of all compute ops in each program to be
+// the canonical sequence value inferred from use-def dependencies of Sair values
+// and available sequence attributes. The relative order is preserved but not the
+// absolute sequence numbers. The traversal order is deterministic but otherwise
+// unspecified for operations that do not have "sequence" attribute and belong
+// to different connected components of the use-def dependency graph, unless
+// minimizing memory, in which case operations are ordered to reduce the peak
+// size of live buffers.
 class DefaultSequencePass
     : public impl::DefaultSequencePassBase<DefaultSequencePass> {
  public:
   void runOnOperation() override {
-    getOperation().walk(
-        [](SairProgramOp program_op) { UpdateSequence(program_op); });
+    // Programs may be processed on other threads, where counters are not
+    // recorded, so reordered programs are counted locally.
+    std::atomic<int> num_reordered = 0;
+    AssertSuccess(ForEachProgram(
+        getOperation(), getAnalysisManager(),
+        [&](SairProgramOp program, mlir::AnalysisManager analysis_manager) {
+          auto &sequence_analysis =
+              analysis_manager.getAnalysis<SequenceAnalysis, SairProgramOp>();
+          if (minimize_memory &&
+              ReduceMemoryPressure(
+                  program, sequence_analysis,
+                  analysis_manager
+                      .getAnalysis<IterationSpaceAnalysis, SairProgramOp>(),
+                  analysis_manager
+                      .getAnalysis<StorageAnalysis, SairProgramOp>())) {
+            ++num_reordered;
+          }
+          sequence_analysis.AssignInferred();
+          return mlir::success();
+        }));
+    num_reordered_programs += num_reordered;
+
+    // Reordering operations may invalidate analyses relying on the relative
+    // order of operations. The sequence analysis is kept up to date.
+    if (minimize_memory) {
+      markAnalysesPreserved<SequenceAnalysis>();
+      return;
+    }
+    // The relative order of operations is unchanged, so analyses relying on it
+    // remain valid.
+    markAnalysesPreserved<SequenceAnalysis, LoopFusionAnalysis,
+                          IterationSpaceAnalysis, StorageAnalysis>();
+  }
+
+ private:
+  // Reorders operations of `program` in `sequence_analysis` to reduce the peak
+  // size of live buffers. Keeps the current order if the new one does not
+  // reduce the peak or if it results in invalid lowering decisions. Only
+  // updates the analysis: sequence attributes are left untouched. Returns true
+  // if the operations were reordered.
+  bool ReduceMemoryPressure(SairProgramOp program,
+                            SequenceAnalysis &sequence_analysis,
+                            const IterationSpaceAnalysis &iteration_spaces,
+                            const StorageAnalysis &storage_analysis) {
+    LiveBuffers live_buffers(program, storage_analysis);
+    auto current_order = llvm::to_vector(sequence_analysis.Ops());
+    llvm::SmallVector<ComputeOpInstance> new_order =
+        MinimizeLiveBuffers(sequence_analysis, live_buffers);
+    if (PeakBytes(new_order, live_buffers) >=
+        PeakBytes(current_order, live_buffers)) {
+      return false;
+    }
+
+    SetOrder(sequence_analysis, new_order);
+    if (IsValidSequence(program, sequence_analysis, iteration_spaces)) {
+      return true;
+    }
+    SetOrder(sequence_analysis, current_order);
+    return false;
   }
+
+  // Number of programs reordered to reduce memory pressure.
+  PassCounter num_reordered_programs{"num-reordered-programs"};
 };
 
 // Sets the expansion field of op to a default scalar
@@ -460,15 +1560,21 @@ class DefaultExpansion
     : public impl::DefaultExpansionPassBase<DefaultExpansion> {
  public:
   void runOnOperation() override {
-    auto result = getOperation().walk([&](SairProgramOp program) {
-      return program.TryWalkComputeOpInstances(
-          [&](ComputeOpInstance &op) -> mlir::WalkResult {
-            return SetDefaultExpansion(op);
-          });
-    });
-    if (result.wasInterrupted()) {
+    auto result = ForEachProgram(
+        getOperation(), getAnalysisManager(),
+        [](SairProgramOp program, mlir::AnalysisManager) {
+          auto walk_result = program.TryWalkComputeOpInstances(
+              [&](ComputeOpInstance &op) -> mlir::WalkResult {
+                return SetDefaultExpansion(op);
+              });
+          return mlir::failure(walk_result.wasInterrupted());
+        });
+    if (mlir::failed(result)) {
       signalPassFailure();
+      return;
     }
+    markAnalysesPreserved<SequenceAnalysis, LoopFusionAnalysis,
+                          IterationSpaceAnalysis, StorageAnalysis>();
   }
 };
 
@@ -482,6 +1588,19 @@ std::unique_ptr<mlir::Pass> CreateDefaultLoopNestPass() {
   return std::make_unique<DefaultLoopNest>();
 }
 
+std::unique_ptr<mlir::Pass> CreateDefaultLoopNestPass(
+    llvm::ArrayRef<int64_t> cache_sizes) {
+  return std::make_unique<DefaultLoopNest>(cache_sizes);
+}
+
+std::unique_ptr<mlir::Pass> CreateFuseLoopsPass() {
+  return std::make_unique<FuseLoops>();
+}
+
+std::unique_ptr<mlir::Pass> CreatePackOperandsPass() {
+  return std::make_unique<PackOperands>();
+}
+
 std::unique_ptr<mlir::Pass> CreateDefaultSequencePass() {
   return std::make_unique<DefaultSequencePass>();
 }
@@ -490,6 +1609,11 @@ std::unique_ptr<mlir::Pass> CreateDefaultStoragePass() {
   return std::make_unique<DefaultStorage>();
 }
 
+std::unique_ptr<mlir::Pass> CreateDefaultStoragePass(
+    int64_t register_tile_limit) {
+  return std::make_unique<DefaultStorage>(register_tile_limit);
+}
+
 std::unique_ptr<mlir::Pass> CreateDefaultExpansionPass() {
   return std::make_unique<DefaultExpansion>();
 }
@@ -499,6 +1623,7 @@ void CreateDefaultLoweringAttributesPipeline(mlir::OpPassManager *pm) {
   pm->addPass(CreateDefaultSequencePass());
   pm->addPass(CreateDefaultLoopNestPass());
   pm->addPass(CreateDefaultStoragePass());
+  pm->addPass(CreatePackOperandsPass());
   pm->addPass(CreateDefaultExpansionPass());
 }
 
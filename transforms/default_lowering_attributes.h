@@ -15,6 +15,7 @@
 #ifndef SAIR_DEFAULT_LOWERING_ATTRIBUTES_H_
 #define SAIR_DEFAULT_LOWERING_ATTRIBUTES_H_
 
+#include <cstdint>
 #include <memory>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -37,6 +38,21 @@ std::unique_ptr<mlir::Pass> CreateDefaultInstancePass();
 // default value. Leaves the attribute untouched if already present.
 std::unique_ptr<mlir::Pass> CreateDefaultLoopNestPass();
 
+// Returns a pass that sets missing `loop_nest` attributes to loop nests tiled
+// so that the working set of each operation fits in caches of the given sizes
+// in bytes, ordered from the innermost cache level.
+std::unique_ptr<mlir::Pass> CreateDefaultLoopNestPass(
+    llvm::ArrayRef<int64_t> cache_sizes);
+
+// Returns a pass that renames loops of operations after the loops of the
+// operations producing their operands when they iterate along the same points,
+// so that intermediate values do not need to be stored in memory.
+std::unique_ptr<mlir::Pass> CreateFuseLoopsPass();
+
+// Returns a pass that copies operands read from memory with a large stride by
+// the innermost loop of their user into contiguous tiles.
+std::unique_ptr<mlir::Pass> CreatePackOperandsPass();
+
 // Returns a pass that sets the `sequence` attribute of Sair compute operations
 // to default values. This pass respects the relative order of the existing
 // sequence numbers but may change their exact values.
@@ -46,6 +62,11 @@ std::unique_ptr<mlir::Pass> CreateDefaultSequencePass();
 // value. Leaves existing memory space attributes intact.
 std::unique_ptr<mlir::Pass> CreateDefaultStoragePass();
 
+// Same as above, but keeps buffers created by the pass in registers if their
+// static size is at most `register_tile_limit` bytes.
+std::unique_ptr<mlir::Pass> CreateDefaultStoragePass(
+    int64_t register_tile_limit);
+
 // Returns a pass that sets sets the `expansion` attribute of Sair compute
 // operations to use the default scalar implementation of the operation.
 std::unique_ptr<mlir::Pass> CreateDefaultExpansionPass();
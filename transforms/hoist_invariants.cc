@@ -0,0 +1,323 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iterator>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "sair_attributes.h"
+#include "sair_op_interfaces.h"
+#include "sair_ops.h"
+#include "sair_types.h"
+#include "statistics_report.h"
+
+namespace sair {
+
+#define GEN_PASS_DEF_HOISTLOOPINVARIANTSPASS
+#include "transforms/lowering.h.inc"
+
+namespace {
+
+// Operations of a sair.map body that only depend on a subset of the domain
+// dimensions.
+struct InvariantGroup {
+  llvm::SmallBitVector dimensions;
+  llvm::SmallVector<mlir::Operation *> ops;
+};
+
+// Indicates if `op` can be computed by a different sair.map operation.
+bool IsHoistable(mlir::Operation *op) {
+  return op->getNumRegions() == 0 &&
+         !op->hasTrait<mlir::OpTrait::IsTerminator>() &&
+         mlir::isMemoryEffectFree(op);
+}
+
+// Moves computations of the body of `op` that only depend on a subset of its
+// domain dimensions into new sair.map operations with a domain restricted to
+// that subset. Converts
+//
+// <res> = sair.map[<D>] <inputs> { <body> }
+//
+// into
+//
+// <invariant> = sair.map[<D'>] <inputs'> { <invariant ops> }
+// <res> = sair.map[<D>] <inputs>, <invariant> { <other ops> }
+//
+// where <D'> is a subset of <D> closed under dimension dependencies. Constants
+// are replicated in each body using them. Returns the number of sair.map
+// operations created.
+int HoistInvariants(SairMapOp op, mlir::OpBuilder &builder) {
+  mlir::MLIRContext *context = op.getContext();
+  mlir::Location loc = op.getLoc();
+  int domain_size = op.getDomain().size();
+  DomainShapeAttr shape = op.getShape();
+  mlir::Block &body = op.block();
+
+  // Extends `mask` with the dimensions its dimensions depend on.
+  auto close_dependencies = [&](llvm::SmallBitVector mask) {
+    mask.resize(domain_size);
+    for (int i = domain_size - 1; i >= 0; --i) {
+      if (!mask.test(i)) continue;
+      llvm::SmallBitVector dependencies = shape.Dimension(i).DependencyMask();
+      dependencies.resize(domain_size);
+      mask |= dependencies;
+    }
+    return mask;
+  };
+
+  // Compute the domain dimensions each value of the body depends on. Values
+  // carried by sair.fby depend on the computation itself and are never
+  // hoisted.
+  llvm::SmallBitVector all_dimensions(domain_size, true);
+  llvm::DenseMap<mlir::Value, llvm::SmallBitVector> dependencies;
+  for (int i = 0; i < domain_size; ++i) {
+    llvm::SmallBitVector mask(domain_size);
+    mask.set(i);
+    dependencies[body.getArgument(i)] = close_dependencies(mask);
+  }
+  for (ValueOperand operand : op.ValueOperands()) {
+    mlir::Value argument = op.block_inputs()[operand.position()];
+    if (isa_and_nonnull<SairFbyOp>(operand.value().getDefiningOp())) {
+      dependencies[argument] = all_dimensions;
+    } else {
+      dependencies[argument] =
+          close_dependencies(operand.Mapping().DependencyMask());
+    }
+  }
+
+  llvm::SmallVector<InvariantGroup> groups;
+  for (mlir::Operation &inner_op : body.without_terminator()) {
+    llvm::SmallBitVector mask(domain_size);
+    if (IsHoistable(&inner_op)) {
+      for (mlir::Value operand : inner_op.getOperands()) {
+        mask |= dependencies[operand];
+      }
+    } else {
+      mask = all_dimensions;
+    }
+    for (mlir::Value result : inner_op.getResults()) {
+      dependencies[result] = mask;
+    }
+    if (mask.all() || inner_op.hasTrait<mlir::OpTrait::ConstantLike>()) {
+      continue;
+    }
+
+    auto it = llvm::find_if(groups, [&](const InvariantGroup &group) {
+      return group.dimensions == mask;
+    });
+    if (it == groups.end()) {
+      groups.push_back({mask, {}});
+      it = std::prev(groups.end());
+    }
+    it->ops.push_back(&inner_op);
+  }
+  if (groups.empty()) return 0;
+
+  // Operations of a group only use values of groups with fewer dimensions.
+  llvm::stable_sort(groups, [](const InvariantGroup &lhs,
+                               const InvariantGroup &rhs) {
+    return lhs.dimensions.count() < rhs.dimensions.count();
+  });
+
+  // Values of the body computed by new sair.map operations, with the mapping
+  // from the domain of `op` to the domain of the new operation.
+  llvm::DenseMap<mlir::Value, ValueAccess> hoisted_values;
+  // Values of the body to replace by new inputs of `op`.
+  llvm::SmallVector<mlir::Value> replaced_values;
+  llvm::SmallPtrSet<mlir::Operation *, 8> hoisted_ops;
+
+  builder.setInsertionPoint(op);
+  for (const InvariantGroup &group : groups) {
+    llvm::SmallPtrSet<mlir::Operation *, 8> group_ops(group.ops.begin(),
+                                                      group.ops.end());
+    hoisted_ops.insert(group.ops.begin(), group.ops.end());
+
+    // Mappings between the domain of `op` and the domain of the new operation.
+    llvm::SmallVector<mlir::Value> domain;
+    llvm::SmallVector<MappingExpr> to_full_exprs(
+        domain_size, MappingNoneExpr::get(context));
+    llvm::SmallVector<MappingExpr> to_group_exprs;
+    for (int dimension : group.dimensions.set_bits()) {
+      to_full_exprs[dimension] = MappingDimExpr::get(domain.size(), context);
+      to_group_exprs.push_back(MappingDimExpr::get(dimension, context));
+      domain.push_back(op.getDomain()[dimension]);
+    }
+    int group_size = domain.size();
+    auto to_full = MappingAttr::get(context, group_size, to_full_exprs);
+    auto to_group = MappingAttr::get(context, domain_size, to_group_exprs);
+
+    llvm::SmallVector<DomainShapeDim> shape_dims;
+    for (int dimension : group.dimensions.set_bits()) {
+      const DomainShapeDim &shape_dim = shape.Dimension(dimension);
+      auto prefix_to_full = MappingAttr::get(
+          context, shape_dims.size(),
+          llvm::ArrayRef<MappingExpr>(to_full_exprs).take_front(dimension));
+      shape_dims.emplace_back(
+          shape_dim.type(),
+          prefix_to_full.Compose(shape_dim.dependency_mapping()));
+    }
+    auto group_shape = DomainShapeAttr::get(context, shape_dims);
+
+    // Collect inputs and results of the new operation.
+    llvm::SmallVector<ValueAccess> inputs;
+    llvm::SmallVector<mlir::Value> input_values;
+    llvm::SmallVector<mlir::Value> results;
+    llvm::SmallVector<mlir::Type> result_types;
+    for (mlir::Operation *group_op : group.ops) {
+      for (mlir::Value operand : group_op->getOperands()) {
+        mlir::Operation *defining_op = operand.getDefiningOp();
+        if (defining_op != nullptr &&
+            (group_ops.contains(defining_op) ||
+             defining_op->hasTrait<mlir::OpTrait::ConstantLike>())) {
+          continue;
+        }
+        auto argument = operand.dyn_cast<mlir::BlockArgument>();
+        if (argument != nullptr && argument.getArgNumber() < domain_size) {
+          continue;
+        }
+        if (llvm::is_contained(input_values, operand)) continue;
+
+        input_values.push_back(operand);
+        auto it = hoisted_values.find(operand);
+        if (it != hoisted_values.end()) {
+          inputs.push_back(
+              {it->second.value, to_full.Compose(it->second.mapping)});
+          continue;
+        }
+        int position = argument.getArgNumber() - domain_size;
+        ValueOperand value_operand = op.ValueOperands()[position];
+        inputs.push_back(
+            {value_operand.value(), to_full.Compose(value_operand.Mapping())});
+      }
+
+      for (mlir::Value result : group_op->getResults()) {
+        bool escapes =
+            llvm::any_of(result.getUsers(), [&](mlir::Operation *user) {
+              return !group_ops.contains(user);
+            });
+        if (!escapes) continue;
+        results.push_back(result);
+        result_types.push_back(ValueType::get(group_shape, result.getType()));
+      }
+    }
+
+    auto invariant_op = builder.create<SairMapOp>(
+        loc, result_types, domain, inputs, group_shape,
+        /*instances=*/nullptr, /*copies=*/nullptr);
+    mlir::Block &invariant_body = invariant_op.block();
+    mlir::IRMapping mapping;
+    for (auto [position, dimension] :
+         llvm::enumerate(group.dimensions.set_bits())) {
+      mapping.map(body.getArgument(dimension),
+                  invariant_body.getArgument(position));
+    }
+    for (auto [value, argument] :
+         llvm::zip(input_values, invariant_op.block_inputs())) {
+      mapping.map(value, argument);
+    }
+
+    mlir::OpBuilder::InsertionGuard guard(builder);
+    builder.setInsertionPointToStart(&invariant_body);
+    for (mlir::Operation *inner_op : group.ops) {
+      for (mlir::Value operand : inner_op->getOperands()) {
+        if (mapping.contains(operand)) continue;
+        builder.clone(*operand.getDefiningOp(), mapping);
+      }
+      builder.clone(*inner_op, mapping);
+    }
+    llvm::SmallVector<mlir::Value> returned_values;
+    for (mlir::Value result : results) {
+      returned_values.push_back(mapping.lookup(result));
+    }
+    builder.create<SairReturnOp>(loc, returned_values);
+
+    for (auto [value, result] : llvm::zip(results, invariant_op.getResults())) {
+      hoisted_values[value] = {result, to_group};
+      replaced_values.push_back(value);
+    }
+  }
+
+  // Replace hoisted values still used in the body by new inputs of `op` and
+  // drop inputs that are only used by hoisted operations.
+  llvm::SmallVector<ValueAccess> inputs;
+  for (ValueOperand operand : op.ValueOperands()) {
+    inputs.push_back({operand.value(), operand.Mapping()});
+  }
+  for (mlir::Value value : replaced_values) {
+    if (llvm::all_of(value.getUsers(), [&](mlir::Operation *user) {
+          return hoisted_ops.contains(user);
+        })) {
+      continue;
+    }
+    value.replaceAllUsesWith(body.addArgument(value.getType(), loc));
+    inputs.push_back(hoisted_values[value]);
+  }
+  for (mlir::Operation &inner_op :
+       llvm::make_early_inc_range(llvm::reverse(body))) {
+    if (hoisted_ops.contains(&inner_op)) inner_op.erase();
+  }
+  for (int i = inputs.size() - 1; i >= 0; --i) {
+    if (!body.getArgument(domain_size + i).use_empty()) continue;
+    body.eraseArgument(domain_size + i);
+    inputs.erase(inputs.begin() + i);
+  }
+
+  auto new_op = builder.create<SairMapOp>(
+      loc, op.getResultTypes(), op.getDomain(), inputs, shape,
+      /*instances=*/nullptr, /*copies=*/nullptr);
+  new_op.getBody().takeBody(op.getBody());
+  op->replaceAllUsesWith(new_op.getResults());
+  op.erase();
+  return groups.size();
+}
+
+// Moves loop-invariant computations of sair.map operations into sair.map
+// operations with fewer dimensions.
+class HoistLoopInvariants
+    : public impl::HoistLoopInvariantsPassBase<HoistLoopInvariants> {
+  void runOnOperation() override {
+    llvm::SmallVector<SairMapOp> ops;
+    getOperation().walk([&](SairMapOp op) {
+      if (op.getInstances().has_value() || op.getCopies().has_value()) return;
+      ops.push_back(op);
+    });
+
+    mlir::OpBuilder builder(&getContext());
+    for (SairMapOp op : ops) {
+      num_hoisted_computations += HoistInvariants(op, builder);
+    }
+  }
+
+ private:
+  // Number of sair.map operations created for invariant code.
+  PassCounter num_hoisted_computations{"num-hoisted-computations"};
+};
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateHoistLoopInvariantsPass() {
+  return std::make_unique<HoistLoopInvariants>();
+}
+
+}  // namespace sair
@@ -14,35 +14,50 @@
 
 #include <list>
 #include <memory>
+#include <optional>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/GPU/IR/GPUDialect.h"
+#include "mlir/Dialect/GPU/Transforms/ParallelLoopMapper.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/Dialect/SCF/Utils/Utils.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/AffineExpr.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/IRMapping.h"
 #include "mlir/IR/Location.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/OperationSupport.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Types.h"
 #include "mlir/IR/UseDefLists.h"
 #include "mlir/IR/Value.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/RegionUtils.h"
+#include "expansion.h"
 #include "sair_attributes.h"
 #include "sair_dialect.h"
 #include "sair_op_interfaces.h"
 #include "sair_ops.h"
 #include "sair_types.h"
 #include "sequence.h"
+#include "statistics_report.h"
 #include "storage.h"
+#include "util.h"
 
 namespace sair {
 
@@ -368,7 +383,8 @@ mlir::ArrayAttr EraseDimensionFromLoopNest(
     }
     new_loop_nest.push_back(LoopAttr::get(
         loop.name(), MappingDimExpr::get(old_dimension - 1, context),
-        loop.unroll(), context));
+        loop.unroll(), loop.parallel(), loop.gpu(), loop.accumulators(),
+        loop.peel(), context));
   }
   return mlir::ArrayAttr::get(context, new_loop_nest);
 }
@@ -469,6 +485,199 @@ mlir::scf::ForOp CreateForOp(mlir::Location loc, mlir::Value lower_bound,
   return for_op;
 }
 
+// Interleaves the reductions carried by `for_op` across `num_accumulators`
+// independent accumulators. A loop-carried value is a reduction if it is only
+// used by a single associative and commutative operation producing its next
+// value, with the `reassoc` flag for floating-point operations. Replaces
+// `for_op` by a loop executing `num_accumulators` iterations at a time, each
+// updating its own accumulators, followed by code combining the accumulators
+// and by a loop executing the remaining iterations. Returns the first loop.
+mlir::FailureOr<mlir::scf::ForOp> InterleaveAccumulators(
+    mlir::scf::ForOp for_op, int64_t step, LoopAttr loop, Driver &driver) {
+  mlir::OpBuilder::InsertionGuard guard(driver);
+  mlir::Location loc = for_op.getLoc();
+  int num_accumulators = loop.accumulators().getInt();
+  mlir::Block *body = for_op.getBody();
+  mlir::Operation *yield = body->getTerminator();
+  int num_iter_args = for_op.getNumRegionIterArgs();
+
+  // Find reductions and assign a position to their additional accumulators in
+  // the loop-carried values of the new loop.
+  llvm::SmallVector<mlir::Operation *> combiners(num_iter_args, nullptr);
+  llvm::SmallVector<int> accumulators_pos(num_iter_args, -1);
+  int num_new_iter_args = num_iter_args;
+  for (int i = 0; i < num_iter_args; ++i) {
+    mlir::Value arg = for_op.getRegionIterArgs()[i];
+    mlir::Value result = yield->getOperand(i);
+    mlir::Operation *combiner = result.getDefiningOp();
+    if (combiner == nullptr || combiner->getBlock() != body ||
+        !arg.hasOneUse() || *arg.user_begin() != combiner ||
+        !result.hasOneUse() || GetReductionIdentity(combiner) == nullptr) {
+      continue;
+    }
+    auto fastmath =
+        llvm::dyn_cast<mlir::arith::ArithFastMathInterface>(combiner);
+    if (fastmath != nullptr &&
+        !mlir::arith::bitEnumContainsAll(
+            fastmath.getFastMathFlagsAttr().getValue(),
+            mlir::arith::FastMathFlags::reassoc)) {
+      continue;
+    }
+    combiners[i] = combiner;
+    accumulators_pos[i] = num_new_iter_args;
+    num_new_iter_args += num_accumulators - 1;
+  }
+  if (num_new_iter_args == num_iter_args) {
+    return for_op.emitError()
+           << "loop " << loop.name()
+           << " does not carry a reduction that can be interleaved; "
+              "floating-point reductions require the 'reassoc' flag";
+  }
+
+  // Compute the end of the last complete group of iterations.
+  driver.setInsertionPoint(for_op);
+  mlir::Value lower_bound = for_op.getLowerBound();
+  mlir::Value upper_bound = for_op.getUpperBound();
+  mlir::Value group_step = driver.create<mlir::arith::ConstantIndexOp>(
+      loc, step * num_accumulators);
+  mlir::Value span =
+      driver.create<mlir::arith::SubIOp>(loc, upper_bound, lower_bound);
+  mlir::Value num_groups =
+      driver.create<mlir::arith::DivSIOp>(loc, span, group_step);
+  mlir::Value groups_span =
+      driver.create<mlir::arith::MulIOp>(loc, num_groups, group_step);
+  mlir::Value groups_end =
+      driver.create<mlir::arith::AddIOp>(loc, lower_bound, groups_span);
+
+  // Additional accumulators start from the neutral element of the reduction.
+  llvm::SmallVector<mlir::Value> inits = llvm::to_vector(
+      for_op->getOperands().drop_front(for_op.getNumControlOperands()));
+  for (mlir::Operation *combiner : combiners) {
+    if (combiner == nullptr) continue;
+    mlir::Value identity = driver.create<mlir::arith::ConstantOp>(
+        loc, GetReductionIdentity(combiner));
+    inits.append(num_accumulators - 1, identity);
+  }
+
+  // Clones the loop body for iteration `index`, with loop-carried values
+  // `iter_args`, and returns the values yielded by the body.
+  auto clone_body = [&](mlir::OpBuilder &builder, mlir::Value index,
+                        mlir::ValueRange iter_args) {
+    mlir::IRMapping mapping;
+    mapping.map(for_op.getInductionVar(), index);
+    mapping.map(for_op.getRegionIterArgs(), iter_args);
+    for (mlir::Operation &op : body->without_terminator()) {
+      builder.clone(op, mapping);
+    }
+    return llvm::to_vector(llvm::map_range(
+        yield->getOperands(),
+        [&](mlir::Value value) { return mapping.lookupOrDefault(value); }));
+  };
+
+  auto groups_loop = driver.create<mlir::scf::ForOp>(
+      loc, lower_bound, groups_end, group_step, inits,
+      [&](mlir::OpBuilder &builder, mlir::Location loc, mlir::Value index,
+          mlir::ValueRange args) {
+        llvm::SmallVector<mlir::Value> results = llvm::to_vector(args);
+        for (int i = 0; i < num_accumulators; ++i) {
+          mlir::Value iteration_index = index;
+          if (i > 0) {
+            mlir::Value offset =
+                builder.create<mlir::arith::ConstantIndexOp>(loc, i * step);
+            iteration_index =
+                builder.create<mlir::arith::AddIOp>(loc, index, offset);
+          }
+          // Iteration `i` uses the `i`-th accumulator of each reduction and
+          // the values produced by the previous iteration for other
+          // loop-carried values.
+          llvm::SmallVector<mlir::Value> iter_args(
+              llvm::ArrayRef<mlir::Value>(results).take_front(num_iter_args));
+          for (int j = 0; j < num_iter_args; ++j) {
+            if (combiners[j] == nullptr || i == 0) continue;
+            iter_args[j] = results[accumulators_pos[j] + i - 1];
+          }
+          llvm::SmallVector<mlir::Value> yielded =
+              clone_body(builder, iteration_index, iter_args);
+          for (int j = 0; j < num_iter_args; ++j) {
+            int pos = combiners[j] == nullptr || i == 0
+                          ? j
+                          : accumulators_pos[j] + i - 1;
+            results[pos] = yielded[j];
+          }
+        }
+        builder.create<mlir::scf::YieldOp>(loc, results);
+      });
+
+  // Combine accumulators of each reduction.
+  llvm::SmallVector<mlir::Value> remainder_inits =
+      llvm::to_vector(groups_loop.getResults().take_front(num_iter_args));
+  for (int i = 0; i < num_iter_args; ++i) {
+    if (combiners[i] == nullptr) continue;
+    mlir::Value accumulator = for_op.getRegionIterArgs()[i];
+    for (int j = 0; j < num_accumulators - 1; ++j) {
+      mlir::Value value = groups_loop.getResult(accumulators_pos[i] + j);
+      mlir::IRMapping mapping;
+      for (mlir::Value operand : combiners[i]->getOperands()) {
+        mapping.map(operand,
+                    operand == accumulator ? remainder_inits[i] : value);
+      }
+      remainder_inits[i] = driver.clone(*combiners[i], mapping)->getResult(0);
+    }
+  }
+
+  // Execute remaining iterations with the original loop body.
+  auto remainder_loop = driver.create<mlir::scf::ForOp>(
+      loc, groups_end, upper_bound, for_op.getStep(), remainder_inits,
+      [&](mlir::OpBuilder &builder, mlir::Location loc, mlir::Value index,
+          mlir::ValueRange args) {
+        builder.create<mlir::scf::YieldOp>(loc,
+                                           clone_body(builder, index, args));
+      });
+  driver.replaceOp(for_op, remainder_loop.getResults());
+  return groups_loop;
+}
+
+// Creates a scf.parallel operation at the current insertion point of `driver`
+// and nests the rest of the current block, except the terminator, in the loop.
+// Replaces `old_index` by the index of the loop.
+mlir::scf::ParallelOp CreateParallelOp(mlir::Location loc,
+                                       mlir::Value lower_bound,
+                                       mlir::Value upper_bound,
+                                       llvm::APInt step, mlir::Value old_index,
+                                       Driver &driver) {
+  mlir::OpBuilder::InsertionGuard guard(driver);
+  mlir::Value step_value =
+      driver.create<mlir::arith::ConstantIndexOp>(loc, step.getSExtValue());
+  auto parallel_op = driver.create<mlir::scf::ParallelOp>(
+      loc, mlir::ValueRange(lower_bound), mlir::ValueRange(upper_bound),
+      mlir::ValueRange(step_value));
+
+  // Move the loop body before the scf.yield operation created by the builder.
+  mlir::Block &block = *driver.getBlock();
+  mlir::Block::OpListType &body = parallel_op.getBody()->getOperations();
+  body.splice(body.begin(), block.getOperations(),
+              mlir::Block::iterator(parallel_op.getOperation()->getNextNode()),
+              block.without_terminator().end());
+
+  old_index.replaceAllUsesWith(parallel_op.getInductionVars().front());
+  return parallel_op;
+}
+
+// Maps the single dimension of `parallel_op` to the GPU processor named
+// `processor`, so that it is turned into a gpu.launch dimension when converting
+// parallel loops to GPU.
+void SetGpuMapping(mlir::scf::ParallelOp parallel_op,
+                   mlir::StringAttr processor) {
+  mlir::MLIRContext *context = parallel_op.getContext();
+  std::optional<mlir::gpu::Processor> processor_kind =
+      mlir::gpu::symbolizeProcessor(processor.getValue());
+  assert(processor_kind.has_value());
+  auto identity = mlir::AffineMap::getMultiDimIdentityMap(1, context);
+  auto mapping = mlir::gpu::ParallelLoopDimMappingAttr::get(
+      context, *processor_kind, identity, identity);
+  AssertSuccess(mlir::gpu::setMappingAttr(parallel_op, {mapping}));
+}
+
 // Use builder to create a variable of the given type. The variable value will
 // not be used. Returns nullptr if the type is not an integer or float type.
 mlir::Value GetValueOfType(mlir::Location loc, mlir::Type type,
@@ -521,10 +730,659 @@ mlir::LogicalResult UpdateLoopUser(SairMapOp old_op, SairMapOp new_op,
   return mlir::success();
 }
 
-// Replaces the innermost dimension of the domain by a loop.
+// Indicates if `expr` only contains additions and multiplications by
+// constants.
+bool IsLinear(mlir::AffineExpr expr) {
+  bool is_linear = true;
+  expr.walk([&](mlir::AffineExpr sub_expr) {
+    switch (sub_expr.getKind()) {
+      case mlir::AffineExprKind::FloorDiv:
+      case mlir::AffineExprKind::CeilDiv:
+      case mlir::AffineExprKind::Mod:
+        is_linear = false;
+        break;
+      default:
+        break;
+    }
+  });
+  return is_linear;
+}
+
+// Returns the memref `memref` refers to, looking through arguments of sair.map
+// bodies and sair.from_scalar operations.
+mlir::Value GetMemRefSource(mlir::Value memref) {
+  while (true) {
+    if (auto arg = memref.dyn_cast<mlir::BlockArgument>()) {
+      auto map_op = dyn_cast<SairMapOp>(arg.getOwner()->getParentOp());
+      if (map_op == nullptr) return memref;
+      int position = arg.getArgNumber() - map_op.getDomain().size();
+      if (position < 0) return memref;
+      memref = map_op.getInputs()[position];
+    } else if (auto from_scalar = memref.getDefiningOp<SairFromScalarOp>()) {
+      memref = from_scalar.getValue();
+    } else {
+      return memref;
+    }
+  }
+}
+
+// Indicates if `source`, as returned by GetMemRefSource, cannot alias any other
+// memref: it is either allocated by the program or a function argument marked
+// with `llvm.noalias`.
+bool IsDistinctMemRef(mlir::Value source) {
+  if (auto arg = source.dyn_cast<mlir::BlockArgument>()) {
+    auto func = dyn_cast<mlir::func::FuncOp>(arg.getOwner()->getParentOp());
+    if (func == nullptr || arg.getOwner() != &func.getBody().front()) {
+      return false;
+    }
+    return func.getArgAttr(arg.getArgNumber(), "llvm.noalias") != nullptr;
+  }
+  mlir::Operation *defining_op = source.getDefiningOp();
+  return isa<mlir::memref::AllocOp, mlir::memref::AllocaOp, SairOp>(
+      defining_op);
+}
+
+// Indicates if `lhs` and `rhs` are computed by equivalent side-effect free
+// operations.
+bool AreEquivalentValues(mlir::Value lhs, mlir::Value rhs) {
+  if (lhs == rhs) return true;
+  mlir::Operation *lhs_op = lhs.getDefiningOp();
+  mlir::Operation *rhs_op = rhs.getDefiningOp();
+  if (lhs_op == nullptr || rhs_op == nullptr ||
+      !mlir::isMemoryEffectFree(lhs_op) || lhs_op->getNumRegions() > 0) {
+    return false;
+  }
+  return mlir::OperationEquivalence::isEquivalentTo(
+      lhs_op, rhs_op,
+      [](mlir::Value lhs, mlir::Value rhs) {
+        return mlir::success(AreEquivalentValues(lhs, rhs));
+      },
+      /*markEquivalent=*/nullptr,
+      mlir::OperationEquivalence::Flags::IgnoreLocations);
+}
+
+// Fails if iterations of the loop with body `block` may access memory written
+// by other iterations. Memrefs written in the loop must only be accessed at
+// the indices they are written to and must not alias other accessed memrefs.
+mlir::LogicalResult VerifyNoLoopCarriedMemoryDependencies(mlir::Block &block) {
+  struct Access {
+    mlir::Operation *op;
+    mlir::Value source;
+    mlir::ValueRange indices;
+  };
+  llvm::SmallVector<Access> accesses;
+  llvm::SmallVector<Access> writes;
+  block.walk([&](mlir::Operation *op) {
+    if (auto load = dyn_cast<mlir::memref::LoadOp>(op)) {
+      accesses.push_back(
+          {op, GetMemRefSource(load.getMemRef()), load.getIndices()});
+    } else if (auto store = dyn_cast<mlir::memref::StoreOp>(op)) {
+      accesses.push_back(
+          {op, GetMemRefSource(store.getMemRef()), store.getIndices()});
+      writes.push_back(accesses.back());
+    }
+  });
+
+  for (const Access &write : writes) {
+    for (const Access &access : accesses) {
+      if (access.op == write.op) continue;
+      if (access.source != write.source) {
+        if (IsDistinctMemRef(access.source) || IsDistinctMemRef(write.source)) {
+          continue;
+        }
+      } else if (llvm::all_of(llvm::zip(access.indices, write.indices),
+                              [](auto pair) {
+                                return AreEquivalentValues(std::get<0>(pair),
+                                                           std::get<1>(pair));
+                              })) {
+        continue;
+      }
+      return write.op->emitError()
+             << "unable to vectorize a loop with memory dependencies between "
+                "iterations";
+    }
+  }
+  return mlir::success();
+}
+
+// Rewrites the body of a loop with a single iteration per vector lane into
+// vector operations executing all iterations at once. The rewrite happens in
+// place, before the terminator of the body. Fails if there are memory
+// dependencies between iterations of the loop.
+//
+// Values computed in the body are classified as:
+// - uniform if they do not depend on the loop index, in which case their
+//   computation is left untouched,
+// - linear if they are equal to a scalar base plus the vector lane, in which
+//   case a scalar operation computing the base is created,
+// - vectors holding one element per lane otherwise.
+class LoopVectorizer {
+ public:
+  // Vectorizes a loop with `width` iterations, starting at `lower_bound` with
+  // step 1 and with induction variable `index`. If non-null, `num_lanes` is
+  // the actual number of iterations, that may be smaller than `width`.
+  LoopVectorizer(mlir::Value index, mlir::Value lower_bound,
+                 mlir::Value num_lanes, int64_t width, Driver &driver)
+      : num_lanes_(num_lanes), width_(width), driver_(driver) {
+    linear_.try_emplace(index, lower_bound);
+  }
+
+  // Vectorizes operations of `block`, except for its terminator. Replaces
+  // terminator operands by their value in the last iteration.
+  mlir::LogicalResult Vectorize(mlir::Block &block);
+
+ private:
+  // Creates vector operations that compute the result of `op` for all lanes.
+  // Leaves uniform operations untouched and sets `erase` to false for them.
+  mlir::LogicalResult Vectorize(mlir::Operation *op, bool &erase);
+  mlir::LogicalResult VectorizeAffineApply(mlir::affine::AffineApplyOp op);
+  mlir::LogicalResult VectorizeLoad(mlir::memref::LoadOp op);
+  mlir::LogicalResult VectorizeStore(mlir::memref::StoreOp op);
+  mlir::LogicalResult VectorizeElementwise(mlir::Operation *op);
+
+  // Indicates if `value` depends on the loop index.
+  bool IsVarying(mlir::Value value) const {
+    return linear_.count(value) > 0 || vectors_.count(value) > 0;
+  }
+
+  // Returns memory access indices with the innermost index replaced by its
+  // base. Fails if the access is not contiguous along the vector lanes.
+  mlir::FailureOr<llvm::SmallVector<mlir::Value>> GetContiguousIndices(
+      mlir::ValueRange indices) const;
+
+  // Returns a vector holding `value` for all lanes.
+  mlir::Value GetVector(mlir::Location loc, mlir::Value value);
+
+  // Returns the value of `value` in the last iteration of the loop.
+  mlir::Value GetLastValue(mlir::Location loc, mlir::Value value);
+
+  // Returns a mask of the active lanes, or nullptr if all lanes are active.
+  mlir::Value GetMask(mlir::Location loc);
+
+  mlir::Value num_lanes_;
+  int64_t width_;
+  Driver &driver_;
+  mlir::Value mask_;
+
+  llvm::DenseMap<mlir::Value, mlir::Value> linear_;
+  llvm::DenseMap<mlir::Value, mlir::Value> vectors_;
+  llvm::DenseMap<mlir::Value, mlir::Value> broadcasts_;
+};
+
+mlir::LogicalResult LoopVectorizer::Vectorize(mlir::Block &block) {
+  if (mlir::failed(VerifyNoLoopCarriedMemoryDependencies(block))) {
+    return mlir::failure();
+  }
+
+  llvm::SmallVector<mlir::Operation *> to_erase;
+  for (mlir::Operation &op :
+       llvm::make_early_inc_range(block.without_terminator())) {
+    bool erase = true;
+    driver_.setInsertionPoint(&op);
+    if (mlir::failed(Vectorize(&op, erase))) return mlir::failure();
+    if (erase) to_erase.push_back(&op);
+  }
+
+  mlir::Operation *terminator = block.getTerminator();
+  driver_.setInsertionPoint(terminator);
+  for (mlir::OpOperand &operand : terminator->getOpOperands()) {
+    operand.set(GetLastValue(terminator->getLoc(), operand.get()));
+  }
+
+  for (mlir::Operation *op : llvm::reverse(to_erase)) {
+    driver_.eraseOp(op);
+  }
+  return mlir::success();
+}
+
+mlir::LogicalResult LoopVectorizer::Vectorize(mlir::Operation *op,
+                                              bool &erase) {
+  if (!llvm::any_of(op->getOperands(),
+                    [&](mlir::Value value) { return IsVarying(value); })) {
+    // Uniform operations are executed once for all lanes.
+    erase = false;
+    if (isa<mlir::memref::LoadOp, mlir::memref::StoreOp>(op) ||
+        mlir::isMemoryEffectFree(op)) {
+      return mlir::success();
+    }
+    return op->emitError() << "unable to vectorize operation with side effects";
+  }
+
+  return llvm::TypeSwitch<mlir::Operation *, mlir::LogicalResult>(op)
+      .Case<mlir::affine::AffineApplyOp>(
+          [&](auto op) { return VectorizeAffineApply(op); })
+      .Case<mlir::memref::LoadOp>([&](auto op) { return VectorizeLoad(op); })
+      .Case<mlir::memref::StoreOp>([&](auto op) { return VectorizeStore(op); })
+      .Default([&](mlir::Operation *op) -> mlir::LogicalResult {
+        if (op->hasTrait<mlir::OpTrait::Elementwise>() &&
+            op->getNumRegions() == 0) {
+          return VectorizeElementwise(op);
+        }
+        return op->emitError() << "unable to vectorize operation";
+      });
+}
+
+mlir::LogicalResult LoopVectorizer::VectorizeAffineApply(
+    mlir::affine::AffineApplyOp op) {
+  mlir::AffineMap map = op.getAffineMap();
+  mlir::AffineExpr expr = mlir::simplifyAffineExpr(
+      map.getResult(0), map.getNumDims(), map.getNumSymbols());
+  if (!IsLinear(expr)) {
+    return op.emitError() << "unable to vectorize non-linear index computation";
+  }
+
+  // Compute the variation of the result between two consecutive lanes.
+  llvm::SmallVector<mlir::Value> base_operands;
+  llvm::DenseMap<mlir::AffineExpr, mlir::AffineExpr> next_lane;
+  for (auto [pos, operand] : llvm::enumerate(op.getMapOperands())) {
+    auto it = linear_.find(operand);
+    if (it == linear_.end()) {
+      if (vectors_.count(operand) > 0) {
+        return op.emitError() << "unable to vectorize indirect index";
+      }
+      base_operands.push_back(operand);
+      continue;
+    }
+    base_operands.push_back(it->second);
+    mlir::AffineExpr operand_expr =
+        pos < map.getNumDims()
+            ? mlir::getAffineDimExpr(pos, op.getContext())
+            : mlir::getAffineSymbolExpr(pos - map.getNumDims(),
+                                        op.getContext());
+    next_lane.try_emplace(operand_expr, operand_expr + 1);
+  }
+  mlir::AffineExpr stride_expr = mlir::simplifyAffineExpr(
+      expr.replace(next_lane) - expr, map.getNumDims(), map.getNumSymbols());
+  auto stride = stride_expr.dyn_cast<mlir::AffineConstantExpr>();
+  if (stride == nullptr) {
+    return op.emitError() << "unable to vectorize non-linear index computation";
+  }
+
+  mlir::Value base = driver_.create<mlir::affine::AffineApplyOp>(
+      op.getLoc(), map, base_operands);
+  if (stride.getValue() == 0) {
+    op.getResult().replaceAllUsesWith(base);
+  } else if (stride.getValue() == 1) {
+    linear_.try_emplace(op.getResult(), base);
+  } else {
+    llvm::SmallVector<int64_t> offsets;
+    offsets.reserve(width_);
+    for (int64_t i = 0; i < width_; ++i) {
+      offsets.push_back(i * stride.getValue());
+    }
+    auto offsets_attr = driver_.getIndexVectorAttr(offsets);
+    auto offsets_op = driver_.create<mlir::arith::ConstantOp>(
+        op.getLoc(), cast<mlir::TypedAttr>(offsets_attr));
+    mlir::Value vector = driver_.create<mlir::arith::AddIOp>(
+        op.getLoc(), GetVector(op.getLoc(), base), offsets_op);
+    vectors_.try_emplace(op.getResult(), vector);
+  }
+  return mlir::success();
+}
+
+mlir::FailureOr<llvm::SmallVector<mlir::Value>>
+LoopVectorizer::GetContiguousIndices(mlir::ValueRange indices) const {
+  if (indices.empty()) return mlir::failure();
+  llvm::SmallVector<mlir::Value> base_indices = indices;
+  for (mlir::Value index : indices.drop_back()) {
+    if (IsVarying(index)) return mlir::failure();
+  }
+  auto it = linear_.find(indices.back());
+  if (it == linear_.end()) return mlir::failure();
+  base_indices.back() = it->second;
+  return base_indices;
+}
+
+mlir::LogicalResult LoopVectorizer::VectorizeLoad(mlir::memref::LoadOp op) {
+  mlir::FailureOr<llvm::SmallVector<mlir::Value>> indices =
+      GetContiguousIndices(op.getIndices());
+  if (mlir::failed(indices)) {
+    return op.emitError() << "unable to vectorize non-contiguous load";
+  }
+
+  auto vector_type = mlir::VectorType::get({width_}, op.getType());
+  mlir::Value vector;
+  if (mlir::Value mask = GetMask(op.getLoc())) {
+    auto zero_attr = cast<mlir::TypedAttr>(driver_.getZeroAttr(vector_type));
+    mlir::Value pass_thru =
+        driver_.create<mlir::arith::ConstantOp>(op.getLoc(), zero_attr);
+    vector = driver_.create<mlir::vector::MaskedLoadOp>(
+        op.getLoc(), vector_type, op.getMemRef(), *indices, mask, pass_thru);
+  } else {
+    vector = driver_.create<mlir::vector::LoadOp>(op.getLoc(), vector_type,
+                                                  op.getMemRef(), *indices);
+  }
+  vectors_.try_emplace(op.getResult(), vector);
+  return mlir::success();
+}
+
+mlir::LogicalResult LoopVectorizer::VectorizeStore(mlir::memref::StoreOp op) {
+  mlir::FailureOr<llvm::SmallVector<mlir::Value>> indices =
+      GetContiguousIndices(op.getIndices());
+  if (IsVarying(op.getMemRef()) || mlir::failed(indices)) {
+    return op.emitError() << "unable to vectorize non-contiguous store";
+  }
+
+  mlir::Value vector = GetVector(op.getLoc(), op.getValueToStore());
+  if (mlir::Value mask = GetMask(op.getLoc())) {
+    driver_.create<mlir::vector::MaskedStoreOp>(op.getLoc(), op.getMemRef(),
+                                                *indices, mask, vector);
+  } else {
+    driver_.create<mlir::vector::StoreOp>(op.getLoc(), vector, op.getMemRef(),
+                                          *indices);
+  }
+  return mlir::success();
+}
+
+mlir::LogicalResult LoopVectorizer::VectorizeElementwise(mlir::Operation *op) {
+  // Inactive lanes of partial tiles hold arbitrary values, such as the zeros
+  // read by masked loads. Divide them by one to avoid undefined behavior.
+  mlir::Value divisor_mask;
+  if (isa<mlir::arith::DivSIOp, mlir::arith::DivUIOp, mlir::arith::RemSIOp,
+          mlir::arith::RemUIOp, mlir::arith::CeilDivSIOp,
+          mlir::arith::CeilDivUIOp, mlir::arith::FloorDivSIOp>(op)) {
+    divisor_mask = GetMask(op->getLoc());
+  }
+
+  mlir::OperationState state(op->getLoc(), op->getName());
+  for (auto [position, operand] : llvm::enumerate(op->getOperands())) {
+    mlir::Value vector = GetVector(op->getLoc(), operand);
+    if (divisor_mask != nullptr && position == 1) {
+      auto ones = driver_.create<mlir::arith::ConstantOp>(
+          op->getLoc(), driver_.getOneAttr(vector.getType()));
+      vector = driver_.create<mlir::arith::SelectOp>(
+          op->getLoc(), divisor_mask, vector, ones);
+    }
+    state.addOperands(vector);
+  }
+  for (mlir::Type type : op->getResultTypes()) {
+    state.addTypes(mlir::VectorType::get({width_}, type));
+  }
+  state.addAttributes(op->getAttrs());
+  mlir::Operation *vector_op = driver_.create(state);
+  for (auto [old_value, new_value] :
+       llvm::zip(op->getResults(), vector_op->getResults())) {
+    vectors_.try_emplace(old_value, new_value);
+  }
+  return mlir::success();
+}
+
+mlir::Value LoopVectorizer::GetVector(mlir::Location loc, mlir::Value value) {
+  auto vector_it = vectors_.find(value);
+  if (vector_it != vectors_.end()) return vector_it->second;
+
+  auto broadcast_it = broadcasts_.find(value);
+  if (broadcast_it != broadcasts_.end()) return broadcast_it->second;
+
+  auto linear_it = linear_.find(value);
+  mlir::Value scalar = linear_it == linear_.end() ? value : linear_it->second;
+  auto vector_type = mlir::VectorType::get({width_}, scalar.getType());
+  mlir::Value vector =
+      driver_.create<mlir::vector::BroadcastOp>(loc, vector_type, scalar);
+  if (linear_it == linear_.end()) {
+    broadcasts_.try_emplace(value, vector);
+    return vector;
+  }
+
+  // Add the lane number to the base of linear values.
+  llvm::SmallVector<int64_t> lanes =
+      llvm::to_vector(llvm::seq<int64_t>(0, width_));
+  auto lanes_op = driver_.create<mlir::arith::ConstantOp>(
+      loc, cast<mlir::TypedAttr>(driver_.getIndexVectorAttr(lanes)));
+  vector = driver_.create<mlir::arith::AddIOp>(loc, vector, lanes_op);
+  vectors_.try_emplace(value, vector);
+  return vector;
+}
+
+mlir::Value LoopVectorizer::GetLastValue(mlir::Location loc,
+                                         mlir::Value value) {
+  if (!IsVarying(value)) return value;
+  mlir::Value last_lane;
+  if (num_lanes_ == nullptr) {
+    last_lane = driver_.create<mlir::arith::ConstantIndexOp>(loc, width_ - 1);
+  } else {
+    auto map = mlir::AffineMap::get(1, 0, driver_.getAffineDimExpr(0) - 1);
+    last_lane =
+        driver_.create<mlir::affine::AffineApplyOp>(loc, map, num_lanes_);
+  }
+
+  auto linear_it = linear_.find(value);
+  if (linear_it != linear_.end()) {
+    return driver_.create<mlir::arith::AddIOp>(loc, linear_it->second,
+                                               last_lane);
+  }
+  return driver_.create<mlir::vector::ExtractElementOp>(loc, vectors_[value],
+                                                        last_lane);
+}
+
+mlir::Value LoopVectorizer::GetMask(mlir::Location loc) {
+  if (num_lanes_ == nullptr || mask_ != nullptr) return mask_;
+  auto mask_type = mlir::VectorType::get({width_}, driver_.getI1Type());
+  mask_ = driver_.create<mlir::vector::CreateMaskOp>(loc, mask_type,
+                                                     num_lanes_);
+  return mask_;
+}
+
+// Creates operations computing the number of iterations of a loop from
+// `lower_bound` to `upper_bound` with step `step`.
+mlir::Value CreateTripCount(mlir::Location loc, mlir::Value lower_bound,
+                            mlir::Value upper_bound, llvm::APInt step,
+                            Driver &driver) {
+  mlir::Value trip_count =
+      driver.create<arith::SubIOp>(loc, upper_bound, lower_bound);
+  if (!step.isOne()) {
+    int64_t step_value = step.getSExtValue();
+    auto rounding = driver.create<arith::ConstantIndexOp>(loc, step_value - 1);
+    auto divisor = driver.create<arith::ConstantIndexOp>(loc, step_value);
+    trip_count = driver.create<arith::AddIOp>(loc, trip_count, rounding);
+    trip_count = driver.create<arith::DivSIOp>(loc, trip_count, divisor);
+  }
+  auto zero = driver.create<arith::ConstantIndexOp>(loc, 0);
+  return driver.create<arith::MaxSIOp>(loc, trip_count, zero);
+}
+
+// Options controlling how loops are generated.
+struct LoopOptions {
+  // Record the cycles and trip count of loops in the profiling runtime.
+  bool profile_loops;
+  // Specialize loops over partial tiles for full tiles.
+  bool multiversion_loops;
+  // Range sizes for which loops with dynamic bounds are specialized.
+  llvm::ArrayRef<int64_t> specialize_sizes;
+};
+
+// Returns the distances between the bounds of a sequential loop over `range`
+// for which the loop is specialized: the size of full tiles if `range` may be
+// a partial tile and either `options.multiversion_loops` or `in_peeled_loop`
+// is set, followed by `options.specialize_sizes`. Returns an empty list if the
+// bounds are constant.
+llvm::SmallVector<int64_t> GetSpecializedExtents(RangeOp range,
+                                                 const LoopOptions &options,
+                                                 bool in_peeled_loop) {
+  llvm::SmallVector<int64_t> extents;
+  if (range.LowerBound().is_constant() && range.UpperBound().is_constant()) {
+    return extents;
+  }
+  bool is_exact = true;
+  std::optional<int64_t> max_trip_count = GetMaxTripCount(range, is_exact);
+  if ((options.multiversion_loops || in_peeled_loop) &&
+      max_trip_count.has_value() && !is_exact) {
+    extents.push_back(*max_trip_count * range.Step());
+  }
+  for (int64_t size : options.specialize_sizes) {
+    if (size > 0 && !llvm::is_contained(extents, size)) {
+      extents.push_back(size);
+    }
+  }
+  return extents;
+}
+
+// Versions `for_op` for each distance between its bounds in `extents`. When
+// the distance between the bounds matches an extent at runtime, executes a
+// copy of the loop iterating from zero to the extent, that has a static trip
+// count and no remainder logic, and offsets its induction variable by the
+// lower bound. Returns the static versions followed by the original loop.
+llvm::SmallVector<mlir::scf::ForOp> MultiversionLoop(
+    mlir::scf::ForOp for_op, llvm::ArrayRef<int64_t> extents, Driver &driver) {
+  mlir::OpBuilder::InsertionGuard guard(driver);
+  mlir::Location loc = for_op.getLoc();
+  llvm::SmallVector<mlir::scf::ForOp> loops;
+
+  // Nests `loop` in `block`, yielding the results of the loop.
+  auto nest = [&](mlir::Block *block, mlir::scf::ForOp loop) {
+    if (block->empty()) {
+      loop->moveBefore(block, block->end());
+      driver.setInsertionPointToEnd(block);
+      driver.create<mlir::scf::YieldOp>(loc, loop.getResults());
+    } else {
+      loop->moveBefore(block->getTerminator());
+    }
+  };
+
+  for (int64_t extent : extents) {
+    driver.setInsertionPoint(for_op);
+    mlir::Value lower_bound = for_op.getLowerBound();
+    mlir::Value distance = driver.create<arith::SubIOp>(
+        loc, for_op.getUpperBound(), lower_bound);
+    mlir::Value zero = driver.create<arith::ConstantIndexOp>(loc, 0);
+    mlir::Value extent_value =
+        driver.create<arith::ConstantIndexOp>(loc, extent);
+    mlir::Value condition = driver.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::eq, distance, extent_value);
+    auto if_op = driver.create<mlir::scf::IfOp>(
+        loc, for_op.getResultTypes(), condition, /*withElseRegion=*/true);
+    for_op->replaceAllUsesWith(if_op.getResults());
+
+    auto static_op = cast<mlir::scf::ForOp>(driver.clone(*for_op));
+    nest(if_op.thenBlock(), static_op);
+    nest(if_op.elseBlock(), for_op);
+    static_op.setLowerBound(zero);
+    static_op.setUpperBound(extent_value);
+    driver.setInsertionPointToStart(static_op.getBody());
+    mlir::Value index = static_op.getInductionVar();
+    mlir::Value shifted_index =
+        driver.create<arith::AddIOp>(loc, lower_bound, index);
+    index.replaceAllUsesExcept(shifted_index,
+                               shifted_index.getDefiningOp());
+    loops.push_back(static_op);
+  }
+
+  loops.push_back(for_op);
+  return loops;
+}
+
+// Indicates if `lhs` and `rhs`, defined in the body of `op`, hold the same
+// value: they are equal constants or arguments bound to the same operand.
+bool IsSameBound(mlir::Value lhs, mlir::Value rhs, SairMapOp op) {
+  if (lhs == rhs) return true;
+  llvm::APInt lhs_value, rhs_value;
+  if (mlir::matchPattern(lhs, mlir::m_ConstantInt(&lhs_value)) &&
+      mlir::matchPattern(rhs, mlir::m_ConstantInt(&rhs_value))) {
+    return lhs_value == rhs_value;
+  }
+  auto lhs_arg = lhs.dyn_cast<mlir::BlockArgument>();
+  auto rhs_arg = rhs.dyn_cast<mlir::BlockArgument>();
+  // The body may still have the argument of the dimension being replaced.
+  int domain_size = op.block().getNumArguments() - op.getInputs().size();
+  if (lhs_arg == nullptr || rhs_arg == nullptr ||
+      lhs_arg.getOwner() != &op.block() || rhs_arg.getOwner() != &op.block() ||
+      lhs_arg.getArgNumber() < domain_size ||
+      rhs_arg.getArgNumber() < domain_size) {
+    return false;
+  }
+  int lhs_pos = lhs_arg.getArgNumber() - domain_size;
+  int rhs_pos = rhs_arg.getArgNumber() - domain_size;
+  return op.getInputs()[lhs_pos] == op.getInputs()[rhs_pos] &&
+         op.getMappingArray()[lhs_pos] == op.getMappingArray()[rhs_pos];
+}
+
+// Indicates if `value` is the induction variable `index`, possibly forwarded
+// by an affine.apply operation.
+bool IsIndex(mlir::Value value, mlir::Value index) {
+  if (value == index) return true;
+  auto apply = value.getDefiningOp<mlir::affine::AffineApplyOp>();
+  if (apply == nullptr) return false;
+  auto dim_expr =
+      apply.getAffineMap().getResult(0).dyn_cast<mlir::AffineDimExpr>();
+  return dim_expr != nullptr &&
+         apply.getMapOperands()[dim_expr.getPosition()] == index;
+}
+
+// Splits `for_op`, nested in the body of `op`, into a loop over the iterations
+// that start a full tile of `step` indices, followed by an epilogue loop
+// executing the last partial tile, if any. In the first loop, replaces the
+// ends of tiles `min(begin + size, end)` computed from the induction variable,
+// as created by `GetRangeParameters`, by `begin + size` so that inner loops
+// iterate on full tiles. Does nothing if bounds are constant and the range is
+// a multiple of `step`.
+void PeelLoop(mlir::scf::ForOp for_op, int64_t step, SairMapOp op,
+              Driver &driver) {
+  mlir::OpBuilder::InsertionGuard guard(driver);
+  mlir::Location loc = for_op.getLoc();
+  mlir::Value lower_bound = for_op.getLowerBound();
+  mlir::Value upper_bound = for_op.getUpperBound();
+  llvm::APInt lower_value, upper_value;
+  if (mlir::matchPattern(lower_bound, mlir::m_ConstantInt(&lower_value)) &&
+      mlir::matchPattern(upper_bound, mlir::m_ConstantInt(&upper_value)) &&
+      (upper_value - lower_value).getSExtValue() % step == 0) {
+    return;
+  }
+
+  // Iterations before `split` start a full tile.
+  driver.setInsertionPoint(for_op);
+  mlir::Value distance =
+      driver.create<arith::SubIOp>(loc, upper_bound, lower_bound);
+  mlir::Value num_tiles =
+      driver.create<arith::DivSIOp>(loc, distance, for_op.getStep());
+  mlir::Value full_distance =
+      driver.create<arith::MulIOp>(loc, num_tiles, for_op.getStep());
+  mlir::Value split =
+      driver.create<arith::AddIOp>(loc, lower_bound, full_distance);
+
+  driver.setInsertionPointAfter(for_op);
+  auto epilogue = cast<mlir::scf::ForOp>(driver.clone(*for_op));
+  for_op->replaceAllUsesWith(epilogue.getResults());
+  epilogue.setLowerBound(split);
+  for (auto [pos, result] : llvm::enumerate(for_op.getResults())) {
+    epilogue->setOperand(epilogue.getNumControlOperands() + pos, result);
+  }
+  for_op.setUpperBound(split);
+
+  mlir::Value index = for_op.getInductionVar();
+  llvm::SmallVector<mlir::arith::SelectOp> tile_ends;
+  for_op.walk([&](mlir::arith::SelectOp select) {
+    auto is_capped = select.getCondition().getDefiningOp<arith::CmpIOp>();
+    auto uncapped_end = select.getFalseValue().getDefiningOp<arith::AddIOp>();
+    if (is_capped == nullptr || uncapped_end == nullptr ||
+        is_capped.getPredicate() != arith::CmpIPredicate::ult ||
+        is_capped.getLhs() != select.getTrueValue() ||
+        is_capped.getRhs() != uncapped_end.getResult() ||
+        !IsSameBound(select.getTrueValue(), upper_bound, op)) {
+      return;
+    }
+    mlir::Value size = uncapped_end.getRhs();
+    if (!IsIndex(uncapped_end.getLhs(), index)) return;
+    llvm::APInt size_value;
+    if (!mlir::matchPattern(size, mlir::m_ConstantInt(&size_value)) ||
+        size_value.getSExtValue() > step) {
+      return;
+    }
+    tile_ends.push_back(select);
+  });
+  for (mlir::arith::SelectOp select : tile_ends) {
+    driver.replaceOp(select, select.getFalseValue());
+  }
+}
+
+// Replaces the innermost dimension of the domain by a loop. If
+// `options.profile_loops` is true, records the cycles and trip count of the
+// loop in the profiling runtime. Sequential loops with dynamic bounds are
+// specialized as specified by `options` and `num_multiversioned` is
+// incremented for each specialized loop.
 mlir::LogicalResult IntroduceLoop(SairMapOp op,
                                   const StorageAnalysis &storage_analysis,
-                                  Driver &driver) {
+                                  const LoopOptions &options,
+                                  int &num_multiversioned, Driver &driver) {
   auto *sair_dialect = static_cast<SairDialect *>(op->getDialect());
   llvm::ArrayRef<mlir::Attribute> loop_nest =
       ComputeOpInstance::Unique(cast<ComputeOp>(op.getOperation())).Loops();
@@ -539,6 +1397,38 @@ mlir::LogicalResult IntroduceLoop(SairMapOp op,
   }
 
   RangeOp range = cast<RangeOp>(dimension_op);
+  DecisionsAttr decisions = op.GetDecisions(0);
+
+  // Loops of operations with a vector expansion pattern are replaced by vector
+  // operations instead of a scf.for operation.
+  bool vectorize = decisions.expansion() != nullptr &&
+                   decisions.expansion().getValue() == kVectorExpansionPattern;
+  // Loops mapped to GPU processors are lowered to annotated scf.parallel
+  // operations.
+  bool parallel = loop.parallel() != nullptr || loop.gpu() != nullptr;
+  bool is_exact_width = true;
+  std::optional<int64_t> width;
+  if (vectorize) {
+    width = GetMaxTripCount(range, is_exact_width);
+    if (!width.has_value() || range.Step() != 1) {
+      return op.emitError() << "vector expansion requires the innermost loop "
+                               "to have a static size and a unit step";
+    }
+    if (llvm::any_of(op.ValueOperands(), [](ValueOperand operand) {
+          return isa_and_nonnull<SairFbyOp>(operand.value().getDefiningOp());
+        })) {
+      return op.emitError()
+             << "vector loops cannot carry values between iterations";
+    }
+    if (loop.gpu() != nullptr) {
+      return op.emitError()
+             << "vector loops cannot be mapped to GPU processors";
+    }
+    if (loop.accumulators() != nullptr) {
+      return op.emitError() << "vector loops cannot interleave accumulators";
+    }
+  }
+
   MappingAttr range_mapping =
       op.getShape().Dimension(dimension).dependency_mapping().ResizeUseDomain(
           op.getDomain().size() - 1);
@@ -584,12 +1474,13 @@ mlir::LogicalResult IntroduceLoop(SairMapOp op,
   driver.setInsertionPoint(op);
   mlir::ArrayAttr new_loop_nest = EraseDimensionFromLoopNest(
       loop_nest.drop_back(), dimension, driver.getContext());
-  DecisionsAttr decisions = op.GetDecisions(0);
+  mlir::StringAttr expansion = decisions.expansion();
+  if (vectorize) expansion = driver.getStringAttr(kMapExpansionPattern);
   auto new_decisions = DecisionsAttr::get(
       /*sequence=*/decisions.sequence(),
       /*loop_nest=*/new_loop_nest,
       /*storage=*/decisions.storage(),
-      /*expansion=*/decisions.expansion(),
+      /*expansion=*/expansion,
       /*copy_of=*/nullptr,
       /*operands=*/EraseOperandFromArray(decisions.operands(), dimension),
       op.getContext());
@@ -642,6 +1533,19 @@ mlir::LogicalResult IntroduceLoop(SairMapOp op,
                                     new_op.getResult(i), dimension, driver))) {
       return mlir::failure();
     }
+    if (vectorize) continue;
+    // `VerifyLoopNests` rejects values carried across iterations of parallel
+    // loops, so their results must not be used after the loop.
+    if (parallel) {
+      if (!new_op.getResult(i).use_empty()) {
+        return op.emitError()
+               << "results of parallel loops cannot be used after the loop";
+      }
+      mlir::Operation *terminator = new_op.block().getTerminator();
+      mlir::Type type = terminator->getOperand(i).getType();
+      terminator->setOperand(i, driver.create<SairUndefOp>(op.getLoc(), type));
+      continue;
+    }
     // Use loop-carried values to project results out of the loop.
     if (results_pos[i] >= 0) continue;
     mlir::Type type = new_op.block().getTerminator()->getOperand(i).getType();
@@ -655,15 +1559,76 @@ mlir::LogicalResult IntroduceLoop(SairMapOp op,
     iter_args_result.push_back(result);
   }
 
-  // Create the scf.for operation.
   mlir::Value old_index = new_op.getBody().getArgument(dimension);
-  mlir::scf::ForOp for_op = CreateForOp(
-      op.getLoc(), lower_bound, upper_bound, step, old_index, iter_args_init,
-      iter_args, iter_args_result, results_pos, driver);
-  if (loop.unroll()) {
-    if (mlir::failed(mlir::loopUnrollByFactor(
-            for_op, loop.unroll().getValue().getZExtValue())))
-      return failure();
+
+  // Profiling probes surround the loops introduced below, including those
+  // created by accumulator interleaving and unrolling. Loops executing on GPUs
+  // cannot call the profiling runtime.
+  bool profile = options.profile_loops && !vectorize &&
+                 llvm::none_of(loop_nest, [](mlir::Attribute attr) {
+                   return attr.cast<LoopAttr>().gpu() != nullptr;
+                 });
+  mlir::Value profile_start;
+  mlir::Value trip_count;
+  if (profile) {
+    trip_count = CreateTripCount(op.getLoc(), lower_bound, upper_bound, step,
+                                 driver);
+    profile_start = driver.create<SairLoopProfileBeginOp>(op.getLoc(),
+                                                          driver.getI64Type());
+  }
+
+  if (vectorize) {
+    // Partial tiles only execute the first `upper_bound - lower_bound` lanes.
+    mlir::Value num_lanes;
+    if (!is_exact_width) {
+      num_lanes = driver.create<arith::SubIOp>(op.getLoc(), upper_bound,
+                                               lower_bound);
+    }
+    LoopVectorizer vectorizer(old_index, lower_bound, num_lanes, *width,
+                              driver);
+    if (mlir::failed(vectorizer.Vectorize(new_op.block()))) {
+      return mlir::failure();
+    }
+  } else if (parallel) {
+    assert(iter_args.empty());
+    mlir::scf::ParallelOp parallel_op = CreateParallelOp(
+        op.getLoc(), lower_bound, upper_bound, step, old_index, driver);
+    if (loop.gpu() != nullptr) SetGpuMapping(parallel_op, loop.gpu());
+  } else {
+    // Create the scf.for operation.
+    mlir::scf::ForOp for_op = CreateForOp(
+        op.getLoc(), lower_bound, upper_bound, step, old_index, iter_args_init,
+        iter_args, iter_args_result, results_pos, driver);
+    // The last tile of peeled loops executes separately, after full tiles.
+    if (loop.peel() != nullptr) {
+      PeelLoop(for_op, step.getSExtValue(), new_op, driver);
+    }
+    bool in_peeled_loop =
+        llvm::any_of(loop_nest.drop_back(), [](mlir::Attribute attr) {
+          return attr.cast<LoopAttr>().peel() != nullptr;
+        });
+    llvm::SmallVector<int64_t> extents =
+        GetSpecializedExtents(range, options, in_peeled_loop);
+    if (!extents.empty()) ++num_multiversioned;
+    for (mlir::scf::ForOp version : MultiversionLoop(for_op, extents, driver)) {
+      if (loop.accumulators()) {
+        mlir::FailureOr<mlir::scf::ForOp> groups_loop = InterleaveAccumulators(
+            version, step.getSExtValue(), loop, driver);
+        if (mlir::failed(groups_loop)) return mlir::failure();
+        version = *groups_loop;
+      }
+      if (loop.unroll()) {
+        if (mlir::failed(mlir::loopUnrollByFactor(
+                version, loop.unroll().getValue().getZExtValue())))
+          return failure();
+      }
+    }
+  }
+  if (profile) {
+    mlir::OpBuilder::InsertionGuard guard(driver);
+    driver.setInsertionPoint(new_op.block().getTerminator());
+    driver.create<SairLoopProfileEndOp>(op.getLoc(), loop.name(),
+                                        profile_start, trip_count);
   }
   new_op.getBody().eraseArgument(dimension);
 
@@ -761,11 +1726,18 @@ void Fuse(SairMapOp first_op, llvm::ArrayRef<mlir::Attribute> first_loop_nest,
   // Create the operation.
   driver.setInsertionPoint(second_op);
   DecisionsAttr first_decisions = first_op.GetDecisions(0);
+  DecisionsAttr second_decisions = second_op.GetDecisions(0);
+  // The fused loop is vectorized if any of the operations is.
+  mlir::StringAttr expansion = first_decisions.expansion();
+  if (second_decisions.expansion() != nullptr &&
+      second_decisions.expansion().getValue() == kVectorExpansionPattern) {
+    expansion = second_decisions.expansion();
+  }
   auto new_decisions = DecisionsAttr::get(
       /*sequence=*/first_decisions.sequence(),
       /*loop_nest=*/first_decisions.loop_nest(),
       /*storage=*/driver.getArrayAttr(storages),
-      /*expansion=*/first_decisions.expansion(),
+      /*expansion=*/expansion,
       /*copy_of=*/first_decisions.copy_of(),
       /*operands=*/
       GetInstanceZeroOperands(context,
@@ -796,11 +1768,19 @@ bool CanFuse(mlir::ArrayAttr lhs, mlir::ArrayAttr rhs) {
   return lhs_inner_loop.name() == rhs_inner_loop.name();
 }
 
+// Number of loops introduced, fused and specialized by IntroduceLoopOrFuse.
+struct LoopCounters {
+  int num_introduced = 0;
+  int num_fused = 0;
+  int num_multiversioned = 0;
+};
+
 // Introduces the innermost loop of `op` or fuse it with one of its immediate
 // neigbors if possible.
 mlir::LogicalResult IntroduceLoopOrFuse(
     SairMapOp op, const StorageAnalysis &storage_analysis,
-    const SequenceAnalysis &sequence_analysis, Driver &driver) {
+    const SequenceAnalysis &sequence_analysis, const LoopOptions &options,
+    Driver &driver, LoopCounters &counters) {
   auto op_instance =
       ComputeOpInstance::Unique(cast<ComputeOp>(op.getOperation()));
   ComputeOpInstance prev_op = sequence_analysis.PrevOp(op_instance);
@@ -815,19 +1795,54 @@ mlir::LogicalResult IntroduceLoopOrFuse(
     auto prev_map_op = cast<SairMapOp>(prev_op.GetDuplicatedOp());
     Fuse(prev_map_op, prev_loop_nest.getValue(), op, curr_loop_nest.getValue(),
          driver);
+    ++counters.num_fused;
   } else if (CanFuse(curr_loop_nest, next_loop_nest)) {
     auto next_map_op = cast<SairMapOp>(next_op.GetDuplicatedOp());
     Fuse(op, curr_loop_nest.getValue(), next_map_op, next_loop_nest.getValue(),
          driver);
+    ++counters.num_fused;
   } else if (!curr_loop_nest.empty() &&
              !IsPrefix(curr_loop_nest, prev_loop_nest) &&
              !IsPrefix(curr_loop_nest, next_loop_nest)) {
-    return IntroduceLoop(op, storage_analysis, driver);
+    ++counters.num_introduced;
+    return IntroduceLoop(op, storage_analysis, options,
+                         counters.num_multiversioned, driver);
   }
 
   return mlir::success();
 }
 
+// Wraps the body of loops directly containing stack allocations into
+// memref.alloca_scope operations so that the stack is released at the end of
+// each iteration.
+void ScopeStackAllocations(mlir::Operation *root) {
+  llvm::SetVector<mlir::Block *> bodies;
+  root->walk([&](mlir::memref::AllocaOp alloca) {
+    if (isa<mlir::scf::ForOp, mlir::scf::ParallelOp>(alloca->getParentOp())) {
+      bodies.insert(alloca->getBlock());
+    }
+  });
+
+  for (mlir::Block *body : bodies) {
+    // Reductions must remain directly nested in their parallel loop.
+    if (!body->getOps<mlir::scf::ReduceOp>().empty()) continue;
+    mlir::Operation *terminator = body->getTerminator();
+    mlir::Location loc = terminator->getLoc();
+    auto builder = mlir::OpBuilder::atBlockBegin(body);
+    auto scope = builder.create<mlir::memref::AllocaScopeOp>(
+        loc, terminator->getOperandTypes());
+    mlir::Block *scope_body = builder.createBlock(&scope.getBodyRegion());
+    scope_body->getOperations().splice(
+        scope_body->end(), body->getOperations(),
+        std::next(mlir::Block::iterator(scope)),
+        mlir::Block::iterator(terminator));
+    builder.setInsertionPointToEnd(scope_body);
+    builder.create<mlir::memref::AllocaScopeReturnOp>(
+        loc, terminator->getOperands());
+    terminator->setOperands(scope.getResults());
+  }
+}
+
 // Replaces iteration dimensions in sair.map and sair.map_reduce operation by
 // loops, converting sair.map_reduce operation into sair.map operations in the
 // process. Fails if operations operand depend on any dimension,  if operations
@@ -838,7 +1853,7 @@ class IntroduceLoops : public impl::IntroduceLoopsPassBase<IntroduceLoops> {
   void IntroduceProgramLoops(SairProgramOp program) {
     auto &sequence_analysis = getChildAnalysis<SequenceAnalysis>(program);
     Driver driver(&getContext(), sequence_analysis);
-    auto storage_analysis = getChildAnalysis<StorageAnalysis>(program);
+    auto &storage_analysis = getChildAnalysis<StorageAnalysis>(program);
     if (mlir::failed(RegisterOperations(program, sequence_analysis, driver))) {
       signalPassFailure();
       return;
@@ -846,21 +1861,40 @@ class IntroduceLoops : public impl::IntroduceLoopsPassBase<IntroduceLoops> {
 
     driver.Simplify();
 
+    llvm::SmallVector<int64_t> sizes(specialize_sizes.begin(),
+                                     specialize_sizes.end());
+    LoopOptions options = {.profile_loops = profile_loops,
+                           .multiversion_loops = multiversion_loops,
+                           .specialize_sizes = sizes};
+    LoopCounters counters;
     while (SairMapOp op = driver.PopMapOp()) {
       if (mlir::failed(IntroduceLoopOrFuse(op, storage_analysis,
-                                           sequence_analysis, driver))) {
+                                           sequence_analysis, options, driver,
+                                           counters))) {
         signalPassFailure();
         return;
       }
 
       driver.Simplify();
     }
+    num_introduced_loops += counters.num_introduced;
+    num_fused_loops += counters.num_fused;
+    num_multiversioned_loops += counters.num_multiversioned;
   }
 
   void runOnOperation() override {
     // Retreive a a sorted list of SairMap operations.
     getOperation().walk([&](SairProgramOp op) { IntroduceProgramLoops(op); });
+    ScopeStackAllocations(getOperation());
   }
+
+ private:
+  // Number of loops introduced.
+  PassCounter num_introduced_loops{"num-introduced-loops"};
+  // Number of operations fused into a neighbor loop.
+  PassCounter num_fused_loops{"num-fused-loops"};
+  // Number of loops with specialized versions.
+  PassCounter num_multiversioned_loops{"num-multiversioned-loops"};
 };
 
 }  // namespace
@@ -15,19 +15,25 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/IRMapping.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Pass/Pass.h"
 #include "sair_attributes.h"
 #include "sair_dialect.h"
+#include "sair_op_interfaces.h"
 #include "sair_ops.h"
+#include "sair_types.h"
+#include "util.h"
 
 namespace sair {
 
 #define GEN_PASS_DEF_LOWERMAPREDUCEPASS
+#define GEN_PASS_DEF_SPLITREDUCTIONSPASS
 #include "transforms/lowering.h.inc"
 
 namespace {
@@ -209,6 +215,282 @@ void RewriteMapReduceToMap(SairMapReduceOp op, mlir::OpBuilder &builder) {
   op.erase();
 }
 
+// Returns the operation that combines the accumulator of result `result` of
+// `op` with the value computed for the current iteration. Returns nullptr if
+// the result is not computed by a single supported operation taking the
+// accumulator as operand.
+mlir::Operation *GetCombiner(SairMapReduceOp op, int result) {
+  mlir::Block &block = op.block();
+  mlir::Value accumulator =
+      block.getArgument(op.getDomain().size() + result);
+  mlir::Operation *combiner =
+      block.getTerminator()->getOperand(result).getDefiningOp();
+  if (combiner == nullptr || !accumulator.hasOneUse() ||
+      *accumulator.user_begin() != combiner ||
+      GetReductionIdentity(combiner) == nullptr) {
+    return nullptr;
+  }
+  return combiner;
+}
+
+// Creates a sair.map operation with an empty body block of index arguments for
+// each dimension and of element type arguments for each input.
+SairMapOp CreateMap(mlir::Location loc, mlir::TypeRange result_types,
+                    mlir::ValueRange domain,
+                    llvm::ArrayRef<mlir::Attribute> mappings,
+                    mlir::ValueRange inputs, DomainShapeAttr shape,
+                    mlir::OpBuilder &builder) {
+  auto map = builder.create<SairMapOp>(
+      loc, result_types, domain, builder.getArrayAttr(mappings), inputs, shape,
+      /*instances=*/nullptr, /*copies=*/nullptr);
+  llvm::SmallVector<mlir::Type> arg_types(domain.size(),
+                                          builder.getIndexType());
+  for (mlir::Value input : inputs) {
+    arg_types.push_back(input.getType().cast<ValueType>().ElementType());
+  }
+  mlir::OpBuilder::InsertionGuard guard(builder);
+  builder.createBlock(&map.getBody(), {}, arg_types,
+                      llvm::SmallVector<mlir::Location>(arg_types.size(), loc));
+  return map;
+}
+
+// Splits the innermost reduction dimension `r` of `op` into chunks of
+// `split_factor` iterations. Converts
+//
+// <res> = sair.map_reduce[<D0>] <inits> reduce[<D1>, r] <values> <body>
+//
+// into
+//
+// <bounds> = sair.map[t] <chunk bounds>
+// i = sair.dyn_range[t] <bounds>
+// <partial> = sair.map_reduce[<D0>, t] <identities> reduce[<D1>, i] <values>
+//   <body>
+// <res> = sair.map_reduce[<D0>] <inits> reduce[t] <partial> <combiners>
+//
+// where `t` iterates over the first index of each chunk and `i` over the
+// indices of a chunk. Iterations of `t` are independent in the first
+// sair.map_reduce so that they can be executed by parallel loops.
+mlir::LogicalResult SplitMapReduce(SairMapReduceOp op,
+                                   mlir::OpBuilder &builder) {
+  MLIRContext *ctx = op.getContext();
+  Location loc = op.getLoc();
+  int split_factor = op.getSplitFactor().value();
+
+  if (op.getInstances().has_value() || op.getCopies().has_value()) {
+    return op.emitError()
+           << "reductions must be split before lowering decisions are set";
+  }
+  if (op.getReductionDomain().empty()) {
+    return op.emitError() << "no reduction dimension to split";
+  }
+
+  int num_parallel = op.getParallelDomain().size();
+  int domain_size = op.getDomain().size();
+  DomainShapeAttr shape = op.getShape();
+  mlir::Value dimension = op.getReductionDomain().back();
+  auto range = dimension.getDefiningOp<RangeOp>();
+  if (range == nullptr || range.Step() != 1 ||
+      shape.Dimensions().back().DependencyMask().any()) {
+    return op.emitError() << "can only split a reduction dimension defined by "
+                             "a range with unit step and without dependencies";
+  }
+
+  llvm::SmallVector<mlir::Operation *> combiners;
+  llvm::SmallVector<mlir::Value> accumulators;
+  for (int i = 0, e = op.getNumResults(); i < e; ++i) {
+    mlir::Operation *combiner = GetCombiner(op, i);
+    if (combiner == nullptr) {
+      return op.emitError()
+             << "result " << i
+             << " is not reduced by a supported associative operation";
+    }
+    combiners.push_back(combiner);
+    accumulators.push_back(op.block().getArgument(domain_size + i));
+  }
+
+  // Create the dimension that iterates over the first index of each chunk.
+  mlir::Value chunks;
+  if (auto type = dimension.getType().dyn_cast<StaticRangeType>()) {
+    chunks = builder.create<SairStaticRangeOp>(
+        loc, StaticRangeType::get(type.size(), split_factor, ctx),
+        /*instances=*/nullptr);
+  } else {
+    auto dyn_range = llvm::cast<SairDynRangeOp>(range.getOperation());
+    chunks = builder.create<SairDynRangeOp>(
+        loc, dyn_range.getType(), dyn_range.getDomain(),
+        dyn_range.getMappingArray(), dyn_range.getLowerBound(),
+        dyn_range.getUpperBound(), builder.getIndexAttr(split_factor),
+        /*instances=*/nullptr);
+  }
+  auto chunks_type = chunks.getType().cast<DimensionType>();
+
+  // Compute the bounds of each chunk as [t, min(t + split_factor, ub)).
+  auto chunks_shape = DomainShapeAttr::get(
+      ctx, {DomainShapeDim(chunks_type, MappingAttr::get(ctx, 0, {}))});
+  ValueOrConstant upper_bound = range.UpperBound();
+  llvm::SmallVector<mlir::Value> bounds_inputs;
+  llvm::SmallVector<mlir::Attribute> bounds_mappings;
+  if (upper_bound.is_value()) {
+    bounds_inputs.push_back(upper_bound.value().value);
+    bounds_mappings.push_back(MappingAttr::get(ctx, 1, {}));
+  }
+  auto index_type = ValueType::get(chunks_shape, builder.getIndexType());
+  SairMapOp bounds =
+      CreateMap(loc, {index_type, index_type}, chunks, bounds_mappings,
+                bounds_inputs, chunks_shape, builder);
+  {
+    mlir::OpBuilder::InsertionGuard guard(builder);
+    mlir::Block &block = bounds.block();
+    builder.setInsertionPointToStart(&block);
+    mlir::Value begin = block.getArgument(0);
+    mlir::Value upper;
+    if (upper_bound.is_value()) {
+      upper = block.getArgument(1);
+    } else {
+      upper = builder.create<mlir::arith::ConstantOp>(
+          loc, upper_bound.constant().cast<mlir::TypedAttr>());
+    }
+    mlir::Value size =
+        builder.create<mlir::arith::ConstantIndexOp>(loc, split_factor);
+    mlir::Value end = builder.create<mlir::arith::AddIOp>(loc, begin, size);
+    end = builder.create<mlir::arith::MinSIOp>(loc, end, upper);
+    builder.create<SairReturnOp>(loc, mlir::ValueRange({begin, end}));
+  }
+
+  // Create the dimension that iterates inside each chunk.
+  auto inner_type = DynRangeType::get(chunks_shape);
+  auto chunk_identity = MappingAttr::GetIdentity(ctx, 1);
+  mlir::Value inner = builder.create<SairDynRangeOp>(
+      loc, inner_type, chunks,
+      builder.getArrayAttr({chunk_identity, chunk_identity}),
+      bounds.getResult(0), bounds.getResult(1), builder.getIndexAttr(1),
+      /*instances=*/nullptr);
+
+  // The partial reduction domain is <D0>, t, <D1>, i. Dimensions of <D1> are
+  // shifted by one to account for `t`.
+  llvm::ArrayRef<DomainShapeDim> dims = shape.Dimensions();
+  llvm::SmallVector<DomainShapeDim> partial_dims;
+  llvm::append_range(partial_dims, dims.take_front(num_parallel));
+  partial_dims.emplace_back(chunks_type,
+                            MappingAttr::get(ctx, num_parallel, {}));
+  for (const DomainShapeDim &dim : dims.drop_front(num_parallel).drop_back()) {
+    partial_dims.emplace_back(
+        dim.type(), dim.dependency_mapping().ShiftRight(1, num_parallel));
+  }
+  partial_dims.emplace_back(
+      inner_type, MappingAttr::get(ctx, domain_size,
+                                   {MappingDimExpr::get(num_parallel, ctx)}));
+  auto partial_shape = DomainShapeAttr::get(ctx, partial_dims);
+  DomainShapeAttr partial_result_shape = partial_shape.Prefix(num_parallel + 1);
+
+  llvm::SmallVector<mlir::Value> partial_parallel_domain =
+      llvm::to_vector(op.getParallelDomain());
+  partial_parallel_domain.push_back(chunks);
+  llvm::SmallVector<mlir::Value> partial_reduction_domain =
+      llvm::to_vector(op.getReductionDomain().drop_back());
+  partial_reduction_domain.push_back(inner);
+
+  // Partial reductions start from the neutral element of the reduction.
+  llvm::SmallVector<mlir::Type> partial_types;
+  for (mlir::Type type : op.getResultTypes()) {
+    partial_types.push_back(ValueType::get(
+        partial_result_shape, type.cast<ValueType>().ElementType()));
+  }
+  SairMapOp identities =
+      CreateMap(loc, partial_types, partial_parallel_domain, {}, {},
+                partial_result_shape, builder);
+  {
+    mlir::OpBuilder::InsertionGuard guard(builder);
+    builder.setInsertionPointToStart(&identities.block());
+    llvm::SmallVector<mlir::Value> values;
+    for (mlir::Operation *combiner : combiners) {
+      values.push_back(builder.create<mlir::arith::ConstantOp>(
+          loc, GetReductionIdentity(combiner)));
+    }
+    builder.create<SairReturnOp>(loc, values);
+  }
+
+  // Maps dimensions of `op` to the partial reduction domain. The original
+  // reduction dimension is the concatenation of `t` and `i`.
+  llvm::SmallVector<MappingExpr> old_dims;
+  for (int i = 0; i < domain_size - 1; ++i) {
+    old_dims.push_back(MappingDimExpr::get(i < num_parallel ? i : i + 1, ctx));
+  }
+  old_dims.push_back(MappingUnStripeExpr::get(
+      {MappingDimExpr::get(num_parallel, ctx),
+       MappingDimExpr::get(domain_size, ctx)},
+      {split_factor, 1}));
+  auto partial_to_old = MappingAttr::get(ctx, domain_size + 1, old_dims);
+
+  llvm::ArrayRef<mlir::Attribute> op_mappings = op.getMappingArray().getValue();
+  auto init_mappings = op_mappings.drop_back(op.getInputs().size());
+  auto input_mappings = op_mappings.take_back(op.getInputs().size());
+  llvm::SmallVector<mlir::Attribute> partial_mappings(
+      op.getNumResults(),
+      MappingAttr::GetIdentity(ctx, num_parallel + 1, domain_size + 1));
+  for (mlir::Attribute mapping : input_mappings) {
+    partial_mappings.push_back(
+        partial_to_old.Compose(mapping.cast<MappingAttr>()));
+  }
+
+  // The partial reduction reuses the body of `op`, with an additional unused
+  // argument for `t`.
+  auto partial = builder.create<SairMapReduceOp>(
+      loc, partial_types, partial_parallel_domain, partial_reduction_domain,
+      builder.getArrayAttr(partial_mappings), identities.getResults(),
+      op.getInputs(), partial_shape, /*instances=*/nullptr,
+      /*copies=*/nullptr, /*split_factor=*/nullptr);
+  partial.getBody().takeBody(op.getBody());
+  partial.block().insertArgument(num_parallel, builder.getIndexType(), loc);
+
+  // The final reduction combines accumulators with partial results.
+  llvm::SmallVector<mlir::Attribute> final_mappings;
+  for (mlir::Attribute mapping : init_mappings) {
+    final_mappings.push_back(
+        mapping.cast<MappingAttr>().ResizeUseDomain(num_parallel + 1));
+  }
+  final_mappings.append(op.getNumResults(),
+                        MappingAttr::GetIdentity(ctx, num_parallel + 1));
+  auto final_op = builder.create<SairMapReduceOp>(
+      loc, op.getResultTypes(), op.getParallelDomain(), chunks,
+      builder.getArrayAttr(final_mappings), op.getInits(),
+      partial.getResults(), partial_result_shape,
+      /*instances=*/nullptr, /*copies=*/nullptr, /*split_factor=*/nullptr);
+  // The body takes indices, accumulators and partial results as arguments.
+  llvm::SmallVector<mlir::Type> element_types;
+  for (mlir::Type type : partial_types) {
+    element_types.push_back(type.cast<ValueType>().ElementType());
+  }
+  llvm::SmallVector<mlir::Type> final_arg_types(num_parallel + 1,
+                                                builder.getIndexType());
+  llvm::append_range(final_arg_types, element_types);
+  llvm::append_range(final_arg_types, element_types);
+  {
+    mlir::OpBuilder::InsertionGuard guard(builder);
+    mlir::Block *block = builder.createBlock(
+        &final_op.getBody(), {}, final_arg_types,
+        llvm::SmallVector<mlir::Location>(final_arg_types.size(), loc));
+    llvm::SmallVector<mlir::Value> values;
+    int num_results = combiners.size();
+    for (int i = 0; i < num_results; ++i) {
+      mlir::Value accumulator = block->getArgument(num_parallel + 1 + i);
+      mlir::Value partial_result =
+          block->getArgument(num_parallel + 1 + num_results + i);
+      mlir::IRMapping mapping;
+      for (mlir::Value operand : combiners[i]->getOperands()) {
+        mapping.map(operand, operand == accumulators[i] ? accumulator
+                                                        : partial_result);
+      }
+      values.push_back(builder.clone(*combiners[i], mapping)->getResult(0));
+    }
+    builder.create<SairReturnOp>(loc, values);
+  }
+
+  op->replaceAllUsesWith(final_op.getResults());
+  op.erase();
+  return mlir::success();
+}
+
 class LowerMapReduce : public impl::LowerMapReducePassBase<LowerMapReduce> {
   // Converts
   //
@@ -221,11 +503,34 @@ class LowerMapReduce : public impl::LowerMapReducePassBase<LowerMapReduce> {
   // <res> = sair.proj_last[<D0>] last[<D1>] <tmp1>
   void runOnOperation() override {
     mlir::MLIRContext *context = &getContext();
-    getOperation().walk([context](SairMapReduceOp op) {
+    auto result = getOperation().walk([context](SairMapReduceOp op) {
+      if (op.getSplitFactor().has_value()) {
+        op.emitError() << "split_factor must be applied by "
+                          "-sair-split-reductions before lowering";
+        return mlir::WalkResult::interrupt();
+      }
       mlir::OpBuilder builder(context);
       builder.setInsertionPoint(op);
       RewriteMapReduceToMap(op, builder);
+      return mlir::WalkResult::advance();
     });
+    if (result.wasInterrupted()) signalPassFailure();
+  }
+};
+
+class SplitReductions : public impl::SplitReductionsPassBase<SplitReductions> {
+  void runOnOperation() override {
+    mlir::MLIRContext *context = &getContext();
+    auto result = getOperation().walk([context](SairMapReduceOp op) {
+      if (!op.getSplitFactor().has_value()) return mlir::WalkResult::advance();
+      mlir::OpBuilder builder(context);
+      builder.setInsertionPoint(op);
+      if (mlir::failed(SplitMapReduce(op, builder))) {
+        return mlir::WalkResult::interrupt();
+      }
+      return mlir::WalkResult::advance();
+    });
+    if (result.wasInterrupted()) signalPassFailure();
   }
 };
 
@@ -236,4 +541,9 @@ CreateLowerMapReducePass() {
   return std::make_unique<LowerMapReduce>();
 }
 
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateSplitReductionsPass() {
+  return std::make_unique<SplitReductions>();
+}
+
 }  // namespace sair
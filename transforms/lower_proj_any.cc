@@ -18,6 +18,7 @@
 #include "loop_nest.h"
 #include "sair_dialect.h"
 #include "sair_ops.h"
+#include "statistics_report.h"
 
 namespace sair {
 
@@ -54,6 +55,7 @@ class LowerProjAny : public impl::LowerProjAnyPassBase<LowerProjAny> {
       }
 
       int domain_size = op.getDomain().size();
+      bool eliminated = true;
       for (OpOperand &use :
            llvm::make_early_inc_range(op.getResult().getUses())) {
         SairOp user = cast<SairOp>(use.getOwner());
@@ -107,12 +109,15 @@ class LowerProjAny : public impl::LowerProjAnyPassBase<LowerProjAny> {
             /*instances=*/op.getInstancesAttr(),
             /*copies=*/nullptr);
 
+        ++num_proj_last;
+        eliminated = false;
         operand.set_value(proj_last);
         int user_domain_size = operand.Mapping().UseDomainSize();
         operand.SetMapping(MappingAttr::GetIdentity(context, num_common_loops)
                                .ResizeUseDomain(user_domain_size));
       }
 
+      if (eliminated) ++num_eliminated_proj_any;
       op.erase();
       return mlir::success();
     });
@@ -121,6 +126,12 @@ class LowerProjAny : public impl::LowerProjAnyPassBase<LowerProjAny> {
       signalPassFailure();
     }
   }
+
+ private:
+  // Number of proj_any operations eliminated.
+  PassCounter num_eliminated_proj_any{"num-eliminated-proj-any"};
+  // Number of proj_last operations created from proj_any.
+  PassCounter num_proj_last{"num-proj-last"};
 };
 
 }  // namespace
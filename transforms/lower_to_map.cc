@@ -69,10 +69,17 @@ class LowerToMap : public impl::LowerToMapPassBase<LowerToMap> {
           pattern.Emit(op, map_body, builder);
       builder.create<SairReturnOp>(op.getLoc(), results);
 
+      // Vector operations are only emitted when introducing loops, so the
+      // vector pattern must survive the expansion.
+      llvm::StringRef new_expansion = kMapExpansionPattern;
+      if (decisions.expansion().getValue() == kVectorExpansionPattern) {
+        new_expansion = kVectorExpansionPattern;
+      }
+
       builder.setInsertionPoint(op);
       auto new_decisions = DecisionsAttr::get(
           decisions.sequence(), decisions.loop_nest(), decisions.storage(),
-          builder.getStringAttr(kMapExpansionPattern), decisions.copy_of(),
+          builder.getStringAttr(new_expansion), decisions.copy_of(),
           decisions.operands(), context);
       SairMapOp map_op = builder.create<SairMapOp>(
           op.getLoc(), op->getResultTypes(), sair_op.getDomain(),
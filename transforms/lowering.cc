@@ -15,6 +15,7 @@
 #include "transforms/lowering.h"
 
 #include <memory>
+#include <string>
 
 #include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
 #include "mlir/Conversion/ArithToLLVM/ArithToLLVM.h"
@@ -23,19 +24,33 @@
 #include "mlir/Conversion/LLVMCommon/ConversionTarget.h"
 #include "mlir/Conversion/LLVMCommon/Pattern.h"
 #include "mlir/Conversion/MemRefToLLVM/MemRefToLLVM.h"
+#include "mlir/Conversion/OpenMPToLLVM/ConvertOpenMPToLLVM.h"
 #include "mlir/Conversion/SCFToControlFlow/SCFToControlFlow.h"
+#include "mlir/Conversion/SCFToGPU/SCFToGPUPass.h"
+#include "mlir/Conversion/SCFToOpenMP/SCFToOpenMP.h"
+#include "mlir/Conversion/VectorToLLVM/ConvertVectorToLLVM.h"
+#include "mlir/Dialect/GPU/Transforms/Passes.h"
+#include "mlir/Dialect/LLVMIR/FunctionCallUtils.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Vector/Transforms/LoweringPatterns.h"
+#include "mlir/Dialect/Vector/Transforms/VectorRewritePatterns.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Value.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/Transforms/Passes.h"
+#include "loop_profile.h"
 #include "sair_dialect.h"
+#include "sair_ops.h"
 
 namespace sair {
 
@@ -63,21 +78,120 @@ class LowerUndef : public ConvertOpToLLVMPattern<SairUndefOp> {
   }
 };
 
+// Converts a SairLoopProfileBeginOp into a call to the profiling runtime.
+class LowerLoopProfileBegin
+    : public ConvertOpToLLVMPattern<SairLoopProfileBeginOp> {
+ public:
+  using ConvertOpToLLVMPattern<SairLoopProfileBeginOp>::ConvertOpToLLVMPattern;
+
+  mlir::LogicalResult matchAndRewrite(
+      SairLoopProfileBeginOp op, OpAdaptor adaptor,
+      mlir::ConversionPatternRewriter &rewriter) const override {
+    auto module = op->getParentOfType<mlir::ModuleOp>();
+    mlir::LLVM::LLVMFuncOp callee = mlir::LLVM::lookupOrCreateFn(
+        module, kLoopProfileBeginFunction, {}, rewriter.getI64Type());
+    rewriter.replaceOpWithNewOp<mlir::LLVM::CallOp>(op, callee,
+                                                    mlir::ValueRange());
+    return mlir::success();
+  }
+};
+
+// Returns the global named `symbol`, creating it at the start of `module` with
+// the given properties if it does not exist yet.
+mlir::LLVM::GlobalOp GetOrCreateGlobal(mlir::ModuleOp module,
+                                       llvm::StringRef symbol,
+                                       mlir::Type type, bool is_constant,
+                                       mlir::Attribute value,
+                                       mlir::Location loc,
+                                       mlir::OpBuilder &builder) {
+  auto global = module.lookupSymbol<mlir::LLVM::GlobalOp>(symbol);
+  if (global != nullptr) return global;
+  mlir::OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToStart(module.getBody());
+  return builder.create<mlir::LLVM::GlobalOp>(
+      loc, type, is_constant, mlir::LLVM::Linkage::Internal, symbol, value);
+}
+
+// Converts a SairLoopProfileEndOp into a call to the profiling runtime. Passes
+// the loop key, `<function>:<loop>`, as a null-terminated string stored in a
+// global constant, along with a zero-initialized global holding the counters
+// of the loop. Both globals are shared by all the probes of the loop so that
+// the runtime updates the counters without looking the loop up.
+class LowerLoopProfileEnd
+    : public ConvertOpToLLVMPattern<SairLoopProfileEndOp> {
+ public:
+  using ConvertOpToLLVMPattern<SairLoopProfileEndOp>::ConvertOpToLLVMPattern;
+
+  mlir::LogicalResult matchAndRewrite(
+      SairLoopProfileEndOp op, OpAdaptor adaptor,
+      mlir::ConversionPatternRewriter &rewriter) const override {
+    auto module = op->getParentOfType<mlir::ModuleOp>();
+    auto function = op->getParentOfType<mlir::FunctionOpInterface>();
+    std::string key = (function.getName() + ":" + op.getLoop()).str();
+
+    auto key_type =
+        mlir::LLVM::LLVMArrayType::get(rewriter.getI8Type(), key.size() + 1);
+    mlir::LLVM::GlobalOp key_global = GetOrCreateGlobal(
+        module, "__sair_loop_profile." + key, key_type, /*is_constant=*/true,
+        rewriter.getStringAttr(key + '\0'), op.getLoc(), rewriter);
+
+    auto probe_type = mlir::LLVM::LLVMArrayType::get(rewriter.getI64Type(),
+                                                     kLoopProbeSize);
+    auto probe_value = mlir::DenseElementsAttr::get(
+        mlir::RankedTensorType::get({kLoopProbeSize}, rewriter.getI64Type()),
+        rewriter.getI64IntegerAttr(0).getValue());
+    mlir::LLVM::GlobalOp probe_global = GetOrCreateGlobal(
+        module, "__sair_loop_probe." + key, probe_type, /*is_constant=*/false,
+        probe_value, op.getLoc(), rewriter);
+
+    auto address_of = [&](mlir::LLVM::GlobalOp global) -> mlir::Value {
+      mlir::Value address =
+          rewriter.create<mlir::LLVM::AddressOfOp>(op.getLoc(), global);
+      return rewriter.create<mlir::LLVM::BitcastOp>(op.getLoc(),
+                                                    getVoidPtrType(), address);
+    };
+    mlir::Value probe = address_of(probe_global);
+    mlir::Value name = address_of(key_global);
+
+    mlir::LLVM::LLVMFuncOp callee = mlir::LLVM::lookupOrCreateFn(
+        module, kLoopProfileEndFunction,
+        {getVoidPtrType(), getVoidPtrType(), rewriter.getI64Type(),
+         getIndexType()},
+        mlir::LLVM::LLVMVoidType::get(op.getContext()));
+    rewriter.replaceOpWithNewOp<mlir::LLVM::CallOp>(
+        op, callee,
+        mlir::ValueRange(
+            {probe, name, adaptor.getStart(), adaptor.getTripCount()}));
+    return mlir::success();
+  }
+};
+
 // A pass that converts Standard ops and SairUndefOp to the LLVM dialect.
 class LowerToLLVMPass : public impl::LowerToLLVMBase<LowerToLLVMPass> {
  public:
   void runOnOperation() override {
     auto module = getOperation();
 
+    // Rewrite vector operations that have no direct LLVM counterpart.
+    RewritePatternSet vector_patterns(&getContext());
+    vector::populateVectorMaskMaterializationPatterns(
+        vector_patterns, /*force32BitVectorIndices=*/false);
+    vector::populateVectorBroadcastLoweringPatterns(vector_patterns);
+    (void)applyPatternsAndFoldGreedily(module, std::move(vector_patterns));
+
     RewritePatternSet patterns(&getContext());
     LLVMTypeConverter converter(&getContext());
+    populateVectorToLLVMConversionPatterns(converter, patterns);
     populateFinalizeMemRefToLLVMConversionPatterns(converter, patterns);
     populateFuncToLLVMConversionPatterns(converter, patterns);
     cf::populateControlFlowToLLVMConversionPatterns(converter, patterns);
     arith::populateArithToLLVMConversionPatterns(converter, patterns);
-    patterns.add<LowerUndef>(converter);
+    populateOpenMPToLLVMConversionPatterns(converter, patterns);
+    patterns.add<LowerUndef, LowerLoopProfileBegin, LowerLoopProfileEnd>(
+        converter);
 
     LLVMConversionTarget target(getContext());
+    configureOpenMPToLLVMConversionLegality(target, converter);
     target.addLegalOp<mlir::ModuleOp>();
     target.addIllegalDialect<SairDialect>();
     if (failed(applyFullConversion(module, target, std::move(patterns)))) {
@@ -92,6 +206,11 @@ std::unique_ptr<mlir::Pass> CreateLowerToLLVMPass() {
   return std::make_unique<LowerToLLVMPass>();
 }
 
+void CreateSairPreLoweringPipeline(mlir::OpPassManager *pm) {
+  pm->addPass(CreateSplitReductionsPass());
+  pm->addPass(CreateHoistLoopInvariantsPass());
+}
+
 void CreateSairToLoopConversionPipeline(mlir::OpPassManager *pm) {
   pm->addPass(CreateLowerMapReducePass());
   pm->addPass(CreateMaterializeBuffersPass());
@@ -103,13 +222,26 @@ void CreateSairToLoopConversionPipeline(mlir::OpPassManager *pm) {
   pm->addPass(CreateLowerToMapPass());
   pm->addPass(CreateIntroduceLoopsPass());
   pm->addPass(CreateInlineTrivialOpsPass());
+  pm->addPass(CreatePrefetchDoubleBuffersPass());
+  pm->addPass(CreateReplaceSlidingWindowsPass());
+  pm->addPass(CreateStrengthReduceIndicesPass());
 }
 
-void CreateSairToLLVMConversionPipeline(mlir::OpPassManager *pm) {
+void CreateSairToLLVMConversionPipeline(mlir::OpPassManager *pm,
+                                        bool use_openmp) {
   CreateSairToLoopConversionPipeline(pm);
   pm->addPass(mlir::createLowerAffinePass());
+  if (use_openmp) pm->addPass(mlir::createConvertSCFToOpenMPPass());
   pm->addPass(mlir::createConvertSCFToCFPass());
   pm->addPass(CreateLowerToLLVMPass());
 }
 
+void CreateSairToGpuConversionPipeline(mlir::OpPassManager *pm) {
+  CreateSairToLoopConversionPipeline(pm);
+  pm->addPass(mlir::createLowerAffinePass());
+  pm->addPass(mlir::createParallelLoopToGpuPass());
+  pm->addPass(CreatePromoteWorkgroupBuffersPass());
+  pm->addPass(mlir::createGpuKernelOutliningPass());
+}
+
 }  // namespace sair
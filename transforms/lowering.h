@@ -29,6 +29,18 @@ namespace sair {
 std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
 CreateLowerMapReducePass();
 
+// Returns a pass that splits the innermost reduction dimension of
+// sair.map_reduce operations with a `split_factor` attribute into a partial and
+// a final reduction.
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateSplitReductionsPass();
+
+// Returns a pass that moves computations of sair.map bodies depending on a
+// subset of the domain dimensions into sair.map operations with fewer
+// dimensions.
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateHoistLoopInvariantsPass();
+
 // Returns a pass that converts sair operations into sair.map operations.
 std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>> CreateLowerToMapPass();
 
@@ -45,6 +57,11 @@ CreateInlineTrivialOpsPass();
 std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
 CreateMaterializeBuffersPass();
 
+// Same as above, but also reuses allocations of buffers with disjoint lifetimes
+// if `reuse_buffers` is true.
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateMaterializeBuffersPass(bool reuse_buffers);
+
 // Create ops for instances and copies defined in attributes.
 std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
 CreateMaterializeInstancesPass();
@@ -63,11 +80,50 @@ CreateNormalizeLoopsPass();
 std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
 CreateLowerProjAnyPass();
 
+// Returns a pass that hoists invariant index computations out of loops and
+// replaces indices increasing by a constant by loop-carried values.
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateStrengthReduceIndicesPass();
+
+// Returns a pass that writes double-buffered buffers one iteration ahead of
+// the operations reading them.
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreatePrefetchDoubleBuffersPass();
+
+// Returns a pass that keeps elements of sliding windows loaded in innermost
+// loops in loop-carried values.
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateReplaceSlidingWindowsPass();
+
+// Returns a pass that reports the estimated memory footprint and traffic of
+// buffers.
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateMemoryReportPass();
+
+// Returns a pass that turns allocations of GPU shared memory buffers into
+// workgroup attributions of the gpu.launch operations accessing them.
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreatePromoteWorkgroupBuffersPass();
+
+// Populates the pass manager with the rewrites of Sair operations that must run
+// before lowering decisions are assigned: splitting reductions with a split
+// factor and hoisting loop-invariant computations out of sair.map bodies.
+void CreateSairPreLoweringPipeline(mlir::OpPassManager *pm);
+
 // Populates the pass manager to convert Sair operations to the Loops dialect.
 void CreateSairToLoopConversionPipeline(mlir::OpPassManager *pm);
 
-// Populates the pass manages to convert Sair operations to LLVM.
-void CreateSairToLLVMConversionPipeline(mlir::OpPassManager *pm);
+// Populates the pass manages to convert Sair operations to LLVM. Parallel
+// loops are executed by OpenMP threads if `use_openmp` is set and sequentially
+// otherwise.
+void CreateSairToLLVMConversionPipeline(mlir::OpPassManager *pm,
+                                        bool use_openmp = false);
+
+// Populates the pass manager to convert Sair operations to loops where loops
+// mapped to GPU processors are executed by gpu.launch kernels. Shared memory
+// buffers become workgroup attributions of the kernels, which are then outlined
+// into gpu.module operations, ready for a target-specific lowering.
+void CreateSairToGpuConversionPipeline(mlir::OpPassManager *pm);
 
 }  // namespace sair
 
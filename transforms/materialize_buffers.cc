@@ -12,14 +12,22 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <optional>
+#include <tuple>
+
 #include "llvm/ADT/STLExtras.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/GPU/IR/GPUDialect.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/Pass/Pass.h"
 #include "loop_nest.h"
 #include "sair_dialect.h"
 #include "sair_op_interfaces.h"
 #include "sequence.h"
+#include "statistics_report.h"
 #include "storage.h"
 #include "transforms/domain_utils.h"
 #include "util.h"
@@ -41,23 +49,35 @@ mlir::ArrayAttr PointwiseLoopNest(llvm::ArrayRef<mlir::StringAttr> loop_names,
   loops.reserve(loop_names.size());
   for (int i = 0, e = loop_names.size(); i < e; ++i) {
     auto dim_expr = MappingDimExpr::get(i, context);
-    mlir::IntegerAttr unroll = fusion_analysis.GetClass(loop_names[i])
-                                   .GetUnrollAttr(*builder.getContext());
-    loops.push_back(LoopAttr::get(loop_names[i], dim_expr, unroll, context));
+    const LoopFusionClass &fusion_class =
+        fusion_analysis.GetClass(loop_names[i]);
+    mlir::IntegerAttr unroll = fusion_class.GetUnrollAttr(*context);
+    mlir::UnitAttr parallel = fusion_class.GetParallelAttr(*context);
+    loops.push_back(LoopAttr::get(loop_names[i], dim_expr, unroll, parallel,
+                                  fusion_class.gpu(),
+                                  fusion_class.accumulators(),
+                                  fusion_class.peel(), context));
   }
   return builder.getArrayAttr(loops);
 }
 
-// Find insertion points for alloc and free operations.
-std::pair<ProgramPoint, ProgramPoint> FindInsertionPoints(
-    const Buffer &buffer, const IterationSpaceAnalysis &iter_spaces,
-    const SequenceAnalysis &sequence_analysis, mlir::OpBuilder &builder) {
+// Returns the first and last operations accessing `buffer`.
+std::pair<ComputeOpInstance, ComputeOpInstance> GetAccessSpan(
+    const Buffer &buffer, const SequenceAnalysis &sequence_analysis) {
   auto reads_writes =
       llvm::to_vector<8>(llvm::make_first_range(buffer.reads()));
   llvm::append_range(reads_writes, llvm::make_first_range(buffer.writes()));
-  auto [first_access, last_access] = sequence_analysis.GetSpan(reads_writes);
+  return sequence_analysis.GetSpan(reads_writes);
+}
+
+// Find insertion points for alloc and free operations nested in the first
+// `num_loops` loops of the buffer loop nest.
+std::pair<ProgramPoint, ProgramPoint> FindInsertionPoints(
+    const Buffer &buffer, int num_loops,
+    const IterationSpaceAnalysis &iter_spaces,
+    const SequenceAnalysis &sequence_analysis, mlir::OpBuilder &builder) {
+  auto [first_access, last_access] = GetAccessSpan(buffer, sequence_analysis);
 
-  int num_loops = buffer.loop_nest().size();
   ProgramPoint alloc_point = sequence_analysis.FindInsertionPoint(
       iter_spaces, first_access, num_loops, Direction::kBefore);
   ProgramPoint free_point = sequence_analysis.FindInsertionPoint(
@@ -66,8 +86,8 @@ std::pair<ProgramPoint, ProgramPoint> FindInsertionPoints(
   return std::make_pair(alloc_point, free_point);
 }
 
-// Returns the shape of the memref implementing `buffer` and the list of values
-// providing dynamic dimension sizes.
+// Returns the shape of the memref implementing `buffer`, including padding, and
+// the list of values providing dynamic dimension sizes.
 std::pair<mlir::SmallVector<int64_t>, ValueRange> GetMemRefShape(
     const Buffer &buffer, DomainShapeAttr shape,
     llvm::ArrayRef<mlir::Value> domain, const LoopNest &loop_nest,
@@ -90,8 +110,13 @@ std::pair<mlir::SmallVector<int64_t>, ValueRange> GetMemRefShape(
   llvm::SmallVector<RangeParameters> range_parameters =
       GetRangeParameters(buffer.location(), buffer.mapping(), buffer_domain,
                          loops_to_domain, map_body, builder);
-  for (const auto &params : range_parameters) {
+  for (auto [dimension, params] : llvm::enumerate(range_parameters)) {
     int step = params.step;
+    int64_t padding = 0;
+    if (buffer.padding() != nullptr) {
+      padding =
+          buffer.padding()[dimension].cast<mlir::IntegerAttr>().getInt();
+    }
     if (params.begin.is<mlir::Attribute>() &&
         params.end.is<mlir::Attribute>()) {
       // Handle constant dimension.
@@ -100,7 +125,7 @@ std::pair<mlir::SmallVector<int64_t>, ValueRange> GetMemRefShape(
                     .getInt();
       int end =
           params.end.get<mlir::Attribute>().cast<mlir::IntegerAttr>().getInt();
-      memref_shape.push_back(llvm::divideCeil(end - beg, step));
+      memref_shape.push_back(llvm::divideCeil(end - beg, step) + padding);
     } else {
       memref_shape.push_back(mlir::ShapedType::kDynamic);
       // Handle dynamic dimensions.
@@ -108,7 +133,7 @@ std::pair<mlir::SmallVector<int64_t>, ValueRange> GetMemRefShape(
       mlir::Value end = Materialize(buffer.location(), params.end, builder);
       auto d0 = mlir::getAffineDimExpr(0, context);
       auto d1 = mlir::getAffineDimExpr(1, context);
-      auto map = mlir::AffineMap::get(2, 0, (d1 - d0).ceilDiv(step));
+      auto map = mlir::AffineMap::get(2, 0, (d1 - d0).ceilDiv(step) + padding);
       scalar_sizes.push_back(builder.create<mlir::affine::AffineApplyOp>(
           buffer.location(), map, llvm::ArrayRef({beg, end})));
     }
@@ -144,14 +169,214 @@ std::pair<mlir::SmallVector<int64_t>, ValueRange> GetMemRefShape(
   return std::make_pair(memref_shape, sizes);
 }
 
-mlir::Value AllocateBuffer(const Buffer &buffer,
+// A statically-shaped allocation that buffers accessed after `last_access` may
+// reuse.
+struct Allocation {
+  mlir::Value memref;
+  SairFreeOp free_op;
+  llvm::ArrayRef<mlir::StringAttr> loop_nest;
+  ComputeOpInstance last_access;
+};
+
+// Returns an allocation of type `type` and alignment `alignment`, in loop nest
+// `loop_nest`, that is no longer accessed when `first_access` executes.
+// Returns nullptr if there is none.
+Allocation *FindReusableAllocation(
+    llvm::MutableArrayRef<Allocation> allocations, mlir::Type type,
+    mlir::IntegerAttr alignment, llvm::ArrayRef<mlir::StringAttr> loop_nest,
+    const ComputeOpInstance &first_access,
+    const IterationSpaceAnalysis &iter_spaces,
+    const SequenceAnalysis &sequence_analysis) {
+  const IterationSpace &first_space = iter_spaces.Get(first_access);
+  for (Allocation &allocation : allocations) {
+    if (allocation.memref.getType() != type) continue;
+    auto alloc_op = allocation.memref.getDefiningOp<SairAllocOp>();
+    if (alloc_op.getAlignmentAttr() != alignment) continue;
+    if (allocation.loop_nest != loop_nest) continue;
+    if (!sequence_analysis.IsBefore(allocation.last_access, first_access)) {
+      continue;
+    }
+    // Accesses sharing a loop that is not part of the buffer loop nest may
+    // execute in interleaved iterations.
+    int num_common_loops =
+        iter_spaces.Get(allocation.last_access).NumCommonLoops(first_space);
+    int num_buffer_loops = loop_nest.size();
+    if (num_common_loops > num_buffer_loops) continue;
+    return &allocation;
+  }
+  return nullptr;
+}
+
+// Erases placeholder operations defining `domain` if they are unused.
+void ErasePlaceholderDomain(llvm::ArrayRef<mlir::Value> domain) {
+  for (mlir::Value dimension : llvm::reverse(domain)) {
+    mlir::Operation *op = dimension.getDefiningOp();
+    if (!op->use_empty()) continue;
+    auto range_domain = llvm::to_vector(op->getOperands());
+    op->erase();
+    ErasePlaceholderDomain(range_domain);
+  }
+}
+
+// Returns the memref memory space that corresponds to the Sair memory space
+// `space`. Buffers in GPU shared memory are allocated in the workgroup address
+// space and local buffers in the private address space.
+mlir::Attribute GetMemRefMemorySpace(mlir::StringAttr space) {
+  mlir::MLIRContext *context = space.getContext();
+  auto *sair_dialect = context->getLoadedDialect<SairDialect>();
+  if (space == sair_dialect->shared_attr()) {
+    return mlir::gpu::AddressSpaceAttr::get(context,
+                                            mlir::gpu::AddressSpace::Workgroup);
+  }
+  if (space == sair_dialect->local_attr()) {
+    return mlir::gpu::AddressSpaceAttr::get(context,
+                                            mlir::gpu::AddressSpace::Private);
+  }
+  return nullptr;
+}
+
+// Returns the size in bytes of `type` if it has a static shape and scalar
+// elements.
+std::optional<int64_t> GetStaticSizeInBytes(mlir::MemRefType type) {
+  if (!type.hasStaticShape()) return std::nullopt;
+  if (!type.getElementType().isIntOrFloat()) return std::nullopt;
+  int64_t element_size =
+      llvm::divideCeil(type.getElementType().getIntOrFloatBitWidth(), 8);
+  return type.getNumElements() * element_size;
+}
+
+// Indicates if `type` has a static shape, occupies at most `limit` bytes and
+// lives in the default or in the private address space.
+bool FitsOnStack(mlir::MemRefType type, int64_t limit) {
+  auto gpu_space =
+      type.getMemorySpace().dyn_cast_or_null<mlir::gpu::AddressSpaceAttr>();
+  bool is_private = gpu_space != nullptr &&
+                    gpu_space.getValue() == mlir::gpu::AddressSpace::Private;
+  if (type.getMemorySpace() != nullptr && !is_private) return false;
+  std::optional<int64_t> size = GetStaticSizeInBytes(type);
+  return size.has_value() && *size <= limit;
+}
+
+// Rotates `buffer` between allocations `first` and `second`, defined in the
+// first `num_alloc_loops` loops of the buffer loop nest, across iterations of
+// loop `buffer.double_buffer()`. Two sair.fby operations carry the memrefs of
+// the current and of the next iteration and a sair.map swaps them after the
+// last access of each iteration, so that writes of an iteration do not wait
+// for reads of the previous one. Once loops are introduced, the prefetch pass
+// moves these writes to the previous iteration. Returns the memref of the
+// current iteration along with its mapping from the loops of the buffer
+// accesses.
+ValueAccess RotateBuffer(const Buffer &buffer, mlir::Value first,
+                         mlir::Value second, int num_alloc_loops,
+                         const IterationSpaceAnalysis &iter_spaces,
+                         const LoopFusionAnalysis &fusion_analysis,
+                         SequenceAnalysis &sequence_analysis,
+                         mlir::OpBuilder &builder) {
+  mlir::MLIRContext *context = builder.getContext();
+  mlir::Location loc = buffer.location();
+  ComputeOpInstance last_access =
+      GetAccessSpan(buffer, sequence_analysis).second;
+  llvm::ArrayRef<mlir::StringAttr> access_loops =
+      iter_spaces.Get(last_access).loop_names();
+  int num_loops =
+      llvm::find(access_loops, buffer.double_buffer()) - access_loops.begin() +
+      1;
+  llvm::ArrayRef<mlir::StringAttr> loops = access_loops.take_front(num_loops);
+
+  DomainShapeAttr shape = fusion_analysis.GetLoopNest(loops).Shape();
+  llvm::SmallVector<mlir::Value> domain =
+      CreatePlaceholderDomain(loc, shape, builder);
+  llvm::ArrayRef<mlir::Value> domain_ref = domain;
+  auto type = ValueType::get(
+      shape, first.getType().cast<ValueType>().ElementType());
+
+  // Use `first` and `second` as both fby operands temporarily, the second
+  // operand is updated once the swapping sair.map is created.
+  auto identity_mapping = MappingAttr::GetIdentity(context, num_loops);
+  mlir::ArrayAttr fby_mappings = builder.getArrayAttr(
+      {MappingAttr::GetIdentity(context, num_alloc_loops, num_loops),
+       identity_mapping});
+  auto create_fby = [&](mlir::Value init) {
+    return builder.create<SairFbyOp>(
+        loc, type, domain_ref.drop_back(), domain_ref.take_back(),
+        fby_mappings, init, init,
+        /*instances=*/
+        GetInstanceZeroOperandsSingleInstance(context, num_loops + 2),
+        /*copies=*/nullptr);
+  };
+  SairFbyOp current = create_fby(first);
+  SairFbyOp next = create_fby(second);
+
+  MapBodyBuilder map_body(num_loops, context);
+  mlir::OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToStart(&map_body.block());
+  mlir::Value current_memref = map_body.AddOperand(
+      {.value = current.getResult(), .mapping = identity_mapping});
+  mlir::Value next_memref = map_body.AddOperand(
+      {.value = next.getResult(), .mapping = identity_mapping});
+  builder.create<SairReturnOp>(
+      loc, llvm::SmallVector<mlir::Value>({next_memref, current_memref}));
+  builder.setInsertionPointAfter(next);
+
+  BufferAttr register_buffer = GetRegister0DBuffer(context);
+  auto decisions = DecisionsAttr::get(
+      /*sequence=*/nullptr,
+      /*loop_nest=*/PointwiseLoopNest(loops, fusion_analysis, builder),
+      /*storage=*/builder.getArrayAttr({register_buffer, register_buffer}),
+      /*expansion=*/builder.getStringAttr(kMapExpansionPattern),
+      /*copy_of=*/nullptr,
+      /*operands=*/GetInstanceZeroOperands(context, num_loops + 2), context);
+  auto swap_op = builder.create<SairMapOp>(
+      loc, llvm::SmallVector<mlir::Type>(2, type), /*domain=*/domain,
+      /*inputs=*/map_body.sair_values(), /*shape=*/shape,
+      /*instances=*/builder.getArrayAttr({decisions}), /*copies=*/nullptr);
+  swap_op.getBody().takeBody(map_body.region());
+  current.Value().set_value(swap_op.getResult(0));
+  next.Value().set_value(swap_op.getResult(1));
+
+  sequence_analysis.Insert(
+      ComputeOpInstance::Unique(cast<ComputeOp>(swap_op.getOperation())),
+      sequence_analysis.FindInsertionPoint(iter_spaces, last_access, num_loops,
+                                           Direction::kAfter));
+  return {.value = current.getResult(), .mapping = identity_mapping};
+}
+
+// Options controlling how buffers are allocated.
+struct AllocationOptions {
+  // Reuse allocations of buffers with disjoint lifetimes.
+  bool reuse_buffers;
+  // Maximal size in bytes of buffers allocated on the stack.
+  int64_t stack_allocation_limit;
+  // Allocate statically-shaped buffers outside of their loop nest.
+  bool hoist_allocations;
+};
+
+// Counts allocations created by AllocateBuffer.
+struct AllocationCounters {
+  int num_allocations = 0;
+  int num_stack_allocations = 0;
+  int num_reused_allocations = 0;
+  // Total size of statically-shaped allocations.
+  int64_t num_allocated_bytes = 0;
+};
+
+// Creates a memref for `buffer` and returns it along with the mapping from the
+// buffer loop nest to the domain of the memref. If `options.reuse_buffers` is
+// set, reuses an allocation of `allocations` that is dead when the buffer is
+// first accessed or registers the new allocation in `allocations` for reuse if
+// it has a static shape. Updates `counters` with the created allocation.
+ValueAccess AllocateBuffer(const Buffer &buffer, mlir::StringAttr space,
+                           const AllocationOptions &options,
                            const IterationSpaceAnalysis &iter_spaces,
                            const LoopFusionAnalysis &fusion_analysis,
                            SequenceAnalysis &sequence_analysis,
+                           llvm::SmallVectorImpl<Allocation> &allocations,
+                           AllocationCounters &counters,
                            mlir::OpBuilder &builder) {
   mlir::MLIRContext *context = builder.getContext();
-  auto [alloc_point, free_point] =
-      FindInsertionPoints(buffer, iter_spaces, sequence_analysis, builder);
+  int num_buffer_loops = buffer.loop_nest().size();
+  auto [alloc_point, free_point] = FindInsertionPoints(
+      buffer, num_buffer_loops, iter_spaces, sequence_analysis, builder);
 
   // Create the domain for malloc and free.
   LoopNest loop_nest = fusion_analysis.GetLoopNest(buffer.loop_nest());
@@ -166,46 +391,156 @@ mlir::Value AllocateBuffer(const Buffer &buffer,
                                               alloc_loop_nest, builder);
 
   // Introduce a malloc operation.
-  auto memref_type = mlir::MemRefType::get(memref_shape, buffer.element_type());
+  auto memref_type = mlir::MemRefType::get(
+      memref_shape, buffer.element_type(), mlir::MemRefLayoutAttrInterface(),
+      GetMemRefMemorySpace(space));
+
+  // Values stored in the buffer do not outlive an iteration of the buffer loop
+  // nest. A statically-shaped buffer can thus be allocated once outside of the
+  // loop nest and reused by all iterations. Iterations of parallel loops run
+  // concurrently and each need their own allocation, so the allocation stays
+  // inside the innermost parallel loop of the buffer loop nest.
+  llvm::ArrayRef<mlir::StringAttr> alloc_loops = buffer.loop_nest();
+  int num_alloc_loops = num_buffer_loops;
+  if (options.hoist_allocations && sizes.empty()) {
+    num_alloc_loops = 0;
+    for (auto [pos, name] : llvm::enumerate(buffer.loop_nest())) {
+      const LoopFusionClass &fusion_class = fusion_analysis.GetClass(name);
+      if (fusion_class.parallel() || fusion_class.gpu() != nullptr) {
+        num_alloc_loops = pos + 1;
+      }
+    }
+  }
+  if (num_alloc_loops < num_buffer_loops) {
+    ErasePlaceholderDomain(domain);
+    alloc_loops = alloc_loops.take_front(num_alloc_loops);
+    shape = fusion_analysis.GetLoopNest(alloc_loops).Shape();
+    domain = CreatePlaceholderDomain(buffer.location(), shape, builder);
+    std::tie(alloc_point, free_point) = FindInsertionPoints(
+        buffer, num_alloc_loops, iter_spaces, sequence_analysis, builder);
+    alloc_loop_nest =
+        PointwiseLoopNest(alloc_point.loop_nest(), fusion_analysis, builder);
+  }
   auto type = ValueType::get(shape, memref_type);
+  ValueAccess result = {
+      .mapping = MappingAttr::GetIdentity(context, alloc_loops.size(),
+                                          num_buffer_loops)};
+
+  // Buffers in registers always live on the stack when their size is static,
+  // as they are promoted to SSA values once loops accessing them are unrolled.
+  // Other buffers, including local ones, must fit in the stack allocation
+  // limit.
+  auto *sair_dialect = context->getLoadedDialect<SairDialect>();
+  bool on_stack = sizes.empty() &&
+                  (space == sair_dialect->register_attr() ||
+                   FitsOnStack(memref_type, options.stack_allocation_limit));
+  auto [first_access, last_access] = GetAccessSpan(buffer, sequence_analysis);
+  Allocation *reused = nullptr;
+  // Double-buffered buffers alternate between their own allocations.
+  if (options.reuse_buffers && sizes.empty() && !on_stack &&
+      buffer.double_buffer() == nullptr) {
+    reused = FindReusableAllocation(allocations, type, buffer.alignment(),
+                                    alloc_loops, first_access, iter_spaces,
+                                    sequence_analysis);
+  }
+  if (reused != nullptr) {
+    // Extend the lifetime of the allocation up to the last access of `buffer`.
+    ErasePlaceholderDomain(domain);
+    auto free_instance = ComputeOpInstance::Unique(
+        cast<ComputeOp>(reused->free_op.getOperation()));
+    sequence_analysis.Erase(free_instance);
+    sequence_analysis.Insert(free_instance, free_point);
+    free_instance.SetLoopNest(
+        PointwiseLoopNest(free_point.loop_nest(), fusion_analysis, builder));
+    reused->last_access = last_access;
+    result.value = reused->memref;
+    ++counters.num_reused_allocations;
+    return result;
+  }
+
   auto identity_mapping =
       MappingAttr::GetIdentity(context, shape.NumDimensions());
   llvm::SmallVector<mlir::Attribute> size_mappings(sizes.size(),
                                                    identity_mapping);
 
-  auto alloc_decisions = DecisionsAttr::get(
-      /*sequence=*/nullptr,
-      /*loop_nest=*/alloc_loop_nest,
-      /*storage=*/builder.getArrayAttr(GetRegister0DBuffer(context)),
-      /*expansion=*/builder.getStringAttr(kAllocExpansionPattern),
-      /*copy_of=*/nullptr,
-      /*operands=*/
-      GetInstanceZeroOperands(context, domain.size() + sizes.size()), context);
-  mlir::Value alloc = builder.create<SairAllocOp>(
-      buffer.location(), type, domain,
-      /*mapping_array=*/builder.getArrayAttr(size_mappings), sizes,
-      /*decisions=*/builder.getArrayAttr({alloc_decisions}),
-      /*copies=*/nullptr);
-  sequence_analysis.Insert(
-      ComputeOpInstance::Unique(alloc.getDefiningOp<ComputeOp>()), alloc_point);
+  // Creates an allocation of the buffer and the operation releasing it.
+  // Dynamic sizes are computed right before the first allocation.
+  auto allocate = [&](std::optional<ComputeOpInstance> previous_alloc) {
+    ++counters.num_allocations;
+    if (on_stack) ++counters.num_stack_allocations;
+    if (std::optional<int64_t> size = GetStaticSizeInBytes(memref_type)) {
+      counters.num_allocated_bytes += *size;
+    }
 
-  mlir::ArrayAttr free_loop_nest =
-      PointwiseLoopNest(free_point.loop_nest(), fusion_analysis, builder);
-  auto free_decisions = DecisionsAttr::get(
-      /*sequence=*/nullptr,
-      /*loop_nest=*/free_loop_nest,
-      /*storage=*/nullptr,
-      /*expansion=*/builder.getStringAttr(kFreeExpansionPattern),
-      /*copy_of=*/nullptr,
-      /*operands=*/GetInstanceZeroOperands(context, domain.size() + 1),
-      context);
-  auto free_op = builder.create<SairFreeOp>(
-      buffer.location(), domain,
-      /*mapping_array=*/builder.getArrayAttr(identity_mapping), alloc,
-      /*instances=*/builder.getArrayAttr({free_decisions}));
-  sequence_analysis.Insert(ComputeOpInstance::Unique(free_op), free_point);
+    auto alloc_decisions = DecisionsAttr::get(
+        /*sequence=*/nullptr,
+        /*loop_nest=*/alloc_loop_nest,
+        /*storage=*/builder.getArrayAttr(GetRegister0DBuffer(context)),
+        /*expansion=*/
+        builder.getStringAttr(on_stack ? kAllocaExpansionPattern
+                                       : kAllocExpansionPattern),
+        /*copy_of=*/nullptr,
+        /*operands=*/
+        GetInstanceZeroOperands(context, domain.size() + sizes.size()),
+        context);
+    auto alloc_op = builder.create<SairAllocOp>(
+        buffer.location(), type, domain,
+        /*mapping_array=*/builder.getArrayAttr(size_mappings), sizes,
+        /*decisions=*/builder.getArrayAttr({alloc_decisions}),
+        /*copies=*/nullptr, /*alignment=*/buffer.alignment());
+    auto alloc_instance =
+        ComputeOpInstance::Unique(cast<ComputeOp>(alloc_op.getOperation()));
+    if (previous_alloc.has_value()) {
+      sequence_analysis.Insert(alloc_instance, *previous_alloc,
+                               Direction::kAfter);
+    } else if (sizes.empty()) {
+      sequence_analysis.Insert(alloc_instance, alloc_point);
+    } else {
+      // Sequence the map computing memref sizes right before the allocation.
+      auto sizes_instance =
+          ComputeOpInstance::Unique(sizes[0].getDefiningOp<ComputeOp>());
+      sequence_analysis.Insert(sizes_instance, alloc_point);
+      sequence_analysis.Insert(alloc_instance, sizes_instance,
+                               Direction::kAfter);
+    }
+    // Stack allocations are released when leaving their loop nest.
+    if (on_stack) return std::make_pair(alloc_op, SairFreeOp());
+
+    mlir::ArrayAttr free_loop_nest =
+        PointwiseLoopNest(free_point.loop_nest(), fusion_analysis, builder);
+    auto free_decisions = DecisionsAttr::get(
+        /*sequence=*/nullptr,
+        /*loop_nest=*/free_loop_nest,
+        /*storage=*/nullptr,
+        /*expansion=*/builder.getStringAttr(kFreeExpansionPattern),
+        /*copy_of=*/nullptr,
+        /*operands=*/GetInstanceZeroOperands(context, domain.size() + 1),
+        context);
+    auto free_op = builder.create<SairFreeOp>(
+        buffer.location(), domain,
+        /*mapping_array=*/builder.getArrayAttr(identity_mapping), alloc_op,
+        /*instances=*/builder.getArrayAttr({free_decisions}));
+    sequence_analysis.Insert(ComputeOpInstance::Unique(free_op), free_point);
+    return std::make_pair(alloc_op, free_op);
+  };
+
+  auto [alloc_op, free_op] = allocate(std::nullopt);
+  if (buffer.double_buffer() != nullptr) {
+    SairAllocOp second_alloc_op = allocate(ComputeOpInstance::Unique(
+        cast<ComputeOp>(alloc_op.getOperation()))).first;
+    return RotateBuffer(buffer, alloc_op, second_alloc_op, alloc_loops.size(),
+                        iter_spaces, fusion_analysis, sequence_analysis,
+                        builder);
+  }
 
-  return alloc;
+  result.value = alloc_op;
+  if (options.reuse_buffers && sizes.empty() && !on_stack) {
+    allocations.push_back({.memref = alloc_op,
+                           .free_op = free_op,
+                           .loop_nest = alloc_loops,
+                           .last_access = last_access});
+  }
+  return result;
 }
 
 // Insert a load from a buffer for the operand `operand_pos` of `op`.
@@ -252,11 +587,17 @@ void InsertLoad(ComputeOp op, int operand_pos, const Buffer &buffer,
       /*copy_of=*/nullptr,
       /*operands=*/GetInstanceZeroOperands(context, load_domain.size() + 1),
       context);
+  // Only prefetch along loops the load is nested in.
+  PrefetchAttr prefetch = buffer.prefetch();
+  if (prefetch != nullptr &&
+      !llvm::is_contained(op_iter_space.loop_names(), prefetch.loop())) {
+    prefetch = nullptr;
+  }
   mlir::Value loaded = builder.create<SairLoadFromMemRefOp>(
       op.getLoc(), loaded_type, load_domain,
       builder.getArrayAttr({memref_mapping}), memref.value,
       operand_storage.layout(), /*instances=*/builder.getArrayAttr({decisions}),
-      /*copies=*/nullptr);
+      /*copies=*/nullptr, prefetch);
 
   auto load_instance =
       ComputeOpInstance::Unique(cast<ComputeOp>(loaded.getDefiningOp()));
@@ -336,7 +677,8 @@ void InsertStore(ComputeOp op, int result_pos, const Buffer &buffer,
       builder.getArrayAttr({memref_mapping, result_mapping}), memref.value,
       result, result_storage.layout(), store_shape,
       /*instances=*/builder.getArrayAttr({decisions}),
-      /*copies=*/nullptr);
+      /*copies=*/nullptr,
+      buffer.nontemporal() ? builder.getUnitAttr() : mlir::UnitAttr());
   auto op_instance = ComputeOpInstance::Unique(op);
   auto to_memref_instance = ComputeOpInstance::Unique(
       cast<ComputeOp>(store_to_memref_op.getOperation()));
@@ -347,19 +689,83 @@ void InsertStore(ComputeOp op, int result_pos, const Buffer &buffer,
   op_instance.SetStorage(result_pos, GetRegister0DBuffer(op.getContext()));
 }
 
+// Conveys the alignment and aliasing facts `import_op` asserts on its memref to
+// the code surrounding `program`. Alignment is asserted with
+// memref.assume_alignment before the program and memrefs passed as function
+// arguments are marked `llvm.noalias`. Facts about memrefs that are neither
+// defined outside the program nor function arguments are dropped.
+void AssumeMemRefFacts(FromToMemRefOp import_op, SairProgramOp program) {
+  auto from_scalar =
+      import_op.MemRef().value().getDefiningOp<SairFromScalarOp>();
+  if (from_scalar == nullptr) return;
+  mlir::Value memref = from_scalar.getValue();
+
+  if (std::optional<uint64_t> alignment = import_op.getAlignment()) {
+    bool is_assumed = llvm::any_of(memref.getUsers(), [&](mlir::Operation *op) {
+      auto assume = dyn_cast<mlir::memref::AssumeAlignmentOp>(op);
+      return assume != nullptr && assume.getAlignment() == *alignment;
+    });
+    if (!is_assumed) {
+      mlir::OpBuilder builder(program);
+      builder.create<mlir::memref::AssumeAlignmentOp>(import_op.getLoc(),
+                                                      memref, *alignment);
+    }
+  }
+
+  auto argument = memref.dyn_cast<mlir::BlockArgument>();
+  if (!import_op.getNoalias() || argument == nullptr) return;
+  auto function =
+      dyn_cast<mlir::func::FuncOp>(argument.getOwner()->getParentOp());
+  if (function == nullptr || argument.getOwner() != &function.front()) return;
+  function.setArgAttr(argument.getArgNumber(),
+                      mlir::LLVM::LLVMDialect::getNoAliasAttrName(),
+                      mlir::UnitAttr::get(function.getContext()));
+}
+
 // Implements storage attributes by replacing Sair values with memrefs.
 class MaterializeBuffers
     : public impl::MaterializeBuffersPassBase<MaterializeBuffers> {
+ public:
+  MaterializeBuffers() = default;
+  explicit MaterializeBuffers(bool reuse_buffers) {
+    this->reuse_buffers = reuse_buffers;
+  }
+
+ private:
   void RunOnProgram(SairProgramOp program) {
     mlir::MLIRContext *context = &getContext();
     mlir::OpBuilder builder(context);
-    auto storage_analysis = getChildAnalysis<StorageAnalysis>(program);
-    auto sequence_analysis = getChildAnalysis<SequenceAnalysis>(program);
-    auto fusion_analysis = getChildAnalysis<LoopFusionAnalysis>(program);
-    auto iteration_spaces = getChildAnalysis<IterationSpaceAnalysis>(program);
+    auto &storage_analysis = getChildAnalysis<StorageAnalysis>(program);
+    auto &sequence_analysis = getChildAnalysis<SequenceAnalysis>(program);
+    auto &fusion_analysis = getChildAnalysis<LoopFusionAnalysis>(program);
+    auto &iteration_spaces = getChildAnalysis<IterationSpaceAnalysis>(program);
 
-    builder.setInsertionPointToStart(&program.getBody().front());
+    llvm::SmallVector<const Buffer *> buffers;
     for (auto &[name, buffer] : storage_analysis.buffers()) {
+      buffers.push_back(&buffer);
+    }
+    // When reusing allocations, process buffers in the order of their first
+    // access so that allocations can be reused by buffers accessed later.
+    if (reuse_buffers) {
+      llvm::stable_sort(buffers, [&](const Buffer *lhs, const Buffer *rhs) {
+        if (lhs->is_external() || rhs->is_external()) {
+          return lhs->is_external() && !rhs->is_external();
+        }
+        return sequence_analysis.IsBefore(
+            GetAccessSpan(*lhs, sequence_analysis).first,
+            GetAccessSpan(*rhs, sequence_analysis).first);
+      });
+    }
+
+    AllocationOptions options = {
+        .reuse_buffers = reuse_buffers,
+        .stack_allocation_limit = stack_allocation_limit,
+        .hoist_allocations = hoist_allocations};
+    llvm::SmallVector<Allocation> allocations;
+    AllocationCounters counters;
+    builder.setInsertionPointToStart(&program.getBody().front());
+    for (const Buffer *buffer_ptr : buffers) {
+      const Buffer &buffer = *buffer_ptr;
       ValueAccess memref;
       // Allocate or retrieve the buffer.
       if (buffer.is_external()) {
@@ -370,11 +776,13 @@ class MaterializeBuffers
         memref.value = memref_operand.value();
         memref.mapping =
             iter_space.mapping().Inverse().Compose(memref_operand.Mapping());
+        AssumeMemRefFacts(buffer.import_op(), program);
       } else {
-        memref.value = AllocateBuffer(buffer, iteration_spaces, fusion_analysis,
-                                      sequence_analysis, builder);
-        memref.mapping =
-            MappingAttr::GetIdentity(context, buffer.loop_nest().size());
+        mlir::StringAttr space =
+            storage_analysis.GetStorage(buffer.values().front()).space();
+        memref = AllocateBuffer(buffer, space, options, iteration_spaces,
+                                fusion_analysis, sequence_analysis,
+                                allocations, counters, builder);
       }
 
       // Insert loads and stores.
@@ -407,20 +815,27 @@ class MaterializeBuffers
           continue;
         }
 
+        sequence_analysis.Erase(OpInstance::Unique(cast<SairOp>(op)));
         op->dropAllDefinedValueUses();
         op->erase();
       }
     }
 
     sequence_analysis.AssignInferred();
+    num_allocations += counters.num_allocations;
+    num_stack_allocations += counters.num_stack_allocations;
+    num_reused_allocations += counters.num_reused_allocations;
+    num_allocated_bytes += counters.num_allocated_bytes;
   }
 
   void runOnOperation() override {
-    markAnalysesPreserved<LoopFusionAnalysis, IterationSpaceAnalysis>();
+    // The sequence analysis is updated as operations are inserted.
+    markAnalysesPreserved<LoopFusionAnalysis, IterationSpaceAnalysis,
+                          SequenceAnalysis>();
 
     auto result = getOperation().walk([&](SairOp op) -> mlir::WalkResult {
-      auto storage_analysis =
-          getChildAnalysis<StorageAnalysis>(op->getParentOp());
+      auto &storage_analysis = getChildAnalysis<StorageAnalysis>(
+          cast<SairProgramOp>(op->getParentOp()));
       if (!op.HasExactlyOneInstance()) {
         return op.emitError() << "operations must have exactly one instance "
                                  "when materializing buffers";
@@ -448,6 +863,15 @@ class MaterializeBuffers
 
     getOperation().walk([&](SairProgramOp program) { RunOnProgram(program); });
   }
+
+  // Number of buffer allocations created.
+  PassCounter num_allocations{"num-allocations"};
+  // Number of buffer allocations created on the stack.
+  PassCounter num_stack_allocations{"num-stack-allocations"};
+  // Number of buffers reusing an existing allocation.
+  PassCounter num_reused_allocations{"num-reused-allocations"};
+  // Total size in bytes of statically-shaped allocations.
+  PassCounter num_allocated_bytes{"num-allocated-bytes"};
 };
 
 }  // namespace
@@ -457,4 +881,9 @@ CreateMaterializeBuffersPass() {
   return std::make_unique<MaterializeBuffers>();
 }
 
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateMaterializeBuffersPass(bool reuse_buffers) {
+  return std::make_unique<MaterializeBuffers>(reuse_buffers);
+}
+
 }  // namespace sair
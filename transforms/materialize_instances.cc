@@ -17,13 +17,17 @@
 #include <tuple>
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "mlir/IR/Value.h"
 #include "mlir/IR/Visitors.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LogicalResult.h"
 #include "sair_attributes.h"
 #include "sair_op_interfaces.h"
 #include "sair_ops.h"
+#include "statistics_report.h"
 #include "transforms/lowering.h"
 
 namespace sair {
@@ -51,10 +55,144 @@ std::optional<unsigned> FindCopiedInstance(
       result_copies, decisions.copy_of().cast<CopyAttr>().getValue(), location);
 }
 
+// For each instance and copy, the position of the first equivalent instance or
+// copy.
+struct EquivalentInstances {
+  llvm::DenseMap<mlir::Operation *, llvm::SmallVector<int>> instances;
+  llvm::DenseMap<mlir::Value, llvm::SmallVector<int>> copies;
+};
+
+// Number of instances and copies merged with an equivalent one.
+struct MergeCounters {
+  int num_instances = 0;
+  int num_copies = 0;
+};
+
+// Indicates if instances of `op` with the same decisions and equivalent
+// operands compute the same values and have no other effect.
+bool CanMergeInstances(SairOp op) {
+  if (op->getNumResults() == 0) return false;
+  if (mlir::isMemoryEffectFree(op)) return true;
+  if (!isa<SairMapOp, SairMapReduceOp>(op.getOperation())) return false;
+  auto result = op->walk([&](mlir::Operation *nested) {
+    if (nested == op.getOperation() ||
+        nested->hasTrait<mlir::OpTrait::IsTerminator>() ||
+        mlir::isMemoryEffectFree(nested)) {
+      return mlir::WalkResult::advance();
+    }
+    return mlir::WalkResult::interrupt();
+  });
+  return !result.wasInterrupted();
+}
+
+// Returns the attribute designating the first instance or copy of `value`
+// equivalent to the one designated by `attr`.
+mlir::Attribute GetEquivalentOperand(mlir::Value value, mlir::Attribute attr,
+                                     const EquivalentInstances &equivalences) {
+  mlir::MLIRContext *context = attr.getContext();
+  if (auto instance = attr.dyn_cast<InstanceAttr>()) {
+    auto it = equivalences.instances.find(value.getDefiningOp());
+    if (it == equivalences.instances.end()) return attr;
+    return InstanceAttr::get(context, it->second[instance.getValue()]);
+  }
+  if (auto copy = attr.dyn_cast<CopyAttr>()) {
+    auto it = equivalences.copies.find(value);
+    if (it == equivalences.copies.end()) return attr;
+    return CopyAttr::get(context, it->second[copy.getValue()]);
+  }
+  return attr;
+}
+
+// Sets each element of `equivalences` to the position of the first key equal
+// to the corresponding key. Returns true if any element changed.
+bool MergeEqualKeys(llvm::ArrayRef<mlir::Attribute> keys,
+                    llvm::SmallVectorImpl<int> &equivalences) {
+  bool changed = false;
+  for (int i = 0, e = keys.size(); i < e; ++i) {
+    int first = llvm::find(keys, keys[i]) - keys.begin();
+    if (equivalences[i] == first) continue;
+    equivalences[i] = first;
+    changed = true;
+  }
+  return changed;
+}
+
+// Finds instances of the same operation with the same decisions and equivalent
+// operands, and copies of the same value with the same decisions. Operands
+// become equivalent when their producers are merged, so this iterates until
+// reaching a fixed point. If `deduplicate` is false, each instance and copy is
+// only equivalent to itself.
+EquivalentInstances FindEquivalentInstances(llvm::ArrayRef<SairOp> ops,
+                                            bool deduplicate) {
+  EquivalentInstances equivalences;
+  for (SairOp op : ops) {
+    equivalences.instances[op.getOperation()] =
+        llvm::to_vector(llvm::seq<int>(0, op.NumInstances()));
+    auto value_producer = dyn_cast<ValueProducerOp>(op.getOperation());
+    if (!value_producer) continue;
+    for (int i = 0, e = op->getNumResults(); i < e; ++i) {
+      equivalences.copies[op->getResult(i)] = llvm::to_vector(
+          llvm::seq<int>(0, value_producer.GetCopies(i).size()));
+    }
+  }
+  if (!deduplicate) return equivalences;
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (SairOp op : ops) {
+      mlir::MLIRContext *context = op.getContext();
+      llvm::SmallVector<mlir::Attribute> keys;
+      if (CanMergeInstances(op)) {
+        for (int i = 0, e = op.NumInstances(); i < e; ++i) {
+          DecisionsAttr decisions = op.GetDecisions(i);
+          if (decisions.operands() != nullptr) {
+            llvm::SmallVector<mlir::Attribute> operands;
+            for (auto [value, attr] :
+                 llvm::zip(op->getOperands(), decisions.operands())) {
+              operands.push_back(
+                  GetEquivalentOperand(value, attr, equivalences));
+            }
+            decisions = UpdateOperands(decisions, operands);
+          }
+          keys.push_back(decisions);
+        }
+        changed |=
+            MergeEqualKeys(keys, equivalences.instances[op.getOperation()]);
+      }
+
+      auto value_producer = dyn_cast<ValueProducerOp>(op.getOperation());
+      if (!value_producer) continue;
+      for (int i = 0, e = op->getNumResults(); i < e; ++i) {
+        mlir::Value result = op->getResult(i);
+        keys.clear();
+        for (mlir::Attribute attr : value_producer.GetCopies(i)) {
+          auto decisions = attr.cast<DecisionsAttr>();
+          if (decisions.copy_of() != nullptr) {
+            decisions = DecisionsAttr::get(
+                decisions.sequence(), decisions.loop_nest(),
+                decisions.storage(), decisions.expansion(),
+                GetEquivalentOperand(result, decisions.copy_of(),
+                                     equivalences),
+                decisions.operands(), context);
+          }
+          keys.push_back(decisions);
+        }
+        changed |= MergeEqualKeys(keys, equivalences.copies[result]);
+      }
+    }
+  }
+  return equivalences;
+}
+
 // In the given container operation, clones operations that have multiple
 // instances and creates copies of their results if requested by `instances`
-// and `copies` attributes, respectively.
-mlir::LogicalResult CreateInstancesAndCopies(Operation *container) {
+// and `copies` attributes, respectively. If `deduplicate` is true, instances
+// and copies equivalent to a previous one are not materialized and their uses
+// are redirected to the previous one.
+mlir::LogicalResult CreateInstancesAndCopies(Operation *container,
+                                             bool deduplicate,
+                                             MergeCounters &counters) {
   // Before starting, check that instances are indeed present when used. Drop
   // operations with empty instance lists and no uses.
   llvm::SmallVector<SairOp> ops;
@@ -89,6 +227,7 @@ mlir::LogicalResult CreateInstancesAndCopies(Operation *container) {
     return mlir::WalkResult::advance();
   });
   if (result.wasInterrupted()) return mlir::failure();
+  EquivalentInstances equivalences = FindEquivalentInstances(ops, deduplicate);
 
   // Stage 1: create clones of the original operation for each instance and
   // introduce copies of required. Populates the mapping from the original
@@ -102,7 +241,19 @@ mlir::LogicalResult CreateInstancesAndCopies(Operation *container) {
   llvm::DenseMap<std::pair<mlir::Value, mlir::Attribute>, mlir::Value> mapping;
   for (SairOp sair_op : ops) {
     OpBuilder builder(sair_op);
+    llvm::ArrayRef<int> equivalent_instances =
+        equivalences.instances[sair_op.getOperation()];
     for (int i = 0, e = sair_op.NumInstances(); i < e; ++i) {
+      if (int first = equivalent_instances[i]; first != i) {
+        for (mlir::Value result : sair_op->getResults()) {
+          mapping.try_emplace(
+              std::make_pair(result, InstanceAttr::get(context, i)),
+              mapping.lookup(
+                  std::make_pair(result, InstanceAttr::get(context, first))));
+        }
+        ++counters.num_instances;
+        continue;
+      }
       Operation *clone = builder.clone(*sair_op.getOperation());
       for (mlir::Value result : sair_op->getResults()) {
         mapping.try_emplace(
@@ -124,9 +275,19 @@ mlir::LogicalResult CreateInstancesAndCopies(Operation *container) {
     // Value producer operations may also request copies of their results to be
     // produced. Create such copies.
     for (int i = 0, e = value_producer->getNumResults(); i < e; ++i) {
+      mlir::Value source = value_producer->getResult(i);
+      llvm::ArrayRef<int> equivalent_copies = equivalences.copies[source];
       for (auto en : llvm::enumerate(value_producer.GetCopies(i))) {
         DecisionsAttr decisions = en.value().cast<DecisionsAttr>();
-        mlir::Value source = value_producer->getResult(i);
+        int index = en.index();
+        if (int first = equivalent_copies[index]; first != index) {
+          mapping.try_emplace(
+              std::make_pair(source, CopyAttr::get(context, index)),
+              mapping.lookup(
+                  std::make_pair(source, CopyAttr::get(context, first))));
+          ++counters.num_copies;
+          continue;
+        }
         unsigned rank =
             source.getType().cast<ValueType>().Shape().NumDimensions();
         std::optional<unsigned> copied_instance = FindCopiedInstance(
@@ -211,10 +372,20 @@ class MaterializeInstancesPass
     : public impl::MaterializeInstancesPassBase<MaterializeInstancesPass> {
  public:
   void runOnOperation() override {
-    if (mlir::failed(CreateInstancesAndCopies(getOperation()))) {
+    MergeCounters counters;
+    if (mlir::failed(
+            CreateInstancesAndCopies(getOperation(), deduplicate, counters))) {
       signalPassFailure();
     }
+    num_merged_instances += counters.num_instances;
+    num_merged_copies += counters.num_copies;
   }
+
+ private:
+  // Number of instances merged with an equivalent instance.
+  PassCounter num_merged_instances{"num-merged-instances"};
+  // Number of copies merged with an equivalent copy.
+  PassCounter num_merged_copies{"num-merged-copies"};
 };
 
 }  // namespace
@@ -0,0 +1,71 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "transforms/memory_effects.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+
+namespace sair {
+
+bool CollectAccessedMemRefs(mlir::Operation *op,
+                            llvm::SmallVectorImpl<mlir::Value> &read,
+                            llvm::SmallVectorImpl<mlir::Value> &written) {
+  mlir::WalkResult result = op->walk([&](mlir::Operation *nested) {
+    if (nested->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>()) {
+      return mlir::WalkResult::advance();
+    }
+    auto effect_interface = dyn_cast<mlir::MemoryEffectOpInterface>(nested);
+    if (effect_interface == nullptr) return mlir::WalkResult::interrupt();
+    llvm::SmallVector<mlir::MemoryEffects::EffectInstance> effects;
+    effect_interface.getEffects(effects);
+    for (const auto &effect : effects) {
+      if (effect.getValue() == nullptr) return mlir::WalkResult::interrupt();
+      if (isa<mlir::MemoryEffects::Read>(effect.getEffect())) {
+        read.push_back(effect.getValue());
+      } else if (isa<mlir::MemoryEffects::Write, mlir::MemoryEffects::Free>(
+                     effect.getEffect())) {
+        written.push_back(effect.getValue());
+      }
+    }
+    return mlir::WalkResult::advance();
+  });
+  return !result.wasInterrupted();
+}
+
+bool IsNoAliasArgument(mlir::Value value) {
+  auto arg = value.dyn_cast<mlir::BlockArgument>();
+  if (arg == nullptr) return false;
+  auto func = dyn_cast<mlir::func::FuncOp>(arg.getOwner()->getParentOp());
+  if (func == nullptr || arg.getOwner() != &func.getBody().front()) {
+    return false;
+  }
+  return func.getArgAttr(arg.getArgNumber(),
+                         mlir::LLVM::LLVMDialect::getNoAliasAttrName()) !=
+         nullptr;
+}
+
+bool IsReadOnly(mlir::Value memref, llvm::ArrayRef<mlir::Value> written,
+                mlir::AliasAnalysis &alias_analysis) {
+  return llvm::all_of(written, [&](mlir::Value other) {
+    if (other != memref && IsNoAliasArgument(memref) &&
+        IsNoAliasArgument(other)) {
+      return true;
+    }
+    return alias_analysis.alias(memref, other).isNo();
+  });
+}
+
+}  // namespace sair
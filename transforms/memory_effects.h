@@ -0,0 +1,42 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef THIRD_PARTY_SAIR_TRANSFORMS_MEMORY_EFFECTS_H_
+#define THIRD_PARTY_SAIR_TRANSFORMS_MEMORY_EFFECTS_H_
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Analysis/AliasAnalysis.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+
+namespace sair {
+
+// Collects memrefs read, and written or freed, by `op` and the operations
+// nested in it. Returns false if an operation has unknown effects or accesses
+// memory that is not identified by a value.
+bool CollectAccessedMemRefs(mlir::Operation *op,
+                            llvm::SmallVectorImpl<mlir::Value> &read,
+                            llvm::SmallVectorImpl<mlir::Value> &written);
+
+// Indicates if `value` is an argument of a function marked with
+// `llvm.noalias`.
+bool IsNoAliasArgument(mlir::Value value);
+
+// Indicates if `memref` is left untouched by writes to `written` memrefs.
+bool IsReadOnly(mlir::Value memref, llvm::ArrayRef<mlir::Value> written,
+                mlir::AliasAnalysis &alias_analysis);
+
+}  // namespace sair
+
+#endif  // THIRD_PARTY_SAIR_TRANSFORMS_MEMORY_EFFECTS_H_
@@ -0,0 +1,239 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/Pass/Pass.h"
+#include "loop_nest.h"
+#include "sair_attributes.h"
+#include "sair_op_interfaces.h"
+#include "sair_ops.h"
+#include "storage.h"
+
+namespace sair {
+
+#define GEN_PASS_DEF_MEMORYREPORTPASS
+#include "transforms/lowering.h.inc"
+
+namespace {
+
+// Multiplies two sizes that may be unknown.
+std::optional<int64_t> MulSizes(std::optional<int64_t> lhs,
+                                std::optional<int64_t> rhs) {
+  if (!lhs.has_value() || !rhs.has_value()) return std::nullopt;
+  return *lhs * *rhs;
+}
+
+// Prints a size, using `?` if it is unknown.
+std::string FormatSize(std::optional<int64_t> size) {
+  return size.has_value() ? std::to_string(*size) : "?";
+}
+
+// Size in bytes of the elements of `buffer`.
+std::optional<int64_t> ElementSize(const Buffer &buffer) {
+  mlir::Type type = buffer.element_type();
+  if (!type.isIntOrFloat()) return std::nullopt;
+  return llvm::divideCeil(type.getIntOrFloatBitWidth(), 8);
+}
+
+// Returns the number of distinct values layout expression `expr` takes while
+// the loops before `level` are fixed and those after iterate over
+// `loops_shape`. Returns std::nullopt if the number is not statically known.
+std::optional<int64_t> TouchedExtent(MappingExpr expr, int level,
+                                     DomainShapeAttr loops_shape) {
+  bool has_fixed_loops = false;
+  bool has_free_loops = false;
+  bool is_fully_specified = true;
+  expr.Walk([&](MappingExpr sub_expr) {
+    if (sub_expr.isa<MappingNoneExpr, MappingUnknownExpr>()) {
+      is_fully_specified = false;
+    } else if (auto dim_expr = sub_expr.dyn_cast<MappingDimExpr>()) {
+      if (dim_expr.dimension() < level) {
+        has_fixed_loops = true;
+      } else {
+        has_free_loops = true;
+      }
+    }
+  });
+  if (!is_fully_specified) return std::nullopt;
+  if (!has_free_loops) return 1;
+  if (!has_fixed_loops) return StaticLayoutExtent(expr, loops_shape);
+
+  // Unstripe expressions with fixed outer stripes span the size of the first
+  // free stripe.
+  auto unstripe = expr.dyn_cast<MappingUnStripeExpr>();
+  if (unstripe == nullptr) return std::nullopt;
+  auto is_fixed = [&](MappingExpr operand) {
+    return TouchedExtent(operand, level, loops_shape) == 1;
+  };
+  llvm::ArrayRef<MappingExpr> operands = unstripe.operands();
+  int first_free = llvm::find_if_not(operands, is_fixed) - operands.begin();
+  if (first_free == 0) return std::nullopt;
+  bool inner_operands_free =
+      llvm::none_of(operands.drop_front(first_free), [&](MappingExpr operand) {
+        bool has_fixed = false;
+        operand.Walk([&](MappingExpr sub_expr) {
+          auto dim_expr = sub_expr.dyn_cast<MappingDimExpr>();
+          has_fixed |= dim_expr != nullptr && dim_expr.dimension() < level;
+        });
+        return has_fixed;
+      });
+  if (!inner_operands_free) return std::nullopt;
+  return unstripe.factors()[first_free - 1];
+}
+
+// Number of bytes of `buffer` touched by an access with layout `layout` while
+// the loops before `level` are fixed. Layout dimensions with an unknown
+// extent are assumed to be fully accessed. Returns std::nullopt if the layout
+// is not specified.
+std::optional<int64_t> TouchedBytes(const Buffer &buffer, MappingAttr layout,
+                                    int level, DomainShapeAttr loops_shape) {
+  if (layout == nullptr || buffer.mapping() == nullptr) return std::nullopt;
+  std::optional<int64_t> bytes = ElementSize(buffer);
+  DomainShapeAttr buffer_shape = buffer.DomainShape();
+  for (auto [expr, buffer_expr] :
+       llvm::zip(layout.Dimensions(), buffer.mapping().Dimensions())) {
+    std::optional<int64_t> extent = TouchedExtent(expr, level, loops_shape);
+    if (!extent.has_value()) {
+      extent = StaticLayoutExtent(buffer_expr, buffer_shape);
+    }
+    bytes = MulSizes(bytes, extent);
+  }
+  return bytes;
+}
+
+// Emits a remark describing the accesses of `op` to `buffer` with layout
+// `layout`, expressed in the domain of the loops of `op`. Reuse distances are
+// printed as `?` if `layout` is null. Returns the number of bytes moved.
+std::optional<int64_t> ReportAccess(
+    const Buffer &buffer, const ComputeOpInstance &op, MappingAttr layout,
+    llvm::StringRef verb, const IterationSpaceAnalysis &iteration_spaces,
+    const LoopFusionAnalysis &fusion_analysis) {
+  const IterationSpace &iter_space = iteration_spaces.Get(op);
+  DomainShapeAttr loops_shape =
+      fusion_analysis.GetLoopNest(iter_space.loop_names()).Shape();
+  mlir::MLIRContext *context = op.context();
+
+  std::optional<int64_t> moved_bytes = ElementSize(buffer);
+  for (int i = 0, e = iter_space.num_loops(); i < e; ++i) {
+    moved_bytes = MulSizes(
+        moved_bytes,
+        StaticLayoutExtent(MappingDimExpr::get(i, context), loops_shape));
+  }
+
+  mlir::InFlightDiagnostic remark = mlir::emitRemark(op.getLoc());
+  remark << verb << " buffer " << buffer.name() << ": "
+         << FormatSize(moved_bytes) << " bytes moved";
+  if (iter_space.num_loops() == 0) return moved_bytes;
+
+  remark << ", reuse distance";
+  for (auto [level, loop] : llvm::enumerate(iter_space.loop_names())) {
+    remark << (level == 0 ? " " : ", ") << loop.getValue() << "="
+           << FormatSize(TouchedBytes(buffer, layout, level + 1, loops_shape));
+    if (layout == nullptr) continue;
+    bool carries_reuse = llvm::none_of(layout, [&](MappingExpr expr) {
+      bool uses_loop = false;
+      expr.Walk([&](MappingExpr sub_expr) {
+        auto dim_expr = sub_expr.dyn_cast<MappingDimExpr>();
+        uses_loop |= dim_expr != nullptr && dim_expr.dimension() == level;
+      });
+      return uses_loop || expr.HasNoneExprs() || expr.HasUnknownExprs();
+    });
+    if (carries_reuse) remark << " (reused)";
+  }
+  return moved_bytes;
+}
+
+// Reports the footprint and traffic of each buffer declared in Sair programs.
+class MemoryReport : public impl::MemoryReportPassBase<MemoryReport> {
+  void RunOnProgram(SairProgramOp program) {
+    auto &storage_analysis = getChildAnalysis<StorageAnalysis>(program);
+    auto &iteration_spaces = getChildAnalysis<IterationSpaceAnalysis>(program);
+    auto &fusion_analysis = getChildAnalysis<LoopFusionAnalysis>(program);
+
+    // Sort buffers by name to report them in a deterministic order.
+    llvm::SmallVector<const Buffer *> buffers;
+    for (auto &[name, buffer] : storage_analysis.buffers()) {
+      buffers.push_back(&buffer);
+    }
+    llvm::sort(buffers, [](const Buffer *lhs, const Buffer *rhs) {
+      return lhs->name().getValue() < rhs->name().getValue();
+    });
+
+    for (const Buffer *buffer : buffers) {
+      std::optional<int64_t> total_bytes = 0;
+      auto add_bytes = [&](std::optional<int64_t> bytes) {
+        if (!total_bytes.has_value() || !bytes.has_value()) {
+          total_bytes = std::nullopt;
+        } else {
+          *total_bytes += *bytes;
+        }
+      };
+
+      // The footprint is unknown if the layout of an access is not specified.
+      bool has_layout = buffer->mapping() != nullptr;
+      for (auto [op, result] : buffer->writes()) {
+        const ValueStorage &storage =
+            storage_analysis.GetStorage(op.Result(result));
+        has_layout &= storage.layout() != nullptr;
+        add_bytes(ReportAccess(*buffer, op, storage.layout(), "writes",
+                               iteration_spaces, fusion_analysis));
+      }
+      for (auto [op, operand] : buffer->reads()) {
+        OperandInstance operand_instance = op.Operand(operand);
+        std::optional<ValueStorage> storage =
+            storage_analysis.GetStorage(*operand_instance.GetValue())
+                .Map(operand_instance, iteration_spaces);
+        MappingAttr layout =
+            storage.has_value() ? storage->layout() : MappingAttr();
+        has_layout &= layout != nullptr;
+        add_bytes(ReportAccess(*buffer, op, layout, "reads", iteration_spaces,
+                               fusion_analysis));
+      }
+
+      std::optional<int64_t> footprint =
+          has_layout ? buffer->StaticSize() : std::nullopt;
+      mlir::InFlightDiagnostic remark = mlir::emitRemark(buffer->location());
+      remark << "buffer " << buffer->name() << ": footprint of "
+             << FormatSize(footprint) << " bytes";
+      if (!buffer->loop_nest().empty()) {
+        remark << " per iteration of loop "
+               << buffer->loop_nest().back().getValue();
+      }
+      remark << ", " << FormatSize(total_bytes) << " bytes moved";
+    }
+  }
+
+  void runOnOperation() override {
+    getOperation().walk([&](SairProgramOp program) { RunOnProgram(program); });
+    markAllAnalysesPreserved();
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateMemoryReportPass() {
+  return std::make_unique<MemoryReport>();
+}
+
+}  // namespace sair
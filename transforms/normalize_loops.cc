@@ -249,10 +249,12 @@ void NormalizeLoops(SairOp op, const IterationSpace &iteration_space,
   for (int i = 0, e = iteration_space.num_loops(); i < e; ++i) {
     auto dim_expr = MappingDimExpr::get(i, context);
     mlir::StringAttr name = iteration_space.loop_names()[i];
-    mlir::IntegerAttr unroll_attr =
-        fusion_analysis.GetClass(name).GetUnrollAttr(*builder.getContext());
-    normalized_loops.push_back(
-        LoopAttr::get(name, dim_expr, unroll_attr, context));
+    const LoopFusionClass &fusion_class = fusion_analysis.GetClass(name);
+    mlir::IntegerAttr unroll_attr = fusion_class.GetUnrollAttr(*context);
+    mlir::UnitAttr parallel_attr = fusion_class.GetParallelAttr(*context);
+    normalized_loops.push_back(LoopAttr::get(
+        name, dim_expr, unroll_attr, parallel_attr, fusion_class.gpu(),
+        fusion_class.accumulators(), fusion_class.peel(), context));
   }
 
   MappingAttr mapping = iteration_space.MappingToLoops();
@@ -271,6 +273,9 @@ void NormalizeLoops(SairOp op, const IterationSpace &iteration_space,
     sequence_analysis.Insert(instance, OpInstance::Unique(op),
                              Direction::kBefore);
     instance.SetLoopNest(builder.getArrayAttr(normalized_loops));
+  } else {
+    sequence_analysis.Replace(OpInstance::Unique(op),
+                              OpInstance::Unique(new_op));
   }
 
   MappingAttr result_mapping =
@@ -333,9 +338,9 @@ class NormalizeLoopsPass
   mlir::LogicalResult RunOpProgram(SairProgramOp program,
                                    mlir::OpBuilder &builder) {
     LoopRangeCache loop_range_cache;
-    auto iteration_spaces = getChildAnalysis<IterationSpaceAnalysis>(program);
-    auto fusion_analysis = getChildAnalysis<LoopFusionAnalysis>(program);
-    auto sequence_analysis = getChildAnalysis<SequenceAnalysis>(program);
+    auto &iteration_spaces = getChildAnalysis<IterationSpaceAnalysis>(program);
+    auto &fusion_analysis = getChildAnalysis<LoopFusionAnalysis>(program);
+    auto &sequence_analysis = getChildAnalysis<SequenceAnalysis>(program);
 
     llvm::SmallVector<SairOp> ops;
     program.walk([&](SairOp op) {
@@ -387,7 +392,12 @@ class NormalizeLoopsPass
         getOperation().walk([&](SairProgramOp program) -> mlir::WalkResult {
           return RunOpProgram(program, builder);
         });
-    if (result.wasInterrupted()) signalPassFailure();
+    if (result.wasInterrupted()) {
+      signalPassFailure();
+      return;
+    }
+    // The sequence analysis is updated as operations are replaced.
+    markAnalysesPreserved<SequenceAnalysis>();
   }
 };
 
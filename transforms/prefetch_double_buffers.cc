@@ -0,0 +1,219 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <memory>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Analysis/AliasAnalysis.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/RegionUtils.h"
+#include "statistics_report.h"
+#include "transforms/memory_effects.h"
+
+namespace sair {
+
+#define GEN_PASS_DEF_PREFETCHDOUBLEBUFFERSPASS
+#include "transforms/lowering.h.inc"
+
+namespace {
+
+// Memrefs a loop swaps at each iteration, as emitted for double-buffered
+// buffers: the buffer accessed by the current iteration and the buffer
+// accessed by the next one.
+struct RotatedBuffer {
+  mlir::BlockArgument current;
+  mlir::BlockArgument next;
+};
+
+// Finds pairs of memrefs carried by `for_op` that the loop swaps at each
+// iteration and such that the body of the loop only accesses one of them.
+llvm::SmallVector<RotatedBuffer> FindRotatedBuffers(mlir::scf::ForOp for_op) {
+  mlir::Block *body = for_op.getBody();
+  mlir::Operation *yield = body->getTerminator();
+  auto only_yielded = [&](mlir::Value value) {
+    return llvm::all_of(value.getUsers(),
+                        [&](mlir::Operation *user) { return user == yield; });
+  };
+
+  llvm::SmallVector<RotatedBuffer> buffers;
+  for (auto [pos, arg] : llvm::enumerate(for_op.getRegionIterArgs())) {
+    if (!arg.getType().isa<mlir::MemRefType>()) continue;
+    auto other = yield->getOperand(pos).dyn_cast<mlir::BlockArgument>();
+    if (other == nullptr || other.getOwner() != body ||
+        other == for_op.getInductionVar()) {
+      continue;
+    }
+    // Skip the induction variable to index yielded values.
+    int other_pos = other.getArgNumber() - 1;
+    if (other_pos <= pos || yield->getOperand(other_pos) != arg) continue;
+    if (only_yielded(other) && !only_yielded(arg)) {
+      buffers.push_back({.current = arg, .next = other});
+    } else if (only_yielded(arg) && !only_yielded(other)) {
+      buffers.push_back({.current = other, .next = arg});
+    }
+  }
+  return buffers;
+}
+
+// Writes the content of the buffer accessed by each iteration of `for_op` at
+// the previous iteration, into the buffer rotated in for the next iteration,
+// before the operations reading the buffer of the current iteration. Writes
+// the buffer of the first iteration before the loop. Operations writing the
+// buffer, along with the operations of the loop body they depend on, must
+// only depend on the induction variable and on values defined outside of the
+// loop and must not read memory that other operations of the loop write.
+// Returns false and leaves the loop untouched otherwise.
+bool PrefetchBuffer(mlir::scf::ForOp for_op, const RotatedBuffer &buffer,
+                    mlir::AliasAnalysis &alias_analysis) {
+  mlir::Block *body = for_op.getBody();
+  llvm::SmallVector<mlir::Operation *> writes;
+  for (mlir::Operation &op : body->without_terminator()) {
+    llvm::SmallVector<mlir::Value> read, written;
+    if (!CollectAccessedMemRefs(&op, read, written)) return false;
+    if (llvm::is_contained(written, buffer.current)) writes.push_back(&op);
+  }
+  if (writes.empty()) return false;
+
+  // Collect the operations computing the content of the buffer.
+  llvm::SmallPtrSet<mlir::Operation *, 8> producers;
+  llvm::SmallVector<mlir::Operation *> worklist = writes;
+  while (!worklist.empty()) {
+    mlir::Operation *op = worklist.pop_back_val();
+    if (!producers.insert(op).second) continue;
+    llvm::SetVector<mlir::Value> operands;
+    operands.insert(op->operand_begin(), op->operand_end());
+    mlir::getUsedValuesDefinedAbove(op->getRegions(), operands);
+    for (mlir::Value operand : operands) {
+      if (operand == for_op.getInductionVar() || operand == buffer.current) {
+        continue;
+      }
+      // Other values carried by the loop are not known one iteration ahead.
+      auto arg = operand.dyn_cast<mlir::BlockArgument>();
+      if (arg != nullptr && arg.getOwner() == body) return false;
+      mlir::Operation *definition = operand.getDefiningOp();
+      if (definition != nullptr && definition->getBlock() == body) {
+        worklist.push_back(definition);
+      }
+    }
+  }
+
+  // Producers of the next iteration now run before the other operations of
+  // the current iteration. Producers that write memory must only write the
+  // buffer and must not have results, so that they can be removed from the
+  // current iteration.
+  llvm::SmallVector<mlir::Operation *> ordered_producers;
+  llvm::SmallVector<mlir::Value> producer_reads, other_writes;
+  for (mlir::Operation &op : body->without_terminator()) {
+    llvm::SmallVector<mlir::Value> read, written;
+    CollectAccessedMemRefs(&op, read, written);
+    if (!producers.contains(&op)) {
+      llvm::append_range(other_writes, written);
+      continue;
+    }
+    ordered_producers.push_back(&op);
+    if (!written.empty() && op.getNumResults() > 0) return false;
+    if (llvm::any_of(written, [&](mlir::Value memref) {
+          return memref != buffer.current;
+        })) {
+      return false;
+    }
+    for (mlir::Value memref : read) {
+      if (memref != buffer.current) producer_reads.push_back(memref);
+    }
+  }
+  for (mlir::Value memref : producer_reads) {
+    if (!IsReadOnly(memref, other_writes, alias_analysis)) return false;
+  }
+
+  // Clones producers into an scf.if operation executed if `condition` holds,
+  // to write `memref` with the content of the buffer at iteration `iv`.
+  mlir::Location loc = for_op.getLoc();
+  auto emit_producers = [&](mlir::Value condition, mlir::Value iv,
+                            mlir::Value memref, mlir::OpBuilder &builder) {
+    builder.create<mlir::scf::IfOp>(
+        loc, condition, [&](mlir::OpBuilder &then_builder, mlir::Location) {
+          mlir::IRMapping mapping;
+          mapping.map(for_op.getInductionVar(), iv);
+          mapping.map(buffer.current, memref);
+          for (mlir::Operation *op : ordered_producers) {
+            then_builder.clone(*op, mapping);
+          }
+          then_builder.create<mlir::scf::YieldOp>(loc);
+        });
+  };
+
+  // Write the buffer of the first iteration before the loop, unless the loop
+  // is empty.
+  mlir::OpBuilder builder(for_op);
+  mlir::Value non_empty = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::slt, for_op.getLowerBound(),
+      for_op.getUpperBound());
+  // Skip the induction variable to index initial values.
+  mlir::Value first_memref =
+      for_op.getInitArgs()[buffer.current.getArgNumber() - 1];
+  emit_producers(non_empty, for_op.getLowerBound(), first_memref, builder);
+
+  // Write the buffer of the next iteration, unless this is the last one,
+  // before writes of the current iteration used to be.
+  builder.setInsertionPoint(writes.front());
+  mlir::Value next_iv = builder.create<mlir::arith::AddIOp>(
+      loc, for_op.getInductionVar(), for_op.getStep());
+  mlir::Value has_next = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::slt, next_iv, for_op.getUpperBound());
+  emit_producers(has_next, next_iv, buffer.next, builder);
+
+  // Producers that do not write memory may still be used by other operations.
+  for (mlir::Operation *op : llvm::reverse(ordered_producers)) {
+    if (op->use_empty()) op->erase();
+  }
+  return true;
+}
+
+// Issues writes of double-buffered buffers one iteration ahead.
+class PrefetchDoubleBuffers
+    : public impl::PrefetchDoubleBuffersPassBase<PrefetchDoubleBuffers> {
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::scf::ForOp> loops;
+    getOperation().walk([&](mlir::scf::ForOp op) { loops.push_back(op); });
+    mlir::AliasAnalysis &alias_analysis = getAnalysis<mlir::AliasAnalysis>();
+    for (mlir::scf::ForOp loop : loops) {
+      for (const RotatedBuffer &buffer : FindRotatedBuffers(loop)) {
+        if (PrefetchBuffer(loop, buffer, alias_analysis)) {
+          ++num_prefetched_buffers;
+        }
+      }
+    }
+  }
+
+ private:
+  // Number of buffers written one iteration ahead of their reads.
+  PassCounter num_prefetched_buffers{"num-prefetched-buffers"};
+};
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreatePrefetchDoubleBuffersPass() {
+  return std::make_unique<PrefetchDoubleBuffers>();
+}
+
+}  // namespace sair
@@ -0,0 +1,106 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/GPU/IR/GPUDialect.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Support/LogicalResult.h"
+
+namespace sair {
+
+#define GEN_PASS_DEF_PROMOTEWORKGROUPBUFFERSPASS
+#include "transforms/lowering.h.inc"
+
+namespace {
+
+// Indicates if `type` is a memref in the GPU workgroup address space.
+bool IsWorkgroupMemRef(mlir::MemRefType type) {
+  auto space =
+      type.getMemorySpace().dyn_cast_or_null<mlir::gpu::AddressSpaceAttr>();
+  return space != nullptr &&
+         space.getValue() == mlir::gpu::AddressSpace::Workgroup;
+}
+
+// Replaces `alloc` by a workgroup attribution of the gpu.launch operation
+// accessing it. Fails if the buffer has a dynamic shape or if it is accessed
+// outside of a single gpu.launch operation.
+mlir::LogicalResult PromoteToWorkgroupAttribution(
+    mlir::memref::AllocOp alloc) {
+  mlir::MemRefType type = alloc.getType();
+  if (!type.hasStaticShape()) {
+    return alloc.emitError()
+           << "GPU shared memory buffers must have a static shape";
+  }
+
+  mlir::gpu::LaunchOp launch;
+  llvm::SmallVector<mlir::Operation *> deallocs;
+  for (mlir::Operation *user : alloc->getUsers()) {
+    if (isa<mlir::memref::DeallocOp>(user)) {
+      deallocs.push_back(user);
+      continue;
+    }
+    auto user_launch = user->getParentOfType<mlir::gpu::LaunchOp>();
+    if (user_launch == nullptr ||
+        (launch != nullptr && user_launch != launch)) {
+      return alloc.emitError() << "GPU shared memory buffers must only be "
+                                  "accessed from a single GPU kernel";
+    }
+    launch = user_launch;
+  }
+
+  if (launch != nullptr) {
+    mlir::Value attribution =
+        launch.addWorkgroupAttribution(type, alloc.getLoc());
+    alloc.getResult().replaceUsesWithIf(
+        attribution, [&](mlir::OpOperand &use) {
+          return launch->isProperAncestor(use.getOwner());
+        });
+  }
+  for (mlir::Operation *dealloc : deallocs) dealloc->erase();
+  alloc.erase();
+  return mlir::success();
+}
+
+// Turns allocations of GPU shared memory buffers into workgroup attributions
+// of the kernels that access them.
+class PromoteWorkgroupBuffers
+    : public impl::PromoteWorkgroupBuffersPassBase<PromoteWorkgroupBuffers> {
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::memref::AllocOp> allocs;
+    getOperation().walk([&](mlir::memref::AllocOp alloc) {
+      if (IsWorkgroupMemRef(alloc.getType())) allocs.push_back(alloc);
+    });
+    for (mlir::memref::AllocOp alloc : allocs) {
+      if (mlir::failed(PromoteToWorkgroupAttribution(alloc))) {
+        signalPassFailure();
+        return;
+      }
+    }
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreatePromoteWorkgroupBuffersPass() {
+  return std::make_unique<PromoteWorkgroupBuffers>();
+}
+
+}  // namespace sair
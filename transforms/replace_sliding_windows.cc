@@ -0,0 +1,387 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include "mlir/Analysis/AliasAnalysis.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/AffineExpr.h"
+#include "mlir/IR/AffineMap.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "statistics_report.h"
+#include "transforms/memory_effects.h"
+
+namespace sair {
+
+#define GEN_PASS_DEF_REPLACESLIDINGWINDOWSPASS
+#include "transforms/lowering.h.inc"
+
+namespace {
+
+// Expresses indices computed in the body of a loop as affine expressions of
+// the induction variable, mapped to the first dimension, and of values defined
+// outside of the loop, each mapped to another dimension.
+class IndexExprBuilder {
+ public:
+  explicit IndexExprBuilder(mlir::scf::ForOp for_op) : for_op_(for_op) {
+    leaves_.push_back(for_op.getInductionVar());
+    exprs_[for_op.getInductionVar()] = induction_var();
+  }
+
+  // Returns the expression of `value` or std::nullopt if `value` is not an
+  // affine function of the induction variable and of loop-invariant values.
+  std::optional<mlir::AffineExpr> Get(mlir::Value value);
+
+  // Dimension standing for the induction variable.
+  mlir::AffineExpr induction_var() const {
+    return mlir::getAffineDimExpr(0, for_op_.getContext());
+  }
+
+  // Simplifies `expr` and returns it if it is a constant.
+  std::optional<int64_t> GetConstant(mlir::AffineExpr expr) const {
+    auto constant =
+        mlir::simplifyAffineExpr(expr, leaves_.size(), 0)
+            .dyn_cast<mlir::AffineConstantExpr>();
+    if (constant == nullptr) return std::nullopt;
+    return constant.getValue();
+  }
+
+ private:
+  std::optional<mlir::AffineExpr> Compute(mlir::Value value);
+
+  mlir::scf::ForOp for_op_;
+  llvm::SmallVector<mlir::Value> leaves_;
+  llvm::DenseMap<mlir::Value, std::optional<mlir::AffineExpr>> exprs_;
+};
+
+std::optional<mlir::AffineExpr> IndexExprBuilder::Get(mlir::Value value) {
+  auto it = exprs_.find(value);
+  if (it != exprs_.end()) return it->second;
+  std::optional<mlir::AffineExpr> expr = Compute(value);
+  exprs_[value] = expr;
+  return expr;
+}
+
+std::optional<mlir::AffineExpr> IndexExprBuilder::Compute(mlir::Value value) {
+  mlir::MLIRContext *context = for_op_.getContext();
+  llvm::APInt constant;
+  if (mlir::matchPattern(value, mlir::m_ConstantInt(&constant))) {
+    return mlir::getAffineConstantExpr(constant.getSExtValue(), context);
+  }
+  if (for_op_.isDefinedOutsideOfLoop(value)) {
+    leaves_.push_back(value);
+    return mlir::getAffineDimExpr(leaves_.size() - 1, context);
+  }
+  mlir::Operation *op = value.getDefiningOp();
+  if (op == nullptr) return std::nullopt;
+
+  llvm::SmallVector<mlir::AffineExpr> operands;
+  for (mlir::Value operand : op->getOperands()) {
+    std::optional<mlir::AffineExpr> expr = Get(operand);
+    if (!expr.has_value()) return std::nullopt;
+    operands.push_back(*expr);
+  }
+  return llvm::TypeSwitch<mlir::Operation *, std::optional<mlir::AffineExpr>>(
+             op)
+      .Case([&](mlir::arith::AddIOp) { return operands[0] + operands[1]; })
+      .Case([&](mlir::arith::SubIOp) { return operands[0] - operands[1]; })
+      .Case([&](mlir::arith::MulIOp) -> std::optional<mlir::AffineExpr> {
+        // Keep expressions affine.
+        if (!operands[0].isa<mlir::AffineConstantExpr>() &&
+            !operands[1].isa<mlir::AffineConstantExpr>()) {
+          return std::nullopt;
+        }
+        return operands[0] * operands[1];
+      })
+      .Case([&](mlir::affine::AffineApplyOp apply) {
+        mlir::AffineMap map = apply.getAffineMap();
+        llvm::ArrayRef<mlir::AffineExpr> all_operands = operands;
+        return map.getResult(0).replaceDimsAndSymbols(
+            all_operands.take_front(map.getNumDims()),
+            all_operands.drop_front(map.getNumDims()));
+      })
+      .Default([](mlir::Operation *) { return std::nullopt; });
+}
+
+// Loads of a memref along a dimension that slides by `increment` elements at
+// each iteration of a loop.
+struct Window {
+  mlir::Value memref;
+  int dimension;
+  int64_t increment;
+  // Indices of the first load of the window.
+  llvm::SmallVector<mlir::AffineExpr> indices;
+  // Loads of the window, indexed by their offset along `dimension` relative to
+  // the first load. The first load of each offset comes first.
+  std::map<int64_t, llvm::SmallVector<mlir::memref::LoadOp>> loads;
+};
+
+// Adds `load` to the window it belongs to, creating a new window if needed.
+// Leaves `windows` unchanged if indices of `load` are not affine or do not
+// slide along exactly one dimension.
+void AddToWindow(mlir::memref::LoadOp load, int64_t step,
+                 IndexExprBuilder &builder,
+                 llvm::SmallVector<Window> &windows) {
+  llvm::SmallVector<mlir::AffineExpr> indices;
+  std::optional<int> dimension;
+  int64_t increment = 0;
+  mlir::AffineExpr iv = builder.induction_var();
+  for (auto [pos, index] : llvm::enumerate(load.getIndices())) {
+    std::optional<mlir::AffineExpr> expr = builder.Get(index);
+    if (!expr.has_value()) return;
+    indices.push_back(*expr);
+    if (!expr->isFunctionOfDim(0)) continue;
+    std::optional<int64_t> index_increment =
+        builder.GetConstant(expr->replace(iv, iv + step) - *expr);
+    if (dimension.has_value() || !index_increment.has_value() ||
+        *index_increment == 0) {
+      return;
+    }
+    dimension = pos;
+    increment = *index_increment;
+  }
+  if (!dimension.has_value()) return;
+
+  for (Window &window : windows) {
+    if (window.memref != load.getMemRef() || window.dimension != *dimension ||
+        window.increment != increment) {
+      continue;
+    }
+    std::optional<int64_t> offset;
+    bool same_window = true;
+    for (int i = 0, e = indices.size(); i < e; ++i) {
+      std::optional<int64_t> difference =
+          builder.GetConstant(indices[i] - window.indices[i]);
+      if (!difference.has_value() || (i != *dimension && *difference != 0)) {
+        same_window = false;
+        break;
+      }
+      if (i == *dimension) offset = difference;
+    }
+    if (!same_window) continue;
+    window.loads[*offset].push_back(load);
+    return;
+  }
+
+  Window &window = windows.emplace_back();
+  window.memref = load.getMemRef();
+  window.dimension = *dimension;
+  window.increment = increment;
+  window.indices = std::move(indices);
+  window.loads[0].push_back(load);
+}
+
+// Collects memrefs written or freed in the body of `for_op`. Returns false if
+// an operation of the body has unknown effects.
+bool CollectWrittenMemRefs(mlir::scf::ForOp for_op,
+                           llvm::SmallVector<mlir::Value> &written) {
+  mlir::WalkResult result = for_op.getBody()->walk([&](mlir::Operation *op) {
+    if (op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>()) {
+      return mlir::WalkResult::advance();
+    }
+    auto effect_interface = dyn_cast<mlir::MemoryEffectOpInterface>(op);
+    if (effect_interface == nullptr) return mlir::WalkResult::interrupt();
+    llvm::SmallVector<mlir::MemoryEffects::EffectInstance> effects;
+    effect_interface.getEffects(effects);
+    for (const auto &effect : effects) {
+      if (!isa<mlir::MemoryEffects::Write, mlir::MemoryEffects::Free>(
+              effect.getEffect())) {
+        continue;
+      }
+      if (effect.getValue() == nullptr) return mlir::WalkResult::interrupt();
+      written.push_back(effect.getValue());
+    }
+    return mlir::WalkResult::advance();
+  });
+  return !result.wasInterrupted();
+}
+
+// Keeps the elements of sliding windows loaded in the innermost loop `for_op`
+// in values carried by the loop, so that each element is only loaded once.
+// Returns the number of loads removed from the loop body.
+int ReplaceWindows(mlir::scf::ForOp for_op,
+                   mlir::AliasAnalysis &alias_analysis) {
+  llvm::APInt step;
+  if (!mlir::matchPattern(for_op.getStep(), mlir::m_ConstantInt(&step))) {
+    return 0;
+  }
+  llvm::SmallVector<mlir::Value> written;
+  if (!CollectWrittenMemRefs(for_op, written)) return 0;
+
+  // Only consider loads executed at each iteration.
+  mlir::Block *old_body = for_op.getBody();
+  IndexExprBuilder index_builder(for_op);
+  llvm::SmallVector<Window> windows;
+  for (auto load : old_body->getOps<mlir::memref::LoadOp>()) {
+    if (!load.getType().isIntOrIndexOrFloat() ||
+        !IsReadOnly(load.getMemRef(), written, alias_analysis)) {
+      continue;
+    }
+    AddToWindow(load, step.getSExtValue(), index_builder, windows);
+  }
+
+  // A load whose element is loaded by another load of its window at the
+  // previous iteration takes its value from the loop. Loads of the same
+  // element in one iteration are replaced by the first one.
+  int num_removed_loads = 0;
+  llvm::SmallVector<mlir::memref::LoadOp> carried_loads, next_loads;
+  for (Window &window : windows) {
+    for (auto &[offset, loads] : window.loads) {
+      for (mlir::memref::LoadOp load : llvm::drop_begin(loads)) {
+        load.replaceAllUsesWith(loads.front().getResult());
+        load.erase();
+        ++num_removed_loads;
+      }
+      auto next = window.loads.find(offset + window.increment);
+      if (next == window.loads.end()) continue;
+      carried_loads.push_back(loads.front());
+      next_loads.push_back(next->second.front());
+    }
+  }
+  if (carried_loads.empty()) return num_removed_loads;
+
+  // Load the elements of the first iteration before the loop, unless the loop
+  // is empty. The values yielded for empty loops are never used.
+  llvm::SmallPtrSet<mlir::Operation *, 8> first_iteration_ops;
+  llvm::SmallVector<mlir::Operation *> worklist(carried_loads.begin(),
+                                                carried_loads.end());
+  while (!worklist.empty()) {
+    mlir::Operation *op = worklist.pop_back_val();
+    if (!first_iteration_ops.insert(op).second) continue;
+    for (mlir::Value operand : op->getOperands()) {
+      mlir::Operation *definition = operand.getDefiningOp();
+      if (definition != nullptr && definition->getBlock() == old_body) {
+        worklist.push_back(definition);
+      }
+    }
+  }
+
+  mlir::OpBuilder builder(for_op);
+  mlir::Location loc = for_op.getLoc();
+  mlir::Value non_empty = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::slt, for_op.getLowerBound(),
+      for_op.getUpperBound());
+  auto first_iteration = builder.create<mlir::scf::IfOp>(
+      loc, non_empty,
+      [&](mlir::OpBuilder &then_builder, mlir::Location) {
+        mlir::IRMapping mapping;
+        mapping.map(for_op.getInductionVar(), for_op.getLowerBound());
+        for (mlir::Operation &op : *old_body) {
+          if (!first_iteration_ops.contains(&op)) continue;
+          then_builder.clone(op, mapping);
+        }
+        llvm::SmallVector<mlir::Value> values;
+        for (mlir::memref::LoadOp load : carried_loads) {
+          values.push_back(mapping.lookup(load.getResult()));
+        }
+        then_builder.create<mlir::scf::YieldOp>(loc, values);
+      },
+      [&](mlir::OpBuilder &else_builder, mlir::Location) {
+        llvm::SmallVector<mlir::Value> values;
+        for (mlir::memref::LoadOp load : carried_loads) {
+          values.push_back(else_builder.create<mlir::arith::ConstantOp>(
+              loc, else_builder.getZeroAttr(load.getType())));
+        }
+        else_builder.create<mlir::scf::YieldOp>(loc, values);
+      });
+
+  // Create a loop carrying the windows and move the body into it.
+  llvm::SmallVector<mlir::Value> inits = llvm::to_vector(for_op.getInitArgs());
+  llvm::append_range(inits, first_iteration.getResults());
+  auto new_loop = builder.create<mlir::scf::ForOp>(
+      loc, for_op.getLowerBound(), for_op.getUpperBound(), for_op.getStep(),
+      inits);
+  mlir::Block *body = new_loop.getBody();
+  body->getOperations().splice(body->end(), old_body->getOperations());
+  for (auto [old_arg, new_arg] :
+       llvm::zip(old_body->getArguments(), body->getArguments())) {
+    old_arg.replaceAllUsesWith(new_arg);
+  }
+
+  // Rotate windows: the element a load reads in the next iteration is the one
+  // the next load of its window reads in the current iteration.
+  int first_arg = 1 + for_op.getNumRegionIterArgs();
+  llvm::DenseMap<mlir::Operation *, mlir::Value> carried_values;
+  for (auto [pos, load] : llvm::enumerate(carried_loads)) {
+    carried_values[load] = body->getArgument(first_arg + pos);
+  }
+  mlir::Operation *yield = body->getTerminator();
+  for (mlir::memref::LoadOp next : next_loads) {
+    mlir::Value value = carried_values.lookup(next);
+    if (value == nullptr) value = next.getResult();
+    yield->insertOperands(yield->getNumOperands(), value);
+  }
+  for (mlir::memref::LoadOp load : carried_loads) {
+    load.replaceAllUsesWith(carried_values[load]);
+    load.erase();
+  }
+  num_removed_loads += carried_loads.size();
+
+  for (auto [old_result, new_result] :
+       llvm::zip(for_op.getResults(), new_loop.getResults())) {
+    old_result.replaceAllUsesWith(new_result);
+  }
+  for_op.erase();
+  return num_removed_loads;
+}
+
+// Keeps sliding windows of innermost loops in registers.
+class ReplaceSlidingWindows
+    : public impl::ReplaceSlidingWindowsPassBase<ReplaceSlidingWindows> {
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::scf::ForOp> loops;
+    getOperation().walk([&](mlir::scf::ForOp op) {
+      bool is_innermost = true;
+      op.getBody()->walk([&](mlir::LoopLikeOpInterface) {
+        is_innermost = false;
+        return mlir::WalkResult::interrupt();
+      });
+      if (is_innermost) loops.push_back(op);
+    });
+    mlir::AliasAnalysis &alias_analysis = getAnalysis<mlir::AliasAnalysis>();
+    for (mlir::scf::ForOp loop : loops) {
+      num_removed_loads += ReplaceWindows(loop, alias_analysis);
+    }
+  }
+
+ private:
+  // Number of loads replaced by loop-carried values.
+  PassCounter num_removed_loads{"num-removed-loads"};
+};
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateReplaceSlidingWindowsPass() {
+  return std::make_unique<ReplaceSlidingWindows>();
+}
+
+}  // namespace sair
@@ -14,7 +14,11 @@
 
 #include "transforms/sair_from_linalg.h"
 
+#include <string>
+
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
 #include "mlir/Dialect/Linalg/Utils/Utils.h"
@@ -26,8 +30,10 @@
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LLVM.h"
+#include "expansion.h"
 #include "sair_attributes.h"
 #include "sair_dialect.h"
 #include "sair_ops.h"
@@ -172,24 +178,37 @@ void CreateSairDomain(mlir::Location loc, llvm::ArrayRef<LoopBound> dimensions,
 // "indexing_maps". Uses "sair_to_linalg_loops" to reshuffle the dimensions so
 // that reduction loops always come last, as expected by Sair. This map is
 // expected to be a bijective map between Sair loop order and Linalg loop order.
+// Operands whose indexing maps are not projected permutations, such as
+// convolution inputs, cannot be expressed with Sair mappings. They are marked
+// in "windowed_operands" and given an identity mapping: they are loaded into a
+// value with the shape of the iteration domain by EmitWindowedOperand.
 // Additionally, computes the mapping from value subscripts to surrounding loops
 // and returns it in "subscripts_to_loops". If there is no subscript
 // corresponding to a loop, return failure.
 mlir::LogicalResult ConvertOperandMappings(
     mlir::ArrayAttr indexing_maps, mlir::AffineMap sair_to_linalg_loops,
     llvm::SmallVectorImpl<mlir::Attribute> &operand_mappings,
+    llvm::SmallBitVector &windowed_operands,
     mlir::AffineMap &subscripts_to_loops) {
   // Affine maps are straightforwardly converted to mappings. Also
   // accumulate the maps extracted from the attribute.
+  mlir::MLIRContext *context = indexing_maps.getContext();
   int num_operands = indexing_maps.size();
   operand_mappings.reserve(num_operands);
+  windowed_operands.resize(num_operands);
   llvm::SmallVector<mlir::AffineMap, 4> loops_to_subscripts;
   loops_to_subscripts.reserve(num_operands);
-  for (mlir::Attribute attr : indexing_maps.getValue()) {
+  for (auto [pos, attr] : llvm::enumerate(indexing_maps.getValue())) {
     mlir::AffineMap indexing = attr.cast<AffineMapAttr>().getValue();
     indexing = indexing.compose(sair_to_linalg_loops);
-    operand_mappings.push_back(MappingAttr::FromAffineMap(indexing));
     loops_to_subscripts.push_back(indexing);
+    if (indexing.isProjectedPermutation()) {
+      operand_mappings.push_back(MappingAttr::FromAffineMap(indexing));
+      continue;
+    }
+    windowed_operands.set(pos);
+    operand_mappings.push_back(
+        MappingAttr::GetIdentity(context, indexing.getNumDims()));
   }
 
   // Concatenate all maps and try to invert them. The inversion only works for
@@ -200,6 +219,9 @@ mlir::LogicalResult ConvertOperandMappings(
     return mlir::failure();
   }
   subscripts_to_loops = mlir::inversePermutation(loops_to_all_subscripts);
+  if (!subscripts_to_loops) {
+    return mlir::failure();
+  }
   return mlir::success();
 }
 
@@ -232,10 +254,13 @@ mlir::LogicalResult ConvertResultMappings(
 // "rewriter" to create operations and positioning them at "loc". Stores the
 // results in "map_operands". The last "num_outputs" operands are treated as
 // in/out operands and their ranges are stored in "result_ranges" for further
-// use, e.g. to convert them back to MemRefs. Non-Sair operations will be
-// created before "sair_program".
+// use, e.g. to convert them back to MemRefs. Operands marked in
+// "windowed_operands" are converted to 0-dimensional values holding the MemRef,
+// to be loaded by EmitWindowedOperand. Non-Sair operations will be created
+// before "sair_program".
 void EmitMemRefToValue(
-    mlir::ValueRange operands, int num_outputs, mlir::Location loc,
+    mlir::ValueRange operands, int num_outputs,
+    const llvm::SmallBitVector &windowed_operands, mlir::Location loc,
     SairProgramOp sair_program, StorageAnalysis &storage_analysis,
     mlir::OpBuilder &rewriter, llvm::SmallVectorImpl<mlir::Value> &map_operands,
     llvm::SmallVectorImpl<llvm::SmallVector<mlir::Value, 4>> &result_ranges) {
@@ -251,6 +276,14 @@ void EmitMemRefToValue(
     int position = en.index();
     mlir::Value operand = en.value();
     auto type = operand.getType().cast<mlir::ShapedType>();
+    auto memref_value_type =
+        ValueType::get(DomainShapeAttr::get(context), type);
+    if (windowed_operands.test(position)) {
+      assert(position < num_inputs);
+      map_operands.push_back(
+          rewriter.create<SairFromScalarOp>(loc, memref_value_type, operand));
+      continue;
+    }
 
     llvm::SmallVector<LoopBound, 4> bounds = LoopBoundsOnShapedType(operand);
     llvm::SmallVector<mlir::Value> ranges;
@@ -260,15 +293,13 @@ void EmitMemRefToValue(
     auto value_type = ValueType::get(domain_shape, type.getElementType());
     auto mappings = rewriter.getArrayAttr(
         {MappingAttr::GetIdentity(context, 0, type.getRank())});
-    auto memref_value_type =
-        ValueType::get(DomainShapeAttr::get(context), type);
 
     auto from_scalar =
         rewriter.create<SairFromScalarOp>(loc, memref_value_type, operand);
     Value new_operand = rewriter.create<SairFromMemRefOp>(
         loc, value_type, mlir::ValueRange(), ranges, mappings, from_scalar,
         storage_analysis.GetFreshBufferName(), /*instances=*/nullptr,
-        /*copies=*/nullptr);
+        /*copies=*/nullptr, /*prefetch=*/nullptr);
     // Insert a copy to avoid storage specification mismatch.
     // TODO(b/181850491): introduce a sair.maybe_copy operation instead.
     auto copy_mapping = rewriter.getArrayAttr(
@@ -322,7 +353,7 @@ void EmitValueToMemRef(mlir::Location loc, SairProgramOp program,
         loc, mlir::ValueRange(), ranges[i], mapping_array, from_scalar,
         sair_values[i], shape, storage_analysis.GetFreshBufferName(),
         /*instances=*/nullptr,
-        /*copies=*/nullptr);
+        /*copies=*/nullptr, /*nontemporal=*/nullptr);
   }
 }
 
@@ -394,13 +425,54 @@ void SegmentPermutation(int num_first, int num_second,
   }
 }
 
+// Emits a sair.map loading, at each point of the iteration domain "domain" of
+// shape "domain_shape", the element of "memref" accessed by "indexing".
+// "memref" is a 0-dimensional value holding the MemRef of an operand whose
+// indexing map is not a projected permutation, such as a convolution input.
+// Returns the loaded value, that has the shape of the iteration domain and is
+// thus accessed with an identity mapping. The map is given the same
+// "instances" as the operation consuming the value, so that their loops are
+// fused.
+mlir::Value EmitWindowedOperand(mlir::Location loc, mlir::Value memref,
+                                mlir::AffineMap indexing,
+                                mlir::ValueRange domain,
+                                DomainShapeAttr domain_shape,
+                                mlir::ArrayAttr instances,
+                                mlir::OpBuilder &rewriter) {
+  mlir::MLIRContext *context = rewriter.getContext();
+  auto memref_type = memref.getType()
+                         .cast<ValueType>()
+                         .ElementType()
+                         .cast<mlir::MemRefType>();
+  int num_dims = domain_shape.NumDimensions();
+  ValueAccess input = {memref, MappingAttr::get(context, num_dims, {})};
+  auto map_op = rewriter.create<SairMapOp>(
+      loc, ValueType::get(domain_shape, memref_type.getElementType()), domain,
+      input, domain_shape, instances, /*copies=*/nullptr);
+
+  mlir::OpBuilder::InsertionGuard raii(rewriter);
+  mlir::Block &body = map_op.block();
+  rewriter.setInsertionPointToStart(&body);
+  mlir::ValueRange loop_indices = body.getArguments().take_front(num_dims);
+  llvm::SmallVector<mlir::Value, 4> indices;
+  indices.reserve(indexing.getNumResults());
+  for (mlir::AffineExpr expr : indexing.getResults()) {
+    auto map = mlir::AffineMap::get(num_dims, /*symbolCount=*/0, expr, context);
+    indices.push_back(rewriter.create<mlir::affine::AffineApplyOp>(
+        loc, map, loop_indices));
+  }
+  mlir::Value element = rewriter.create<mlir::memref::LoadOp>(
+      loc, map_op.block_inputs().front(), indices);
+  rewriter.create<SairReturnOp>(loc, element);
+  return map_op.getResult(0);
+}
+
 // Moves the body region of "source_op" into "target_region" using "rewriter" to
-// keep track of changes. The region is cleared of its existing content.
+// keep track of changes. The region is cleared of its existing content. Both
+// generic and named Linalg operations carry their body in a region.
 void MoveBodyBlock(mlir::AffineMap linalg_to_sair_loops,
                    mlir::OpBuilder &rewriter, mlir::Region &target_region,
                    mlir::linalg::LinalgOp source_op) {
-  assert(isa<mlir::linalg::GenericOp>(source_op.getOperation()));
-
   mlir::Region &source_region = source_op.getOperation()->getRegion(0);
   target_region.getBlocks().clear();
   target_region.getBlocks().splice(target_region.begin(),
@@ -514,7 +586,7 @@ mlir::Operation *CreateMapReduceOp(
     mlir::ValueRange domain, mlir::ValueRange linalg_operands,
     llvm::ArrayRef<mlir::Attribute> operand_mappings,
     DomainShapeAttr domain_shape, int num_reduction_loops, int num_outputs,
-    mlir::OpBuilder &rewriter) {
+    mlir::ArrayAttr instances, mlir::OpBuilder &rewriter) {
   // Split domain and operand lists into reduction and parallel parts.
   mlir::ValueRange parallel_domain = domain.drop_back(num_reduction_loops);
   mlir::ValueRange reduction_domain = domain.take_back(num_reduction_loops);
@@ -530,14 +602,116 @@ mlir::Operation *CreateMapReduceOp(
 
   return rewriter.create<SairMapReduceOp>(
       loc, result_types, parallel_domain, reduction_domain, mappings_attr,
-      init_operands, input_operands, domain_shape,
-      /*decisions=*/nullptr, /*copies=*/nullptr);
+      init_operands, input_operands, domain_shape, instances,
+      /*copies=*/nullptr, /*split_factor=*/nullptr);
 }
 
-// Rewrites Linalg generic operation into a semantically equivalent sequence of
-// Sair operations. This sequence contains conversions between MemRefs and Sair
-// values and a Sair map or map_reduce operation.
+// Creates a loop nest for an operation with the given "domain_shape", whose
+// last "num_reduction_dims" dimensions are reduction dimensions. Parallel
+// dimensions larger than "tile_size" are tiled, with tile loops surrounding
+// point loops. Reduction dimensions are iterated on by the innermost loops.
+mlir::ArrayAttr CreateTiledLoopNest(DomainShapeAttr domain_shape,
+                                    int num_reduction_dims, int tile_size) {
+  mlir::MLIRContext *context = domain_shape.getContext();
+  int num_dims = domain_shape.NumDimensions();
+  int num_parallel_dims = num_dims - num_reduction_dims;
+
+  llvm::SmallVector<MappingExpr, 8> iters;
+  llvm::SmallVector<bool, 8> is_tiled;
+  for (int i = 0; i < num_parallel_dims; ++i) {
+    auto range =
+        domain_shape.Dimension(i).type().dyn_cast<StaticRangeType>();
+    is_tiled.push_back(range == nullptr || range.size() > tile_size);
+    if (!is_tiled.back()) continue;
+    iters.push_back(
+        MappingStripeExpr::get(MappingDimExpr::get(i, context), {tile_size}));
+  }
+  for (int i = 0; i < num_dims; ++i) {
+    MappingExpr dim_expr = MappingDimExpr::get(i, context);
+    if (i < num_parallel_dims && is_tiled[i]) {
+      iters.push_back(MappingStripeExpr::get(dim_expr, {tile_size, 1}));
+    } else {
+      iters.push_back(dim_expr);
+    }
+  }
+
+  llvm::SmallVector<mlir::Attribute, 8> loop_nest;
+  loop_nest.reserve(iters.size());
+  for (auto [pos, iter] : llvm::enumerate(iters)) {
+    auto name = mlir::StringAttr::get(context, "loop_" + std::to_string(pos));
+    loop_nest.push_back(LoopAttr::get(name, iter, /*unroll=*/nullptr,
+                                      /*parallel=*/nullptr, /*gpu=*/nullptr,
+                                      /*accumulators=*/nullptr,
+                                      /*peel=*/nullptr, context));
+  }
+  return mlir::ArrayAttr::get(context, loop_nest);
+}
+
+// Returns the function called in place of "op" by the libcall expansion
+// pattern, or nullptr if there is none. The "library_call" attribute of "op"
+// must name a function declaration, taking the operands of "op" and without
+// results, whose "sair.microkernel" attribute refers to the microkernel
+// implementing it.
+mlir::func::FuncOp GetLibraryCall(mlir::linalg::LinalgOp op) {
+  auto name = op->getAttrOfType<mlir::StringAttr>("library_call");
+  if (name == nullptr) return nullptr;
+  auto callee = mlir::SymbolTable::lookupNearestSymbolFrom<mlir::func::FuncOp>(
+      op, mlir::FlatSymbolRefAttr::get(name));
+  if (callee == nullptr || !callee.isExternal() ||
+      !callee->hasAttr(kMicrokernelAttrName)) {
+    return nullptr;
+  }
+  mlir::FunctionType type = callee.getFunctionType();
+  if (type.getNumResults() != 0 ||
+      !llvm::equal(type.getInputs(), op->getOperandTypes())) {
+    return nullptr;
+  }
+  return callee;
+}
+
+// Rewrites "op" into a 0-dimensional sair.map calling "callee" on the entire
+// operand MemRefs. The map is expanded with the libcall pattern, so that the
+// microkernel registered for "callee" implements the operation.
+void RewriteLinalgToLibcall(mlir::linalg::LinalgOp op,
+                            mlir::func::FuncOp callee,
+                            mlir::OpBuilder &rewriter) {
+  mlir::MLIRContext *context = op.getContext();
+  mlir::Location loc = op.getLoc();
+  auto sair_program = rewriter.create<SairProgramOp>(loc);
+  rewriter.setInsertionPointToStart(&sair_program.getBody().front());
+
+  auto empty_shape = DomainShapeAttr::get(context);
+  llvm::SmallVector<ValueAccess> inputs;
+  for (mlir::Value operand : op->getOperands()) {
+    auto type = ValueType::get(empty_shape, operand.getType());
+    inputs.push_back({rewriter.create<SairFromScalarOp>(loc, type, operand),
+                      MappingAttr::get(context, 0, {})});
+  }
+  auto decisions = DecisionsAttr::get(
+      /*sequence=*/nullptr, /*loop_nest=*/rewriter.getArrayAttr({}),
+      /*storage=*/nullptr,
+      /*expansion=*/rewriter.getStringAttr(kLibcallExpansionPattern),
+      /*copy_of=*/nullptr, /*operands=*/nullptr, context);
+  auto map_op = rewriter.create<SairMapOp>(
+      loc, mlir::TypeRange(), mlir::ValueRange(), inputs, empty_shape,
+      rewriter.getArrayAttr({decisions}), /*copies=*/nullptr);
+  {
+    mlir::OpBuilder::InsertionGuard raii(rewriter);
+    rewriter.setInsertionPointToStart(&map_op.block());
+    rewriter.create<mlir::func::CallOp>(loc, callee, map_op.block_inputs());
+    rewriter.create<SairReturnOp>(loc, mlir::ValueRange());
+  }
+  rewriter.create<SairExitOp>(loc);
+  op.erase();
+}
+
+// Rewrites Linalg operation into a semantically equivalent sequence of Sair
+// operations. This sequence contains conversions between MemRefs and Sair
+// values and a Sair map or map_reduce operation. Named Linalg operations are
+// given a loop nest tiling parallel dimensions by "tile_size", unless it is
+// zero.
 mlir::LogicalResult RewriteLinalgToSair(mlir::linalg::LinalgOp op,
+                                        int tile_size,
                                         mlir::OpBuilder &rewriter) {
   mlir::MLIRContext *context = op.getContext();
   // Only support Linalg on memrefs.
@@ -545,6 +719,20 @@ mlir::LogicalResult RewriteLinalgToSair(mlir::linalg::LinalgOp op,
     return mlir::failure();
   }
 
+  // Scalar operands, as in linalg.fill, are not supported.
+  if (!llvm::all_of(op->getOperandTypes(), [](mlir::Type type) {
+        return type.isa<mlir::MemRefType>();
+      })) {
+    return mlir::failure();
+  }
+
+  // Operations with a library call implemented by a microkernel are executed
+  // by a single call on their entire operands.
+  if (mlir::func::FuncOp callee = GetLibraryCall(op)) {
+    RewriteLinalgToLibcall(op, callee, rewriter);
+    return mlir::success();
+  }
+
   // Linalg operations with outlined body are not supported.
   mlir::Operation *operation = op.getOperation();
   if (operation->getNumRegions() != 1 || operation->getRegion(0).empty()) {
@@ -565,10 +753,11 @@ mlir::LogicalResult RewriteLinalgToSair(mlir::linalg::LinalgOp op,
   // Convert Linalg indexing maps to Sair mappings and keep track of the
   // mapping between value access subscripts and iteration domain dimensions.
   llvm::SmallVector<mlir::Attribute, 4> operand_mappings;
+  llvm::SmallBitVector windowed_operands;
   mlir::AffineMap subscripts_to_loops;
-  if (mlir::failed(
-          ConvertOperandMappings(op.getIndexingMaps(), sair_to_linalg_loops,
-                                 operand_mappings, subscripts_to_loops))) {
+  if (mlir::failed(ConvertOperandMappings(
+          op.getIndexingMaps(), sair_to_linalg_loops, operand_mappings,
+          windowed_operands, subscripts_to_loops))) {
     return mlir::failure();
   }
 
@@ -577,6 +766,9 @@ mlir::LogicalResult RewriteLinalgToSair(mlir::linalg::LinalgOp op,
   int num_parallel_loops = op.getNumParallelLoops();
   int num_operands = op->getNumOperands();
   for (int i = op.getNumDpsInputs(); i < num_operands; ++i) {
+    if (windowed_operands.test(i)) {
+      return mlir::failure();
+    }
     auto mapping = operand_mappings[i].cast<MappingAttr>();
     if (mlir::failed(VerifyReductionMapping(mapping, num_parallel_loops))) {
       return mlir::failure();
@@ -604,8 +796,9 @@ mlir::LogicalResult RewriteLinalgToSair(mlir::linalg::LinalgOp op,
   llvm::SmallVector<mlir::Value, 4> map_operands;
   llvm::SmallVector<llvm::SmallVector<mlir::Value, 4>, 4> result_ranges;
   llvm::SmallVector<mlir::Value> operands = op->getOperands();
-  EmitMemRefToValue(operands, op.getNumDpsInits(), loc, sair_program,
-                    storage_analysis, rewriter, map_operands, result_ranges);
+  EmitMemRefToValue(operands, op.getNumDpsInits(), windowed_operands, loc,
+                    sair_program, storage_analysis, rewriter, map_operands,
+                    result_ranges);
 
   // Prepare parameters of the Sair map operation.
   int num_loops = op.getNumLoops();
@@ -627,6 +820,26 @@ mlir::LogicalResult RewriteLinalgToSair(mlir::linalg::LinalgOp op,
         outputOperand->get().getType().cast<MemRefType>());
   CreateResultTypes(rewriter, result_shape, outputBufferTypes, result_types);
 
+  // Named operations have a known structure and are given a tiled loop nest.
+  mlir::ArrayAttr instances;
+  if (tile_size > 0 && !isa<mlir::linalg::GenericOp>(operation)) {
+    mlir::ArrayAttr loop_nest =
+        CreateTiledLoopNest(domain_shape, num_reduction_dims, tile_size);
+    instances = rewriter.getArrayAttr({DecisionsAttr::get(
+        /*sequence=*/nullptr, loop_nest, /*storage=*/nullptr,
+        /*expansion=*/nullptr, /*copy_of=*/nullptr, /*operands=*/nullptr,
+        context)});
+  }
+
+  // Load windowed operands into values with the shape of the domain.
+  for (int position : windowed_operands.set_bits()) {
+    mlir::AffineMap indexing =
+        op.getIndexingMapsArray()[position].compose(sair_to_linalg_loops);
+    map_operands[position] =
+        EmitWindowedOperand(loc, map_operands[position], indexing,
+                            domain_ranges, domain_shape, instances, rewriter);
+  }
+
   // Check that all operands shapes match.
   for (auto [value, mapping] : llvm::zip(map_operands, operand_mappings)) {
     DomainShapeAttr shape = value.getType().cast<ValueType>().Shape();
@@ -640,13 +853,13 @@ mlir::LogicalResult RewriteLinalgToSair(mlir::linalg::LinalgOp op,
   if (num_reduction_dims == 0) {
     map_op = rewriter.create<SairMapOp>(loc, result_types, domain_ranges,
                                         rewriter.getArrayAttr(operand_mappings),
-                                        map_operands, domain_shape,
-                                        /*decisions=*/nullptr,
+                                        map_operands, domain_shape, instances,
                                         /*copies=*/nullptr);
   } else {
-    map_op = CreateMapReduceOp(
-        loc, result_types, domain_ranges, map_operands, operand_mappings,
-        domain_shape, num_reduction_dims, op.getNumDpsInits(), rewriter);
+    map_op = CreateMapReduceOp(loc, result_types, domain_ranges, map_operands,
+                               operand_mappings, domain_shape,
+                               num_reduction_dims, op.getNumDpsInits(),
+                               instances, rewriter);
   }
   MoveBodyBlock(linalg_to_sair_loops, rewriter, map_op->getRegion(0), op);
 
@@ -666,7 +879,7 @@ mlir::LogicalResult RewriteLinalgToSair(mlir::linalg::LinalgOp op,
 #define GEN_PASS_DEF_SAIRFROMLINALGPASS
 #include "transforms/sair_from_linalg.h.inc"
 
-// A pass converting Linalg (indexed) generic operations to Sair equivalents in
+// A pass converting Linalg generic and named operations to Sair equivalents in
 // the given function.
 class LinalgToSairConversion
     : public impl::SairFromLinalgPassBase<LinalgToSairConversion> {
@@ -678,11 +891,11 @@ class LinalgToSairConversion
 void LinalgToSairConversion::runOnOperation() {
   mlir::MLIRContext *context = &getContext();
 
-  // Replace all suitable Linalg generic operations in a function.
+  // Replace all suitable Linalg operations in a function.
   getOperation().walk([context, this](mlir::linalg::LinalgOp op) {
     mlir::OpBuilder builder(context);
     builder.setInsertionPoint(op);
-    if (mlir::failed(sair::RewriteLinalgToSair(op, builder))) {
+    if (mlir::failed(sair::RewriteLinalgToSair(op, tile_size, builder))) {
       mlir::emitError(op.getLoc()) << "Linalg op is not compatible with Sair";
       signalPassFailure();
     }
@@ -0,0 +1,258 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/AffineExpr.h"
+#include "mlir/IR/AffineMap.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/LoopInvariantCodeMotionUtils.h"
+#include "statistics_report.h"
+
+namespace sair {
+
+#define GEN_PASS_DEF_STRENGTHREDUCEINDICESPASS
+#include "transforms/lowering.h.inc"
+
+namespace {
+
+// Returns how much the result of `map` increases when each of its operands
+// increases by the corresponding element of `operand_increments`, or
+// std::nullopt if the increase depends on the value of the operands.
+std::optional<int64_t> GetIncrement(
+    mlir::AffineMap map, llvm::ArrayRef<int64_t> operand_increments) {
+  mlir::MLIRContext *context = map.getContext();
+  int num_dims = map.getNumDims();
+  int num_symbols = map.getNumSymbols();
+
+  // Substitute each operand `x` by `x + increment * t`, where `t` is a new
+  // dimension, and compute the difference between `t + 1` and `t`.
+  mlir::AffineExpr t = mlir::getAffineDimExpr(num_dims, context);
+  llvm::SmallVector<mlir::AffineExpr> dims, symbols;
+  for (int i = 0; i < num_dims; ++i) {
+    dims.push_back(mlir::getAffineDimExpr(i, context) +
+                   t * operand_increments[i]);
+  }
+  for (int i = 0; i < num_symbols; ++i) {
+    symbols.push_back(mlir::getAffineSymbolExpr(i, context) +
+                      t * operand_increments[num_dims + i]);
+  }
+  mlir::AffineExpr expr =
+      map.getResult(0).replaceDimsAndSymbols(dims, symbols);
+  mlir::AffineExpr difference = mlir::simplifyAffineExpr(
+      expr.replace(t, t + 1) - expr, num_dims + 1, num_symbols);
+  auto constant = difference.dyn_cast<mlir::AffineConstantExpr>();
+  if (constant == nullptr) return std::nullopt;
+  return constant.getValue();
+}
+
+// Returns how much the index computed by `op` increases at each iteration of
+// `for_op`, given the increments of the values of the loop body computed so
+// far. Values defined outside of the loop do not increase. Returns
+// std::nullopt if `op` does not compute an index or if its increase is not
+// constant.
+std::optional<int64_t> GetIncrement(
+    mlir::Operation *op, mlir::scf::ForOp for_op,
+    const llvm::DenseMap<mlir::Value, int64_t> &increments) {
+  if (op->getNumRegions() != 0 || op->getNumResults() != 1 ||
+      !op->getResult(0).getType().isIndex()) {
+    return std::nullopt;
+  }
+  llvm::SmallVector<int64_t> operand_increments;
+  for (mlir::Value operand : op->getOperands()) {
+    if (for_op.isDefinedOutsideOfLoop(operand)) {
+      operand_increments.push_back(0);
+      continue;
+    }
+    auto it = increments.find(operand);
+    if (it == increments.end()) return std::nullopt;
+    operand_increments.push_back(it->second);
+  }
+
+  llvm::ArrayRef<int64_t> inc = operand_increments;
+  return llvm::TypeSwitch<mlir::Operation *, std::optional<int64_t>>(op)
+      .Case([&](mlir::arith::AddIOp) { return inc[0] + inc[1]; })
+      .Case([&](mlir::arith::SubIOp) { return inc[0] - inc[1]; })
+      .Case([&](mlir::arith::MulIOp mul) -> std::optional<int64_t> {
+        llvm::APInt factor;
+        if (inc[1] == 0 &&
+            mlir::matchPattern(mul.getRhs(), mlir::m_ConstantInt(&factor))) {
+          return inc[0] * factor.getSExtValue();
+        }
+        if (inc[0] == 0 &&
+            mlir::matchPattern(mul.getLhs(), mlir::m_ConstantInt(&factor))) {
+          return inc[1] * factor.getSExtValue();
+        }
+        return std::nullopt;
+      })
+      .Case([&](mlir::affine::AffineApplyOp apply) {
+        return GetIncrement(apply.getAffineMap(), inc);
+      })
+      .Default([](mlir::Operation *) { return std::nullopt; });
+}
+
+// Returns the number of arithmetic operations `op` performs once lowered.
+int NumArithOps(mlir::Operation *op) {
+  auto apply = dyn_cast<mlir::affine::AffineApplyOp>(op);
+  if (apply == nullptr) return 1;
+  int num_ops = 0;
+  apply.getAffineMap().getResult(0).walk([&](mlir::AffineExpr expr) {
+    if (expr.isa<mlir::AffineBinaryOpExpr>()) ++num_ops;
+  });
+  return num_ops;
+}
+
+// Hoists loop-invariant computations out of `for_op` and replaces indices that
+// increase by a constant at each iteration, and that take more than one
+// operation to compute, by values carried by the loop and incremented at each
+// iteration. Indices computed before nested loops start are thus in turn
+// strength-reduced when processing outer loops. Returns the number of indices
+// replaced.
+int ReduceLoopIndices(mlir::scf::ForOp for_op) {
+  mlir::moveLoopInvariantCode(
+      cast<mlir::LoopLikeOpInterface>(for_op.getOperation()));
+
+  // Find indices computed from the induction variable.
+  llvm::DenseMap<mlir::Value, int64_t> increments;
+  llvm::DenseMap<mlir::Value, int> costs;
+  llvm::SmallVector<mlir::Operation *> index_ops;
+  llvm::SmallPtrSet<mlir::Operation *, 8> index_ops_set;
+  increments[for_op.getInductionVar()] = 1;
+  for (mlir::Operation &op : for_op.getBody()->without_terminator()) {
+    std::optional<int64_t> increment = GetIncrement(&op, for_op, increments);
+    if (!increment.has_value()) continue;
+    int cost = NumArithOps(&op);
+    for (mlir::Value operand : op.getOperands()) cost += costs.lookup(operand);
+    increments[op.getResult(0)] = *increment;
+    costs[op.getResult(0)] = cost;
+    index_ops.push_back(&op);
+    index_ops_set.insert(&op);
+  }
+
+  // Only replace indices used by other operations. Indices that do not change
+  // are left to loop-invariant code motion.
+  llvm::SmallVector<mlir::Operation *> reduced_ops;
+  for (mlir::Operation *op : index_ops) {
+    mlir::Value result = op->getResult(0);
+    if (increments[result] == 0 || costs[result] <= 1) continue;
+    if (llvm::any_of(result.getUsers(), [&](mlir::Operation *user) {
+          return !index_ops_set.contains(user);
+        })) {
+      reduced_ops.push_back(op);
+    }
+  }
+  if (reduced_ops.empty()) return 0;
+
+  // Compute the value of indices in the first iteration and their increments.
+  mlir::OpBuilder builder(for_op);
+  mlir::Location loc = for_op.getLoc();
+  mlir::IRMapping first_iteration;
+  first_iteration.map(for_op.getInductionVar(), for_op.getLowerBound());
+  llvm::SmallVector<mlir::Operation *> first_iteration_ops;
+  for (mlir::Operation *op : index_ops) {
+    first_iteration_ops.push_back(builder.clone(*op, first_iteration));
+  }
+  llvm::SmallVector<mlir::Value> inits = llvm::to_vector(for_op.getInitArgs());
+  llvm::SmallVector<mlir::Value> steps;
+  for (mlir::Operation *op : reduced_ops) {
+    mlir::Value result = op->getResult(0);
+    inits.push_back(first_iteration.lookup(result));
+    mlir::Value step = for_op.getStep();
+    if (increments[result] != 1) {
+      auto factor = builder.create<mlir::arith::ConstantIndexOp>(
+          loc, increments[result]);
+      step = builder.create<mlir::arith::MulIOp>(loc, step, factor);
+    }
+    steps.push_back(step);
+  }
+  for (mlir::Operation *op : llvm::reverse(first_iteration_ops)) {
+    if (op->use_empty()) op->erase();
+  }
+
+  // Create a loop carrying the indices and move the body into it.
+  auto new_loop = builder.create<mlir::scf::ForOp>(
+      loc, for_op.getLowerBound(), for_op.getUpperBound(), for_op.getStep(),
+      inits);
+  mlir::Block *body = new_loop.getBody();
+  body->getOperations().splice(body->end(),
+                               for_op.getBody()->getOperations());
+  for (auto [old_arg, new_arg] :
+       llvm::zip(for_op.getBody()->getArguments(), body->getArguments())) {
+    old_arg.replaceAllUsesWith(new_arg);
+  }
+
+  mlir::Operation *yield = body->getTerminator();
+  builder.setInsertionPoint(yield);
+  int first_arg = 1 + for_op.getNumRegionIterArgs();
+  for (auto [pos, op] : llvm::enumerate(reduced_ops)) {
+    mlir::Value index = body->getArgument(first_arg + pos);
+    op->getResult(0).replaceAllUsesWith(index);
+    mlir::Value next_index =
+        builder.create<mlir::arith::AddIOp>(loc, index, steps[pos]);
+    yield->insertOperands(yield->getNumOperands(), next_index);
+  }
+  for (mlir::Operation *op : llvm::reverse(index_ops)) {
+    if (op->use_empty()) op->erase();
+  }
+
+  for (auto [old_result, new_result] :
+       llvm::zip(for_op.getResults(), new_loop.getResults())) {
+    old_result.replaceAllUsesWith(new_result);
+  }
+  for_op.erase();
+  return reduced_ops.size();
+}
+
+// Hoists invariant index computations out of loops and replaces indices that
+// are affine functions of induction variables by loop-carried values.
+class StrengthReduceIndices
+    : public impl::StrengthReduceIndicesPassBase<StrengthReduceIndices> {
+  void runOnOperation() override {
+    // Process inner loops first so that the indices they start from are
+    // strength-reduced by enclosing loops.
+    llvm::SmallVector<mlir::scf::ForOp> loops;
+    getOperation().walk([&](mlir::scf::ForOp op) { loops.push_back(op); });
+    for (mlir::scf::ForOp loop : loops) {
+      num_reduced_indices += ReduceLoopIndices(loop);
+    }
+  }
+
+ private:
+  // Number of indices replaced by loop-carried values.
+  PassCounter num_reduced_indices{"num-reduced-indices"};
+};
+
+}  // namespace
+
+std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
+CreateStrengthReduceIndicesPass() {
+  return std::make_unique<StrengthReduceIndices>();
+}
+
+}  // namespace sair
@@ -14,11 +14,19 @@
 
 #include "util.h"
 
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/APInt.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/MathExtras.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/IR/BuiltinAttributeInterfaces.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/IR/OperationSupport.h"
 #include "sair_op_interfaces.h"
 #include "sair_ops.h"
@@ -229,4 +237,89 @@ mlir::Value MapBodyBuilder::AddOperand(ValueAccess operand) {
   return block().addArgument(value_type.ElementType(), operand.value.getLoc());
 }
 
+std::optional<int64_t> GetMaxTripCount(RangeOp range, bool &is_exact) {
+  is_exact = true;
+  int64_t step = range.Step();
+  ValueOrConstant lower_bound = range.LowerBound();
+  ValueOrConstant upper_bound = range.UpperBound();
+  if (upper_bound.is_constant()) {
+    if (!lower_bound.is_constant()) return std::nullopt;
+    int64_t size = upper_bound.constant().cast<mlir::IntegerAttr>().getInt() -
+                   lower_bound.constant().cast<mlir::IntegerAttr>().getInt();
+    return llvm::divideCeil(size, step);
+  }
+
+  // Look for stripe bounds computed by a sair.map operation returning `begin`
+  // and `min(begin + size, end)`, as created by `GetRangeParameters`.
+  if (!lower_bound.is_value() ||
+      lower_bound.value().mapping != upper_bound.value().mapping) {
+    return std::nullopt;
+  }
+  auto lower_result = lower_bound.value().value.cast<mlir::OpResult>();
+  auto upper_result = upper_bound.value().value.cast<mlir::OpResult>();
+  auto map_op = dyn_cast<SairMapOp>(upper_result.getOwner());
+  if (map_op == nullptr || lower_result.getOwner() != map_op) {
+    return std::nullopt;
+  }
+
+  mlir::Operation *terminator = map_op.block().getTerminator();
+  mlir::Value begin = terminator->getOperand(lower_result.getResultNumber());
+  mlir::Value end = terminator->getOperand(upper_result.getResultNumber());
+  if (auto select = end.getDefiningOp<mlir::arith::SelectOp>()) {
+    is_exact = false;
+    end = select.getFalseValue();
+  }
+  auto add = end.getDefiningOp<mlir::arith::AddIOp>();
+  if (add == nullptr) return std::nullopt;
+  mlir::Value size = add.getLhs() == begin ? add.getRhs() : add.getLhs();
+  llvm::APInt size_value;
+  if ((add.getLhs() != begin && add.getRhs() != begin) ||
+      !mlir::matchPattern(size, mlir::m_ConstantInt(&size_value))) {
+    return std::nullopt;
+  }
+  return llvm::divideCeil(size_value.getSExtValue(), step);
+}
+
+mlir::TypedAttr GetReductionIdentity(mlir::Operation *combiner) {
+  if (combiner->getNumOperands() != 2 || combiner->getNumResults() != 1) {
+    return nullptr;
+  }
+  mlir::Type type = combiner->getResult(0).getType();
+  if (!type.isIntOrIndexOrFloat()) return nullptr;
+
+  auto float_attr = [&](bool one) -> mlir::TypedAttr {
+    const llvm::fltSemantics &semantics =
+        type.cast<mlir::FloatType>().getFloatSemantics();
+    // -0.0 is the neutral element of floating-point additions.
+    return mlir::FloatAttr::get(
+        type, one ? llvm::APFloat::getOne(semantics)
+                  : llvm::APFloat::getZero(semantics, /*Negative=*/true));
+  };
+  unsigned width = type.isIndex() ? mlir::IndexType::kInternalStorageBitWidth
+                                  : type.getIntOrFloatBitWidth();
+  auto int_attr = [&](llvm::APInt value) -> mlir::TypedAttr {
+    return mlir::IntegerAttr::get(type, value);
+  };
+  llvm::APInt zero = llvm::APInt::getZero(width);
+  llvm::APInt all_ones = llvm::APInt::getAllOnes(width);
+
+  return llvm::TypeSwitch<mlir::Operation *, mlir::TypedAttr>(combiner)
+      .Case([&](mlir::arith::AddFOp) { return float_attr(false); })
+      .Case([&](mlir::arith::MulFOp) { return float_attr(true); })
+      .Case<mlir::arith::AddIOp, mlir::arith::OrIOp, mlir::arith::XOrIOp,
+            mlir::arith::MaxUIOp>([&](auto) { return int_attr(zero); })
+      .Case([&](mlir::arith::MulIOp) {
+        return int_attr(llvm::APInt(width, 1));
+      })
+      .Case<mlir::arith::AndIOp, mlir::arith::MinUIOp>(
+          [&](auto) { return int_attr(all_ones); })
+      .Case([&](mlir::arith::MaxSIOp) {
+        return int_attr(llvm::APInt::getSignedMinValue(width));
+      })
+      .Case([&](mlir::arith::MinSIOp) {
+        return int_attr(llvm::APInt::getSignedMaxValue(width));
+      })
+      .Default([](mlir::Operation *) { return nullptr; });
+}
+
 }  // namespace sair
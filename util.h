@@ -15,6 +15,9 @@
 #ifndef THIRD_PARTY_SAIR_TRANSFORMS_UTIL_H_
 #define THIRD_PARTY_SAIR_TRANSFORMS_UTIL_H_
 
+#include <cstdint>
+#include <optional>
+
 #include "mlir/IR/Builders.h"
 #include "sair_attributes.h"
 #include "sair_op_interfaces.h"
@@ -120,6 +123,17 @@ llvm::SmallVector<RangeParameters> GetRangeParameters(
     llvm::ArrayRef<ValueAccess> source_domain, MappingAttr current_to_source,
     MapBodyBuilder &current_body, mlir::OpBuilder &builder);
 
+// Returns an upper bound of the number of iterations of the loop spanning
+// `range` if it is a constant. Sets `is_exact` to false if some instances of
+// the range may have fewer iterations, as for the last tile of a stripe that
+// does not divide its range.
+std::optional<int64_t> GetMaxTripCount(RangeOp range, bool &is_exact);
+
+// Returns the neutral element of the reduction performed by `combiner` or
+// nullptr if `combiner` is not a supported associative and commutative
+// operation.
+mlir::TypedAttr GetReductionIdentity(mlir::Operation *combiner);
+
 }  // namespace sair
 
 #endif  // THIRD_PARTY_SAIR_TRANSFORMS_UTIL_H_